@@ -0,0 +1,40 @@
+#pragma once
+
+#include "fw/Application.h"
+#include "fw/Buffer.h"
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <vector>
+
+class AllocatorStressApp : public fw::Application
+{
+public:
+    AllocatorStressApp(){};
+    virtual ~AllocatorStressApp(){};
+    AllocatorStressApp(const AllocatorStressApp&) = delete;
+    AllocatorStressApp(AllocatorStressApp&&) = delete;
+    AllocatorStressApp& operator=(const AllocatorStressApp&) = delete;
+    AllocatorStressApp& operator=(AllocatorStressApp&&) = delete;
+
+    virtual bool initialize() final;
+    virtual void update() final;
+    virtual void onGUI() final{};
+    virtual void postUpdate() final{};
+
+private:
+    struct BufferInfo
+    {
+        VkDeviceSize size;
+        VkBufferUsageFlags usage;
+        VkMemoryPropertyFlags properties;
+    };
+
+    std::vector<BufferInfo> m_bufferInfos;
+    std::vector<std::unique_ptr<fw::Buffer>> m_buffers;
+
+    void createBufferInfos();
+    bool runSubAllocated();
+    bool runDirectAllocations();
+};
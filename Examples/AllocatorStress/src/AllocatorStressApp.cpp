@@ -0,0 +1,189 @@
+#include "AllocatorStressApp.h"
+#include "fw/API.h"
+#include "fw/Allocator.h"
+#include "fw/Common.h"
+#include "fw/Context.h"
+#include "fw/Macros.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+namespace
+{
+const size_t c_numBuffers = 10000;
+const VkDeviceSize c_minBufferSize = 256;
+const VkDeviceSize c_maxBufferSize = 64 * 1024;
+// Leave room for the allocations made by the framework itself
+const uint32_t c_reservedAllocationCount = 64;
+
+class Timer
+{
+public:
+    Timer() :
+        m_start(std::chrono::steady_clock::now()) {}
+
+    double getMilliseconds() const
+    {
+        std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - m_start;
+        return duration.count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+void printTiming(const char* name, double milliseconds, size_t count)
+{
+    std::cout << name << ": " << milliseconds << " ms (" << milliseconds * 1000.0 / static_cast<double>(count) << " us per buffer)\n";
+}
+
+} // unnamed
+
+bool AllocatorStressApp::initialize()
+{
+    fw::API::setRenderingEnabled(false);
+
+    createBufferInfos();
+    CHECK(runSubAllocated());
+    CHECK(runDirectAllocations());
+
+    return true;
+}
+
+void AllocatorStressApp::update()
+{
+    fw::API::quitApplication();
+}
+
+void AllocatorStressApp::createBufferInfos()
+{
+    const std::vector<VkBufferUsageFlags> usages = {
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT};
+    const std::vector<VkMemoryPropertyFlags> properties = {
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+
+    std::default_random_engine randomEngine;
+    std::uniform_int_distribution<VkDeviceSize> sizeDistribution(c_minBufferSize, c_maxBufferSize);
+    std::uniform_int_distribution<size_t> usageDistribution(0, usages.size() - 1);
+    std::uniform_int_distribution<size_t> propertyDistribution(0, properties.size() - 1);
+
+    m_bufferInfos.resize(c_numBuffers);
+    for (BufferInfo& info : m_bufferInfos)
+    {
+        info.size = sizeDistribution(randomEngine);
+        info.usage = usages[usageDistribution(randomEngine)];
+        info.properties = properties[propertyDistribution(randomEngine)];
+    }
+}
+
+bool AllocatorStressApp::runSubAllocated()
+{
+    std::cout << "Sub-allocated, " << c_numBuffers << " buffers\n";
+
+    auto createBuffer = [this](size_t index) {
+        const BufferInfo& info = m_bufferInfos[index];
+        m_buffers[index] = std::make_unique<fw::Buffer>();
+        return m_buffers[index]->create(info.size, info.usage, info.properties);
+    };
+
+    m_buffers.resize(c_numBuffers);
+    Timer createTimer;
+    for (size_t i = 0; i < c_numBuffers; ++i)
+    {
+        if (!createBuffer(i))
+        {
+            return false;
+        }
+    }
+    printTiming("Create", createTimer.getMilliseconds(), c_numBuffers);
+
+    // Destroy a random half to leave holes in the blocks
+    std::vector<size_t> indices(c_numBuffers);
+    for (size_t i = 0; i < c_numBuffers; ++i)
+    {
+        indices[i] = i;
+    }
+    std::shuffle(indices.begin(), indices.end(), std::default_random_engine());
+    indices.resize(c_numBuffers / 2);
+
+    Timer destroyHalfTimer;
+    for (size_t index : indices)
+    {
+        m_buffers[index].reset();
+    }
+    printTiming("Destroy half", destroyHalfTimer.getMilliseconds(), indices.size());
+    fw::Allocator::printStats();
+
+    Timer recreateTimer;
+    for (size_t index : indices)
+    {
+        if (!createBuffer(index))
+        {
+            return false;
+        }
+    }
+    printTiming("Recreate half", recreateTimer.getMilliseconds(), indices.size());
+    fw::Allocator::printStats();
+
+    Timer destroyTimer;
+    m_buffers.clear();
+    printTiming("Destroy all", destroyTimer.getMilliseconds(), c_numBuffers);
+    fw::Allocator::printStats();
+
+    return true;
+}
+
+bool AllocatorStressApp::runDirectAllocations()
+{
+    VkDevice logicalDevice = fw::Context::getLogicalDevice();
+    uint32_t maxAllocations = fw::Context::getPhysicalDeviceProperties()->limits.maxMemoryAllocationCount;
+    size_t count = std::min(c_numBuffers, static_cast<size_t>(maxAllocations - c_reservedAllocationCount));
+
+    std::cout << "vkAllocateMemory per buffer, " << count << " buffers (maxMemoryAllocationCount " << maxAllocations << ")\n";
+
+    std::vector<VkBuffer> buffers(count, VK_NULL_HANDLE);
+    std::vector<VkDeviceMemory> memories(count, VK_NULL_HANDLE);
+
+    Timer createTimer;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const BufferInfo& info = m_bufferInfos[i];
+
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = info.size;
+        bufferInfo.usage = info.usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        VK_CHECK(vkCreateBuffer(logicalDevice, &bufferInfo, nullptr, &buffers[i]));
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(logicalDevice, buffers[i], &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        if (!fw::findMemoryType(memRequirements.memoryTypeBits, info.properties, allocInfo.memoryTypeIndex))
+        {
+            return false;
+        }
+        VK_CHECK(vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &memories[i]));
+        VK_CHECK(vkBindBufferMemory(logicalDevice, buffers[i], memories[i], 0));
+    }
+    printTiming("Create", createTimer.getMilliseconds(), count);
+
+    Timer destroyTimer;
+    for (size_t i = 0; i < count; ++i)
+    {
+        vkDestroyBuffer(logicalDevice, buffers[i], nullptr);
+        vkFreeMemory(logicalDevice, memories[i], nullptr);
+    }
+    printTiming("Destroy all", destroyTimer.getMilliseconds(), count);
+
+    return true;
+}
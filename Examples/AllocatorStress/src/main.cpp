@@ -0,0 +1,7 @@
+#include "AllocatorStressApp.h"
+#include "fw/Execute.h"
+
+int main(int argc, char** argv)
+{
+    return fw::runApplication<AllocatorStressApp>(argc, argv);
+}
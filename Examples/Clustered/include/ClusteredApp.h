@@ -8,12 +8,16 @@
 #include "fw/Buffer.h"
 #include "fw/Camera.h"
 #include "fw/CameraController.h"
+#include "fw/DescriptorAllocator.h"
+#include "fw/RingBuffer.h"
 #include "fw/Sampler.h"
 #include "fw/Texture.h"
 #include "fw/Transformation.h"
+#include "fw/UploadBatch.h"
 
 #include <glm/glm.hpp>
 
+#include <array>
 #include <vector>
 
 class ClusteredApp : public fw::Application
@@ -25,7 +29,6 @@ public:
         fw::Buffer indexBuffer;
         uint32_t numIndices;
         fw::Texture texture;
-        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
     };
 
     ClusteredApp(){};
@@ -52,17 +55,21 @@ private:
     fw::CameraController m_cameraController;
     fw::Transformation m_transformation;
     Matrices m_matrices;
-    fw::Buffer m_matrixBuffer;
-    fw::Buffer m_sceneBuffer;
+    // The matrices and the scene info of every frame, read by both the culling and the shading
+    fw::RingBuffer m_uniformRing;
     std::vector<RenderObject> m_renderObjects;
+    // The larger mip levels of the textures, one level of every texture per frame
+    fw::UploadBatch m_streamingBatch;
+    bool m_texturesResident = false;
 
+    // Only for the GUI, the shading sets are transient
     VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
-    std::vector<VkDescriptorSet> m_descriptorSets;
+    fw::DescriptorAllocator m_descriptorAllocator;
 
     ClusteredCompute m_clusteredCompute;
     fw::Buffer m_lightStorageBuffer;
-    fw::Buffer m_tileStorageBuffer;
-    fw::Buffer m_numLightsPertileStorageBuffer;
+    std::array<fw::Buffer, c_tileBufferCount> m_tileStorageBuffers;
+    std::array<fw::Buffer, c_tileBufferCount> m_numLightsPertileStorageBuffers;
 
     DebugDraw m_debugDraw;
 
@@ -72,7 +79,7 @@ private:
     void createPipeline();
     void createDescriptorPool();
     void createRenderObjects();
-    void createDescriptorSets(uint32_t setCount);
-    void updateDescriptorSet(VkDescriptorSet descriptorSet, VkImageView imageView);
-    void createCommandBuffers();
+    void updateDescriptorSet(VkDescriptorSet descriptorSet, VkImageView imageView, uint32_t bufferIndex);
+    void streamTextures();
+    void updateCommandBuffer(const UniformOffsets& uniformOffsets, uint32_t bufferIndex);
 };
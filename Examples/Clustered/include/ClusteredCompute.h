@@ -3,9 +3,13 @@
 #include "Helpers.h"
 
 #include "fw/Buffer.h"
+#include "fw/Constants.h"
+#include "fw/DescriptorAllocator.h"
 
 #include <vulkan/vulkan.h>
 
+#include <array>
+
 class ClusteredCompute
 {
 public:
@@ -13,6 +17,9 @@ public:
     ~ClusteredCompute();
 
     bool initialize(const Buffers& buffers);
+    // Switches to the other light grid and submits its culling for the frame, call before the frame is rendered
+    void update(const UniformOffsets& uniformOffsets);
+    uint32_t getBufferIndex() const;
 
 private:
     VkDevice m_logicalDevice = VK_NULL_HANDLE;
@@ -22,12 +29,16 @@ private:
 
     Buffers m_buffers;
 
-    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
-    VkDescriptorSet m_descriptorSet;
+    fw::DescriptorAllocator m_descriptorAllocator;
+    std::array<VkDescriptorSet, c_tileBufferCount> m_descriptorSets{};
+    // Recorded every frame with the uniform offsets of the frame, one per frame in flight
+    std::array<VkCommandBuffer, fw::Constants::maxFramesInFlight> m_commandBuffers{};
+    uint32_t m_bufferIndex = 0;
 
     void writeRandomData();
     void createDescriptorSetLayout();
     void createCullingPipeline();
     void createDescriptorSets();
     void createCommandBuffers();
+    void updateCommandBuffer(const UniformOffsets& uniformOffsets);
 };
@@ -9,11 +9,12 @@ public:
     ~DebugDraw(){};
 
     void initialize(const Buffers& buffers);
-    void writeImages(const Matrices& matrices);
+    // Reads the light grid at the given buffer index, the caller makes sure that the GPU is not writing to it
+    void writeImages(const Matrices& matrices, uint32_t bufferIndex);
 
 private:
     Buffers m_buffers;
 
     void writeLights(const Matrices& matrices);
-    void writeTiles();
+    void writeTiles(uint32_t bufferIndex);
 };
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <fw/Buffer.h>
+#include <fw/RingBuffer.h>
 
 #include <glm/glm.hpp>
 
@@ -29,13 +30,19 @@ struct SceneInfo
     uint32_t maxLightsPerTile;
 };
 
+// The light grid is double buffered so that the culling of the next frame can run on the compute queue while the
+// current frame is shaded
+const uint32_t c_tileBufferCount = 2;
+
+// Dynamic offsets of the matrices and the scene info in the uniform ring, in binding order
+using UniformOffsets = std::array<uint32_t, 2>;
+
 struct Buffers
 {
-    fw::Buffer* matrixBuffer;
-    fw::Buffer* sceneBuffer;
+    fw::RingBuffer* uniformRing;
     fw::Buffer* lightBuffer;
-    fw::Buffer* tileBuffer;
-    fw::Buffer* numLightsPerTileBuffer;
+    std::array<fw::Buffer*, c_tileBufferCount> tileBuffers;
+    std::array<fw::Buffer*, c_tileBufferCount> numLightsPerTileBuffers;
 };
 
 const std::string c_assetsFolder = ASSETS_PATH;
@@ -3,11 +3,15 @@
 #include "fw/Command.h"
 #include "fw/Common.h"
 #include "fw/Context.h"
+#include "fw/DescriptorLayoutCache.h"
 #include "fw/Macros.h"
 #include "fw/Mesh.h"
 #include "fw/Model.h"
 #include "fw/Pipeline.h"
+#include "fw/Profiler.h"
 #include "fw/RenderPass.h"
+#include "fw/ShaderModuleCache.h"
+#include "fw/UploadBatch.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <vulkan/vulkan.h>
@@ -20,7 +24,6 @@ ClusteredApp::~ClusteredApp()
     vkDestroyDescriptorPool(m_logicalDevice, m_descriptorPool, nullptr);
     vkDestroyPipeline(m_logicalDevice, m_graphicsPipeline, nullptr);
     vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
-    vkDestroyDescriptorSetLayout(m_logicalDevice, m_descriptorSetLayout, nullptr);
     vkDestroyRenderPass(m_logicalDevice, m_renderPass, nullptr);
 }
 
@@ -38,7 +41,6 @@ bool ClusteredApp::initialize()
     createDescriptorPool();
     createRenderObjects();
     success = success && fw::API::initializeGUI(m_descriptorPool);
-    createCommandBuffers();
 
     CHECK(success);
 
@@ -52,7 +54,12 @@ bool ClusteredApp::initialize()
     m_matrices.proj = m_camera.getProjectionMatrix();
     m_matrices.inverseProj = glm::inverse(m_camera.getProjectionMatrix());
 
-    Buffers buffers{&m_matrixBuffer, &m_sceneBuffer, &m_lightStorageBuffer, &m_tileStorageBuffer, &m_numLightsPertileStorageBuffer};
+    Buffers buffers{&m_uniformRing, &m_lightStorageBuffer, {}, {}};
+    for (uint32_t i = 0; i < c_tileBufferCount; ++i)
+    {
+        buffers.tileBuffers[i] = &m_tileStorageBuffers[i];
+        buffers.numLightsPerTileBuffers[i] = &m_numLightsPertileStorageBuffers[i];
+    }
     m_clusteredCompute.initialize(buffers);
 
     m_debugDraw.initialize(buffers);
@@ -68,19 +75,28 @@ void ClusteredApp::update()
     m_cameraController.update();
     m_matrices.view = m_camera.getViewMatrix();
 
-    m_matrixBuffer.setData(sizeof(m_matrices), &m_matrices);
-
     SceneInfo sceneInfo;
     sceneInfo.ncp = m_camera.getNearClipDistance();
     sceneInfo.fcp = m_camera.getFarClipDistance();
     sceneInfo.lightCount = c_numLights;
     sceneInfo.maxLightsPerTile = c_maxLightsPerTile;
-    m_sceneBuffer.setData(c_sceneInfoSize, &sceneInfo);
+
+    // The culling and the shading of earlier frames may still read their own regions of the ring
+    UniformOffsets uniformOffsets{};
+    CHECK(m_uniformRing.push(m_matrices, uniformOffsets[0]));
+    CHECK(m_uniformRing.push(sceneInfo, uniformOffsets[1]));
+
+    streamTextures();
+
+    m_clusteredCompute.update(uniformOffsets);
+    uint32_t bufferIndex = m_clusteredCompute.getBufferIndex();
+    updateCommandBuffer(uniformOffsets, bufferIndex);
 
     static int i = 0;
     if (++i == 5)
     {
-        m_debugDraw.writeImages(m_matrices);
+        // The grid culled for this frame was last written two frames ago, that frame has finished
+        m_debugDraw.writeImages(m_matrices, bufferIndex);
     }
 }
 
@@ -94,6 +110,13 @@ void ClusteredApp::onGUI()
     glm::vec3 p = m_camera.getTransformation().getPosition();
     ImGui::Text("Camera position: %.1f %.1f %.1f", p.x, p.y, p.z);
     ImGui::Text("%.2f ms/frame (%.0f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+    ImGui::Text("Compute queue: %s", fw::API::hasDedicatedComputeQueue() ? "dedicated" : "shared with graphics");
+
+    bool asyncCompute = fw::API::isAsyncComputeEnabled();
+    if (ImGui::Checkbox("Async compute", &asyncCompute))
+    {
+        fw::API::setAsyncCompute(asyncCompute);
+    }
 
 #ifndef WIN32
 #pragma GCC diagnostic pop
@@ -102,14 +125,19 @@ void ClusteredApp::onGUI()
 
 void ClusteredApp::createBuffers()
 {
+    // Room for the matrices and the scene info with the padding to align the second one
+    VkDeviceSize uniformAlignment = fw::Context::getPhysicalDeviceProperties()->limits.minUniformBufferOffsetAlignment;
+    CHECK(m_uniformRing.create(c_transformMatricesSize + uniformAlignment + c_sceneInfoSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, true));
+
     VkMemoryPropertyFlags uboProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    CHECK(m_matrixBuffer.create(c_transformMatricesSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
-    CHECK(m_sceneBuffer.create(c_sceneInfoSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
 
     VkBufferUsageFlags bufferUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-    CHECK(m_lightStorageBuffer.create(c_lightBufferSize, bufferUsage, uboProperties));
-    CHECK(m_tileStorageBuffer.create(c_tileBufferSize, bufferUsage, uboProperties));
-    CHECK(m_numLightsPertileStorageBuffer.create(c_numLightsPerTileBufferSize, bufferUsage, uboProperties));
+    CHECK(m_lightStorageBuffer.create(c_lightBufferSize, bufferUsage, uboProperties, true));
+    for (uint32_t i = 0; i < c_tileBufferCount; ++i)
+    {
+        CHECK(m_tileStorageBuffers[i].create(c_tileBufferSize, bufferUsage, uboProperties, true));
+        CHECK(m_numLightsPertileStorageBuffers[i].create(c_numLightsPerTileBufferSize, bufferUsage, uboProperties, true));
+    }
 }
 
 void ClusteredApp::createRenderPass()
@@ -156,7 +184,7 @@ void ClusteredApp::createDescriptorSetLayout()
 {
     VkDescriptorSetLayoutBinding uboBinding{};
     uboBinding.binding = 0;
-    uboBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    uboBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     uboBinding.descriptorCount = 1;
     uboBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
     uboBinding.pImmutableSamplers = nullptr; // Optional
@@ -191,7 +219,7 @@ void ClusteredApp::createDescriptorSetLayout()
 
     VkDescriptorSetLayoutBinding sceneUniformBinding{};
     sceneUniformBinding.binding = 5;
-    sceneUniformBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    sceneUniformBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     sceneUniformBinding.descriptorCount = 1;
     sceneUniformBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     sceneUniformBinding.pImmutableSamplers = nullptr; // Optional
@@ -203,12 +231,9 @@ void ClusteredApp::createDescriptorSetLayout()
         tileStorageBinding,
         numLightsPerTileStorageBinding,
         sceneUniformBinding};
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = fw::ui32size(bindings);
-    layoutInfo.pBindings = bindings.data();
-
-    VK_CHECK(vkCreateDescriptorSetLayout(m_logicalDevice, &layoutInfo, nullptr, &m_descriptorSetLayout));
+    // From the cache so that the transient sets can be allocated for it
+    m_descriptorSetLayout = fw::DescriptorLayoutCache::get(bindings);
+    CHECK(m_descriptorSetLayout != VK_NULL_HANDLE);
 }
 
 void ClusteredApp::createPipeline()
@@ -222,10 +247,10 @@ void ClusteredApp::createPipeline()
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(m_logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
@@ -263,24 +288,20 @@ void ClusteredApp::createPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
 }
 
 void ClusteredApp::createDescriptorPool()
 {
-    std::array<VkDescriptorPoolSize, 3> poolSizes{};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = 8;
-    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = 8;
-    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    poolSizes[2].descriptorCount = 8;
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount = 1;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = fw::ui32size(poolSizes);
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = 3;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 1;
 
     VK_CHECK(vkCreateDescriptorPool(m_logicalDevice, &poolInfo, nullptr, &m_descriptorPool));
 }
@@ -293,10 +314,10 @@ void ClusteredApp::createRenderObjects()
     fw::Model::Meshes meshes = model.getMeshes();
     uint32_t numMeshes = fw::ui32size(meshes);
 
-    createDescriptorSets(numMeshes);
-
     m_renderObjects.resize(numMeshes);
 
+    // All the meshes and textures are uploaded with a single submit
+    fw::UploadBatch uploadBatch;
     bool success = true;
     for (unsigned int i = 0; i < numMeshes; ++i)
     {
@@ -304,40 +325,50 @@ void ClusteredApp::createRenderObjects()
         RenderObject& ro = m_renderObjects[i];
 
         success = success
-            && ro.vertexBuffer.createForDevice<fw::Mesh::Vertex>(mesh.getVertices(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
-            && ro.indexBuffer.createForDevice<uint32_t>(mesh.indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+            && ro.vertexBuffer.createVertexBuffer(mesh, fw::Mesh::VertexFormat::Full, uploadBatch)
+            && ro.indexBuffer.createForDevice<uint32_t>(mesh.indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, uploadBatch);
 
         ro.numIndices = fw::ui32size(mesh.indices);
 
+        // Only the small mip levels are uploaded here, the rest are streamed in while rendering
         std::string textureFile = c_assetsFolder + mesh.getFirstTextureOfType(aiTextureType::aiTextureType_DIFFUSE);
-        ro.texture.load(textureFile, VK_FORMAT_R8G8B8A8_UNORM);
-        updateDescriptorSet(m_descriptorSets[i], ro.texture.getImageView());
-        ro.descriptorSet = m_descriptorSets[i];
+        success = success && ro.texture.loadStreamed(textureFile, VK_FORMAT_R8G8B8A8_UNORM, uploadBatch);
     }
 
-    CHECK(success);
+    CHECK(success && uploadBatch.flush());
 }
 
-void ClusteredApp::createDescriptorSets(uint32_t setCount)
+void ClusteredApp::streamTextures()
 {
-    m_descriptorSets.resize(setCount);
-
-    std::vector<VkDescriptorSetLayout> layouts(setCount, m_descriptorSetLayout);
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = m_descriptorPool;
-    allocInfo.descriptorSetCount = setCount;
-    allocInfo.pSetLayouts = layouts.data();
+    // The frame never waits for the uploads, the next levels are submitted once the previous ones have finished
+    if (m_texturesResident || !m_streamingBatch.isFinished())
+    {
+        return;
+    }
+    CHECK(m_streamingBatch.wait());
 
-    VK_CHECK(vkAllocateDescriptorSets(m_logicalDevice, &allocInfo, m_descriptorSets.data()));
+    m_texturesResident = true;
+    for (RenderObject& ro : m_renderObjects)
+    {
+        CHECK(ro.texture.updateImageView());
+        if (!ro.texture.isFullyResident())
+        {
+            CHECK(ro.texture.streamNextMipLevel(m_streamingBatch));
+            m_texturesResident = false;
+        }
+    }
+    if (!m_texturesResident)
+    {
+        CHECK(m_streamingBatch.submit());
+    }
 }
 
-void ClusteredApp::updateDescriptorSet(VkDescriptorSet descriptorSet, VkImageView imageView)
+void ClusteredApp::updateDescriptorSet(VkDescriptorSet descriptorSet, VkImageView imageView, uint32_t bufferIndex)
 {
     std::array<VkWriteDescriptorSet, 6> descriptorWrites{};
 
     VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = m_matrixBuffer.getBuffer();
+    bufferInfo.buffer = m_uniformRing.getBuffer();
     bufferInfo.offset = 0;
     bufferInfo.range = c_transformMatricesSize;
 
@@ -345,7 +376,7 @@ void ClusteredApp::updateDescriptorSet(VkDescriptorSet descriptorSet, VkImageVie
     descriptorWrites[0].dstSet = descriptorSet;
     descriptorWrites[0].dstBinding = 0;
     descriptorWrites[0].dstArrayElement = 0;
-    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     descriptorWrites[0].descriptorCount = 1;
     descriptorWrites[0].pBufferInfo = &bufferInfo;
 
@@ -376,7 +407,7 @@ void ClusteredApp::updateDescriptorSet(VkDescriptorSet descriptorSet, VkImageVie
     descriptorWrites[2].pBufferInfo = &lightBufferInfo;
 
     VkDescriptorBufferInfo tileBufferInfo{};
-    tileBufferInfo.buffer = m_tileStorageBuffer.getBuffer();
+    tileBufferInfo.buffer = m_tileStorageBuffers[bufferIndex].getBuffer();
     tileBufferInfo.offset = 0;
     tileBufferInfo.range = c_tileBufferSize;
 
@@ -389,7 +420,7 @@ void ClusteredApp::updateDescriptorSet(VkDescriptorSet descriptorSet, VkImageVie
     descriptorWrites[3].pBufferInfo = &tileBufferInfo;
 
     VkDescriptorBufferInfo numLightsPerTileBufferInfo{};
-    numLightsPerTileBufferInfo.buffer = m_numLightsPertileStorageBuffer.getBuffer();
+    numLightsPerTileBufferInfo.buffer = m_numLightsPertileStorageBuffers[bufferIndex].getBuffer();
     numLightsPerTileBufferInfo.offset = 0;
     numLightsPerTileBufferInfo.range = c_numLightsPerTileBufferSize;
 
@@ -402,7 +433,7 @@ void ClusteredApp::updateDescriptorSet(VkDescriptorSet descriptorSet, VkImageVie
     descriptorWrites[4].pBufferInfo = &numLightsPerTileBufferInfo;
 
     VkDescriptorBufferInfo sceneBufferInfo{};
-    sceneBufferInfo.buffer = m_sceneBuffer.getBuffer();
+    sceneBufferInfo.buffer = m_uniformRing.getBuffer();
     sceneBufferInfo.offset = 0;
     sceneBufferInfo.range = c_sceneInfoSize;
 
@@ -410,29 +441,20 @@ void ClusteredApp::updateDescriptorSet(VkDescriptorSet descriptorSet, VkImageVie
     descriptorWrites[5].dstSet = descriptorSet;
     descriptorWrites[5].dstBinding = 5;
     descriptorWrites[5].dstArrayElement = 0;
-    descriptorWrites[5].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorWrites[5].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     descriptorWrites[5].descriptorCount = 1;
     descriptorWrites[5].pBufferInfo = &sceneBufferInfo;
 
     vkUpdateDescriptorSets(m_logicalDevice, fw::ui32size(descriptorWrites), descriptorWrites.data(), 0, nullptr);
 }
 
-void ClusteredApp::createCommandBuffers()
+void ClusteredApp::updateCommandBuffer(const UniformOffsets& uniformOffsets, uint32_t bufferIndex)
 {
     const std::vector<VkFramebuffer>& swapChainFramebuffers = fw::API::getSwapChainFramebuffers();
-    std::vector<VkCommandBuffer> commandBuffers(swapChainFramebuffers.size());
-
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = fw::API::getCommandPool();
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = fw::ui32size(commandBuffers);
-
-    VK_CHECK(vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, commandBuffers.data()));
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     beginInfo.pInheritanceInfo = nullptr; // Optional
 
     std::array<VkClearValue, 2> clearValues{};
@@ -446,33 +468,36 @@ void ClusteredApp::createCommandBuffers()
     renderPassInfo.renderArea.extent = fw::API::getSwapChainExtent();
     renderPassInfo.clearValueCount = fw::ui32size(clearValues);
     renderPassInfo.pClearValues = clearValues.data();
+    renderPassInfo.framebuffer = swapChainFramebuffers[fw::API::getCurrentSwapChainImageIndex()];
 
     VkDeviceSize offsets[] = {0};
 
-    for (size_t i = 0; i < commandBuffers.size(); ++i)
-    {
-        VkCommandBuffer cb = commandBuffers[i];
-
-        vkBeginCommandBuffer(cb, &beginInfo);
+    VkCommandBuffer cb = fw::API::getCurrentFrameCommandBuffer();
+    VK_CHECK(vkBeginCommandBuffer(cb, &beginInfo));
 
-        renderPassInfo.framebuffer = swapChainFramebuffers[i];
+    fw::Profiler::beginScope(cb, "Clustered shading");
+    vkCmdBeginRenderPass(cb, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
 
-        vkCmdBeginRenderPass(cb, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
-
-        for (const RenderObject& ro : m_renderObjects)
-        {
-            VkBuffer vb = ro.vertexBuffer.getBuffer();
-            vkCmdBindVertexBuffers(cb, 0, 1, &vb, offsets);
-            vkCmdBindIndexBuffer(cb, ro.indexBuffer.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
-            vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &ro.descriptorSet, 0, nullptr);
-            vkCmdDrawIndexed(cb, ro.numIndices, 1, 0, 0, 0);
-        }
+    for (const RenderObject& ro : m_renderObjects)
+    {
+        VkBuffer vb = ro.vertexBuffer.getBuffer();
+        vkCmdBindVertexBuffers(cb, 0, 1, &vb, offsets);
+        vkCmdBindIndexBuffer(cb, ro.indexBuffer.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+        // Written every frame with the current texture view and the light grid that the culling of the frame writes
+        VkDescriptorSet descriptorSet;
+        CHECK(m_descriptorAllocator.allocateTransient(m_descriptorSetLayout, descriptorSet));
+        updateDescriptorSet(descriptorSet, ro.texture.getImageView(), bufferIndex);
+        vkCmdBindDescriptorSets(
+            cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &descriptorSet, fw::ui32size(uniformOffsets), uniformOffsets.data());
+        vkCmdDrawIndexed(cb, ro.numIndices, 1, 0, 0, 0);
+    }
 
-        vkCmdEndRenderPass(cb);
+    vkCmdEndRenderPass(cb);
+    fw::Profiler::endScope(cb, "Clustered shading");
 
-        VK_CHECK(vkEndCommandBuffer(cb));
-    }
+    VK_CHECK(vkEndCommandBuffer(cb));
 
-    fw::API::setCommandBuffers(commandBuffers);
+    fw::API::setNextCommandBuffer(cb);
 }
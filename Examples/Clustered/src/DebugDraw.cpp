@@ -1,6 +1,5 @@
 #include "DebugDraw.h"
 
-#include "fw/Context.h"
 #include "fw/API.h"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -17,17 +16,15 @@ void DebugDraw::initialize(const Buffers& buffers)
     m_buffers = buffers;
 }
 
-void DebugDraw::writeImages(const Matrices& matrices)
+void DebugDraw::writeImages(const Matrices& matrices, uint32_t bufferIndex)
 {
     writeLights(matrices);
-    writeTiles();
+    writeTiles(bufferIndex);
 }
 
 void DebugDraw::writeLights(const Matrices& matrices)
 {
-    void* mappedMemory = NULL;
-    VkDevice logicalDevice = fw::Context::getLogicalDevice();
-    vkMapMemory(logicalDevice, m_buffers.lightBuffer->getMemory(), 0, c_lightBufferSize, 0, &mappedMemory);
+    void* mappedMemory = m_buffers.lightBuffer->getMappedMemory();
     Light* lightMemory = (Light*)mappedMemory;
 
     VkExtent2D extent = fw::API::getSwapChainExtent();
@@ -58,20 +55,14 @@ void DebugDraw::writeLights(const Matrices& matrices)
 
     stbi_write_png(fileName.c_str(), extent.width, extent.height, numComponents, image.data(), 0);
     std::cout << "Wrote file " << fileName << "\n";
-
-    vkUnmapMemory(logicalDevice, m_buffers.lightBuffer->getMemory());
 }
 
-void DebugDraw::writeTiles()
+void DebugDraw::writeTiles(uint32_t bufferIndex)
 {
-    VkDevice logicalDevice = fw::Context::getLogicalDevice();
-
-    void* mappedTileMemory = NULL;
-    vkMapMemory(logicalDevice, m_buffers.tileBuffer->getMemory(), 0, c_tileBufferSize, 0, &mappedTileMemory);
+    void* mappedTileMemory = m_buffers.tileBuffers[bufferIndex]->getMappedMemory();
     uint32_t* tileMemory = (uint32_t*)mappedTileMemory;
 
-    void* mappedNumLightsMemory = NULL;
-    vkMapMemory(logicalDevice, m_buffers.numLightsPerTileBuffer->getMemory(), 0, c_numLightsPerTileBufferSize, 0, &mappedNumLightsMemory);
+    void* mappedNumLightsMemory = m_buffers.numLightsPerTileBuffers[bufferIndex]->getMappedMemory();
     uint32_t* numLightsMemory = (uint32_t*)mappedNumLightsMemory;
 
     int numComponents = 3;
@@ -95,6 +86,4 @@ void DebugDraw::writeTiles()
     stbir_resize_uint8(tileLights.data(), c_gridWidth, c_gridHeight, 0, tileImage.data(), extent.width, extent.height, 0, numComponents);
     stbi_write_png(fileName.c_str(), extent.width, extent.height, numComponents, tileImage.data(), 0);
     std::cout << "Wrote file " << fileName << "\n";
-
-    vkUnmapMemory(logicalDevice, m_buffers.tileBuffer->getMemory());
 }
@@ -1,7 +1,7 @@
 #include "ClusteredApp.h"
 #include "fw/Execute.h"
 
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 {
-    return fw::runApplication<ClusteredApp>();
+    return fw::runApplication<ClusteredApp>(argc, argv);
 }
@@ -23,13 +23,14 @@ public:
 
     struct BufferData
     {
-        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-        fw::Buffer uniformBuffer;
+        // The sets and the buffers are per swap chain image, the frame that used the image last has finished when the
+        // image is acquired again
+        std::vector<VkDescriptorSet> descriptorSets;
+        std::vector<fw::Buffer> uniformBuffers;
         size_t dynamicAlignment = 0;
         size_t dynamicBufferSize = 0;
         glm::mat4* dynamicBufferData = nullptr;
-        fw::Buffer dynamicBuffer;
-        void* mappedDynamicMemory = nullptr;
+        std::vector<fw::Buffer> dynamicBuffers;
     };
 
     struct RenderObject
@@ -8,6 +8,7 @@
 #include "fw/Model.h"
 #include "fw/Pipeline.h"
 #include "fw/RenderPass.h"
+#include "fw/ShaderModuleCache.h"
 #include "fw/Common.h"
 
 #include <glm/gtc/matrix_transform.hpp>
@@ -79,7 +80,8 @@ void DynamicApp::update()
     globalMatrices.view = m_camera.getViewMatrix();
     globalMatrices.proj = m_camera.getProjectionMatrix();
 
-    m_bufferData.uniformBuffer.setData(c_globalMatricesSize, &globalMatrices);
+    uint32_t imageIndex = fw::API::getCurrentSwapChainImageIndex();
+    m_bufferData.uniformBuffers[imageIndex].setData(c_globalMatricesSize, &globalMatrices);
 
     for (size_t i = 0; i < c_numRenderObjects; ++i)
     {
@@ -89,13 +91,10 @@ void DynamicApp::update()
         m_bufferData.dynamicBufferData[m_bufferData.dynamicAlignment / sizeof(glm::mat4) * i] = m_transformations[i].getWorldMatrix();
     }
 
-    // Implicitly flush non-coherent memory. With VkMappedMemoryRange it is possible to do partial update.
-    memcpy(m_bufferData.mappedDynamicMemory, m_bufferData.dynamicBufferData, m_bufferData.dynamicBufferSize);
-    VkMappedMemoryRange mappedMemoryRange{};
-    mappedMemoryRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedMemoryRange.memory = m_bufferData.dynamicBuffer.getMemory();
-    mappedMemoryRange.size = m_bufferData.dynamicBufferSize;
-    vkFlushMappedMemoryRanges(m_logicalDevice, 1, &mappedMemoryRange);
+    // Explicitly flush non-coherent memory. With a smaller range it is possible to do partial update.
+    fw::Buffer& dynamicBuffer = m_bufferData.dynamicBuffers[imageIndex];
+    memcpy(dynamicBuffer.getMappedMemory(), m_bufferData.dynamicBufferData, m_bufferData.dynamicBufferSize);
+    dynamicBuffer.flush(0, m_bufferData.dynamicBufferSize);
 }
 
 void DynamicApp::onGUI()
@@ -194,10 +193,10 @@ void DynamicApp::createPipeline()
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(m_logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
@@ -239,7 +238,7 @@ void DynamicApp::createPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
 }
 
 void DynamicApp::createDescriptorPool()
@@ -271,7 +270,7 @@ void DynamicApp::createRenderObject()
     CHECK(numMeshes == 1);
     const fw::Mesh& mesh = meshes[0];
 
-    bool vertexBufferCreated = m_renderObject.vertexBuffer.createForDevice<fw::Mesh::Vertex>(mesh.getVertices(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    bool vertexBufferCreated = m_renderObject.vertexBuffer.createVertexBuffer(mesh);
     bool indexBufferCreated = m_renderObject.indexBuffer.createForDevice<uint32_t>(mesh.indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
     CHECK(vertexBufferCreated && indexBufferCreated);
@@ -294,64 +293,73 @@ void DynamicApp::createDescriptorSets()
     m_bufferData.dynamicBufferSize = c_numRenderObjects * alignment;
     m_bufferData.dynamicBufferData = static_cast<glm::mat4*>(fw::alignedAlloc(m_bufferData.dynamicBufferSize, alignment));
     assert(m_bufferData.dynamicBufferData);
+    uint32_t imageCount = fw::API::getSwapChainImageCount();
     VkMemoryPropertyFlags uboProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
-    m_bufferData.dynamicBuffer.create(m_bufferData.dynamicBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties);
-
-    VkDeviceMemory dynamicMemory = m_bufferData.dynamicBuffer.getMemory();
-    VK_CHECK(vkMapMemory(m_logicalDevice, dynamicMemory, 0, m_bufferData.dynamicBufferSize, 0, &m_bufferData.mappedDynamicMemory));
+    m_bufferData.dynamicBuffers.resize(imageCount);
+    m_bufferData.uniformBuffers.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; ++i)
+    {
+        CHECK(m_bufferData.dynamicBuffers[i].create(m_bufferData.dynamicBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
+        CHECK(m_bufferData.dynamicBuffers[i].getMappedMemory());
+        CHECK(m_bufferData.uniformBuffers[i].create(c_globalMatricesSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
+    }
 
-    CHECK(m_bufferData.uniformBuffer.create(c_globalMatricesSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
+    m_bufferData.descriptorSets.resize(imageCount);
 
+    std::vector<VkDescriptorSetLayout> layouts(imageCount, m_descriptorSetLayout);
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = m_descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &m_descriptorSetLayout;
+    allocInfo.descriptorSetCount = imageCount;
+    allocInfo.pSetLayouts = layouts.data();
 
-    VK_CHECK(vkAllocateDescriptorSets(m_logicalDevice, &allocInfo, &m_bufferData.descriptorSet));
-
-    VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = m_bufferData.uniformBuffer.getBuffer();
-    bufferInfo.offset = 0;
-    bufferInfo.range = c_globalMatricesSize;
+    VK_CHECK(vkAllocateDescriptorSets(m_logicalDevice, &allocInfo, m_bufferData.descriptorSets.data()));
 
     VkDescriptorImageInfo imageInfo{};
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     imageInfo.imageView = m_renderObject.texture.getImageView();
     imageInfo.sampler = m_sampler.getSampler();
 
-    VkDescriptorBufferInfo dynamicBufferInfo{};
-    dynamicBufferInfo.buffer = m_bufferData.dynamicBuffer.getBuffer();
-    dynamicBufferInfo.offset = 0;
-    dynamicBufferInfo.range = VK_WHOLE_SIZE;
-
-    std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
-
-    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[0].dstSet = m_bufferData.descriptorSet;
-    descriptorWrites[0].dstBinding = 0;
-    descriptorWrites[0].dstArrayElement = 0;
-    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptorWrites[0].descriptorCount = 1;
-    descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[1].dstSet = m_bufferData.descriptorSet;
-    descriptorWrites[1].dstBinding = 1;
-    descriptorWrites[1].dstArrayElement = 0;
-    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrites[1].descriptorCount = 1;
-    descriptorWrites[1].pImageInfo = &imageInfo;
-
-    descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[2].dstSet = m_bufferData.descriptorSet;
-    descriptorWrites[2].dstBinding = 2;
-    descriptorWrites[2].dstArrayElement = 0;
-    descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-    descriptorWrites[2].descriptorCount = 1;
-    descriptorWrites[2].pBufferInfo = &dynamicBufferInfo;
-
-    vkUpdateDescriptorSets(m_logicalDevice, fw::ui32size(descriptorWrites), descriptorWrites.data(), 0, nullptr);
+    for (uint32_t i = 0; i < imageCount; ++i)
+    {
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = m_bufferData.uniformBuffers[i].getBuffer();
+        bufferInfo.offset = 0;
+        bufferInfo.range = c_globalMatricesSize;
+
+        VkDescriptorBufferInfo dynamicBufferInfo{};
+        dynamicBufferInfo.buffer = m_bufferData.dynamicBuffers[i].getBuffer();
+        dynamicBufferInfo.offset = 0;
+        dynamicBufferInfo.range = VK_WHOLE_SIZE;
+
+        std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+
+        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[0].dstSet = m_bufferData.descriptorSets[i];
+        descriptorWrites[0].dstBinding = 0;
+        descriptorWrites[0].dstArrayElement = 0;
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrites[0].descriptorCount = 1;
+        descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[1].dstSet = m_bufferData.descriptorSets[i];
+        descriptorWrites[1].dstBinding = 1;
+        descriptorWrites[1].dstArrayElement = 0;
+        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[1].descriptorCount = 1;
+        descriptorWrites[1].pImageInfo = &imageInfo;
+
+        descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[2].dstSet = m_bufferData.descriptorSets[i];
+        descriptorWrites[2].dstBinding = 2;
+        descriptorWrites[2].dstArrayElement = 0;
+        descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        descriptorWrites[2].descriptorCount = 1;
+        descriptorWrites[2].pBufferInfo = &dynamicBufferInfo;
+
+        vkUpdateDescriptorSets(m_logicalDevice, fw::ui32size(descriptorWrites), descriptorWrites.data(), 0, nullptr);
+    }
 }
 
 void DynamicApp::createCommandBuffers()
@@ -404,7 +412,7 @@ void DynamicApp::createCommandBuffers()
         for (size_t j = 0; j < c_numRenderObjects; ++j)
         {
             uint32_t dynamicOffset = static_cast<uint32_t>(j * m_bufferData.dynamicAlignment);
-            vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_bufferData.descriptorSet, 1, &dynamicOffset);
+            vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_bufferData.descriptorSets[i], 1, &dynamicOffset);
             vkCmdDrawIndexed(cb, m_renderObject.numIndices, 1, 0, 0, 0);
         }
 
@@ -1,7 +1,7 @@
 #include "DynamicApp.h"
 #include "fw/Execute.h"
 
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 {
-    return fw::runApplication<DynamicApp>();
+    return fw::runApplication<DynamicApp>(argc, argv);
 }
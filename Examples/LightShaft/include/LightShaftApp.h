@@ -45,9 +45,6 @@ private:
     VkPipeline m_graphicsPipeline = VK_NULL_HANDLE;
     VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
 
-    VkCommandBuffer m_commandBuffer;
-    VkFence m_renderBufferFence;
-
     fw::Sampler m_sampler;
     fw::Camera m_camera;
     fw::CameraController m_cameraController;
@@ -68,7 +65,5 @@ private:
     void createPipeline();
     void createDescriptorPool();
     void createDescriptorSets();
-    void createCommandBuffer();
-    void createFence();
     void updateCommandBuffers();
 };
@@ -7,13 +7,14 @@
 #include "fw/Context.h"
 #include "fw/Macros.h"
 #include "fw/Pipeline.h"
+#include "fw/Profiler.h"
 #include "fw/RenderPass.h"
+#include "fw/ShaderModuleCache.h"
 
 #include <array>
 
 LightShaftApp::~LightShaftApp()
 {
-    vkDestroyFence(m_logicalDevice, m_renderBufferFence, nullptr);
     vkDestroyDescriptorPool(m_logicalDevice, m_descriptorPool, nullptr);
     vkDestroyPipeline(m_logicalDevice, m_graphicsPipeline, nullptr);
     vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
@@ -25,6 +26,9 @@ bool LightShaftApp::initialize()
 {
     m_logicalDevice = fw::Context::getLogicalDevice();
 
+    // Offscreen pass attachments are shared so frames cannot overlap
+    fw::API::setFramesInFlight(1);
+
     m_objectRenderPass.initialize(&m_camera);
     m_lightShaftPrepass.initialize(m_objectRenderPass.getMatrixDescriptorSetLayout(), &m_lightTransformation);
 
@@ -35,8 +39,6 @@ bool LightShaftApp::initialize()
     CHECK(m_sampler.create(VK_COMPARE_OP_NEVER));
     createDescriptorPool();
     createDescriptorSets();
-    createCommandBuffer();
-    createFence();
     CHECK(fw::API::initializeGUI(m_descriptorPool));
 
     m_cameraController.setCamera(&m_camera);
@@ -179,10 +181,10 @@ void LightShaftApp::createPipeline()
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(m_logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
@@ -228,7 +230,7 @@ void LightShaftApp::createPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
 }
 
 void LightShaftApp::createDescriptorPool()
@@ -287,26 +289,6 @@ void LightShaftApp::createDescriptorSets()
     vkUpdateDescriptorSets(m_logicalDevice, fw::ui32size(descriptorWrites), descriptorWrites.data(), 0, nullptr);
 }
 
-void LightShaftApp::createCommandBuffer()
-{
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = fw::API::getCommandPool();
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = 1;
-
-    VK_CHECK(vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, &m_commandBuffer));
-}
-
-void LightShaftApp::createFence()
-{
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    VK_CHECK(vkCreateFence(m_logicalDevice, &fenceInfo, nullptr, &m_renderBufferFence));
-    fw::API::setRenderBufferFence(m_renderBufferFence);
-}
-
 void LightShaftApp::updateCommandBuffers()
 {
     const std::vector<VkFramebuffer>& swapChainFramebuffers = fw::API::getSwapChainFramebuffers();
@@ -315,16 +297,19 @@ void LightShaftApp::updateCommandBuffers()
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     beginInfo.pInheritanceInfo = nullptr; // Optional
 
-    vkWaitForFences(m_logicalDevice, 1, &m_renderBufferFence, VK_TRUE, UINT64_MAX);
-    vkResetFences(m_logicalDevice, 1, &m_renderBufferFence);
+    VkCommandBuffer commandBuffer = fw::API::getCurrentFrameCommandBuffer();
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
-    vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+    fw::Profiler::beginScope(commandBuffer, "Objects");
+    m_objectRenderPass.writeRenderCommands(commandBuffer);
+    fw::Profiler::endScope(commandBuffer, "Objects");
 
-    m_objectRenderPass.writeRenderCommands(m_commandBuffer);
-    m_lightShaftPrepass.writeRenderCommands(m_commandBuffer, m_objectRenderPass.getRenderObjects());
+    fw::Profiler::beginScope(commandBuffer, "Light shaft prepass");
+    m_lightShaftPrepass.writeRenderCommands(commandBuffer, m_objectRenderPass.getRenderObjects());
+    fw::Profiler::endScope(commandBuffer, "Light shaft prepass");
 
     std::array<VkClearValue, 2> clearValues{};
     clearValues[0].color = {0.0f, 0.0f, 0.0f, 1.0f};
@@ -339,16 +324,18 @@ void LightShaftApp::updateCommandBuffers()
     renderPassInfo.pClearValues = clearValues.data();
     renderPassInfo.framebuffer = framebuffer;
 
-    vkCmdPushConstants(m_commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(ShaderParameters), &m_shaderParameters);
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(ShaderParameters), &m_shaderParameters);
 
-    vkCmdBeginRenderPass(m_commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
-    vkCmdBindDescriptorSets(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_textureDescriptorSet, 0, nullptr);
-    vkCmdDraw(m_commandBuffer, 3, 1, 0, 0);
+    fw::Profiler::beginScope(commandBuffer, "Light shafts");
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_textureDescriptorSet, 0, nullptr);
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
 
-    vkCmdEndRenderPass(m_commandBuffer);
+    vkCmdEndRenderPass(commandBuffer);
+    fw::Profiler::endScope(commandBuffer, "Light shafts");
 
-    VK_CHECK(vkEndCommandBuffer(m_commandBuffer));
+    VK_CHECK(vkEndCommandBuffer(commandBuffer));
 
-    fw::API::setNextCommandBuffer(m_commandBuffer);
+    fw::API::setNextCommandBuffer(commandBuffer);
 }
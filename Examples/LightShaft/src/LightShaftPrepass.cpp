@@ -7,6 +7,7 @@
 #include "fw/Common.h"
 #include "fw/Context.h"
 #include "fw/RenderPass.h"
+#include "fw/ShaderModuleCache.h"
 #include "fw/Macros.h"
 #include "fw/Pipeline.h"
 
@@ -230,10 +231,10 @@ void LightShaftPrepass::createPipeline()
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(m_logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
@@ -271,7 +272,7 @@ void LightShaftPrepass::createPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
 }
 
 void LightShaftPrepass::createDescriptorPool()
@@ -333,7 +334,7 @@ void LightShaftPrepass::createRenderObject()
     const fw::Mesh& mesh = meshes[0];
 
     success = success
-        && m_sphere.vertexBuffer.createForDevice<fw::Mesh::Vertex>(mesh.getVertices(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+        && m_sphere.vertexBuffer.createVertexBuffer(mesh)
         && m_sphere.indexBuffer.createForDevice<uint32_t>(mesh.indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
     m_sphere.numIndices = fw::ui32size(mesh.indices);
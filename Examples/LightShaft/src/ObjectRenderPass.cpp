@@ -8,6 +8,7 @@
 #include "fw/Model.h"
 #include "fw/Pipeline.h"
 #include "fw/RenderPass.h"
+#include "fw/ShaderModuleCache.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -246,10 +247,10 @@ void ObjectRenderPass::createPipeline()
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(m_logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
@@ -287,7 +288,7 @@ void ObjectRenderPass::createPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
 }
 
 void ObjectRenderPass::createDescriptorPool()
@@ -329,7 +330,7 @@ void ObjectRenderPass::createRenderObjects()
         RenderObject& ro = m_renderObjects[i];
 
         success = success
-            && ro.vertexBuffer.createForDevice<fw::Mesh::Vertex>(mesh.getVertices(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+            && ro.vertexBuffer.createVertexBuffer(mesh)
             && ro.indexBuffer.createForDevice<uint32_t>(mesh.indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
         ro.numIndices = fw::ui32size(mesh.indices);
@@ -1,7 +1,7 @@
 #include "LightShaftApp.h"
 #include "fw/Execute.h"
 
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 {
-    return fw::runApplication<LightShaftApp>();
+    return fw::runApplication<LightShaftApp>(argc, argv);
 }
@@ -5,6 +5,7 @@
 #include "fw/Context.h"
 #include "fw/Macros.h"
 #include "fw/Pipeline.h"
+#include "fw/ShaderModuleCache.h"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image_write.h>
@@ -57,8 +58,7 @@ void MandelbrotApp::postUpdate()
 
     std::cout << "MandelbrotApp::postUpdate: Writing image...\n";
 
-    void* mappedMemory = NULL;
-    vkMapMemory(m_logicalDevice, m_storageBuffer.getMemory(), 0, c_bufferSize, 0, &mappedMemory);
+    void* mappedMemory = m_storageBuffer.getMappedMemory();
     glm::vec4* vecMemory = (glm::vec4*)mappedMemory;
 
     std::vector<uint8_t> image;
@@ -71,8 +71,6 @@ void MandelbrotApp::postUpdate()
         image.push_back((uint8_t)(255.0f * (vecMemory[i].a)));
     }
 
-    vkUnmapMemory(m_logicalDevice, m_storageBuffer.getMemory());
-
     std::string fileName = "output.png";
     stbi_write_png(fileName.c_str(), c_width, c_height, 4, image.data(), 0);
     std::cout << "Wrote file " << fileName << "\n";
@@ -109,8 +107,8 @@ void MandelbrotApp::createPipeline()
 
     VkPipelineShaderStageCreateInfo shaderStage = fw::Pipeline::getComputeShaderStageInfo(c_shaderFolder + "shader.comp.spv");
 
-    fw::Cleaner cleaner([&shaderStage, this]() {
-        vkDestroyShaderModule(m_logicalDevice, shaderStage.module, nullptr);
+    fw::Cleaner cleaner([&shaderStage]() {
+        fw::ShaderModuleCache::release(shaderStage.module);
     });
 
     VkComputePipelineCreateInfo pipelineCreateInfo{};
@@ -118,7 +116,7 @@ void MandelbrotApp::createPipeline()
     pipelineCreateInfo.stage = shaderStage;
     pipelineCreateInfo.layout = m_pipelineLayout;
 
-    VK_CHECK(vkCreateComputePipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_computePipeline));
+    VK_CHECK(vkCreateComputePipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineCreateInfo, nullptr, &m_computePipeline));
 }
 
 void MandelbrotApp::createDescriptorSets()
@@ -1,7 +1,7 @@
 #include "MandelbrotApp.h"
 #include "fw/Execute.h"
 
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 {
-    return fw::runApplication<MandelbrotApp>();
+    return fw::runApplication<MandelbrotApp>(argc, argv);
 }
@@ -10,8 +10,9 @@ layout(binding = 0) uniform TransformationMatrices
 ubo;
 
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
-layout(location = 2) in vec3 inTangent;
+// Packed vertex format, normal and tangent are octahedral encoded
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inTangent;
 layout(location = 3) in vec2 inUv;
 
 layout(location = 0) out vec2 outUv;
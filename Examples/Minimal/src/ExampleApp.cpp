@@ -8,6 +8,7 @@
 #include "fw/Model.h"
 #include "fw/Pipeline.h"
 #include "fw/RenderPass.h"
+#include "fw/ShaderModuleCache.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <vulkan/vulkan.h>
@@ -20,6 +21,10 @@ namespace
 const std::size_t c_transformMatricesSize = sizeof(ExampleApp::Matrices);
 const std::string c_assetsFolder = ASSETS_PATH;
 const std::string c_shaderFolder = SHADER_PATH;
+// Only position and uv are used so the smaller vertex is enough
+const fw::Mesh::VertexFormat c_vertexFormat = fw::Mesh::VertexFormat::Packed;
+// Meshes in the droid model
+const uint32_t c_maxMeshCount = 2;
 } // namespace
 
 ExampleApp::~ExampleApp()
@@ -65,7 +70,7 @@ void ExampleApp::update()
     m_cameraController.update();
     m_matrices.view = m_camera.getViewMatrix();
 
-    m_uniformBuffer.setData(sizeof(m_matrices), &m_matrices);
+    m_uniformBuffers[fw::API::getCurrentSwapChainImageIndex()].setData(sizeof(m_matrices), &m_matrices);
 }
 
 void ExampleApp::onGUI()
@@ -160,15 +165,15 @@ void ExampleApp::createPipeline()
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(m_logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
-    VkVertexInputBindingDescription vertexDescription = fw::Pipeline::getVertexDescription();
-    std::vector<VkVertexInputAttributeDescription> attributeDescriptions = fw::Pipeline::getAttributeDescriptions();
+    VkVertexInputBindingDescription vertexDescription = fw::Pipeline::getVertexDescription(c_vertexFormat);
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions = fw::Pipeline::getAttributeDescriptions(c_vertexFormat);
     VkPipelineVertexInputStateCreateInfo vertexInputState = fw::Pipeline::getVertexInputState(&vertexDescription, &attributeDescriptions);
 
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = fw::Pipeline::getInputAssemblyState();
@@ -201,38 +206,47 @@ void ExampleApp::createPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
 }
 
 void ExampleApp::createDescriptorPool()
 {
+    // A set per mesh and swap chain image and one for the GUI
+    uint32_t meshSetCount = c_maxMeshCount * fw::API::getSwapChainImageCount();
+
     std::array<VkDescriptorPoolSize, 2> poolSizes{};
     poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = 2;
+    poolSizes[0].descriptorCount = meshSetCount;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = 3;
+    poolSizes[1].descriptorCount = meshSetCount + 1;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = fw::ui32size(poolSizes);
     poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = 3;
+    poolInfo.maxSets = meshSetCount + 1;
 
     VK_CHECK(vkCreateDescriptorPool(m_logicalDevice, &poolInfo, nullptr, &m_descriptorPool));
 }
 
 void ExampleApp::createRenderObjects()
 {
+    uint32_t imageCount = fw::API::getSwapChainImageCount();
     VkMemoryPropertyFlags uboProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    CHECK(m_uniformBuffer.create(c_transformMatricesSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
+    m_uniformBuffers.resize(imageCount);
+    for (fw::Buffer& uniformBuffer : m_uniformBuffers)
+    {
+        CHECK(uniformBuffer.create(c_transformMatricesSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
+    }
 
     fw::Model model;
     CHECK(model.loadModel(c_assetsFolder + "attack_droid.obj"));
 
     fw::Model::Meshes meshes = model.getMeshes();
     uint32_t numMeshes = fw::ui32size(meshes);
+    CHECK(numMeshes <= c_maxMeshCount);
 
-    createDescriptorSets(numMeshes);
+    createDescriptorSets(numMeshes * imageCount);
 
     m_renderObjects.resize(numMeshes);
 
@@ -243,15 +257,19 @@ void ExampleApp::createRenderObjects()
         RenderObject& ro = m_renderObjects[i];
 
         success = success
-            && ro.vertexBuffer.createForDevice<fw::Mesh::Vertex>(mesh.getVertices(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+            && ro.vertexBuffer.createVertexBuffer(mesh, c_vertexFormat)
             && ro.indexBuffer.createForDevice<uint32_t>(mesh.indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
         ro.numIndices = fw::ui32size(mesh.indices);
 
         std::string textureFile = c_assetsFolder + mesh.getFirstTextureOfType(aiTextureType::aiTextureType_DIFFUSE);
-        ro.texture.load(textureFile, VK_FORMAT_R8G8B8A8_UNORM);
-        updateDescriptorSet(m_descriptorSets[i], ro.texture.getImageView());
-        ro.descriptorSet = m_descriptorSets[i];
+        ro.texture.loadCompressed(textureFile, fw::Texture::Compression::BC1, false);
+        ro.descriptorSets.resize(imageCount);
+        for (uint32_t image = 0; image < imageCount; ++image)
+        {
+            ro.descriptorSets[image] = m_descriptorSets[i * imageCount + image];
+            updateDescriptorSet(ro.descriptorSets[image], m_uniformBuffers[image], ro.texture.getImageView());
+        }
     }
 
     CHECK(success);
@@ -271,12 +289,12 @@ void ExampleApp::createDescriptorSets(uint32_t setCount)
     VK_CHECK(vkAllocateDescriptorSets(m_logicalDevice, &allocInfo, m_descriptorSets.data()));
 }
 
-void ExampleApp::updateDescriptorSet(VkDescriptorSet descriptorSet, VkImageView imageView)
+void ExampleApp::updateDescriptorSet(VkDescriptorSet descriptorSet, const fw::Buffer& uniformBuffer, VkImageView imageView)
 {
     std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
 
     VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = m_uniformBuffer.getBuffer();
+    bufferInfo.buffer = uniformBuffer.getBuffer();
     bufferInfo.offset = 0;
     bufferInfo.range = c_transformMatricesSize;
 
@@ -353,7 +371,7 @@ void ExampleApp::createCommandBuffers()
             vkCmdBindVertexBuffers(cb, 0, 1, &vb, offsets);
             vkCmdBindIndexBuffer(cb, ro.indexBuffer.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
             vkCmdBindDescriptorSets(
-                cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &ro.descriptorSet, 0, nullptr);
+                cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &ro.descriptorSets[i], 0, nullptr);
             vkCmdDrawIndexed(cb, ro.numIndices, 1, 0, 0, 0);
         }
 
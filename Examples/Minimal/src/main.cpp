@@ -1,7 +1,7 @@
 #include "ExampleApp.h"
 #include "fw/Execute.h"
 
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 {
-    return fw::runApplication<ExampleApp>();
+    return fw::runApplication<ExampleApp>(argc, argv);
 }
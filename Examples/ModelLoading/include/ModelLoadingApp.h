@@ -0,0 +1,24 @@
+#pragma once
+
+#include "fw/Application.h"
+
+#include <string>
+
+class ModelLoadingApp : public fw::Application
+{
+public:
+    ModelLoadingApp(){};
+    virtual ~ModelLoadingApp(){};
+    ModelLoadingApp(const ModelLoadingApp&) = delete;
+    ModelLoadingApp(ModelLoadingApp&&) = delete;
+    ModelLoadingApp& operator=(const ModelLoadingApp&) = delete;
+    ModelLoadingApp& operator=(ModelLoadingApp&&) = delete;
+
+    virtual bool initialize() final;
+    virtual void update() final;
+    virtual void onGUI() final{};
+    virtual void postUpdate() final{};
+
+private:
+    bool benchmarkModel(const std::string& file);
+};
@@ -0,0 +1,89 @@
+#include "ModelLoadingApp.h"
+#include "fw/API.h"
+#include "fw/Macros.h"
+#include "fw/Model.h"
+
+#include <iostream>
+#include <vector>
+
+namespace
+{
+const std::string c_assetsFolder = ASSETS_PATH;
+const std::vector<std::string> c_models = {"monkey.3ds", "lowpoly_sphere.obj", "attack_droid.obj", "Cerberus.FBX"};
+const int c_iterations = 5;
+
+double getVerticesPerSecond(size_t vertexCount, double milliseconds)
+{
+    return milliseconds > 0.0 ? static_cast<double>(vertexCount) * 1000.0 / milliseconds : 0.0;
+}
+
+} // unnamed
+
+bool ModelLoadingApp::initialize()
+{
+    fw::API::setRenderingEnabled(false);
+
+    for (const std::string& model : c_models)
+    {
+        CHECK(benchmarkModel(c_assetsFolder + model));
+    }
+
+    return true;
+}
+
+void ModelLoadingApp::update()
+{
+    fw::API::quitApplication();
+}
+
+bool ModelLoadingApp::benchmarkModel(const std::string& file)
+{
+    double importMilliseconds = 0.0;
+    double extractMilliseconds = 0.0;
+    double optimizeMilliseconds = 0.0;
+    size_t vertexCount = 0;
+    fw::MeshOptimizer::VertexCacheStats importedVertexCache;
+    fw::MeshOptimizer::VertexCacheStats optimizedVertexCache;
+    for (int i = 0; i < c_iterations; ++i)
+    {
+        fw::Model model;
+        model.setCacheEnabled(false);
+        if (!model.loadModel(file))
+        {
+            return false;
+        }
+        const fw::Model::LoadStats& stats = model.getLoadStats();
+        importMilliseconds += stats.importMilliseconds;
+        extractMilliseconds += stats.extractMilliseconds;
+        optimizeMilliseconds += stats.optimizeMilliseconds;
+        vertexCount = stats.vertexCount;
+        importedVertexCache = stats.importedVertexCache;
+        optimizedVertexCache = stats.vertexCache;
+    }
+    importMilliseconds /= c_iterations;
+    extractMilliseconds /= c_iterations;
+    optimizeMilliseconds /= c_iterations;
+
+    // The first cached load writes the cache if it does not exist yet
+    double cachedMilliseconds = 0.0;
+    for (int i = 0; i < 2; ++i)
+    {
+        fw::Model model;
+        if (!model.loadModel(file))
+        {
+            return false;
+        }
+        cachedMilliseconds = model.getLoadStats().fromCache ? model.getLoadStats().totalMilliseconds : 0.0;
+    }
+
+    std::cout << file << "\n"
+              << "  Vertices: " << vertexCount << "\n"
+              << "  Assimp import: " << importMilliseconds << " ms\n"
+              << "  Extraction: " << extractMilliseconds << " ms (" << getVerticesPerSecond(vertexCount, extractMilliseconds) << " vertices/s)\n"
+              << "  Optimization: " << optimizeMilliseconds << " ms\n"
+              << "  ACMR: " << importedVertexCache.getAcmr() << " -> " << optimizedVertexCache.getAcmr() << "\n"
+              << "  ATVR: " << importedVertexCache.getAtvr() << " -> " << optimizedVertexCache.getAtvr() << "\n"
+              << "  Total: " << importMilliseconds + extractMilliseconds + optimizeMilliseconds << " ms (" << getVerticesPerSecond(vertexCount, importMilliseconds + extractMilliseconds + optimizeMilliseconds) << " vertices/s)\n"
+              << "  Cached: " << cachedMilliseconds << " ms (" << getVerticesPerSecond(vertexCount, cachedMilliseconds) << " vertices/s)\n";
+    return true;
+}
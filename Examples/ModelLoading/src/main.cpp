@@ -0,0 +1,7 @@
+#include "ModelLoadingApp.h"
+#include "fw/Execute.h"
+
+int main(int argc, char** argv)
+{
+    return fw::runApplication<ModelLoadingApp>(argc, argv);
+}
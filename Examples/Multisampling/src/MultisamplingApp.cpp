@@ -8,6 +8,7 @@
 #include "fw/Model.h"
 #include "fw/Pipeline.h"
 #include "fw/RenderPass.h"
+#include "fw/ShaderModuleCache.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <vulkan/vulkan.h>
@@ -20,6 +21,8 @@ namespace
 const std::size_t c_transformMatricesSize = sizeof(MultisamplingApp::Matrices);
 const std::string c_assetsFolder = ASSETS_PATH;
 const std::string c_shaderFolder = SHADER_PATH;
+// Meshes in the droid model
+const uint32_t c_maxMeshCount = 2;
 const VkSampleCountFlagBits c_sampleCount = VK_SAMPLE_COUNT_4_BIT;
 
 int sampleCountToInt(VkSampleCountFlags count)
@@ -109,7 +112,7 @@ void MultisamplingApp::update()
     m_cameraController.update();
     m_matrices.view = m_camera.getViewMatrix();
 
-    m_uniformBuffer.setData(sizeof(m_matrices), &m_matrices);
+    m_uniformBuffers[fw::API::getCurrentSwapChainImageIndex()].setData(sizeof(m_matrices), &m_matrices);
 }
 
 void MultisamplingApp::createRenderPass()
@@ -238,10 +241,10 @@ void MultisamplingApp::createPipeline()
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(m_logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
@@ -284,38 +287,47 @@ void MultisamplingApp::createPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
 }
 
 void MultisamplingApp::createDescriptorPool()
 {
+    // A set per mesh and swap chain image and one for the GUI
+    uint32_t meshSetCount = c_maxMeshCount * fw::API::getSwapChainImageCount();
+
     std::array<VkDescriptorPoolSize, 2> poolSizes{};
     poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = 2;
+    poolSizes[0].descriptorCount = meshSetCount;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = 3;
+    poolSizes[1].descriptorCount = meshSetCount + 1;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = fw::ui32size(poolSizes);
     poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = 3;
+    poolInfo.maxSets = meshSetCount + 1;
 
     VK_CHECK(vkCreateDescriptorPool(m_logicalDevice, &poolInfo, nullptr, &m_descriptorPool));
 }
 
 void MultisamplingApp::createRenderObjects()
 {
+    uint32_t imageCount = fw::API::getSwapChainImageCount();
     VkMemoryPropertyFlags uboProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    CHECK(m_uniformBuffer.create(c_transformMatricesSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
+    m_uniformBuffers.resize(imageCount);
+    for (fw::Buffer& uniformBuffer : m_uniformBuffers)
+    {
+        CHECK(uniformBuffer.create(c_transformMatricesSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
+    }
 
     fw::Model model;
     CHECK(model.loadModel(c_assetsFolder + "attack_droid.obj"));
 
     fw::Model::Meshes meshes = model.getMeshes();
     uint32_t numMeshes = fw::ui32size(meshes);
+    CHECK(numMeshes <= c_maxMeshCount);
 
-    createDescriptorSets(numMeshes);
+    createDescriptorSets(numMeshes * imageCount);
 
     m_renderObjects.resize(numMeshes);
 
@@ -326,15 +338,19 @@ void MultisamplingApp::createRenderObjects()
         RenderObject& ro = m_renderObjects[i];
 
         success = success
-            && ro.vertexBuffer.createForDevice<fw::Mesh::Vertex>(mesh.getVertices(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+            && ro.vertexBuffer.createVertexBuffer(mesh)
             && ro.indexBuffer.createForDevice<uint32_t>(mesh.indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
         ro.numIndices = fw::ui32size(mesh.indices);
 
         std::string textureFile = c_assetsFolder + mesh.getFirstTextureOfType(aiTextureType::aiTextureType_DIFFUSE);
         ro.texture.load(textureFile, VK_FORMAT_R8G8B8A8_UNORM);
-        updateDescriptorSet(m_descriptorSets[i], ro.texture.getImageView());
-        ro.descriptorSet = m_descriptorSets[i];
+        ro.descriptorSets.resize(imageCount);
+        for (uint32_t image = 0; image < imageCount; ++image)
+        {
+            ro.descriptorSets[image] = m_descriptorSets[i * imageCount + image];
+            updateDescriptorSet(ro.descriptorSets[image], m_uniformBuffers[image], ro.texture.getImageView());
+        }
     }
 
     CHECK(success);
@@ -354,10 +370,10 @@ void MultisamplingApp::createDescriptorSets(uint32_t setCount)
     VK_CHECK(vkAllocateDescriptorSets(m_logicalDevice, &allocInfo, m_descriptorSets.data()));
 }
 
-void MultisamplingApp::updateDescriptorSet(VkDescriptorSet descriptorSet, VkImageView imageView)
+void MultisamplingApp::updateDescriptorSet(VkDescriptorSet descriptorSet, const fw::Buffer& uniformBuffer, VkImageView imageView)
 {
     VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = m_uniformBuffer.getBuffer();
+    bufferInfo.buffer = uniformBuffer.getBuffer();
     bufferInfo.offset = 0;
     bufferInfo.range = c_transformMatricesSize;
 
@@ -435,7 +451,7 @@ void MultisamplingApp::createCommandBuffers()
             vkCmdBindVertexBuffers(cb, 0, 1, &vb, offsets);
             vkCmdBindIndexBuffer(cb, ro.indexBuffer.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
             vkCmdBindDescriptorSets(
-                cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &ro.descriptorSet, 0, nullptr);
+                cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &ro.descriptorSets[i], 0, nullptr);
             vkCmdDrawIndexed(cb, ro.numIndices, 1, 0, 0, 0);
         }
 
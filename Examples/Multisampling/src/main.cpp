@@ -1,7 +1,7 @@
 #include "MultisamplingApp.h"
 #include "fw/Execute.h"
 
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 {
-    return fw::runApplication<MultisamplingApp>();
+    return fw::runApplication<MultisamplingApp>(argc, argv);
 }
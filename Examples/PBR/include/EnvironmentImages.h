@@ -4,6 +4,7 @@
 #include "PipelineHelper.h"
 
 #include "fw/Buffer.h"
+#include "fw/DescriptorAllocator.h"
 #include "fw/Image.h"
 #include "fw/Sampler.h"
 #include "fw/Texture.h"
@@ -67,7 +68,7 @@ private:
 
     VkRenderPass renderPass = VK_NULL_HANDLE;
     VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
-    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    fw::DescriptorAllocator descriptorAllocator;
     VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
 
     fw::Image plainImage;
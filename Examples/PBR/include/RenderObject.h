@@ -24,7 +24,7 @@ public:
     void initialize(VkRenderPass pass, VkDescriptorPool pool, VkSampler textureSampler);
     void setImages(VkImageView irradiance, VkImageView prefilter, VkImageView brdf);
     void update(const fw::Camera& camera);
-    void render(VkCommandBuffer cb);
+    void render(VkCommandBuffer cb, uint32_t imageIndex);
 
 private:
     struct TextureInfo
@@ -51,7 +51,9 @@ private:
     VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
     VkPipeline pipeline = VK_NULL_HANDLE;
 
-    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    // The sets and the uniform buffers are per swap chain image, the frame that used the image last has finished when
+    // the image is acquired again
+    std::vector<VkDescriptorSet> descriptorSets;
     fw::Buffer vertexBuffer;
     fw::Buffer indexBuffer;
     uint32_t numIndices = 0;
@@ -60,13 +62,14 @@ private:
 
     fw::Transformation transformation;
     UniformData uniformData;
-    fw::Buffer uniformBuffer;
+    std::vector<fw::Buffer> uniformBuffers;
 
     float rotation = 0.0f;
 
     void createDescriptorSetLayout();
     void createPipeline();
     void createRenderObject();
-    void allocateDescriptorSet();
-    void updateDescriptorSet();
+    void allocateDescriptorSets();
+    void updateDescriptorSets();
+    void updateDescriptorSet(VkDescriptorSet descriptorSet, const fw::Buffer& uniformBuffer);
 };
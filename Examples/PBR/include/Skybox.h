@@ -21,7 +21,7 @@ public:
 
     void initialize(VkRenderPass pass, VkDescriptorPool pool, VkSampler skyboxSampler, VkImageView skyboxTexture);
     void update(const fw::Camera& camera);
-    void render(VkCommandBuffer cb);
+    void render(VkCommandBuffer cb, uint32_t imageIndex);
 
 private:
     VkDevice logicalDevice = VK_NULL_HANDLE;
@@ -30,14 +30,15 @@ private:
     VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
     VkPipeline pipeline = VK_NULL_HANDLE;
     VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
-    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    // One set and transformation buffer per swap chain image
+    std::vector<VkDescriptorSet> descriptorSets;
 
     VkRenderPass renderPass;
     VkSampler sampler;
     VkImageView texture;
 
     fw::Transformation transformation;
-    fw::Buffer transformationBuffer;
+    std::vector<fw::Buffer> transformationBuffers;
     fw::Buffer vertexBuffer;
     fw::Buffer indexBuffer;
     uint32_t numIndices = 0;
@@ -6,6 +6,7 @@
 #include "fw/Context.h"
 #include "fw/Macros.h"
 #include "fw/Pipeline.h"
+#include "fw/ShaderModuleCache.h"
 
 #include <array>
 
@@ -206,11 +207,11 @@ bool BRDFLUT::createPipeline()
     pipelineInfo.stageCount = fw::ui32size(shaderStages);
     pipelineInfo.pStages = shaderStages.data();
 
-    VK_CHECK(vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline));
 
     for (const auto& shaderStage : shaderStages)
     {
-        vkDestroyShaderModule(logicalDevice, shaderStage.module, nullptr);
+        fw::ShaderModuleCache::release(shaderStage.module);
     }
     return true;
 }
@@ -5,6 +5,7 @@
 #include "fw/Common.h"
 #include "fw/Constants.h"
 #include "fw/Context.h"
+#include "fw/DescriptorLayoutCache.h"
 #include "fw/Macros.h"
 #include "fw/Model.h"
 #include "fw/Pipeline.h"
@@ -41,8 +42,6 @@ const glm::mat4 invertViewMatrices[]
 
 EnvironmentImages::~EnvironmentImages()
 {
-    vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
-    vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
     vkDestroyImageView(logicalDevice, plainImageView, nullptr);
     vkDestroyImageView(logicalDevice, irradianceImageView, nullptr);
     vkDestroyImageView(logicalDevice, prefilterImageView, nullptr);
@@ -177,19 +176,6 @@ void EnvironmentImages::createRenderPass()
 
 void EnvironmentImages::createDescriptors()
 {
-    // Pool
-    VkDescriptorPoolSize poolSize{};
-    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSize.descriptorCount = 1;
-
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = 1;
-    poolInfo.pPoolSizes = &poolSize;
-    poolInfo.maxSets = 2;
-
-    VK_CHECK(vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &descriptorPool));
-
     // Layout
     VkDescriptorSetLayoutBinding setLayoutBinding{};
     setLayoutBinding.binding = 0;
@@ -198,21 +184,11 @@ void EnvironmentImages::createDescriptors()
     setLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     setLayoutBinding.pImmutableSamplers = nullptr;
 
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.pBindings = &setLayoutBinding;
-    layoutInfo.bindingCount = 1;
-
-    VK_CHECK(vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, nullptr, &descriptorSetLayout));
+    descriptorSetLayout = fw::DescriptorLayoutCache::get({setLayoutBinding});
+    CHECK(descriptorSetLayout != VK_NULL_HANDLE);
 
     // Descriptor set
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptorPool;
-    allocInfo.pSetLayouts = &descriptorSetLayout;
-    allocInfo.descriptorSetCount = 1;
-
-    VK_CHECK(vkAllocateDescriptorSets(logicalDevice, &allocInfo, &descriptorSet));
+    CHECK(descriptorAllocator.allocate(descriptorSetLayout, descriptorSet));
 }
 
 void EnvironmentImages::createEnvironmentImage(int32_t textureSize,
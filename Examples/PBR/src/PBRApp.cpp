@@ -8,6 +8,7 @@
 #include "fw/Model.h"
 #include "fw/Pipeline.h"
 #include "fw/RenderPass.h"
+#include "fw/ShaderModuleCache.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <vulkan/vulkan.h>
@@ -36,6 +37,8 @@ bool PBRApp::initialize()
     CHECK(fw::API::initializeGUI(descriptorPool));
     skybox.initialize(renderPass, descriptorPool, sampler.getSampler(), environmentImages.getPlainImageView());
     renderObject.initialize(renderPass, descriptorPool, sampler.getSampler());
+    // Every pipeline has been built, the environment passes shared their vertex shader modules
+    fw::ShaderModuleCache::trim();
 
     extent = fw::API::getSwapChainExtent();
     cameraController.setCamera(&camera);
@@ -119,17 +122,20 @@ void PBRApp::createRenderPass()
 
 void PBRApp::createDescriptorPool()
 {
+    // The render object and the skybox have a set per swap chain image with 8 and 1 samplers, the GUI has one more
+    uint32_t imageCount = fw::API::getSwapChainImageCount();
+
     std::array<VkDescriptorPoolSize, 2> poolSizes{};
     poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = 16;
+    poolSizes[0].descriptorCount = 2 * imageCount;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = 16;
+    poolSizes[1].descriptorCount = 9 * imageCount + 1;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = fw::ui32size(poolSizes);
     poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = 3;
+    poolInfo.maxSets = 2 * imageCount + 1;
 
     VK_CHECK(vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &descriptorPool));
 }
@@ -173,8 +179,8 @@ void PBRApp::createCommandBuffers()
         renderPassInfo.framebuffer = swapChainFramebuffers[i];
 
         vkCmdBeginRenderPass(cb, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        renderObject.render(cb);
-        skybox.render(cb);
+        renderObject.render(cb, static_cast<uint32_t>(i));
+        skybox.render(cb, static_cast<uint32_t>(i));
         vkCmdEndRenderPass(cb);
 
         VK_CHECK(vkEndCommandBuffer(cb));
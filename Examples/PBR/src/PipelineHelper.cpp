@@ -4,6 +4,7 @@
 #include "fw/Context.h"
 #include "fw/Macros.h"
 #include "fw/Pipeline.h"
+#include "fw/ShaderModuleCache.h"
 
 #include <glm/glm.hpp>
 
@@ -86,10 +87,10 @@ void PipelineHelper::createPipeline(uint32_t viewportSize,
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
@@ -108,7 +109,7 @@ void PipelineHelper::createPipeline(uint32_t viewportSize,
     pipelineInfo.stageCount = fw::ui32size(shaderStages);
     pipelineInfo.pStages = shaderStages.data();
 
-    VK_CHECK(vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline));
 }
 
 VkPipeline PipelineHelper::getPipeline() const
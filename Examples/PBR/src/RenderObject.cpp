@@ -1,12 +1,17 @@
 #include "RenderObject.h"
 #include "Helpers.h"
 
+#include "fw/API.h"
 #include "fw/Common.h"
 #include "fw/Context.h"
 #include "fw/Macros.h"
 #include "fw/Model.h"
 #include "fw/Pipeline.h"
 #include "fw/RenderPass.h"
+#include "fw/ShaderModuleCache.h"
+#include "fw/TextureLoader.h"
+
+#include <algorithm>
 
 RenderObject::~RenderObject()
 {
@@ -45,7 +50,7 @@ void RenderObject::setImages(VkImageView irradiance, VkImageView prefilter, VkIm
     images[1].imageView = prefilter;
     images[2].imageView = brdf;
 
-    updateDescriptorSet();
+    updateDescriptorSets();
 }
 
 void RenderObject::update(const fw::Camera& camera)
@@ -59,10 +64,10 @@ void RenderObject::update(const fw::Camera& camera)
     matrices.proj = camera.getProjectionMatrix();
     uniformData.transformationMatrices = matrices;
     uniformData.cameraPosition = camera.getTransformation().getPosition();
-    uniformBuffer.setData(sizeof(uniformData), &uniformData);
+    uniformBuffers[fw::API::getCurrentSwapChainImageIndex()].setData(sizeof(uniformData), &uniformData);
 }
 
-void RenderObject::render(VkCommandBuffer cb)
+void RenderObject::render(VkCommandBuffer cb, uint32_t imageIndex)
 {
     vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 
@@ -70,7 +75,7 @@ void RenderObject::render(VkCommandBuffer cb)
     VkBuffer vb = vertexBuffer.getBuffer();
     vkCmdBindVertexBuffers(cb, 0, 1, &vb, offsets);
     vkCmdBindIndexBuffer(cb, indexBuffer.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
-    vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[imageIndex], 0, nullptr);
     vkCmdDrawIndexed(cb, numIndices, 1, 0, 0, 0);
 }
 
@@ -122,10 +127,10 @@ void RenderObject::createPipeline()
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
@@ -167,13 +172,17 @@ void RenderObject::createPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    VK_CHECK(vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline));
 }
 
 void RenderObject::createRenderObject()
 {
     VkMemoryPropertyFlags uboProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    bool success = uniformBuffer.create(sizeof(uniformData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties);
+    uniformBuffers.resize(fw::API::getSwapChainImageCount());
+    for (fw::Buffer& uniformBuffer : uniformBuffers)
+    {
+        CHECK(uniformBuffer.create(sizeof(uniformData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
+    }
 
     fw::Model model;
     CHECK(model.loadModel(assetsFolder + "DamagedHelmet.gltf"));
@@ -184,12 +193,15 @@ void RenderObject::createRenderObject()
     const fw::Mesh& mesh = meshes[0];
     numIndices = fw::ui32size(mesh.indices);
 
-    success = vertexBuffer.createForDevice<fw::Mesh::Vertex>(mesh.getVertices(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+    bool success = vertexBuffer.createVertexBuffer(mesh)
         && indexBuffer.createForDevice<uint32_t>(mesh.indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
     CHECK(success);
 
-    allocateDescriptorSet();
+    allocateDescriptorSets();
 
+    // The embedded textures are decoded in parallel, the model owns the data until the loader has finished
+    fw::TextureLoader textureLoader;
+    std::vector<TextureInfo*> loadedTextures;
     for (const auto& kv : mesh.materials)
     {
         for (unsigned int i = 0; i < kv.second.size(); ++i)
@@ -200,34 +212,52 @@ void RenderObject::createRenderObject()
             const std::vector<unsigned char>& textureData = model.getTextureData(index + i);
             for (TextureInfo& info : textures)
             {
-                if (info.imageView == VK_NULL_HANDLE && info.type == kv.first)
+                bool loading = std::find(loadedTextures.begin(), loadedTextures.end(), &info) != loadedTextures.end();
+                if (!loading && info.type == kv.first)
                 {
                     VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
                     if (info.type == aiTextureType_DIFFUSE || info.type == aiTextureType_EMISSIVE)
                     {
                         format = VK_FORMAT_R8G8B8A8_SRGB;
                     }
-                    info.texture.load(textureData.data(), textureData.size(), format);
-                    info.imageView = info.texture.getImageView();
+                    textureLoader.add(info.texture, textureData.data(), textureData.size(), format);
+                    loadedTextures.push_back(&info);
                     break;
                 }
             }
         }
     }
+
+    CHECK(textureLoader.wait());
+    for (TextureInfo* info : loadedTextures)
+    {
+        info->imageView = info->texture.getImageView();
+    }
 }
 
-void RenderObject::allocateDescriptorSet()
+void RenderObject::allocateDescriptorSets()
 {
+    descriptorSets.resize(uniformBuffers.size());
+
+    std::vector<VkDescriptorSetLayout> layouts(descriptorSets.size(), descriptorSetLayout);
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &descriptorSetLayout;
+    allocInfo.descriptorSetCount = fw::ui32size(layouts);
+    allocInfo.pSetLayouts = layouts.data();
+
+    VK_CHECK(vkAllocateDescriptorSets(logicalDevice, &allocInfo, descriptorSets.data()))
+}
 
-    VK_CHECK(vkAllocateDescriptorSets(logicalDevice, &allocInfo, &descriptorSet))
+void RenderObject::updateDescriptorSets()
+{
+    for (size_t i = 0; i < descriptorSets.size(); ++i)
+    {
+        updateDescriptorSet(descriptorSets[i], uniformBuffers[i]);
+    }
 }
 
-void RenderObject::updateDescriptorSet()
+void RenderObject::updateDescriptorSet(VkDescriptorSet descriptorSet, const fw::Buffer& uniformBuffer)
 {
     VkDescriptorBufferInfo bufferInfo{};
     bufferInfo.buffer = uniformBuffer.getBuffer();
@@ -1,12 +1,14 @@
 #include "Skybox.h"
 #include "Helpers.h"
 
+#include "fw/API.h"
 #include "fw/Common.h"
 #include "fw/Context.h"
 #include "fw/Macros.h"
 #include "fw/Model.h"
 #include "fw/Pipeline.h"
 #include "fw/RenderPass.h"
+#include "fw/ShaderModuleCache.h"
 
 #include <array>
 
@@ -37,10 +39,10 @@ void Skybox::update(const fw::Camera& camera)
     matrices.world = transformation.getWorldMatrix();
     matrices.view = camera.getViewMatrix();
     matrices.proj = camera.getProjectionMatrix();
-    transformationBuffer.setData(sizeof(matrices), &matrices);
+    transformationBuffers[fw::API::getCurrentSwapChainImageIndex()].setData(sizeof(matrices), &matrices);
 }
 
-void Skybox::render(VkCommandBuffer cb)
+void Skybox::render(VkCommandBuffer cb, uint32_t imageIndex)
 {
     vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 
@@ -48,7 +50,7 @@ void Skybox::render(VkCommandBuffer cb)
     VkBuffer vb = vertexBuffer.getBuffer();
     vkCmdBindVertexBuffers(cb, 0, 1, &vb, offsets);
     vkCmdBindIndexBuffer(cb, indexBuffer.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
-    vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[imageIndex], 0, nullptr);
     vkCmdDrawIndexed(cb, numIndices, 1, 0, 0, 0);
 }
 
@@ -84,10 +86,10 @@ void Skybox::createPipeline()
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
@@ -144,7 +146,7 @@ void Skybox::createPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    VK_CHECK(vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline));
 }
 
 void Skybox::createSkybox()
@@ -163,48 +165,59 @@ void Skybox::createSkybox()
     numIndices = fw::ui32size(mesh.indices);
 
     // Allocate descriptors
+    uint32_t imageCount = fw::API::getSwapChainImageCount();
+    descriptorSets.resize(imageCount);
+
+    std::vector<VkDescriptorSetLayout> layouts(imageCount, descriptorSetLayout);
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &descriptorSetLayout;
+    allocInfo.descriptorSetCount = imageCount;
+    allocInfo.pSetLayouts = layouts.data();
 
-    VK_CHECK(vkAllocateDescriptorSets(logicalDevice, &allocInfo, &descriptorSet));
+    VK_CHECK(vkAllocateDescriptorSets(logicalDevice, &allocInfo, descriptorSets.data()));
 
     VkMemoryPropertyFlags uboProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    success = success
-        && transformationBuffer.create(transformMatricesSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties);
+    transformationBuffers.resize(imageCount);
+    for (fw::Buffer& transformationBuffer : transformationBuffers)
+    {
+        success = success
+            && transformationBuffer.create(transformMatricesSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties);
+    }
 
     CHECK(success);
 
     // Update descriptors
-    VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = transformationBuffer.getBuffer();
-    bufferInfo.offset = 0;
-    bufferInfo.range = transformMatricesSize;
-
     VkDescriptorImageInfo imageInfo{};
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     imageInfo.imageView = texture;
     imageInfo.sampler = sampler;
 
-    std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{};
-
-    writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writeDescriptorSets[0].dstSet = descriptorSet;
-    writeDescriptorSets[0].dstBinding = 0;
-    writeDescriptorSets[0].dstArrayElement = 0;
-    writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    writeDescriptorSets[0].descriptorCount = 1;
-    writeDescriptorSets[0].pBufferInfo = &bufferInfo;
-
-    writeDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writeDescriptorSets[1].dstSet = descriptorSet;
-    writeDescriptorSets[1].dstBinding = 1;
-    writeDescriptorSets[1].dstArrayElement = 0;
-    writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    writeDescriptorSets[1].descriptorCount = 1;
-    writeDescriptorSets[1].pImageInfo = &imageInfo;
-
-    vkUpdateDescriptorSets(logicalDevice, fw::ui32size(writeDescriptorSets), writeDescriptorSets.data(), 0, nullptr);
+    for (uint32_t i = 0; i < imageCount; ++i)
+    {
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = transformationBuffers[i].getBuffer();
+        bufferInfo.offset = 0;
+        bufferInfo.range = transformMatricesSize;
+
+        std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{};
+
+        writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writeDescriptorSets[0].dstSet = descriptorSets[i];
+        writeDescriptorSets[0].dstBinding = 0;
+        writeDescriptorSets[0].dstArrayElement = 0;
+        writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        writeDescriptorSets[0].descriptorCount = 1;
+        writeDescriptorSets[0].pBufferInfo = &bufferInfo;
+
+        writeDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writeDescriptorSets[1].dstSet = descriptorSets[i];
+        writeDescriptorSets[1].dstBinding = 1;
+        writeDescriptorSets[1].dstArrayElement = 0;
+        writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writeDescriptorSets[1].descriptorCount = 1;
+        writeDescriptorSets[1].pImageInfo = &imageInfo;
+
+        vkUpdateDescriptorSets(logicalDevice, fw::ui32size(writeDescriptorSets), writeDescriptorSets.data(), 0, nullptr);
+    }
 }
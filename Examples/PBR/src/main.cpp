@@ -1,7 +1,7 @@
 #include "PBRApp.h"
 #include "fw/Execute.h"
 
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 {
-    return fw::runApplication<PBRApp>();
+    return fw::runApplication<PBRApp>(argc, argv);
 }
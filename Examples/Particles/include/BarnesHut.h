@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Helpers.h"
+
+#include "fw/Buffer.h"
+#include "fw/DescriptorAllocator.h"
+#include "fw/RadixSort.h"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+// Approximates the forces with a tree built over the Morton codes of the positions. A node far enough away is used
+// as a single mass at its center of mass, which makes the cost O(N log N) instead of O(N²).
+class BarnesHut
+{
+public:
+    BarnesHut(){};
+    ~BarnesHut();
+    BarnesHut(const BarnesHut&) = delete;
+    BarnesHut(BarnesHut&&) = delete;
+    BarnesHut& operator=(const BarnesHut&) = delete;
+    BarnesHut& operator=(BarnesHut&&) = delete;
+
+    bool initialize(fw::Buffer* storageBuffer, uint32_t particleCount, uint32_t workgroupSize);
+    // Replaces the direction pass. The comparison calculates the exact forces of evenly spaced samples too.
+    void recordForces(VkCommandBuffer commandBuffer, bool compareWithExact, const std::string& scopeName);
+
+    // Node size / distance below which a node is not opened, zero gives the exact forces
+    void setOpeningAngle(float openingAngle);
+    float getOpeningAngle() const;
+    // Relative error of the samples in the last compared frame that has finished
+    void getError(float& mean, float& max) const;
+
+private:
+    enum Stage
+    {
+        Bounds,
+        Morton,
+        Build,
+        Reduce,
+        Traverse,
+        Compare,
+        StageCount
+    };
+
+    struct SpecializationData
+    {
+        float gravity = c_gravity;
+        int32_t particleCount = 0;
+        uint32_t workgroupSize = 0;
+        int32_t sampleCount = 0;
+    };
+
+    struct Node
+    {
+        glm::vec4 centerOfMass;
+        int32_t left;
+        int32_t right;
+        int32_t parent;
+        float size;
+    };
+
+    VkDevice m_logicalDevice = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    std::array<VkPipeline, StageCount> m_pipelines{};
+
+    uint32_t m_particleCount = 0;
+    uint32_t m_workgroupSize = 0;
+    uint32_t m_sampleCount = 0;
+    float m_openingAngle = 0.5f;
+
+    SpecializationData m_specializationData;
+    std::array<VkSpecializationMapEntry, 4> m_specializationEntries{};
+    VkSpecializationInfo m_specializationInfo{};
+
+    fw::Buffer* m_storageBuffer;
+    fw::Buffer m_keyBuffer;
+    fw::Buffer m_valueBuffer;
+    fw::RadixSort m_radixSort;
+    fw::Buffer m_sortedPositionBuffer;
+    fw::Buffer m_nodeBuffer;
+    fw::Buffer m_leafParentBuffer;
+    fw::Buffer m_visitBuffer;
+    fw::Buffer m_boundsBuffer;
+    fw::Buffer m_forceBuffer;
+    fw::Buffer m_errorBuffer;
+    fw::Buffer m_parameterBuffer;
+
+    fw::DescriptorAllocator m_descriptorAllocator;
+    VkDescriptorSet m_descriptorSet;
+
+    void createSpecializationInfo();
+    void createBuffers();
+    void createDescriptorSetLayout();
+    void createPipelines();
+    void createDescriptorSet();
+    void dispatch(VkCommandBuffer commandBuffer, Stage stage, uint32_t invocationCount);
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Helpers.h"
+
+#include "fw/ThreadPool.h"
+
+#include <cstdint>
+#include <vector>
+
+// Same steps as direction.comp and position.comp on the CPU, for validating the GPU results and for running without
+// a fast GPU. The particles are kept as structure of arrays so that the force loop can use SIMD, with AVX2 when the
+// compiler targets it, NEON on ARM and SSE2 otherwise on x64. The rows of particles are split over a thread pool.
+class CpuSimulation
+{
+public:
+    // Zero uses all the hardware threads
+    explicit CpuSimulation(uint32_t threadCount = 0);
+    CpuSimulation(const CpuSimulation&) = delete;
+    CpuSimulation(CpuSimulation&&) = delete;
+    CpuSimulation& operator=(const CpuSimulation&) = delete;
+    CpuSimulation& operator=(CpuSimulation&&) = delete;
+
+    void setParticles(const Particle* particles, uint32_t count);
+    // Writes the same layout as the storage buffer
+    void getParticles(Particle* particles) const;
+    void step();
+
+    uint32_t getParticleCount() const;
+    static const char* getInstructionSet();
+
+private:
+    uint32_t m_particleCount = 0;
+    fw::ThreadPool m_threadPool;
+
+    // Padded to the SIMD width with massless particles
+    std::vector<float> m_positionX;
+    std::vector<float> m_positionY;
+    std::vector<float> m_positionZ;
+    std::vector<float> m_mass;
+    std::vector<float> m_directionX;
+    std::vector<float> m_directionY;
+    std::vector<float> m_directionZ;
+    std::vector<float> m_directionW;
+
+    void updateDirections(size_t begin, size_t end);
+    void updatePositions(size_t begin, size_t end);
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Helpers.h"
+
+#include "fw/Buffer.h"
+#include "fw/DescriptorAllocator.h"
+#include "fw/RadixSort.h"
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+
+// Orders the particles back to front every frame so that they blend correctly. The particle indices sorted by view
+// depth are copied to the index buffer of the render buffer and the particles are drawn indexed.
+class DepthSort
+{
+public:
+    using IndexBuffers = std::array<fw::Buffer*, c_renderBufferCount>;
+
+    DepthSort(){};
+    ~DepthSort();
+    DepthSort(const DepthSort&) = delete;
+    DepthSort(DepthSort&&) = delete;
+    DepthSort& operator=(const DepthSort&) = delete;
+    DepthSort& operator=(DepthSort&&) = delete;
+
+    bool initialize(fw::Buffer* storageBuffer, const IndexBuffers& indexBuffers, uint32_t particleCount, uint32_t workgroupSize);
+    // The view of the frame that writes the render buffer, the GPU has finished with the previous one
+    void setView(const glm::mat4& view, uint32_t renderBufferIndex);
+    // Expects the positions to be written before the compute shader stage
+    void record(VkCommandBuffer commandBuffer, uint32_t renderBufferIndex);
+
+    // Name of the GPU profiler scope around the radix sort
+    static const char* getScopeName();
+
+private:
+    struct SpecializationData
+    {
+        int32_t particleCount = 0;
+        uint32_t workgroupSize = 0;
+    };
+
+    VkDevice m_logicalDevice = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_depthPipeline = VK_NULL_HANDLE;
+
+    uint32_t m_particleCount = 0;
+    uint32_t m_workgroupSize = 0;
+
+    SpecializationData m_specializationData;
+    std::array<VkSpecializationMapEntry, 2> m_specializationEntries{};
+    VkSpecializationInfo m_specializationInfo{};
+
+    fw::Buffer* m_storageBuffer;
+    IndexBuffers m_indexBuffers;
+    fw::Buffer m_keyBuffer;
+    fw::Buffer m_valueBuffer;
+    std::array<fw::Buffer, c_renderBufferCount> m_viewBuffers;
+    fw::RadixSort m_radixSort;
+
+    fw::DescriptorAllocator m_descriptorAllocator;
+    std::array<VkDescriptorSet, c_renderBufferCount> m_descriptorSets{};
+
+    void createSpecializationInfo();
+    void createBuffers();
+    void createDescriptorSetLayout();
+    void createPipeline();
+    void createDescriptorSets();
+};
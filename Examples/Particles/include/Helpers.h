@@ -21,7 +21,12 @@ const std::string c_assetsFolder = ASSETS_PATH;
 const std::string c_shaderFolder = SHADER_PATH;
 
 const std::size_t c_transformMatricesSize = sizeof(Matrices);
-const int c_numParticles = 16000;
-const int c_bufferSize = sizeof(Particle) * c_numParticles;
-const int c_workgroupSize = 32;
-const float c_initialSpeed = 100.0f;
\ No newline at end of file
+const uint32_t c_numParticles = 16000;
+const uint32_t c_workgroupSize = 256;
+const uint32_t c_tileSize = 256;
+const float c_gravity = 0.00003f;
+const float c_initialSpeed = 100.0f;
+// The compute of a frame writes one copy while the previous frame is drawn from the other
+const uint32_t c_renderBufferCount = 2;
+// Distance moved per unit of direction in a step, the same as in position.comp
+const float c_positionStep = 0.0001f;
\ No newline at end of file
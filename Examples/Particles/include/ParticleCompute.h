@@ -1,33 +1,118 @@
 #pragma once
 
+#include "BarnesHut.h"
+#include "CpuSimulation.h"
+#include "DepthSort.h"
+#include "Helpers.h"
+
 #include "fw/Buffer.h"
+#include "fw/DescriptorAllocator.h"
 
 #include <vulkan/vulkan.h>
 
+#include <array>
+#include <string>
+#include <vector>
+
 class ParticleCompute
 {
 public:
+    enum class Kernel
+    {
+        // Every invocation reads all the positions from the storage buffer
+        Naive,
+        // The workgroup stages blocks of positions in shared memory
+        Tiled,
+        // Tree of the positions, approximate but scales to millions of particles
+        BarnesHut,
+        // Same steps as the naive kernel with SIMD and threads on the CPU
+        Cpu
+    };
+
+    struct Settings
+    {
+        uint32_t particleCount = c_numParticles;
+        Kernel kernel = Kernel::Tiled;
+        uint32_t workgroupSize = c_workgroupSize;
+        uint32_t tileSize = c_tileSize;
+        float openingAngle = 0.5f;
+        bool compareWithExact = false;
+        // Runs the CPU simulation for the same number of steps after this many GPU steps and logs the difference
+        uint32_t cpuCompareSteps = 0;
+        // The simulation of a frame runs alongside the rendering of the previous frame
+        bool asyncCompute = true;
+    };
+
+    using RenderBuffers = std::array<fw::Buffer*, c_renderBufferCount>;
+
     ParticleCompute(){};
     ~ParticleCompute();
 
-    bool initialize(fw::Buffer* storageBuffer);
+    // The simulation runs in the storage buffer and is copied to one of the render buffers at the end of every step,
+    // the particle indices sorted back to front are copied to the index buffer of the same render buffer
+    bool initialize(fw::Buffer* storageBuffer, const RenderBuffers& renderBuffers, const RenderBuffers& indexBuffers, const Settings& settings);
+    // Selects the render buffer of the frame, steps the CPU kernel and checks if it is time for the CPU comparison.
+    // The particles are sorted by their depth in the view.
+    void update(const glm::mat4& view);
+    // The render buffer that the compute of the current frame writes
+    uint32_t getRenderBufferIndex() const;
+    void setKernel(Kernel kernel);
+    Kernel getKernel() const;
+    void setOpeningAngle(float openingAngle);
+    // Calculates the exact forces of sampled particles next to the Barnes-Hut forces
+    void setCompareWithExact(bool compare);
+    const BarnesHut& getBarnesHut() const;
+    const Settings& getSettings() const;
+    // Name of the GPU profiler scope around the force calculation of the kernel
+    static std::string getScopeName(Kernel kernel);
+    // Clamps the settings to what the device and the kernels support with a warning, call before the buffers are
+    // sized with the particle count
+    static void validateSettings(Settings& settings);
 
 private:
+    struct SpecializationData
+    {
+        float gravity = c_gravity;
+        int32_t particleCount = 0;
+        uint32_t workgroupSize = 0;
+        int32_t tileSize = 0;
+    };
+
     VkDevice m_logicalDevice = VK_NULL_HANDLE;
     VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
     VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
-    VkPipeline m_directionPipeline = VK_NULL_HANDLE;
+    std::array<VkPipeline, 2> m_directionPipelines{};
     VkPipeline m_positionPipeline = VK_NULL_HANDLE;
+    // One per kernel and render buffer, switching only changes the one that is submitted. The CPU kernel only copies.
+    std::array<std::array<VkCommandBuffer, c_renderBufferCount>, 4> m_commandBuffers{};
+    std::array<VkCommandBuffer, c_renderBufferCount> m_compareCommandBuffers{};
+    uint32_t m_renderBufferIndex = 0;
 
+    Settings m_settings;
+    SpecializationData m_specializationData;
+    std::array<VkSpecializationMapEntry, 4> m_specializationEntries{};
+    VkSpecializationInfo m_specializationInfo{};
     fw::Buffer* m_storageBuffer;
+    RenderBuffers m_renderBuffers;
+    BarnesHut m_barnesHut;
+    DepthSort m_depthSort;
+    CpuSimulation m_cpuSimulation;
+    std::vector<Particle> m_initialParticles;
+    uint32_t m_gpuStepCount = 0;
 
-    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    fw::DescriptorAllocator m_descriptorAllocator;
     VkDescriptorSet m_descriptorSet;
 
+    void createSpecializationInfo();
     void writeRandomData();
     void createDescriptorSetLayout();
-    void createDirectionPipeline();
+    void createDirectionPipelines();
     void createPositionPipeline();
     void createDescriptorSets();
     void createCommandBuffers();
+    void recordCommandBuffer(VkCommandBuffer commandBuffer, Kernel kernel, bool compareWithExact, uint32_t renderBufferIndex);
+    void recordStep(VkCommandBuffer commandBuffer, Kernel kernel, bool compareWithExact);
+    void updateCommandBuffer();
+    void stepCpu();
+    void compareWithCpu();
 };
@@ -10,6 +10,7 @@
 
 #include <glm/glm.hpp>
 
+#include <array>
 #include <vector>
 
 class ParticlesApp : public fw::Application
@@ -27,7 +28,12 @@ public:
     virtual void onGUI() final;
     virtual void postUpdate() final{};
 
+    // Has to be set before the application is initialized
+    static void setComputeSettings(const ParticleCompute::Settings& settings);
+
 private:
+    static ParticleCompute::Settings s_computeSettings;
+
     VkDevice m_logicalDevice = VK_NULL_HANDLE;
     VkRenderPass m_renderPass = VK_NULL_HANDLE;
     VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
@@ -37,13 +43,20 @@ private:
     fw::Camera m_camera;
     fw::CameraController m_cameraController;
     Matrices m_matrices;
-    fw::Buffer m_uniformBuffer;
+    // The uniform buffers and the sets are per swap chain image, the frame that used the image last has finished when
+    // the image is acquired again
+    std::vector<fw::Buffer> m_uniformBuffers;
 
     VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
-    VkDescriptorSet m_descriptorSet;
+    std::vector<VkDescriptorSet> m_descriptorSets;
 
     ParticleCompute m_particleCompute;
     fw::Buffer m_storageBuffer;
+    std::array<fw::Buffer, c_renderBufferCount> m_renderBuffers;
+    // The particle indices from back to front
+    std::array<fw::Buffer, c_renderBufferCount> m_indexBuffers;
+    // One set of swap chain image command buffers per render buffer
+    std::array<std::vector<VkCommandBuffer>, c_renderBufferCount> m_commandBuffers;
 
     void createBuffer();
     void createRenderPass();
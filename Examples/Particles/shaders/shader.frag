@@ -9,5 +9,6 @@ layout(location = 0) out vec4 outColor;
 
 void main()
 {
-    outColor = vec4(0.0, 1.0 - inSpeed, 1.0, 1.0);
+    // Translucent, the particles are drawn back to front
+    outColor = vec4(0.0, 1.0 - inSpeed, 1.0, 0.5);
 }
@@ -0,0 +1,290 @@
+#include "BarnesHut.h"
+
+#include "fw/Common.h"
+#include "fw/Context.h"
+#include "fw/DescriptorLayoutCache.h"
+#include "fw/Macros.h"
+#include "fw/Pipeline.h"
+#include "fw/Profiler.h"
+#include "fw/ShaderModuleCache.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+// Particles compared with the exact forces, fewer when there are not as many particles
+const uint32_t c_maxSampleCount = 256;
+// Each invocation of the bounds pass reduces a strided range before the atomics
+const uint32_t c_boundsWorkgroupCount = 64;
+
+const std::array<const char*, 6> c_shaderFilenames = {
+    "bh_bounds.comp.spv",
+    "bh_morton.comp.spv",
+    "bh_build.comp.spv",
+    "bh_reduce.comp.spv",
+    "bh_traverse.comp.spv",
+    "bh_compare.comp.spv"};
+
+// Bits of the Morton codes, 10 per axis
+const uint32_t c_mortonBits = 30;
+
+// Ordered unsigned integer versions of the largest and smallest floats, the bounds are reset to these
+const uint32_t c_boundsMinReset = 0xFFFFFFFF;
+const uint32_t c_boundsMaxReset = 0;
+
+void addComputeBarrier(VkCommandBuffer commandBuffer)
+{
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+} // unnamed
+
+BarnesHut::~BarnesHut()
+{
+    for (VkPipeline pipeline : m_pipelines)
+    {
+        vkDestroyPipeline(m_logicalDevice, pipeline, nullptr);
+    }
+    vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
+}
+
+bool BarnesHut::initialize(fw::Buffer* storageBuffer, uint32_t particleCount, uint32_t workgroupSize)
+{
+    m_logicalDevice = fw::Context::getLogicalDevice();
+    m_storageBuffer = storageBuffer;
+    m_particleCount = particleCount;
+    m_workgroupSize = workgroupSize;
+    m_sampleCount = std::min(c_maxSampleCount, particleCount);
+
+    // A tree needs at least one internal node
+    CHECK(particleCount >= 2);
+
+    createSpecializationInfo();
+    createBuffers();
+    CHECK(m_radixSort.create(&m_keyBuffer, &m_valueBuffer, m_particleCount));
+    createDescriptorSetLayout();
+    createPipelines();
+    createDescriptorSet();
+    setOpeningAngle(m_openingAngle);
+
+    return true;
+}
+
+void BarnesHut::recordForces(VkCommandBuffer commandBuffer, bool compareWithExact, const std::string& scopeName)
+{
+    fw::Profiler::beginScope(commandBuffer, scopeName, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    uint32_t boundsResets[] = {c_boundsMinReset, c_boundsMaxReset};
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        vkCmdFillBuffer(commandBuffer, m_boundsBuffer.getBuffer(), i * sizeof(glm::uvec4), sizeof(glm::uvec4), boundsResets[i]);
+    }
+    vkCmdFillBuffer(commandBuffer, m_visitBuffer.getBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+    VkMemoryBarrier fillBarrier{};
+    fillBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    fillBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    fillBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &fillBarrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
+
+    dispatch(commandBuffer, Bounds, c_boundsWorkgroupCount * m_workgroupSize);
+    addComputeBarrier(commandBuffer);
+    dispatch(commandBuffer, Morton, m_particleCount);
+    addComputeBarrier(commandBuffer);
+
+    fw::Profiler::beginScope(commandBuffer, scopeName + " sort", VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    m_radixSort.record(commandBuffer, m_particleCount, c_mortonBits);
+    addComputeBarrier(commandBuffer);
+    fw::Profiler::endScope(commandBuffer, scopeName + " sort", VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    // The sort binds its own descriptor sets
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
+    dispatch(commandBuffer, Build, m_particleCount);
+    addComputeBarrier(commandBuffer);
+    dispatch(commandBuffer, Reduce, m_particleCount);
+    addComputeBarrier(commandBuffer);
+
+    fw::Profiler::beginScope(commandBuffer, scopeName + " traversal", VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    dispatch(commandBuffer, Traverse, m_particleCount);
+    fw::Profiler::endScope(commandBuffer, scopeName + " traversal", VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    if (compareWithExact)
+    {
+        addComputeBarrier(commandBuffer);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelines[Compare]);
+        vkCmdDispatch(commandBuffer, m_sampleCount, 1, 1);
+
+        VkMemoryBarrier hostBarrier{};
+        hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        hostBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+    }
+
+    fw::Profiler::endScope(commandBuffer, scopeName, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+}
+
+void BarnesHut::setOpeningAngle(float openingAngle)
+{
+    m_openingAngle = std::max(openingAngle, 0.0f);
+    m_parameterBuffer.setData(sizeof(m_openingAngle), &m_openingAngle);
+}
+
+float BarnesHut::getOpeningAngle() const
+{
+    return m_openingAngle;
+}
+
+void BarnesHut::getError(float& mean, float& max) const
+{
+    const float* errors = static_cast<const float*>(m_errorBuffer.getMappedMemory());
+    float sum = 0.0f;
+    max = 0.0f;
+    for (uint32_t i = 0; i < m_sampleCount; ++i)
+    {
+        sum += errors[i];
+        max = std::max(max, errors[i]);
+    }
+    mean = sum / static_cast<float>(m_sampleCount);
+}
+
+void BarnesHut::createSpecializationInfo()
+{
+    m_specializationData.particleCount = static_cast<int32_t>(m_particleCount);
+    m_specializationData.workgroupSize = m_workgroupSize;
+    m_specializationData.sampleCount = static_cast<int32_t>(m_sampleCount);
+
+    // IDs 0 to 2 are shared with the other particle shaders
+    m_specializationEntries[0].constantID = 0;
+    m_specializationEntries[0].size = sizeof(m_specializationData.gravity);
+    m_specializationEntries[0].offset = offsetof(SpecializationData, gravity);
+
+    m_specializationEntries[1].constantID = 1;
+    m_specializationEntries[1].size = sizeof(m_specializationData.particleCount);
+    m_specializationEntries[1].offset = offsetof(SpecializationData, particleCount);
+
+    m_specializationEntries[2].constantID = 2;
+    m_specializationEntries[2].size = sizeof(m_specializationData.workgroupSize);
+    m_specializationEntries[2].offset = offsetof(SpecializationData, workgroupSize);
+
+    m_specializationEntries[3].constantID = 5;
+    m_specializationEntries[3].size = sizeof(m_specializationData.sampleCount);
+    m_specializationEntries[3].offset = offsetof(SpecializationData, sampleCount);
+
+    m_specializationInfo.mapEntryCount = fw::ui32size(m_specializationEntries);
+    m_specializationInfo.pMapEntries = m_specializationEntries.data();
+    m_specializationInfo.dataSize = sizeof(m_specializationData);
+    m_specializationInfo.pData = &m_specializationData;
+}
+
+void BarnesHut::createBuffers()
+{
+    VkBufferUsageFlags storageUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    VkMemoryPropertyFlags deviceLocal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    uint32_t nodeCount = m_particleCount - 1;
+
+    CHECK(m_keyBuffer.create(sizeof(uint32_t) * m_particleCount, storageUsage, deviceLocal));
+    CHECK(m_valueBuffer.create(sizeof(uint32_t) * m_particleCount, storageUsage, deviceLocal));
+    CHECK(m_sortedPositionBuffer.create(sizeof(glm::vec4) * m_particleCount, storageUsage, deviceLocal));
+    CHECK(m_nodeBuffer.create(sizeof(Node) * nodeCount, storageUsage, deviceLocal));
+    CHECK(m_leafParentBuffer.create(sizeof(int32_t) * m_particleCount, storageUsage, deviceLocal));
+    CHECK(m_visitBuffer.create(sizeof(uint32_t) * nodeCount, storageUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, deviceLocal));
+    CHECK(m_boundsBuffer.create(sizeof(glm::uvec4) * 2, storageUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, deviceLocal));
+    CHECK(m_forceBuffer.create(sizeof(glm::vec4) * m_particleCount, storageUsage, deviceLocal));
+    CHECK(m_errorBuffer.create(sizeof(float) * m_sampleCount, storageUsage, hostVisible));
+    CHECK(m_parameterBuffer.create(sizeof(glm::vec4), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, hostVisible));
+
+    std::vector<float> noErrors(m_sampleCount, 0.0f);
+    m_errorBuffer.setData(sizeof(float) * m_sampleCount, noErrors.data());
+}
+
+void BarnesHut::createDescriptorSetLayout()
+{
+    // Bindings 0 to 9 are storage buffers and 10 is the parameters, every stage sees the same set
+    std::vector<VkDescriptorSetLayoutBinding> bindings(11);
+    for (uint32_t i = 0; i < bindings.size(); ++i)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = i < 10 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    m_descriptorSetLayout = fw::DescriptorLayoutCache::get(bindings);
+    CHECK(m_descriptorSetLayout != VK_NULL_HANDLE);
+}
+
+void BarnesHut::createPipelines()
+{
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = fw::Pipeline::getPipelineLayoutInfo(&m_descriptorSetLayout);
+    VK_CHECK(vkCreatePipelineLayout(m_logicalDevice, &pipelineLayoutInfo, nullptr, &m_pipelineLayout));
+
+    for (size_t i = 0; i < m_pipelines.size(); ++i)
+    {
+        VkPipelineShaderStageCreateInfo shaderStage = fw::Pipeline::getComputeShaderStageInfo(c_shaderFolder + c_shaderFilenames[i]);
+        shaderStage.pSpecializationInfo = &m_specializationInfo;
+
+        fw::Cleaner cleaner([&shaderStage]() {
+            fw::ShaderModuleCache::release(shaderStage.module);
+        });
+
+        VkComputePipelineCreateInfo pipelineCreateInfo{};
+        pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineCreateInfo.stage = shaderStage;
+        pipelineCreateInfo.layout = m_pipelineLayout;
+
+        VK_CHECK(vkCreateComputePipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineCreateInfo, nullptr, &m_pipelines[i]));
+    }
+}
+
+void BarnesHut::createDescriptorSet()
+{
+    CHECK(m_descriptorAllocator.allocate(m_descriptorSetLayout, m_descriptorSet));
+
+    std::array<const fw::Buffer*, 11> buffers = {
+        m_storageBuffer,
+        &m_keyBuffer,
+        &m_valueBuffer,
+        &m_sortedPositionBuffer,
+        &m_nodeBuffer,
+        &m_leafParentBuffer,
+        &m_visitBuffer,
+        &m_boundsBuffer,
+        &m_forceBuffer,
+        &m_errorBuffer,
+        &m_parameterBuffer};
+
+    std::array<VkDescriptorBufferInfo, 11> bufferInfos{};
+    std::array<VkWriteDescriptorSet, 11> descriptorWrites{};
+    for (uint32_t i = 0; i < descriptorWrites.size(); ++i)
+    {
+        bufferInfos[i].buffer = buffers[i]->getBuffer();
+        bufferInfos[i].offset = 0;
+        bufferInfos[i].range = VK_WHOLE_SIZE;
+
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = m_descriptorSet;
+        descriptorWrites[i].dstBinding = i;
+        descriptorWrites[i].dstArrayElement = 0;
+        descriptorWrites[i].descriptorType = i < 10 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrites[i].descriptorCount = 1;
+        descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+    }
+
+    vkUpdateDescriptorSets(m_logicalDevice, fw::ui32size(descriptorWrites), descriptorWrites.data(), 0, nullptr);
+}
+
+void BarnesHut::dispatch(VkCommandBuffer commandBuffer, Stage stage, uint32_t invocationCount)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelines[stage]);
+    vkCmdDispatch(commandBuffer, (invocationCount + m_workgroupSize - 1) / m_workgroupSize, 1, 1);
+}
@@ -0,0 +1,233 @@
+#include "CpuSimulation.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MYVK_PARTICLES_AVX2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define MYVK_PARTICLES_NEON
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MYVK_PARTICLES_SSE2
+#endif
+
+namespace
+{
+#if defined(MYVK_PARTICLES_AVX2)
+const uint32_t c_simdWidth = 8;
+#elif defined(MYVK_PARTICLES_NEON) || defined(MYVK_PARTICLES_SSE2)
+const uint32_t c_simdWidth = 4;
+#else
+const uint32_t c_simdWidth = 1;
+#endif
+
+#if defined(MYVK_PARTICLES_AVX2)
+float sum(__m256 v)
+{
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    return _mm_cvtss_f32(half);
+}
+
+__m256 multiplyAdd(__m256 a, __m256 b, __m256 c)
+{
+#if defined(__FMA__)
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+#elif defined(MYVK_PARTICLES_SSE2)
+float sum(__m128 v)
+{
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+#endif
+
+} // unnamed
+
+CpuSimulation::CpuSimulation(uint32_t threadCount) :
+    m_threadPool(threadCount)
+{
+}
+
+void CpuSimulation::setParticles(const Particle* particles, uint32_t count)
+{
+    m_particleCount = count;
+    size_t paddedCount = (count + c_simdWidth - 1) / c_simdWidth * c_simdWidth;
+    for (std::vector<float>* stream : {&m_positionX, &m_positionY, &m_positionZ, &m_mass, &m_directionX, &m_directionY, &m_directionZ, &m_directionW})
+    {
+        stream->assign(paddedCount, 0.0f);
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        m_positionX[i] = particles[i].position.x;
+        m_positionY[i] = particles[i].position.y;
+        m_positionZ[i] = particles[i].position.z;
+        m_mass[i] = particles[i].position.w;
+        m_directionX[i] = particles[i].direction.x;
+        m_directionY[i] = particles[i].direction.y;
+        m_directionZ[i] = particles[i].direction.z;
+        m_directionW[i] = particles[i].direction.w;
+    }
+}
+
+void CpuSimulation::getParticles(Particle* particles) const
+{
+    for (uint32_t i = 0; i < m_particleCount; ++i)
+    {
+        particles[i].position = glm::vec4(m_positionX[i], m_positionY[i], m_positionZ[i], m_mass[i]);
+        particles[i].direction = glm::vec4(m_directionX[i], m_directionY[i], m_directionZ[i], m_directionW[i]);
+    }
+}
+
+void CpuSimulation::step()
+{
+    // All the directions are updated before any position moves, like the two dispatches on the GPU
+    m_threadPool.parallelFor(m_particleCount, [this](size_t begin, size_t end, uint32_t) { updateDirections(begin, end); });
+    m_threadPool.parallelFor(m_particleCount, [this](size_t begin, size_t end, uint32_t) { updatePositions(begin, end); });
+}
+
+uint32_t CpuSimulation::getParticleCount() const
+{
+    return m_particleCount;
+}
+
+const char* CpuSimulation::getInstructionSet()
+{
+#if defined(MYVK_PARTICLES_AVX2)
+    return "AVX2";
+#elif defined(MYVK_PARTICLES_NEON)
+    return "NEON";
+#elif defined(MYVK_PARTICLES_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void CpuSimulation::updateDirections(size_t begin, size_t end)
+{
+    // The particle itself and the padding are at zero distance or have no mass, the force of a zero distance is
+    // masked out instead of comparing indices
+    const size_t paddedCount = m_positionX.size();
+    const float* otherX = m_positionX.data();
+    const float* otherY = m_positionY.data();
+    const float* otherZ = m_positionZ.data();
+    const float* otherMass = m_mass.data();
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        const float x = m_positionX[i];
+        const float y = m_positionY[i];
+        const float z = m_positionZ[i];
+        const float scale = c_gravity * m_mass[i];
+        float forceX = 0.0f;
+        float forceY = 0.0f;
+        float forceZ = 0.0f;
+
+#if defined(MYVK_PARTICLES_AVX2)
+        const __m256 px = _mm256_set1_ps(x);
+        const __m256 py = _mm256_set1_ps(y);
+        const __m256 pz = _mm256_set1_ps(z);
+        const __m256 s = _mm256_set1_ps(scale);
+        const __m256 zero = _mm256_setzero_ps();
+        __m256 fx = zero;
+        __m256 fy = zero;
+        __m256 fz = zero;
+        for (size_t j = 0; j < paddedCount; j += c_simdWidth)
+        {
+            __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(otherX + j), px);
+            __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(otherY + j), py);
+            __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(otherZ + j), pz);
+            __m256 distance = multiplyAdd(dz, dz, multiplyAdd(dy, dy, _mm256_mul_ps(dx, dx)));
+            __m256 strength = _mm256_div_ps(_mm256_mul_ps(s, _mm256_loadu_ps(otherMass + j)), distance);
+            strength = _mm256_and_ps(strength, _mm256_cmp_ps(distance, zero, _CMP_GT_OQ));
+            fx = multiplyAdd(strength, dx, fx);
+            fy = multiplyAdd(strength, dy, fy);
+            fz = multiplyAdd(strength, dz, fz);
+        }
+        forceX = sum(fx);
+        forceY = sum(fy);
+        forceZ = sum(fz);
+#elif defined(MYVK_PARTICLES_NEON)
+        const float32x4_t px = vdupq_n_f32(x);
+        const float32x4_t py = vdupq_n_f32(y);
+        const float32x4_t pz = vdupq_n_f32(z);
+        const float32x4_t s = vdupq_n_f32(scale);
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        float32x4_t fx = zero;
+        float32x4_t fy = zero;
+        float32x4_t fz = zero;
+        for (size_t j = 0; j < paddedCount; j += c_simdWidth)
+        {
+            float32x4_t dx = vsubq_f32(vld1q_f32(otherX + j), px);
+            float32x4_t dy = vsubq_f32(vld1q_f32(otherY + j), py);
+            float32x4_t dz = vsubq_f32(vld1q_f32(otherZ + j), pz);
+            float32x4_t distance = vfmaq_f32(vfmaq_f32(vmulq_f32(dx, dx), dy, dy), dz, dz);
+            float32x4_t strength = vdivq_f32(vmulq_f32(s, vld1q_f32(otherMass + j)), distance);
+            strength = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(strength), vcgtq_f32(distance, zero)));
+            fx = vfmaq_f32(fx, strength, dx);
+            fy = vfmaq_f32(fy, strength, dy);
+            fz = vfmaq_f32(fz, strength, dz);
+        }
+        forceX = vaddvq_f32(fx);
+        forceY = vaddvq_f32(fy);
+        forceZ = vaddvq_f32(fz);
+#elif defined(MYVK_PARTICLES_SSE2)
+        const __m128 px = _mm_set1_ps(x);
+        const __m128 py = _mm_set1_ps(y);
+        const __m128 pz = _mm_set1_ps(z);
+        const __m128 s = _mm_set1_ps(scale);
+        const __m128 zero = _mm_setzero_ps();
+        __m128 fx = zero;
+        __m128 fy = zero;
+        __m128 fz = zero;
+        for (size_t j = 0; j < paddedCount; j += c_simdWidth)
+        {
+            __m128 dx = _mm_sub_ps(_mm_loadu_ps(otherX + j), px);
+            __m128 dy = _mm_sub_ps(_mm_loadu_ps(otherY + j), py);
+            __m128 dz = _mm_sub_ps(_mm_loadu_ps(otherZ + j), pz);
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            __m128 strength = _mm_div_ps(_mm_mul_ps(s, _mm_loadu_ps(otherMass + j)), distance);
+            strength = _mm_and_ps(strength, _mm_cmpgt_ps(distance, zero));
+            fx = _mm_add_ps(fx, _mm_mul_ps(strength, dx));
+            fy = _mm_add_ps(fy, _mm_mul_ps(strength, dy));
+            fz = _mm_add_ps(fz, _mm_mul_ps(strength, dz));
+        }
+        forceX = sum(fx);
+        forceY = sum(fy);
+        forceZ = sum(fz);
+#else
+        for (size_t j = 0; j < paddedCount; ++j)
+        {
+            float dx = otherX[j] - x;
+            float dy = otherY[j] - y;
+            float dz = otherZ[j] - z;
+            float distance = dx * dx + dy * dy + dz * dz;
+            float strength = distance > 0.0f ? scale * otherMass[j] / distance : 0.0f;
+            forceX += strength * dx;
+            forceY += strength * dy;
+            forceZ += strength * dz;
+        }
+#endif
+
+        m_directionX[i] += forceX;
+        m_directionY[i] += forceY;
+        m_directionZ[i] += forceZ;
+    }
+}
+
+void CpuSimulation::updatePositions(size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        m_positionX[i] += m_directionX[i] * c_positionStep;
+        m_positionY[i] += m_directionY[i] * c_positionStep;
+        m_positionZ[i] += m_directionZ[i] * c_positionStep;
+    }
+}
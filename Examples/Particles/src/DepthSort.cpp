@@ -0,0 +1,193 @@
+#include "DepthSort.h"
+
+#include "fw/Common.h"
+#include "fw/Context.h"
+#include "fw/DescriptorLayoutCache.h"
+#include "fw/Macros.h"
+#include "fw/Pipeline.h"
+#include "fw/Profiler.h"
+#include "fw/ShaderModuleCache.h"
+
+#include <vector>
+
+namespace
+{
+const char* c_scopeName = "Depth sort";
+
+// Bindings 0 to 2 are the particles, the keys and the values, 3 is the view matrix
+const uint32_t c_bindingCount = 4;
+
+void addBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+{
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = srcAccess;
+    memoryBarrier.dstAccessMask = dstAccess;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+} // unnamed
+
+DepthSort::~DepthSort()
+{
+    vkDestroyPipeline(m_logicalDevice, m_depthPipeline, nullptr);
+    vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
+}
+
+bool DepthSort::initialize(fw::Buffer* storageBuffer, const IndexBuffers& indexBuffers, uint32_t particleCount, uint32_t workgroupSize)
+{
+    m_logicalDevice = fw::Context::getLogicalDevice();
+    m_storageBuffer = storageBuffer;
+    m_indexBuffers = indexBuffers;
+    m_particleCount = particleCount;
+    m_workgroupSize = workgroupSize;
+
+    createSpecializationInfo();
+    createBuffers();
+    CHECK(m_radixSort.create(&m_keyBuffer, &m_valueBuffer, m_particleCount));
+    createDescriptorSetLayout();
+    createPipeline();
+    createDescriptorSets();
+
+    return true;
+}
+
+void DepthSort::setView(const glm::mat4& view, uint32_t renderBufferIndex)
+{
+    m_viewBuffers[renderBufferIndex].setData(sizeof(view), &view);
+}
+
+void DepthSort::record(VkCommandBuffer commandBuffer, uint32_t renderBufferIndex)
+{
+    // The sort of the previous frame has finished with the keys and the values, and the positions are written
+    addBarrier(commandBuffer,
+               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+               VK_ACCESS_SHADER_WRITE_BIT,
+               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_depthPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSets[renderBufferIndex], 0, nullptr);
+    vkCmdDispatch(commandBuffer, (m_particleCount + m_workgroupSize - 1) / m_workgroupSize, 1, 1);
+
+    addBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    fw::Profiler::beginScope(commandBuffer, c_scopeName, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    m_radixSort.record(commandBuffer, m_particleCount);
+    fw::Profiler::endScope(commandBuffer, c_scopeName, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    addBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+    // Made visible to the index input of the rendering by the semaphore like the particle copy
+    VkBufferCopy copyRegion{};
+    copyRegion.size = sizeof(uint32_t) * m_particleCount;
+    vkCmdCopyBuffer(commandBuffer, m_valueBuffer.getBuffer(), m_indexBuffers[renderBufferIndex]->getBuffer(), 1, &copyRegion);
+}
+
+const char* DepthSort::getScopeName()
+{
+    return c_scopeName;
+}
+
+void DepthSort::createSpecializationInfo()
+{
+    m_specializationData.particleCount = static_cast<int32_t>(m_particleCount);
+    m_specializationData.workgroupSize = m_workgroupSize;
+
+    // Same IDs as in the other particle shaders
+    m_specializationEntries[0].constantID = 1;
+    m_specializationEntries[0].size = sizeof(m_specializationData.particleCount);
+    m_specializationEntries[0].offset = offsetof(SpecializationData, particleCount);
+
+    m_specializationEntries[1].constantID = 2;
+    m_specializationEntries[1].size = sizeof(m_specializationData.workgroupSize);
+    m_specializationEntries[1].offset = offsetof(SpecializationData, workgroupSize);
+
+    m_specializationInfo.mapEntryCount = fw::ui32size(m_specializationEntries);
+    m_specializationInfo.pMapEntries = m_specializationEntries.data();
+    m_specializationInfo.dataSize = sizeof(m_specializationData);
+    m_specializationInfo.pData = &m_specializationData;
+}
+
+void DepthSort::createBuffers()
+{
+    VkBufferUsageFlags storageUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    VkMemoryPropertyFlags deviceLocal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    CHECK(m_keyBuffer.create(sizeof(uint32_t) * m_particleCount, storageUsage, deviceLocal));
+    CHECK(m_valueBuffer.create(sizeof(uint32_t) * m_particleCount, storageUsage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, deviceLocal));
+    for (fw::Buffer& viewBuffer : m_viewBuffers)
+    {
+        CHECK(viewBuffer.create(sizeof(glm::mat4), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, hostVisible));
+    }
+}
+
+void DepthSort::createDescriptorSetLayout()
+{
+    std::vector<VkDescriptorSetLayoutBinding> bindings(c_bindingCount);
+    for (uint32_t i = 0; i < bindings.size(); ++i)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = i < 3 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    m_descriptorSetLayout = fw::DescriptorLayoutCache::get(bindings);
+    CHECK(m_descriptorSetLayout != VK_NULL_HANDLE);
+}
+
+void DepthSort::createPipeline()
+{
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = fw::Pipeline::getPipelineLayoutInfo(&m_descriptorSetLayout);
+    VK_CHECK(vkCreatePipelineLayout(m_logicalDevice, &pipelineLayoutInfo, nullptr, &m_pipelineLayout));
+
+    VkPipelineShaderStageCreateInfo shaderStage = fw::Pipeline::getComputeShaderStageInfo(c_shaderFolder + "depth.comp.spv");
+    shaderStage.pSpecializationInfo = &m_specializationInfo;
+
+    fw::Cleaner cleaner([&shaderStage]() {
+        fw::ShaderModuleCache::release(shaderStage.module);
+    });
+
+    VkComputePipelineCreateInfo pipelineCreateInfo{};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.stage = shaderStage;
+    pipelineCreateInfo.layout = m_pipelineLayout;
+
+    VK_CHECK(vkCreateComputePipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineCreateInfo, nullptr, &m_depthPipeline));
+}
+
+void DepthSort::createDescriptorSets()
+{
+    for (uint32_t i = 0; i < c_renderBufferCount; ++i)
+    {
+        CHECK(m_descriptorAllocator.allocate(m_descriptorSetLayout, m_descriptorSets[i]));
+
+        std::array<const fw::Buffer*, c_bindingCount> buffers = {
+            m_storageBuffer,
+            &m_keyBuffer,
+            &m_valueBuffer,
+            &m_viewBuffers[i]};
+
+        std::array<VkDescriptorBufferInfo, c_bindingCount> bufferInfos{};
+        std::array<VkWriteDescriptorSet, c_bindingCount> descriptorWrites{};
+        for (uint32_t binding = 0; binding < descriptorWrites.size(); ++binding)
+        {
+            bufferInfos[binding].buffer = buffers[binding]->getBuffer();
+            bufferInfos[binding].offset = 0;
+            bufferInfos[binding].range = VK_WHOLE_SIZE;
+
+            descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[binding].dstSet = m_descriptorSets[i];
+            descriptorWrites[binding].dstBinding = binding;
+            descriptorWrites[binding].dstArrayElement = 0;
+            descriptorWrites[binding].descriptorType = binding < 3 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            descriptorWrites[binding].descriptorCount = 1;
+            descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+        }
+
+        vkUpdateDescriptorSets(m_logicalDevice, fw::ui32size(descriptorWrites), descriptorWrites.data(), 0, nullptr);
+    }
+}
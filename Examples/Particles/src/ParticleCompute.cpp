@@ -5,48 +5,218 @@
 #include "fw/Command.h"
 #include "fw/Common.h"
 #include "fw/Context.h"
+#include "fw/DescriptorLayoutCache.h"
 #include "fw/Macros.h"
 #include "fw/Pipeline.h"
+#include "fw/Profiler.h"
+#include "fw/ShaderModuleCache.h"
 
-#include <array>
+#include <algorithm>
 #include <random>
 #include <iostream>
 
+namespace
+{
+const char* c_cpuScopeName = "N-body CPU";
+} // unnamed
+
 ParticleCompute::~ParticleCompute()
 {
-    vkDestroyDescriptorPool(m_logicalDevice, m_descriptorPool, nullptr);
     vkDestroyPipeline(m_logicalDevice, m_positionPipeline, nullptr);
-    vkDestroyPipeline(m_logicalDevice, m_directionPipeline, nullptr);
+    for (VkPipeline pipeline : m_directionPipelines)
+    {
+        vkDestroyPipeline(m_logicalDevice, pipeline, nullptr);
+    }
     vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
-    vkDestroyDescriptorSetLayout(m_logicalDevice, m_descriptorSetLayout, nullptr);
 }
 
-bool ParticleCompute::initialize(fw::Buffer* storageBuffer)
+bool ParticleCompute::initialize(fw::Buffer* storageBuffer, const RenderBuffers& renderBuffers, const RenderBuffers& indexBuffers, const Settings& settings)
 {
     m_logicalDevice = fw::Context::getLogicalDevice();
     m_storageBuffer = storageBuffer;
+    m_renderBuffers = renderBuffers;
+    m_settings = settings;
 
+    validateSettings(m_settings);
+    createSpecializationInfo();
     writeRandomData();
+    const Particle* particles = static_cast<const Particle*>(m_storageBuffer->getMappedMemory());
+    if (m_settings.cpuCompareSteps > 0)
+    {
+        m_initialParticles.assign(particles, particles + m_settings.particleCount);
+    }
+    if (m_settings.kernel == Kernel::Cpu)
+    {
+        m_cpuSimulation.setParticles(particles, m_settings.particleCount);
+    }
     createDescriptorSetLayout();
-    createDirectionPipeline();
+    createDirectionPipelines();
     createPositionPipeline();
     createDescriptorSets();
+    CHECK(m_barnesHut.initialize(m_storageBuffer, m_settings.particleCount, m_settings.workgroupSize));
+    m_barnesHut.setOpeningAngle(m_settings.openingAngle);
+    CHECK(m_depthSort.initialize(m_storageBuffer, indexBuffers, m_settings.particleCount, m_settings.workgroupSize));
     createCommandBuffers();
+    fw::API::setAsyncCompute(m_settings.asyncCompute);
 
     return true;
 }
 
+void ParticleCompute::update(const glm::mat4& view)
+{
+    m_renderBufferIndex = (m_renderBufferIndex + 1) % c_renderBufferCount;
+    m_depthSort.setView(view, m_renderBufferIndex);
+    updateCommandBuffer();
+
+    if (m_settings.kernel == Kernel::Cpu)
+    {
+        stepCpu();
+    }
+    else if (m_settings.cpuCompareSteps > 0)
+    {
+        // The compute command buffers of all the previous frames have been submitted
+        if (m_gpuStepCount == m_settings.cpuCompareSteps)
+        {
+            compareWithCpu();
+        }
+        ++m_gpuStepCount;
+    }
+}
+
+void ParticleCompute::setKernel(Kernel kernel)
+{
+    if (kernel == Kernel::Cpu && m_settings.kernel != Kernel::Cpu)
+    {
+        // Continue from the last GPU step
+        vkDeviceWaitIdle(m_logicalDevice);
+        m_cpuSimulation.setParticles(static_cast<const Particle*>(m_storageBuffer->getMappedMemory()), m_settings.particleCount);
+    }
+    m_settings.kernel = kernel;
+    updateCommandBuffer();
+}
+
+uint32_t ParticleCompute::getRenderBufferIndex() const
+{
+    return m_renderBufferIndex;
+}
+
+ParticleCompute::Kernel ParticleCompute::getKernel() const
+{
+    return m_settings.kernel;
+}
+
+void ParticleCompute::setOpeningAngle(float openingAngle)
+{
+    m_barnesHut.setOpeningAngle(openingAngle);
+    m_settings.openingAngle = m_barnesHut.getOpeningAngle();
+}
+
+void ParticleCompute::setCompareWithExact(bool compare)
+{
+    m_settings.compareWithExact = compare;
+    updateCommandBuffer();
+}
+
+const BarnesHut& ParticleCompute::getBarnesHut() const
+{
+    return m_barnesHut;
+}
+
+const ParticleCompute::Settings& ParticleCompute::getSettings() const
+{
+    return m_settings;
+}
+
+std::string ParticleCompute::getScopeName(Kernel kernel)
+{
+    switch (kernel)
+    {
+    case Kernel::Naive:
+        return "N-body naive";
+    case Kernel::Tiled:
+        return "N-body tiled";
+    case Kernel::BarnesHut:
+        return "N-body Barnes-Hut";
+    case Kernel::Cpu:
+        return c_cpuScopeName;
+    }
+    return "N-body";
+}
+
+void ParticleCompute::validateSettings(Settings& settings)
+{
+    const VkPhysicalDeviceLimits& limits = fw::Context::getPhysicalDeviceProperties()->limits;
+
+    uint32_t maxWorkgroupSize = std::min(limits.maxComputeWorkGroupSize[0], limits.maxComputeWorkGroupInvocations);
+    if (settings.workgroupSize == 0 || settings.workgroupSize > maxWorkgroupSize)
+    {
+        settings.workgroupSize = std::clamp(settings.workgroupSize, 1u, maxWorkgroupSize);
+        fw::printWarning("Particle workgroup size clamped to " + std::to_string(settings.workgroupSize));
+    }
+
+    uint32_t maxTileSize = limits.maxComputeSharedMemorySize / static_cast<uint32_t>(sizeof(glm::vec4));
+    if (settings.tileSize == 0 || settings.tileSize > maxTileSize)
+    {
+        settings.tileSize = std::clamp(settings.tileSize, 1u, maxTileSize);
+        fw::printWarning("Particle tile size clamped to " + std::to_string(settings.tileSize));
+    }
+
+    // The Barnes-Hut tree needs at least one internal node
+    if (settings.particleCount < 2)
+    {
+        settings.particleCount = 2;
+        fw::printWarning("Particle count clamped to " + std::to_string(settings.particleCount));
+    }
+
+    uint32_t workgroupCount = (settings.particleCount + settings.workgroupSize - 1) / settings.workgroupSize;
+    CHECK(workgroupCount <= limits.maxComputeWorkGroupCount[0]);
+
+    if (settings.kernel == Kernel::Cpu && settings.cpuCompareSteps > 0)
+    {
+        settings.cpuCompareSteps = 0;
+        fw::printWarning("CPU comparison needs a GPU kernel, disabled");
+    }
+}
+
+void ParticleCompute::createSpecializationInfo()
+{
+    m_specializationData.particleCount = static_cast<int32_t>(m_settings.particleCount);
+    m_specializationData.workgroupSize = m_settings.workgroupSize;
+    m_specializationData.tileSize = static_cast<int32_t>(m_settings.tileSize);
+
+    // Same IDs in all the compute shaders, the ones a shader does not declare are ignored
+    m_specializationEntries[0].constantID = 0;
+    m_specializationEntries[0].size = sizeof(m_specializationData.gravity);
+    m_specializationEntries[0].offset = offsetof(SpecializationData, gravity);
+
+    m_specializationEntries[1].constantID = 1;
+    m_specializationEntries[1].size = sizeof(m_specializationData.particleCount);
+    m_specializationEntries[1].offset = offsetof(SpecializationData, particleCount);
+
+    m_specializationEntries[2].constantID = 2;
+    m_specializationEntries[2].size = sizeof(m_specializationData.workgroupSize);
+    m_specializationEntries[2].offset = offsetof(SpecializationData, workgroupSize);
+
+    m_specializationEntries[3].constantID = 3;
+    m_specializationEntries[3].size = sizeof(m_specializationData.tileSize);
+    m_specializationEntries[3].offset = offsetof(SpecializationData, tileSize);
+
+    m_specializationInfo.mapEntryCount = static_cast<uint32_t>(m_specializationEntries.size());
+    m_specializationInfo.pMapEntries = m_specializationEntries.data();
+    m_specializationInfo.dataSize = sizeof(m_specializationData);
+    m_specializationInfo.pData = &m_specializationData;
+}
+
 void ParticleCompute::writeRandomData()
 {
-    void* mappedMemory = NULL;
-    vkMapMemory(m_logicalDevice, m_storageBuffer->getMemory(), 0, c_bufferSize, 0, &mappedMemory);
+    void* mappedMemory = m_storageBuffer->getMappedMemory();
     Particle* particleMemory = (Particle*)mappedMemory;
 
     std::default_random_engine randomEngine;
     std::uniform_real_distribution<float> positionDistribution(-0.5f, 0.5f);
     std::uniform_real_distribution<float> scaleDistribution(0.8f, 1.0f);
     std::uniform_real_distribution<float> directionDistribution(1.0f, 2.0f);
-    for (int i = 0; i < c_numParticles; ++i)
+    for (uint32_t i = 0; i < m_settings.particleCount; ++i)
     {
         glm::vec3 p(positionDistribution(randomEngine),
                     positionDistribution(randomEngine),
@@ -57,8 +227,6 @@ void ParticleCompute::writeRandomData()
         particleMemory[i].position = position;
         particleMemory[i].direction = position * c_initialSpeed;
     }
-
-    vkUnmapMemory(m_logicalDevice, m_storageBuffer->getMemory());
 }
 
 void ParticleCompute::createDescriptorSetLayout()
@@ -70,40 +238,42 @@ void ParticleCompute::createDescriptorSetLayout()
     storageLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
     storageLayoutBinding.pImmutableSamplers = nullptr; // Optional
 
-    std::vector<VkDescriptorSetLayoutBinding> bindings = {storageLayoutBinding};
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = fw::ui32size(bindings);
-    layoutInfo.pBindings = bindings.data();
-
-    VK_CHECK(vkCreateDescriptorSetLayout(m_logicalDevice, &layoutInfo, nullptr, &m_descriptorSetLayout));
+    m_descriptorSetLayout = fw::DescriptorLayoutCache::get({storageLayoutBinding});
+    CHECK(m_descriptorSetLayout != VK_NULL_HANDLE);
 }
 
-void ParticleCompute::createDirectionPipeline()
+void ParticleCompute::createDirectionPipelines()
 {
     VkPipelineLayoutCreateInfo pipelineLayoutInfo = fw::Pipeline::getPipelineLayoutInfo(&m_descriptorSetLayout);
     VK_CHECK(vkCreatePipelineLayout(m_logicalDevice, &pipelineLayoutInfo, nullptr, &m_pipelineLayout));
 
-    VkPipelineShaderStageCreateInfo shaderStage = fw::Pipeline::getComputeShaderStageInfo(c_shaderFolder + "direction.comp.spv");
+    for (Kernel kernel : {Kernel::Naive, Kernel::Tiled})
+    {
+        std::string filename = kernel == Kernel::Tiled ? "direction_tiled.comp.spv" : "direction.comp.spv";
+        VkPipelineShaderStageCreateInfo shaderStage = fw::Pipeline::getComputeShaderStageInfo(c_shaderFolder + filename);
+        shaderStage.pSpecializationInfo = &m_specializationInfo;
 
-    fw::Cleaner cleaner([&shaderStage, this]() {
-        vkDestroyShaderModule(m_logicalDevice, shaderStage.module, nullptr);
-    });
+        fw::Cleaner cleaner([&shaderStage]() {
+            fw::ShaderModuleCache::release(shaderStage.module);
+        });
 
-    VkComputePipelineCreateInfo pipelineCreateInfo{};
-    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-    pipelineCreateInfo.stage = shaderStage;
-    pipelineCreateInfo.layout = m_pipelineLayout;
+        VkComputePipelineCreateInfo pipelineCreateInfo{};
+        pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineCreateInfo.stage = shaderStage;
+        pipelineCreateInfo.layout = m_pipelineLayout;
 
-    VK_CHECK(vkCreateComputePipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_directionPipeline));
+        VkPipeline* pipeline = &m_directionPipelines[static_cast<size_t>(kernel)];
+        VK_CHECK(vkCreateComputePipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineCreateInfo, nullptr, pipeline));
+    }
 }
 
 void ParticleCompute::createPositionPipeline()
 {
     VkPipelineShaderStageCreateInfo shaderStage = fw::Pipeline::getComputeShaderStageInfo(c_shaderFolder + "position.comp.spv");
+    shaderStage.pSpecializationInfo = &m_specializationInfo;
 
-    fw::Cleaner cleaner([&shaderStage, this]() {
-        vkDestroyShaderModule(m_logicalDevice, shaderStage.module, nullptr);
+    fw::Cleaner cleaner([&shaderStage]() {
+        fw::ShaderModuleCache::release(shaderStage.module);
     });
 
     VkComputePipelineCreateInfo pipelineCreateInfo{};
@@ -111,37 +281,19 @@ void ParticleCompute::createPositionPipeline()
     pipelineCreateInfo.stage = shaderStage;
     pipelineCreateInfo.layout = m_pipelineLayout;
 
-    VK_CHECK(vkCreateComputePipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_positionPipeline));
+    VK_CHECK(vkCreateComputePipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineCreateInfo, nullptr, &m_positionPipeline));
 }
 
 void ParticleCompute::createDescriptorSets()
 {
-    std::array<VkDescriptorPoolSize, 1> poolSizes{};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    poolSizes[0].descriptorCount = 1;
-
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = fw::ui32size(poolSizes);
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = 1;
-
-    VK_CHECK(vkCreateDescriptorPool(m_logicalDevice, &poolInfo, nullptr, &m_descriptorPool));
-
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = m_descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &m_descriptorSetLayout;
-
-    VK_CHECK(vkAllocateDescriptorSets(m_logicalDevice, &allocInfo, &m_descriptorSet));
+    CHECK(m_descriptorAllocator.allocate(m_descriptorSetLayout, m_descriptorSet));
 
     VkWriteDescriptorSet descriptorWrite{};
 
     VkDescriptorBufferInfo bufferInfo{};
     bufferInfo.buffer = m_storageBuffer->getBuffer();
     bufferInfo.offset = 0;
-    bufferInfo.range = c_bufferSize;
+    bufferInfo.range = VK_WHOLE_SIZE;
 
     descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     descriptorWrite.dstSet = m_descriptorSet;
@@ -156,30 +308,77 @@ void ParticleCompute::createDescriptorSets()
 
 void ParticleCompute::createCommandBuffers()
 {
-    VkCommandBuffer commandBuffer;
     VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
     commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     commandBufferAllocateInfo.commandPool = fw::API::getComputeCommandPool();
     commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    commandBufferAllocateInfo.commandBufferCount = 1;
-    VK_CHECK(vkAllocateCommandBuffers(m_logicalDevice, &commandBufferAllocateInfo, &commandBuffer));
+    commandBufferAllocateInfo.commandBufferCount = c_renderBufferCount;
+    for (std::array<VkCommandBuffer, c_renderBufferCount>& commandBuffers : m_commandBuffers)
+    {
+        VK_CHECK(vkAllocateCommandBuffers(m_logicalDevice, &commandBufferAllocateInfo, commandBuffers.data()));
+    }
+    VK_CHECK(vkAllocateCommandBuffers(m_logicalDevice, &commandBufferAllocateInfo, m_compareCommandBuffers.data()));
+
+    for (uint32_t i = 0; i < c_renderBufferCount; ++i)
+    {
+        for (Kernel kernel : {Kernel::Naive, Kernel::Tiled, Kernel::BarnesHut, Kernel::Cpu})
+        {
+            recordCommandBuffer(m_commandBuffers[static_cast<size_t>(kernel)][i], kernel, false, i);
+        }
+        recordCommandBuffer(m_compareCommandBuffers[i], Kernel::BarnesHut, true, i);
+    }
+
+    updateCommandBuffer();
+}
 
+void ParticleCompute::updateCommandBuffer()
+{
+    bool compare = m_settings.kernel == Kernel::BarnesHut && m_settings.compareWithExact;
+    const std::array<VkCommandBuffer, c_renderBufferCount>& commandBuffers = compare ? m_compareCommandBuffers : m_commandBuffers[static_cast<size_t>(m_settings.kernel)];
+    fw::API::setNextComputeCommandBuffer(commandBuffers[m_renderBufferIndex]);
+}
+
+void ParticleCompute::recordCommandBuffer(VkCommandBuffer commandBuffer, Kernel kernel, bool compareWithExact, uint32_t renderBufferIndex)
+{
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = 0;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
     VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
 
+    // The CPU kernel has written the storage buffer before the submit
+    if (kernel != Kernel::Cpu)
+    {
+        recordStep(commandBuffer, kernel, compareWithExact);
+    }
+
+    // The framework submits the rendering of the frame with a semaphore wait on this so the copy is visible to the
+    // vertex input, also when the rendering is on another queue
+    VkBufferCopy copyRegion{};
+    copyRegion.size = sizeof(Particle) * m_settings.particleCount;
+    vkCmdCopyBuffer(commandBuffer, m_storageBuffer->getBuffer(), m_renderBuffers[renderBufferIndex]->getBuffer(), 1, &copyRegion);
+
+    m_depthSort.record(commandBuffer, renderBufferIndex);
+
+    VK_CHECK(vkEndCommandBuffer(commandBuffer));
+}
+
+void ParticleCompute::recordStep(VkCommandBuffer commandBuffer, Kernel kernel, bool compareWithExact)
+{
+    uint32_t workgroupCount = (m_settings.particleCount + m_settings.workgroupSize - 1) / m_settings.workgroupSize;
+
+    // Only the compute queue uses the storage buffer, the rendering draws from the render buffers
     VkBufferMemoryBarrier bufferBarrier{};
     bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
     bufferBarrier.buffer = m_storageBuffer->getBuffer();
-    bufferBarrier.size = c_bufferSize;
-    bufferBarrier.srcAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT; // Vertex shader invocations have finished reading from the buffer
-    bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT; // Compute shader wants to write to the buffer
+    bufferBarrier.size = VK_WHOLE_SIZE;
+    bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT; // The step of the previous frame has finished writing to the buffer
+    bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
     bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 
+    // The copy of the previous frame has finished reading from the buffer too
     vkCmdPipelineBarrier(commandBuffer,
-                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
                          0,
                          0,
@@ -189,15 +388,25 @@ void ParticleCompute::createCommandBuffers()
                          0,
                          nullptr);
 
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_directionPipeline);
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, NULL);
-    vkCmdDispatch(commandBuffer, c_numParticles / c_workgroupSize, 1, 1);
+    std::string scopeName = getScopeName(kernel);
+    if (kernel == Kernel::BarnesHut)
+    {
+        m_barnesHut.recordForces(commandBuffer, compareWithExact, scopeName);
+    }
+    else
+    {
+        fw::Profiler::beginScope(commandBuffer, scopeName, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_directionPipelines[static_cast<size_t>(kernel)]);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, NULL);
+        vkCmdDispatch(commandBuffer, workgroupCount, 1, 1);
+        fw::Profiler::endScope(commandBuffer, scopeName, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
 
     // Add memory barrier to ensure that compute shader has finished writing to the buffer
     bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT; // Compute shader has finished writes to the buffer
     bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
     bufferBarrier.buffer = m_storageBuffer->getBuffer();
-    bufferBarrier.size = c_bufferSize;
+    bufferBarrier.size = VK_WHOLE_SIZE;
     bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 
@@ -215,21 +424,20 @@ void ParticleCompute::createCommandBuffers()
 
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_positionPipeline);
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, NULL);
-    vkCmdDispatch(commandBuffer, c_numParticles / c_workgroupSize, 1, 1);
+    vkCmdDispatch(commandBuffer, workgroupCount, 1, 1);
 
-    // Add memory barrier to ensure that compute shader has finished writing to the buffer
-    // Without this the (rendering) vertex shader may display incomplete results (partial data from last frame)
+    // Add memory barrier to ensure that compute shader has finished writing to the buffer before it is copied
     bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT; // Compute shader has finished writes to the buffer
-    bufferBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT; // Vertex shader invocations want to read from the buffer
+    bufferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
     bufferBarrier.buffer = m_storageBuffer->getBuffer();
-    bufferBarrier.size = c_bufferSize;
+    bufferBarrier.size = VK_WHOLE_SIZE;
     bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 
     vkCmdPipelineBarrier(
         commandBuffer,
         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
         0,
         0,
         nullptr,
@@ -237,8 +445,53 @@ void ParticleCompute::createCommandBuffers()
         &bufferBarrier,
         0,
         nullptr);
+}
 
-    VK_CHECK(vkEndCommandBuffer(commandBuffer));
+void ParticleCompute::stepCpu()
+{
+    {
+        fw::Profiler::CpuScope scope(c_cpuScopeName);
+        m_cpuSimulation.step();
+    }
+    // The copy of the previous frame may still be reading the buffer
+    vkDeviceWaitIdle(m_logicalDevice);
+    m_cpuSimulation.getParticles(static_cast<Particle*>(m_storageBuffer->getMappedMemory()));
+}
+
+void ParticleCompute::compareWithCpu()
+{
+    vkDeviceWaitIdle(m_logicalDevice);
+    const Particle* gpuParticles = static_cast<const Particle*>(m_storageBuffer->getMappedMemory());
 
-    fw::API::setNextComputeCommandBuffer(commandBuffer);
+    uint32_t stepCount = m_settings.cpuCompareSteps;
+    m_cpuSimulation.setParticles(m_initialParticles.data(), m_settings.particleCount);
+    for (uint32_t i = 0; i < stepCount; ++i)
+    {
+        m_cpuSimulation.step();
+    }
+    std::vector<Particle> cpuParticles(m_settings.particleCount);
+    m_cpuSimulation.getParticles(cpuParticles.data());
+
+    double positionSum = 0.0;
+    float positionMax = 0.0f;
+    double directionSum = 0.0;
+    float directionMax = 0.0f;
+    for (uint32_t i = 0; i < m_settings.particleCount; ++i)
+    {
+        glm::vec3 cpuDirection(cpuParticles[i].direction);
+        float position = glm::length(glm::vec3(gpuParticles[i].position - cpuParticles[i].position));
+        float direction = glm::length(glm::vec3(gpuParticles[i].direction) - cpuDirection) / std::max(glm::length(cpuDirection), 1e-6f);
+        positionSum += position;
+        positionMax = std::max(positionMax, position);
+        directionSum += direction;
+        directionMax = std::max(directionMax, direction);
+    }
+    double count = static_cast<double>(m_settings.particleCount);
+    fw::printLog(getScopeName(m_settings.kernel) + " compared with " + CpuSimulation::getInstructionSet() + " CPU after " + std::to_string(stepCount) + " steps");
+    fw::printLog("Position difference: mean " + std::to_string(positionSum / count) + ", max " + std::to_string(positionMax));
+    fw::printLog("Relative direction difference: mean " + std::to_string(directionSum / count) + ", max " + std::to_string(directionMax));
+
+    m_settings.cpuCompareSteps = 0;
+    fw::API::setNextComputeCommandBuffer(nullptr);
+    fw::API::quitApplication();
 }
@@ -5,7 +5,9 @@
 #include "fw/Context.h"
 #include "fw/Macros.h"
 #include "fw/Pipeline.h"
+#include "fw/Profiler.h"
 #include "fw/RenderPass.h"
+#include "fw/ShaderModuleCache.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <vulkan/vulkan.h>
@@ -13,8 +15,19 @@
 #include <array>
 #include <iostream>
 
+ParticleCompute::Settings ParticlesApp::s_computeSettings;
+
 ParticlesApp::~ParticlesApp()
 {
+    const ParticleCompute::Settings& settings = m_particleCompute.getSettings();
+    if (settings.kernel == ParticleCompute::Kernel::BarnesHut && settings.compareWithExact)
+    {
+        float meanError = 0.0f;
+        float maxError = 0.0f;
+        m_particleCompute.getBarnesHut().getError(meanError, maxError);
+        fw::printLog("Barnes-Hut relative force error: mean " + std::to_string(meanError) + ", max " + std::to_string(maxError));
+    }
+
     vkDestroyDescriptorPool(m_logicalDevice, m_descriptorPool, nullptr);
     vkDestroyPipeline(m_logicalDevice, m_graphicsPipeline, nullptr);
     vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
@@ -46,8 +59,16 @@ bool ParticlesApp::initialize()
               << "maxComputeWorkGroupSize[2]: " << maxComputeWorkGroupSize[2] << "\n"
               << "maxComputeWorkGroupInvocations: " << maxComputeWorkGroupInvocations << "\n";
 
+    ParticleCompute::validateSettings(s_computeSettings);
     createBuffer();
-    m_particleCompute.initialize(&m_storageBuffer);
+    ParticleCompute::RenderBuffers renderBuffers;
+    ParticleCompute::RenderBuffers indexBuffers;
+    for (uint32_t i = 0; i < c_renderBufferCount; ++i)
+    {
+        renderBuffers[i] = &m_renderBuffers[i];
+        indexBuffers[i] = &m_indexBuffers[i];
+    }
+    m_particleCompute.initialize(&m_storageBuffer, renderBuffers, indexBuffers, s_computeSettings);
     createRenderPass();
     bool success = fw::API::initializeSwapChainWithDefaultFramebuffer(m_renderPass);
     createDescriptorSetLayout();
@@ -69,14 +90,37 @@ bool ParticlesApp::initialize()
 
     m_matrices.proj = m_camera.getProjectionMatrix();
 
+    // Every particle is pulled by all the others, except with the tree that has no fixed interaction count
+    double particleCount = static_cast<double>(s_computeSettings.particleCount);
+    std::string scopeName = ParticleCompute::getScopeName(s_computeSettings.kernel);
+    if (s_computeSettings.kernel == ParticleCompute::Kernel::BarnesHut)
+    {
+        fw::API::setBenchmarkThroughput(scopeName, particleCount, "particles");
+    }
+    else
+    {
+        fw::API::setBenchmarkThroughput(scopeName, particleCount * (particleCount - 1.0), "interactions");
+    }
+    fw::API::setBenchmarkThroughput(DepthSort::getScopeName(), particleCount, "keys");
+
     return true;
 }
 
+void ParticlesApp::setComputeSettings(const ParticleCompute::Settings& settings)
+{
+    s_computeSettings = settings;
+}
+
 void ParticlesApp::update()
 {
     m_cameraController.update();
     m_matrices.view = m_camera.getViewMatrix();
-    m_uniformBuffer.setData(sizeof(m_matrices), &m_matrices);
+    m_uniformBuffers[fw::API::getCurrentSwapChainImageIndex()].setData(sizeof(m_matrices), &m_matrices);
+    m_particleCompute.update(m_matrices.view);
+
+    // Draws the render buffer that the compute of this frame writes
+    const std::vector<VkCommandBuffer>& commandBuffers = m_commandBuffers[m_particleCompute.getRenderBufferIndex()];
+    fw::API::setNextCommandBuffer(commandBuffers[fw::API::getCurrentSwapChainImageIndex()]);
 }
 
 void ParticlesApp::onGUI()
@@ -90,6 +134,75 @@ void ParticlesApp::onGUI()
     ImGui::Text("Camera position: %.1f %.1f %.1f", p.x, p.y, p.z);
     ImGui::Text("%.2f ms/frame (%.0f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 
+    const ParticleCompute::Settings& settings = m_particleCompute.getSettings();
+    ImGui::Text("Particles: %u, workgroup size: %u, tile size: %u", settings.particleCount, settings.workgroupSize, settings.tileSize);
+    int kernel = static_cast<int>(m_particleCompute.getKernel());
+    bool changed = ImGui::RadioButton("Naive", &kernel, static_cast<int>(ParticleCompute::Kernel::Naive));
+    ImGui::SameLine();
+    changed = ImGui::RadioButton("Tiled", &kernel, static_cast<int>(ParticleCompute::Kernel::Tiled)) || changed;
+    ImGui::SameLine();
+    changed = ImGui::RadioButton("Barnes-Hut", &kernel, static_cast<int>(ParticleCompute::Kernel::BarnesHut)) || changed;
+    ImGui::SameLine();
+    changed = ImGui::RadioButton("CPU", &kernel, static_cast<int>(ParticleCompute::Kernel::Cpu)) || changed;
+    if (changed)
+    {
+        m_particleCompute.setKernel(static_cast<ParticleCompute::Kernel>(kernel));
+    }
+
+    bool asyncCompute = fw::API::isAsyncComputeEnabled();
+    if (ImGui::Checkbox("Async compute", &asyncCompute))
+    {
+        fw::API::setAsyncCompute(asyncCompute);
+    }
+    ImGui::SameLine();
+    ImGui::Text("Compute queue: %s", fw::API::hasDedicatedComputeQueue() ? "dedicated" : "shared with graphics");
+
+    bool barnesHut = m_particleCompute.getKernel() == ParticleCompute::Kernel::BarnesHut;
+    if (barnesHut)
+    {
+        float openingAngle = settings.openingAngle;
+        if (ImGui::SliderFloat("Opening angle", &openingAngle, 0.0f, 1.5f))
+        {
+            m_particleCompute.setOpeningAngle(openingAngle);
+        }
+        bool compare = settings.compareWithExact;
+        if (ImGui::Checkbox("Compare with exact", &compare))
+        {
+            m_particleCompute.setCompareWithExact(compare);
+        }
+        if (compare)
+        {
+            float meanError = 0.0f;
+            float maxError = 0.0f;
+            m_particleCompute.getBarnesHut().getError(meanError, maxError);
+            ImGui::Text("Relative force error: mean %.4f, max %.4f", meanError, maxError);
+        }
+    }
+
+    bool cpu = m_particleCompute.getKernel() == ParticleCompute::Kernel::Cpu;
+    if (cpu)
+    {
+        ImGui::Text("Instruction set: %s", CpuSimulation::getInstructionSet());
+    }
+
+    std::string scopeName = ParticleCompute::getScopeName(m_particleCompute.getKernel());
+    for (const fw::Profiler::Result& result : fw::Profiler::getResults())
+    {
+        if (result.gpu != cpu && result.name == scopeName && result.averageMs > 0.0)
+        {
+            double particleCount = static_cast<double>(settings.particleCount);
+            if (barnesHut)
+            {
+                ImGui::Text("%.3f ms, %.2f M particles/s", result.averageMs, particleCount / (result.averageMs / 1000.0) / 1.0e6);
+            }
+            else
+            {
+                double interactions = particleCount * (particleCount - 1.0) / (result.averageMs / 1000.0);
+                ImGui::Text("%.3f ms, %.2f G interactions/s", result.averageMs, interactions / 1.0e9);
+            }
+        }
+    }
+
 #ifndef WIN32
 #pragma GCC diagnostic pop
 #endif
@@ -98,7 +211,18 @@ void ParticlesApp::onGUI()
 void ParticlesApp::createBuffer()
 {
     VkMemoryPropertyFlags uboProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    m_storageBuffer.create(c_bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, uboProperties);
+    VkDeviceSize bufferSize = sizeof(Particle) * s_computeSettings.particleCount;
+    CHECK(m_storageBuffer.create(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, uboProperties));
+    for (fw::Buffer& renderBuffer : m_renderBuffers)
+    {
+        // Written by the compute queue and read by the graphics queue
+        CHECK(renderBuffer.create(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true));
+    }
+    for (fw::Buffer& indexBuffer : m_indexBuffers)
+    {
+        VkDeviceSize indexBufferSize = sizeof(uint32_t) * s_computeSettings.particleCount;
+        CHECK(indexBuffer.create(indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true));
+    }
 }
 
 void ParticlesApp::createRenderPass()
@@ -177,10 +301,10 @@ void ParticlesApp::createPipeline()
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(m_logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
@@ -211,8 +335,13 @@ void ParticlesApp::createPipeline()
 
     VkPipelineRasterizationStateCreateInfo rasterizationState = fw::Pipeline::getRasterizationState();
     VkPipelineMultisampleStateCreateInfo multisampleState = fw::Pipeline::getMultisampleState();
+    // The particles are drawn back to front and blended over each other, depth writes would hide the ones behind
     VkPipelineDepthStencilStateCreateInfo depthStencilState = fw::Pipeline::getDepthStencilState();
+    depthStencilState.depthWriteEnable = VK_FALSE;
     VkPipelineColorBlendAttachmentState colorBlendAttachmentState = fw::Pipeline::getColorBlendAttachmentState();
+    colorBlendAttachmentState.blendEnable = VK_TRUE;
+    colorBlendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
     VkPipelineColorBlendStateCreateInfo colorBlendState = fw::Pipeline::getColorBlendState(&colorBlendAttachmentState);
 
     VkGraphicsPipelineCreateInfo pipelineInfo{};
@@ -233,7 +362,7 @@ void ParticlesApp::createPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
 }
 
 void ParticlesApp::createDescriptorPool()
@@ -255,48 +384,52 @@ void ParticlesApp::createDescriptorPool()
 
 void ParticlesApp::createDescriptorSets()
 {
-    std::vector<VkDescriptorSetLayout> layouts{m_descriptorSetLayout};
+    uint32_t imageCount = fw::API::getSwapChainImageCount();
+    m_descriptorSets.resize(imageCount);
+
+    std::vector<VkDescriptorSetLayout> layouts(imageCount, m_descriptorSetLayout);
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = m_descriptorPool;
     allocInfo.descriptorSetCount = fw::ui32size(layouts);
     allocInfo.pSetLayouts = layouts.data();
 
-    VK_CHECK(vkAllocateDescriptorSets(m_logicalDevice, &allocInfo, &m_descriptorSet));
-
-    std::array<VkWriteDescriptorSet, 1> descriptorWrites{};
+    VK_CHECK(vkAllocateDescriptorSets(m_logicalDevice, &allocInfo, m_descriptorSets.data()));
 
     VkMemoryPropertyFlags uboProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    CHECK(m_uniformBuffer.create(c_transformMatricesSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
-
-    VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = m_uniformBuffer.getBuffer();
-    bufferInfo.offset = 0;
-    bufferInfo.range = c_transformMatricesSize;
-
-    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[0].dstSet = m_descriptorSet;
-    descriptorWrites[0].dstBinding = 0;
-    descriptorWrites[0].dstArrayElement = 0;
-    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptorWrites[0].descriptorCount = 1;
-    descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-    vkUpdateDescriptorSets(m_logicalDevice, fw::ui32size(descriptorWrites), descriptorWrites.data(), 0, nullptr);
+    m_uniformBuffers.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; ++i)
+    {
+        CHECK(m_uniformBuffers[i].create(c_transformMatricesSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
+
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = m_uniformBuffers[i].getBuffer();
+        bufferInfo.offset = 0;
+        bufferInfo.range = c_transformMatricesSize;
+
+        std::array<VkWriteDescriptorSet, 1> descriptorWrites{};
+
+        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[0].dstSet = m_descriptorSets[i];
+        descriptorWrites[0].dstBinding = 0;
+        descriptorWrites[0].dstArrayElement = 0;
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrites[0].descriptorCount = 1;
+        descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+        vkUpdateDescriptorSets(m_logicalDevice, fw::ui32size(descriptorWrites), descriptorWrites.data(), 0, nullptr);
+    }
 }
 
 void ParticlesApp::createCommandBuffers()
 {
     const std::vector<VkFramebuffer>& swapChainFramebuffers = fw::API::getSwapChainFramebuffers();
-    std::vector<VkCommandBuffer> commandBuffers(swapChainFramebuffers.size());
 
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.commandPool = fw::API::getCommandPool();
     allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = fw::ui32size(commandBuffers);
-
-    VK_CHECK(vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, commandBuffers.data()));
+    allocInfo.commandBufferCount = fw::ui32size(swapChainFramebuffers);
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -317,26 +450,32 @@ void ParticlesApp::createCommandBuffers()
 
     VkDeviceSize offsets[] = {0};
 
-    for (size_t i = 0; i < commandBuffers.size(); ++i)
+    for (uint32_t bufferIndex = 0; bufferIndex < c_renderBufferCount; ++bufferIndex)
     {
-        VkCommandBuffer cb = commandBuffers[i];
+        std::vector<VkCommandBuffer>& commandBuffers = m_commandBuffers[bufferIndex];
+        commandBuffers.resize(swapChainFramebuffers.size());
+        VK_CHECK(vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, commandBuffers.data()));
+
+        for (size_t i = 0; i < commandBuffers.size(); ++i)
+        {
+            VkCommandBuffer cb = commandBuffers[i];
 
-        vkBeginCommandBuffer(cb, &beginInfo);
+            vkBeginCommandBuffer(cb, &beginInfo);
 
-        renderPassInfo.framebuffer = swapChainFramebuffers[i];
+            renderPassInfo.framebuffer = swapChainFramebuffers[i];
 
-        vkCmdBeginRenderPass(cb, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+            vkCmdBeginRenderPass(cb, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
 
-        VkBuffer vb = m_storageBuffer.getBuffer();
-        vkCmdBindVertexBuffers(cb, 0, 1, &vb, offsets);
-        vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
-        vkCmdDraw(cb, c_numParticles, 1, 0, 0);
+            VkBuffer vb = m_renderBuffers[bufferIndex].getBuffer();
+            vkCmdBindVertexBuffers(cb, 0, 1, &vb, offsets);
+            vkCmdBindIndexBuffer(cb, m_indexBuffers[bufferIndex].getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSets[i], 0, nullptr);
+            vkCmdDrawIndexed(cb, s_computeSettings.particleCount, 1, 0, 0, 0);
 
-        vkCmdEndRenderPass(cb);
+            vkCmdEndRenderPass(cb);
 
-        VK_CHECK(vkEndCommandBuffer(cb));
+            VK_CHECK(vkEndCommandBuffer(cb));
+        }
     }
-
-    fw::API::setCommandBuffers(commandBuffers);
 }
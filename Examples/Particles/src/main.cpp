@@ -1,7 +1,74 @@
 #include "ParticlesApp.h"
 #include "fw/Execute.h"
 
-int main(int /*argc*/, char** /*argv*/)
+#include <cstdlib>
+#include <cstring>
+
+// Takes "--particles <count>", "--kernel <naive|tiled|barnes-hut|cpu>", "--workgroup-size <size>", "--tile-size <size>",
+// "--opening-angle <angle>", "--compare", "--cpu-compare <steps>" and "--no-async-compute" in addition to the framework
+// arguments
+int main(int argc, char** argv)
 {
-    return fw::runApplication<ParticlesApp>();
+    ParticleCompute::Settings settings;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--compare") == 0)
+        {
+            settings.compareWithExact = true;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--no-async-compute") == 0)
+        {
+            settings.asyncCompute = false;
+            continue;
+        }
+        if (i + 1 == argc)
+        {
+            break;
+        }
+
+        if (std::strcmp(argv[i], "--particles") == 0)
+        {
+            settings.particleCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--kernel") == 0)
+        {
+            const char* kernel = argv[++i];
+            if (std::strcmp(kernel, "naive") == 0)
+            {
+                settings.kernel = ParticleCompute::Kernel::Naive;
+            }
+            else if (std::strcmp(kernel, "barnes-hut") == 0)
+            {
+                settings.kernel = ParticleCompute::Kernel::BarnesHut;
+            }
+            else if (std::strcmp(kernel, "cpu") == 0)
+            {
+                settings.kernel = ParticleCompute::Kernel::Cpu;
+            }
+            else
+            {
+                settings.kernel = ParticleCompute::Kernel::Tiled;
+            }
+        }
+        else if (std::strcmp(argv[i], "--opening-angle") == 0)
+        {
+            settings.openingAngle = std::strtof(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--workgroup-size") == 0)
+        {
+            settings.workgroupSize = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--tile-size") == 0)
+        {
+            settings.tileSize = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--cpu-compare") == 0)
+        {
+            settings.cpuCompareSteps = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+    }
+    ParticlesApp::setComputeSettings(settings);
+
+    return fw::runApplication<ParticlesApp>(argc, argv);
 }
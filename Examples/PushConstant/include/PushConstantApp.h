@@ -28,7 +28,8 @@ public:
         fw::Buffer indexBuffer;
         uint32_t numIndices;
         fw::Texture texture;
-        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        // One per swap chain image
+        std::vector<VkDescriptorSet> descriptorSets;
     };
 
     PushConstantApp(){};
@@ -55,7 +56,8 @@ private:
     fw::CameraController m_cameraController;
     fw::Transformation m_trans;
     MatrixUBO m_ubo;
-    fw::Buffer m_uniformBuffer;
+    // One per swap chain image, the frame that used the image last has finished when the image is acquired again
+    std::vector<fw::Buffer> m_uniformBuffers;
     std::vector<RenderObject> m_renderObjects;
 
     VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
@@ -63,17 +65,12 @@ private:
 
     VkExtent2D extent;
 
-    VkFence m_renderBufferFence;
-    VkCommandBuffer m_commandBuffer;
-
     void createRenderPass();
     void createDescriptorSetLayout();
     void createPipeline();
     void createDescriptorPool();
     void createRenderObjects();
     void createDescriptorSets(uint32_t setCount);
-    void updateDescriptorSet(VkDescriptorSet descriptorSet, VkImageView imageView);
-    void createCommandBuffer();
-    void createFence();
+    void updateDescriptorSet(VkDescriptorSet descriptorSet, const fw::Buffer& uniformBuffer, VkImageView imageView);
     void updateCommandBuffer();
 };
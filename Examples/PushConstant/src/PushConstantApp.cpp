@@ -8,6 +8,7 @@
 #include "fw/Model.h"
 #include "fw/Pipeline.h"
 #include "fw/RenderPass.h"
+#include "fw/ShaderModuleCache.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <vulkan/vulkan.h>
@@ -20,12 +21,13 @@ namespace
 const std::size_t c_transformMatricesSize = sizeof(glm::mat4x4) * 3;
 const std::string c_assetsFolder = ASSETS_PATH;
 const std::string c_shaderFolder = SHADER_PATH;
+// Meshes in the droid model
+const uint32_t c_maxMeshCount = 2;
 const size_t c_pushConstantsSize = sizeof(glm::vec4);
 } // unnamed
 
 PushConstantApp::~PushConstantApp()
 {
-    vkDestroyFence(m_logicalDevice, m_renderBufferFence, nullptr);
     vkDestroyDescriptorPool(m_logicalDevice, m_descriptorPool, nullptr);
     vkDestroyPipeline(m_logicalDevice, m_graphicsPipeline, nullptr);
     vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
@@ -49,8 +51,6 @@ bool PushConstantApp::initialize()
     createDescriptorPool();
     createRenderObjects();
     success = success && fw::API::initializeGUI(m_descriptorPool);
-    createCommandBuffer();
-    createFence();
     CHECK(success);
 
     extent = fw::API::getSwapChainExtent();
@@ -72,7 +72,7 @@ void PushConstantApp::update()
     m_cameraController.update();
     m_ubo.view = m_camera.getViewMatrix();
 
-    m_uniformBuffer.setData(sizeof(m_ubo), &m_ubo);
+    m_uniformBuffers[fw::API::getCurrentSwapChainImageIndex()].setData(sizeof(m_ubo), &m_ubo);
 
     updateCommandBuffer();
 }
@@ -166,10 +166,10 @@ void PushConstantApp::createPipeline()
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(m_logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
@@ -222,38 +222,47 @@ void PushConstantApp::createPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
 }
 
 void PushConstantApp::createDescriptorPool()
 {
+    // A set per mesh and swap chain image and one for the GUI
+    uint32_t meshSetCount = c_maxMeshCount * fw::API::getSwapChainImageCount();
+
     std::array<VkDescriptorPoolSize, 2> poolSizes{};
     poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = 2;
+    poolSizes[0].descriptorCount = meshSetCount;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = 3;
+    poolSizes[1].descriptorCount = meshSetCount + 1;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = fw::ui32size(poolSizes);
     poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = 3;
+    poolInfo.maxSets = meshSetCount + 1;
 
     VK_CHECK(vkCreateDescriptorPool(m_logicalDevice, &poolInfo, nullptr, &m_descriptorPool));
 }
 
 void PushConstantApp::createRenderObjects()
 {
+    uint32_t imageCount = fw::API::getSwapChainImageCount();
     VkMemoryPropertyFlags uboProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    CHECK(m_uniformBuffer.create(c_transformMatricesSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
+    m_uniformBuffers.resize(imageCount);
+    for (fw::Buffer& uniformBuffer : m_uniformBuffers)
+    {
+        CHECK(uniformBuffer.create(c_transformMatricesSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
+    }
 
     fw::Model model;
     CHECK(model.loadModel(c_assetsFolder + "attack_droid.obj"));
 
     fw::Model::Meshes meshes = model.getMeshes();
     uint32_t numMeshes = fw::ui32size(meshes);
+    CHECK(numMeshes <= c_maxMeshCount);
 
-    createDescriptorSets(numMeshes);
+    createDescriptorSets(numMeshes * imageCount);
 
     m_renderObjects.resize(numMeshes);
 
@@ -264,15 +273,19 @@ void PushConstantApp::createRenderObjects()
         RenderObject& ro = m_renderObjects[i];
 
         success = success
-            && ro.vertexBuffer.createForDevice<fw::Mesh::Vertex>(mesh.getVertices(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+            && ro.vertexBuffer.createVertexBuffer(mesh)
             && ro.indexBuffer.createForDevice<uint32_t>(mesh.indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
         ro.numIndices = fw::ui32size(mesh.indices);
 
         std::string textureFile = c_assetsFolder + mesh.getFirstTextureOfType(aiTextureType::aiTextureType_DIFFUSE);
         ro.texture.load(textureFile, VK_FORMAT_R8G8B8A8_UNORM);
-        updateDescriptorSet(m_descriptorSets[i], ro.texture.getImageView());
-        ro.descriptorSet = m_descriptorSets[i];
+        ro.descriptorSets.resize(imageCount);
+        for (uint32_t image = 0; image < imageCount; ++image)
+        {
+            ro.descriptorSets[image] = m_descriptorSets[i * imageCount + image];
+            updateDescriptorSet(ro.descriptorSets[image], m_uniformBuffers[image], ro.texture.getImageView());
+        }
     }
 
     CHECK(success);
@@ -292,10 +305,10 @@ void PushConstantApp::createDescriptorSets(uint32_t setCount)
     VK_CHECK(vkAllocateDescriptorSets(m_logicalDevice, &allocInfo, m_descriptorSets.data()));
 }
 
-void PushConstantApp::updateDescriptorSet(VkDescriptorSet descriptorSet, VkImageView imageView)
+void PushConstantApp::updateDescriptorSet(VkDescriptorSet descriptorSet, const fw::Buffer& uniformBuffer, VkImageView imageView)
 {
     VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = m_uniformBuffer.getBuffer();
+    bufferInfo.buffer = uniformBuffer.getBuffer();
     bufferInfo.offset = 0;
     bufferInfo.range = c_transformMatricesSize;
 
@@ -325,31 +338,11 @@ void PushConstantApp::updateDescriptorSet(VkDescriptorSet descriptorSet, VkImage
     vkUpdateDescriptorSets(m_logicalDevice, fw::ui32size(descriptorWrites), descriptorWrites.data(), 0, nullptr);
 }
 
-void PushConstantApp::createCommandBuffer()
-{
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = fw::API::getCommandPool();
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = 1;
-
-    VK_CHECK(vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, &m_commandBuffer));
-}
-
-void PushConstantApp::createFence()
-{
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    VK_CHECK(vkCreateFence(m_logicalDevice, &fenceInfo, nullptr, &m_renderBufferFence));
-    fw::API::setRenderBufferFence(m_renderBufferFence);
-}
-
 void PushConstantApp::updateCommandBuffer()
 {
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     beginInfo.pInheritanceInfo = nullptr; // Optional
 
     std::array<VkClearValue, 2> clearValues{};
@@ -370,28 +363,26 @@ void PushConstantApp::updateCommandBuffer()
 
     VkDeviceSize offsets[] = {0};
 
-    vkWaitForFences(m_logicalDevice, 1, &m_renderBufferFence, VK_TRUE, UINT64_MAX);
-    vkResetFences(m_logicalDevice, 1, &m_renderBufferFence);
-
-    vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
-    vkCmdBeginRenderPass(m_commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+    VkCommandBuffer commandBuffer = fw::API::getCurrentFrameCommandBuffer();
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
     glm::vec4 color(std::cos(fw::API::getTimeSinceStart()), 1.0f, std::sin(fw::API::getTimeSinceStart()), 1.0f);
-    vkCmdPushConstants(m_commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, c_pushConstantsSize, &color);
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, c_pushConstantsSize, &color);
 
     for (const RenderObject& ro : m_renderObjects)
     {
         VkBuffer vb = ro.vertexBuffer.getBuffer();
-        vkCmdBindVertexBuffers(m_commandBuffer, 0, 1, &vb, offsets);
-        vkCmdBindIndexBuffer(m_commandBuffer, ro.indexBuffer.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vb, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, ro.indexBuffer.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
         vkCmdBindDescriptorSets(
-            m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &ro.descriptorSet, 0, nullptr);
-        vkCmdDrawIndexed(m_commandBuffer, ro.numIndices, 1, 0, 0, 0);
+            commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &ro.descriptorSets[currentIndex], 0, nullptr);
+        vkCmdDrawIndexed(commandBuffer, ro.numIndices, 1, 0, 0, 0);
     }
 
-    vkCmdEndRenderPass(m_commandBuffer);
+    vkCmdEndRenderPass(commandBuffer);
 
-    VK_CHECK(vkEndCommandBuffer(m_commandBuffer));
+    VK_CHECK(vkEndCommandBuffer(commandBuffer));
 
-    fw::API::setNextCommandBuffer(m_commandBuffer);
+    fw::API::setNextCommandBuffer(commandBuffer);
 }
@@ -1,7 +1,7 @@
 #include "PushConstantApp.h"
 #include "fw/Execute.h"
 
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 {
-    return fw::runApplication<PushConstantApp>();
+    return fw::runApplication<PushConstantApp>(argc, argv);
 }
@@ -2,6 +2,7 @@
 
 #include "fw/Buffer.h"
 #include "fw/Camera.h"
+#include "fw/DescriptorAllocator.h"
 #include "fw/Sampler.h"
 #include "fw/Transformation.h"
 #include "fw/Image.h"
@@ -59,7 +60,7 @@ private:
     VkDevice m_logicalDevice = VK_NULL_HANDLE;
     VkRenderPass m_renderPass = VK_NULL_HANDLE;
     VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
-    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    fw::DescriptorAllocator m_descriptorAllocator;
     VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
     VkPipeline m_graphicsPipeline = VK_NULL_HANDLE;
 
@@ -82,6 +83,5 @@ private:
     void createFramebuffer();
     void createDescriptorSetLayouts();
     void createPipeline();
-    void createDescriptorPool();
     void createRenderObjects();
 };
@@ -3,11 +3,14 @@
 #include "fw/Command.h"
 #include "fw/Common.h"
 #include "fw/Context.h"
+#include "fw/DescriptorLayoutCache.h"
 #include "fw/Macros.h"
 #include "fw/Mesh.h"
 #include "fw/Model.h"
 #include "fw/Pipeline.h"
 #include "fw/RenderPass.h"
+#include "fw/ShaderModuleCache.h"
+#include "fw/TextureLoader.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -30,10 +33,8 @@ GBufferPass::~GBufferPass()
     vkDestroyImageView(m_logicalDevice, m_normal.imageView, nullptr);
     vkDestroyImageView(m_logicalDevice, m_depth.imageView, nullptr);
     vkDestroyFramebuffer(m_logicalDevice, m_framebuffer, nullptr);
-    vkDestroyDescriptorPool(m_logicalDevice, m_descriptorPool, nullptr);
     vkDestroyPipeline(m_logicalDevice, m_graphicsPipeline, nullptr);
     vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
-    vkDestroyDescriptorSetLayout(m_logicalDevice, m_descriptorSetLayout, nullptr);
     vkDestroyRenderPass(m_logicalDevice, m_renderPass, nullptr);
 }
 
@@ -46,7 +47,6 @@ void GBufferPass::initialize(const fw::Camera* camera)
     createDescriptorSetLayouts();
     createPipeline();
     CHECK(m_sampler.create(VK_COMPARE_OP_ALWAYS));
-    createDescriptorPool();
     createRenderObjects();
 
     m_camera = camera;
@@ -250,13 +250,8 @@ void GBufferPass::createDescriptorSetLayouts()
     samplerBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     samplerBinding.pImmutableSamplers = nullptr;
 
-    std::vector<VkDescriptorSetLayoutBinding> gbufferBindings{matrixBinding, samplerBinding};
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = fw::ui32size(gbufferBindings);
-    layoutInfo.pBindings = gbufferBindings.data();
-
-    VK_CHECK(vkCreateDescriptorSetLayout(m_logicalDevice, &layoutInfo, nullptr, &m_descriptorSetLayout));
+    m_descriptorSetLayout = fw::DescriptorLayoutCache::get({matrixBinding, samplerBinding});
+    CHECK(m_descriptorSetLayout != VK_NULL_HANDLE);
 }
 
 void GBufferPass::createPipeline()
@@ -281,10 +276,10 @@ void GBufferPass::createPipeline()
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(m_logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
@@ -325,31 +320,17 @@ void GBufferPass::createPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
-}
-
-void GBufferPass::createDescriptorPool()
-{
-    std::array<VkDescriptorPoolSize, 2> poolSizes{};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = 4;
-    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = 4;
-
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = fw::ui32size(poolSizes);
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = 4;
-
-    VK_CHECK(vkCreateDescriptorPool(m_logicalDevice, &poolInfo, nullptr, &m_descriptorPool));
+    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
 }
 
 void GBufferPass::createRenderObjects()
 {
     VkMemoryPropertyFlags uboProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 
-    auto loadModel = [this, uboProperties](const std::string modelName, RenderObject& renderObject, std::string texture = "") {
+    // Textures of all the models are decoded in parallel, descriptors are written once they have been uploaded
+    fw::TextureLoader textureLoader;
+
+    auto loadModel = [this, uboProperties, &textureLoader](const std::string modelName, RenderObject& renderObject, std::string texture = "") {
         // Load model
         CHECK(renderObject.uniformBuffer.create(c_transformMatricesSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
         fw::Model model;
@@ -359,15 +340,9 @@ void GBufferPass::createRenderObjects()
         renderObject.objectData.resize(numMeshes);
 
         // Allocate desc sets
-        std::vector<VkDescriptorSet> descriptorSets(numMeshes);
+        std::vector<VkDescriptorSet> descriptorSets;
         std::vector<VkDescriptorSetLayout> gbufferLayouts(numMeshes, m_descriptorSetLayout);
-        VkDescriptorSetAllocateInfo gbufferAllocInfo{};
-        gbufferAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        gbufferAllocInfo.descriptorPool = m_descriptorPool;
-        gbufferAllocInfo.descriptorSetCount = numMeshes;
-        gbufferAllocInfo.pSetLayouts = gbufferLayouts.data();
-
-        VK_CHECK(vkAllocateDescriptorSets(m_logicalDevice, &gbufferAllocInfo, descriptorSets.data()));
+        CHECK(m_descriptorAllocator.allocate(gbufferLayouts, descriptorSets));
 
         for (unsigned int i = 0; i < numMeshes; ++i)
         {
@@ -375,17 +350,20 @@ void GBufferPass::createRenderObjects()
             ObjectData& data = renderObject.objectData[i];
 
             // Create buffers and textures
-            CHECK(data.vertexBuffer.createForDevice<fw::Mesh::Vertex>(mesh.getVertices(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT));
+            std::string textureFile = c_assetsFolder + (!texture.empty() ? texture : mesh.getFirstTextureOfType(aiTextureType::aiTextureType_DIFFUSE));
+            textureLoader.add(data.texture, textureFile, VK_FORMAT_R8G8B8A8_UNORM);
+
+            CHECK(data.vertexBuffer.createVertexBuffer(mesh));
             CHECK(data.indexBuffer.createForDevice<uint32_t>(mesh.indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT));
 
             data.numIndices = fw::ui32size(mesh.indices);
-
-            std::string textureFile = c_assetsFolder + (!texture.empty() ? texture : mesh.getFirstTextureOfType(aiTextureType::aiTextureType_DIFFUSE));
-            data.texture.load(textureFile, VK_FORMAT_R8G8B8A8_UNORM);
-
-            // Update descriptor set
             data.descriptorSet = descriptorSets[i];
+        }
+    };
 
+    auto updateDescriptorSets = [this](RenderObject& renderObject) {
+        for (ObjectData& data : renderObject.objectData)
+        {
             VkDescriptorBufferInfo matrixBufferInfo{};
             matrixBufferInfo.buffer = renderObject.uniformBuffer.getBuffer();
             matrixBufferInfo.offset = 0;
@@ -393,7 +371,7 @@ void GBufferPass::createRenderObjects()
 
             VkDescriptorImageInfo albedoTextureInfo{};
             albedoTextureInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            albedoTextureInfo.imageView = renderObject.objectData[i].texture.getImageView();
+            albedoTextureInfo.imageView = data.texture.getImageView();
             albedoTextureInfo.sampler = m_sampler.getSampler();
 
             std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
@@ -421,4 +399,9 @@ void GBufferPass::createRenderObjects()
     loadModel("attack_droid.obj", m_droid);
     loadModel("cube.obj", m_cube, "checker.png");
     loadModel("cube.obj", m_wall, "wall.jpg");
+
+    CHECK(textureLoader.wait());
+    updateDescriptorSets(m_droid);
+    updateDescriptorSets(m_cube);
+    updateDescriptorSets(m_wall);
 }
@@ -8,7 +8,9 @@
 #include "fw/Mesh.h"
 #include "fw/Model.h"
 #include "fw/Pipeline.h"
+#include "fw/Profiler.h"
 #include "fw/RenderPass.h"
+#include "fw/ShaderModuleCache.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -34,6 +36,9 @@ ReflectionApp::~ReflectionApp()
 
 bool ReflectionApp::initialize()
 {
+    // G-buffer attachments are shared so frames cannot overlap
+    fw::API::setFramesInFlight(1);
+
     m_gbufferPass.initialize(&m_camera);
 
     m_logicalDevice = fw::Context::getLogicalDevice();
@@ -156,10 +161,10 @@ void ReflectionApp::createPipeline()
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(m_logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
@@ -205,7 +210,7 @@ void ReflectionApp::createPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
 }
 
 void ReflectionApp::createDescriptorPool()
@@ -312,9 +317,12 @@ void ReflectionApp::createCommandBuffers()
         VkCommandBuffer cb = commandBuffers[i];
         VK_CHECK(vkBeginCommandBuffer(cb, &beginInfo));
 
+        fw::Profiler::beginScope(cb, "G-buffer");
         m_gbufferPass.writeRenderCommands(cb);
+        fw::Profiler::endScope(cb, "G-buffer");
 
         renderPassInfo.framebuffer = swapChainFramebuffers[i];
+        fw::Profiler::beginScope(cb, "SSR");
         vkCmdBeginRenderPass(cb, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
         vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
@@ -322,6 +330,7 @@ void ReflectionApp::createCommandBuffers()
         vkCmdDraw(cb, 3, 1, 0, 0);
 
         vkCmdEndRenderPass(cb);
+        fw::Profiler::endScope(cb, "SSR");
 
         VK_CHECK(vkEndCommandBuffer(cb));
     }
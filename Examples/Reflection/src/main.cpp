@@ -1,7 +1,7 @@
 #include "ReflectionApp.h"
 #include "fw/Execute.h"
 
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 {
-    return fw::runApplication<ReflectionApp>();
+    return fw::runApplication<ReflectionApp>(argc, argv);
 }
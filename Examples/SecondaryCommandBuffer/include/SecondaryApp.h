@@ -4,6 +4,8 @@
 #include "fw/Buffer.h"
 #include "fw/Camera.h"
 #include "fw/CameraController.h"
+#include "fw/ParallelRecorder.h"
+#include "fw/RingBuffer.h"
 #include "fw/Sampler.h"
 #include "fw/Texture.h"
 #include "fw/Transformation.h"
@@ -25,9 +27,8 @@ public:
 
     struct BufferObject
     {
-        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
         fw::Transformation trans;
-        fw::Buffer uniformBuffer;
+        uint32_t uniformOffset = 0;
     };
 
     SecondaryApp();
@@ -54,13 +55,17 @@ private:
     fw::CameraController m_cameraController;
     RenderObject m_renderObject;
     std::vector<BufferObject> m_bufferObjects;
+    fw::RingBuffer m_uniformRing;
 
     VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
 
-    VkFence m_renderBufferFence;
-    VkCommandBuffer m_primaryCommandBuffer;
+    fw::ParallelRecorder m_recorder;
     std::vector<VkCommandBuffer> m_secondaryCommandBuffers;
-    size_t m_currentFrameIndex = 0;
+    int m_jobCount = 1;
+    double m_recordMilliseconds = 0.0;
+    double m_benchmarkMilliseconds = 0.0;
+    uint32_t m_benchmarkFrames = 0;
 
     VkExtent2D m_extent;
 
@@ -69,8 +74,7 @@ private:
     void createPipeline();
     void createDescriptorPool();
     void createRenderObject();
-    void createDescriptorSets();
-    void createCommandBuffers();
-    void createFence();
+    void createDescriptorSet();
     void updateCommandBuffers();
+    void updateBenchmark();
 };
@@ -8,11 +8,13 @@
 #include "fw/Model.h"
 #include "fw/Pipeline.h"
 #include "fw/RenderPass.h"
+#include "fw/ShaderModuleCache.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <vulkan/vulkan.h>
 
 #include <array>
+#include <chrono>
 #include <iostream>
 
 namespace
@@ -20,7 +22,10 @@ namespace
 const std::size_t c_uboSize = sizeof(glm::mat4x4);
 const std::string c_assetsFolder = ASSETS_PATH;
 const std::string c_shaderFolder = SHADER_PATH;
-const size_t c_numRenderObjects = 3;
+const size_t c_gridSize = 64;
+const size_t c_numRenderObjects = c_gridSize * c_gridSize;
+const float c_objectSpacing = 3.0f;
+const uint32_t c_benchmarkFramesPerJobCount = 100;
 
 } // unnamed
 
@@ -31,7 +36,6 @@ SecondaryApp::SecondaryApp()
 
 SecondaryApp::~SecondaryApp()
 {
-    vkDestroyFence(m_logicalDevice, m_renderBufferFence, nullptr);
     vkDestroyDescriptorPool(m_logicalDevice, m_descriptorPool, nullptr);
     vkDestroyPipeline(m_logicalDevice, m_graphicsPipeline, nullptr);
     vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
@@ -50,16 +54,28 @@ bool SecondaryApp::initialize()
     success = success && m_sampler.create(VK_COMPARE_OP_ALWAYS);
     createDescriptorPool();
     createRenderObject();
-    createDescriptorSets();
+    createDescriptorSet();
     success = success && fw::API::initializeGUI(m_descriptorPool);
-    createCommandBuffers();
-    createFence();
+    success = success && m_recorder.initialize();
 
     CHECK(success);
 
+    // The headless benchmark starts from a single job and goes up to one job per thread
+    m_jobCount = fw::API::isHeadless() ? 1 : static_cast<int>(m_recorder.getThreadCount());
+    m_recorder.setJobCount(static_cast<uint32_t>(m_jobCount));
+
+    for (size_t i = 0; i < c_numRenderObjects; ++i)
+    {
+        float x = static_cast<float>(i % c_gridSize) * c_objectSpacing;
+        float y = static_cast<float>(i / c_gridSize) * c_objectSpacing;
+        m_bufferObjects[i].trans.setPosition(x, y, 0.0f);
+    }
+
     m_extent = fw::API::getSwapChainExtent();
     m_cameraController.setCamera(&m_camera);
-    glm::vec3 initPos(0.0f, 0.0f, 10.0f);
+    float gridCenter = static_cast<float>(c_gridSize - 1) * c_objectSpacing * 0.5f;
+    glm::vec3 initPos(gridCenter, gridCenter, 250.0f);
+    m_camera.setFarClipDistance(500.0f);
     m_cameraController.setResetMode(initPos, glm::vec3(), GLFW_KEY_R);
     m_camera.setPosition(initPos);
 
@@ -75,15 +91,15 @@ void SecondaryApp::update()
     for (size_t i = 0; i < c_numRenderObjects; ++i)
     {
         BufferObject& bo = m_bufferObjects[i];
-        float floatIndex = static_cast<float>(i);
-        bo.trans.setPosition(floatIndex * 3.0f, 0.0f, 0.0f);
-        bo.trans.rotate(glm::vec3(0.0f, 1.0f, 0.0f), (floatIndex + 0.2f) * 0.1f * fw::API::getTimeDelta());
+        float speed = static_cast<float>(i % 7) + 0.2f;
+        bo.trans.rotate(glm::vec3(0.0f, 1.0f, 0.0f), speed * 0.1f * fw::API::getTimeDelta());
         const glm::mat4& world = bo.trans.getWorldMatrix();
         glm::mat4 wvp = proj * view * world;
-        bo.uniformBuffer.setData(c_uboSize, &wvp);
+        CHECK(m_uniformRing.push(wvp, bo.uniformOffset));
     }
 
     updateCommandBuffers();
+    updateBenchmark();
 }
 
 void SecondaryApp::onGUI()
@@ -96,6 +112,11 @@ void SecondaryApp::onGUI()
     glm::vec3 p = m_camera.getTransformation().getPosition();
     ImGui::Text("Camera position: %.1f %.1f %.1f", p.x, p.y, p.z);
     ImGui::Text("%.2f ms/frame (%.0f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+    ImGui::Text("Recording %zu objects: %.3f ms", c_numRenderObjects, m_recordMilliseconds);
+    if (ImGui::SliderInt("Jobs", &m_jobCount, 1, static_cast<int>(m_recorder.getThreadCount())))
+    {
+        m_recorder.setJobCount(static_cast<uint32_t>(m_jobCount));
+    }
 
 #ifndef WIN32
 #pragma GCC diagnostic pop
@@ -147,7 +168,7 @@ void SecondaryApp::createDescriptorSetLayout()
 {
     VkDescriptorSetLayoutBinding uboLayoutBinding{};
     uboLayoutBinding.binding = 0;
-    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     uboLayoutBinding.descriptorCount = 1;
     uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
     uboLayoutBinding.pImmutableSamplers = nullptr; // Optional
@@ -175,10 +196,10 @@ void SecondaryApp::createPipeline()
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(m_logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
@@ -220,14 +241,14 @@ void SecondaryApp::createPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &m_graphicsPipeline));
 }
 
 void SecondaryApp::createDescriptorPool()
 {
     std::array<VkDescriptorPoolSize, 2> poolSizes{};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = 16;
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[0].descriptorCount = 1;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     poolSizes[1].descriptorCount = 16;
 
@@ -250,7 +271,7 @@ void SecondaryApp::createRenderObject()
     CHECK(numMeshes == 1);
     const fw::Mesh& mesh = meshes[0];
 
-    bool vertexBufferCreated = m_renderObject.vertexBuffer.createForDevice<fw::Mesh::Vertex>(mesh.getVertices(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    bool vertexBufferCreated = m_renderObject.vertexBuffer.createVertexBuffer(mesh);
     bool indexBufferCreated = m_renderObject.indexBuffer.createForDevice<uint32_t>(mesh.indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
     CHECK(vertexBufferCreated && indexBufferCreated);
@@ -261,79 +282,50 @@ void SecondaryApp::createRenderObject()
     m_renderObject.texture.load(textureFile, VK_FORMAT_R8G8B8A8_UNORM);
 }
 
-void SecondaryApp::createDescriptorSets()
+void SecondaryApp::createDescriptorSet()
 {
-    VkMemoryPropertyFlags uboProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    for (BufferObject& bo : m_bufferObjects)
-    {
-        CHECK(bo.uniformBuffer.create(c_uboSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
-    }
-
-    for (BufferObject& bo : m_bufferObjects)
-    {
-        VkDescriptorSetAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        allocInfo.descriptorPool = m_descriptorPool;
-        allocInfo.descriptorSetCount = 1;
-        allocInfo.pSetLayouts = &m_descriptorSetLayout;
-
-        VK_CHECK(vkAllocateDescriptorSets(m_logicalDevice, &allocInfo, &bo.descriptorSet));
-
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = bo.uniformBuffer.getBuffer();
-        bufferInfo.offset = 0;
-        bufferInfo.range = c_uboSize;
-
-        VkDescriptorImageInfo imageInfo{};
-        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        imageInfo.imageView = m_renderObject.texture.getImageView();
-        imageInfo.sampler = m_sampler.getSampler();
-
-        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-
-        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[0].dstSet = bo.descriptorSet;
-        descriptorWrites[0].dstBinding = 0;
-        descriptorWrites[0].dstArrayElement = 0;
-        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrites[0].descriptorCount = 1;
-        descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[1].dstSet = bo.descriptorSet;
-        descriptorWrites[1].dstBinding = 1;
-        descriptorWrites[1].dstArrayElement = 0;
-        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[1].descriptorCount = 1;
-        descriptorWrites[1].pImageInfo = &imageInfo;
-
-        vkUpdateDescriptorSets(m_logicalDevice, fw::ui32size(descriptorWrites), descriptorWrites.data(), 0, nullptr);
-    }
-}
-
-void SecondaryApp::createCommandBuffers()
-{
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = fw::API::getCommandPool();
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = 1;
-
-    VK_CHECK(vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, &m_primaryCommandBuffer));
-
-    m_secondaryCommandBuffers.resize(c_numRenderObjects);
-    allocInfo.commandBufferCount = c_numRenderObjects;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
-    VK_CHECK(vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, m_secondaryCommandBuffers.data()));
-}
-
-void SecondaryApp::createFence()
-{
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    VK_CHECK(vkCreateFence(m_logicalDevice, &fenceInfo, nullptr, &m_renderBufferFence));
-    fw::API::setRenderBufferFence(m_renderBufferFence);
+    // All the objects share one ring buffer, the per-frame location is given as a dynamic offset when binding
+    VkDeviceSize alignment = fw::Context::getPhysicalDeviceProperties()->limits.minUniformBufferOffsetAlignment;
+    VkDeviceSize alignedUboSize = (c_uboSize + alignment - 1) / alignment * alignment;
+    CHECK(m_uniformRing.create(alignedUboSize * c_numRenderObjects, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT));
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_descriptorSetLayout;
+
+    VK_CHECK(vkAllocateDescriptorSets(m_logicalDevice, &allocInfo, &m_descriptorSet));
+
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = m_uniformRing.getBuffer();
+    bufferInfo.offset = 0;
+    bufferInfo.range = c_uboSize;
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = m_renderObject.texture.getImageView();
+    imageInfo.sampler = m_sampler.getSampler();
+
+    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+
+    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstSet = m_descriptorSet;
+    descriptorWrites[0].dstBinding = 0;
+    descriptorWrites[0].dstArrayElement = 0;
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[1].dstSet = m_descriptorSet;
+    descriptorWrites[1].dstBinding = 1;
+    descriptorWrites[1].dstArrayElement = 0;
+    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrites[1].descriptorCount = 1;
+    descriptorWrites[1].pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(m_logicalDevice, fw::ui32size(descriptorWrites), descriptorWrites.data(), 0, nullptr);
 }
 
 void SecondaryApp::updateCommandBuffers()
@@ -343,6 +335,7 @@ void SecondaryApp::updateCommandBuffers()
 
     VkCommandBufferBeginInfo primaryCommandBufferBeginInfo{};
     primaryCommandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    primaryCommandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     primaryCommandBufferBeginInfo.pInheritanceInfo = nullptr; // Optional
 
     std::array<VkClearValue, 2> clearValues{};
@@ -358,46 +351,59 @@ void SecondaryApp::updateCommandBuffers()
     renderPassInfo.pClearValues = clearValues.data();
     renderPassInfo.framebuffer = swapChainFramebuffers[currentIndex];
 
-    vkWaitForFences(m_logicalDevice, 1, &m_renderBufferFence, VK_TRUE, UINT64_MAX);
-    vkResetFences(m_logicalDevice, 1, &m_renderBufferFence);
-
-    VK_CHECK(vkBeginCommandBuffer(m_primaryCommandBuffer, &primaryCommandBufferBeginInfo));
-    vkCmdBeginRenderPass(m_primaryCommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    VkCommandBuffer primaryCommandBuffer = fw::API::getCurrentFrameCommandBuffer();
+    VK_CHECK(vkBeginCommandBuffer(primaryCommandBuffer, &primaryCommandBufferBeginInfo));
+    vkCmdBeginRenderPass(primaryCommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
     VkCommandBufferInheritanceInfo inheritanceInfo{};
     inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
     inheritanceInfo.renderPass = m_renderPass;
     inheritanceInfo.framebuffer = swapChainFramebuffers[currentIndex];
 
-    VkDeviceSize offsets[] = {0};
-
-    std::vector<VkCommandBuffer> secondaryCommands;
-
-    // Secondary command buffers could be created in parallel (i.e. multithreaded command buffer generation)
-    for (size_t i = 0; i < m_secondaryCommandBuffers.size(); ++i)
-    {
-        VkCommandBufferBeginInfo secondaryCommandBufferBeginInfo{};
-        secondaryCommandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        secondaryCommandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
-        secondaryCommandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
-
-        VkCommandBuffer cmdBuffer = m_secondaryCommandBuffers[i];
-
-        VK_CHECK(vkBeginCommandBuffer(cmdBuffer, &secondaryCommandBufferBeginInfo));
+    // Each job records a contiguous range of objects into its own secondary command buffer
+    auto recordObjects = [this](VkCommandBuffer cmdBuffer, size_t begin, size_t end) {
+        VkDeviceSize offsets[] = {0};
         vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
         VkBuffer vb = m_renderObject.vertexBuffer.getBuffer();
         vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &vb, offsets);
         vkCmdBindIndexBuffer(cmdBuffer, m_renderObject.indexBuffer.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
-        BufferObject& bo = m_bufferObjects[i];
-        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &bo.descriptorSet, 0, nullptr);
-        vkCmdDrawIndexed(cmdBuffer, m_renderObject.numIndices, 1, 0, 0, 0);
-        vkEndCommandBuffer(cmdBuffer);
-        secondaryCommands.push_back(cmdBuffer);
+        for (size_t i = begin; i < end; ++i)
+        {
+            const BufferObject& bo = m_bufferObjects[i];
+            vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSet, 1, &bo.uniformOffset);
+            vkCmdDrawIndexed(cmdBuffer, m_renderObject.numIndices, 1, 0, 0, 0);
+        }
+    };
+
+    auto recordStart = std::chrono::steady_clock::now();
+    CHECK(m_recorder.record(inheritanceInfo, c_numRenderObjects, recordObjects, m_secondaryCommandBuffers));
+    std::chrono::duration<double, std::milli> recordTime = std::chrono::steady_clock::now() - recordStart;
+    m_recordMilliseconds = recordTime.count();
+
+    vkCmdExecuteCommands(primaryCommandBuffer, fw::ui32size(m_secondaryCommandBuffers), m_secondaryCommandBuffers.data());
+    vkCmdEndRenderPass(primaryCommandBuffer);
+    VK_CHECK(vkEndCommandBuffer(primaryCommandBuffer));
+
+    fw::API::setNextCommandBuffer(primaryCommandBuffer);
+}
+
+void SecondaryApp::updateBenchmark()
+{
+    if (!fw::API::isHeadless())
+    {
+        return;
+    }
+
+    m_benchmarkMilliseconds += m_recordMilliseconds;
+    if (++m_benchmarkFrames < c_benchmarkFramesPerJobCount)
+    {
+        return;
     }
 
-    vkCmdExecuteCommands(m_primaryCommandBuffer, fw::ui32size(secondaryCommands), secondaryCommands.data());
-    vkCmdEndRenderPass(m_primaryCommandBuffer);
-    VK_CHECK(vkEndCommandBuffer(m_primaryCommandBuffer));
+    std::cout << "Jobs " << m_jobCount << ": " << m_benchmarkMilliseconds / m_benchmarkFrames << " ms to record " << c_numRenderObjects << " objects\n";
+    m_benchmarkMilliseconds = 0.0;
+    m_benchmarkFrames = 0;
 
-    fw::API::setNextCommandBuffer(m_primaryCommandBuffer);
+    m_jobCount = m_jobCount % static_cast<int>(m_recorder.getThreadCount()) + 1;
+    m_recorder.setJobCount(static_cast<uint32_t>(m_jobCount));
 }
@@ -1,7 +1,7 @@
 #include "SecondaryApp.h"
 #include "fw/Execute.h"
 
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 {
-    return fw::runApplication<SecondaryApp>();
+    return fw::runApplication<SecondaryApp>(argc, argv);
 }
@@ -1,7 +1,7 @@
 #include "SpecializationApp.h"
 #include "fw/Execute.h"
 
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 {
-    return fw::runApplication<SpecializationApp>();
+    return fw::runApplication<SpecializationApp>(argc, argv);
 }
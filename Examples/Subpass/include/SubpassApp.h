@@ -41,7 +41,8 @@ private:
         fw::Buffer indexBuffer;
         uint32_t numIndices;
         fw::Texture texture;
-        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        // One per swap chain image
+        std::vector<VkDescriptorSet> descriptorSets;
     };
 
     struct Subpass
@@ -75,7 +76,8 @@ private:
     fw::CameraController m_cameraController;
     fw::Transformation m_transformation;
     MatrixUBO m_ubo;
-    fw::Buffer m_uniformBuffer;
+    // One per swap chain image, the frame that used the image last has finished when the image is acquired again
+    std::vector<fw::Buffer> m_uniformBuffers;
     std::vector<RenderObject> m_renderObjects;
 
     VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
@@ -89,7 +91,7 @@ private:
     void createDescriptorPool();
     void createRenderObjects();
     void createGBufferDescriptorSets(uint32_t setCount);
-    void updateGBufferDescriptorSet(VkDescriptorSet descriptorSet, VkImageView imageView);
+    void updateGBufferDescriptorSet(VkDescriptorSet descriptorSet, const fw::Buffer& uniformBuffer, VkImageView imageView);
     void createAndUpdateCompositeDescriptorSet();
     void createCommandBuffers();
 };
@@ -9,6 +9,8 @@
 #include "fw/Model.h"
 #include "fw/Pipeline.h"
 #include "fw/RenderPass.h"
+#include "fw/ShaderModuleCache.h"
+#include "fw/TextureLoader.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <vulkan/vulkan.h>
@@ -89,7 +91,7 @@ void SubpassApp::update()
     m_cameraController.update();
     m_ubo.view = m_camera.getViewMatrix();
 
-    m_uniformBuffer.setData(sizeof(m_ubo), &m_ubo);
+    m_uniformBuffers[fw::API::getCurrentSwapChainImageIndex()].setData(sizeof(m_ubo), &m_ubo);
 }
 
 void SubpassApp::createGBufferAttachments()
@@ -305,10 +307,10 @@ void SubpassApp::createGBufferPipeline()
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(m_logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
@@ -352,7 +354,7 @@ void SubpassApp::createGBufferPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_gbuffer.pipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &m_gbuffer.pipeline));
 }
 
 void SubpassApp::createCompositePipeline()
@@ -362,10 +364,10 @@ void SubpassApp::createCompositePipeline()
 
     CHECK(!shaderStages.empty());
 
-    fw::Cleaner cleaner([&shaderStages, this]() {
+    fw::Cleaner cleaner([&shaderStages]() {
         for (const auto& info : shaderStages)
         {
-            vkDestroyShaderModule(m_logicalDevice, info.module, nullptr);
+            fw::ShaderModuleCache::release(info.module);
         }
     });
 
@@ -408,7 +410,7 @@ void SubpassApp::createCompositePipeline()
     pipelineInfo.basePipelineIndex = -1;
 
     VK_CHECK(
-        vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_composite.pipeline));
+        vkCreateGraphicsPipelines(m_logicalDevice, fw::Context::getPipelineCache(), 1, &pipelineInfo, nullptr, &m_composite.pipeline));
 }
 
 void SubpassApp::createDescriptorPool()
@@ -432,8 +434,13 @@ void SubpassApp::createDescriptorPool()
 
 void SubpassApp::createRenderObjects()
 {
+    uint32_t imageCount = fw::API::getSwapChainImageCount();
     VkMemoryPropertyFlags uboProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    CHECK(m_uniformBuffer.create(c_transformMatricesSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
+    m_uniformBuffers.resize(imageCount);
+    for (fw::Buffer& uniformBuffer : m_uniformBuffers)
+    {
+        CHECK(uniformBuffer.create(c_transformMatricesSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uboProperties));
+    }
 
     fw::Model model;
     CHECK(model.loadModel(c_assetsFolder + "attack_droid.obj"));
@@ -441,26 +448,37 @@ void SubpassApp::createRenderObjects()
     fw::Model::Meshes meshes = model.getMeshes();
     uint32_t numMeshes = fw::ui32size(meshes);
 
-    createGBufferDescriptorSets(numMeshes);
+    createGBufferDescriptorSets(numMeshes * imageCount);
 
     m_renderObjects.resize(numMeshes);
 
     bool success = true;
+    fw::TextureLoader textureLoader;
     for (unsigned int i = 0; i < numMeshes; ++i)
     {
         const fw::Mesh& mesh = meshes[i];
         RenderObject& ro = m_renderObjects[i];
 
+        std::string textureFile = c_assetsFolder + mesh.getFirstTextureOfType(aiTextureType::aiTextureType_DIFFUSE);
+        textureLoader.add(ro.texture, textureFile, VK_FORMAT_R8G8B8A8_UNORM);
+
         success = success
-            && ro.vertexBuffer.createForDevice<fw::Mesh::Vertex>(mesh.getVertices(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+            && ro.vertexBuffer.createVertexBuffer(mesh)
             && ro.indexBuffer.createForDevice<uint32_t>(mesh.indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
         ro.numIndices = fw::ui32size(mesh.indices);
+    }
 
-        std::string textureFile = c_assetsFolder + mesh.getFirstTextureOfType(aiTextureType::aiTextureType_DIFFUSE);
-        ro.texture.load(textureFile, VK_FORMAT_R8G8B8A8_UNORM);
-        updateGBufferDescriptorSet(m_gbuffer.descriptorSets[i], ro.texture.getImageView());
-        ro.descriptorSet = m_gbuffer.descriptorSets[i];
+    success = textureLoader.wait() && success;
+    for (unsigned int i = 0; i < numMeshes; ++i)
+    {
+        RenderObject& ro = m_renderObjects[i];
+        ro.descriptorSets.resize(imageCount);
+        for (uint32_t image = 0; image < imageCount; ++image)
+        {
+            ro.descriptorSets[image] = m_gbuffer.descriptorSets[i * imageCount + image];
+            updateGBufferDescriptorSet(ro.descriptorSets[image], m_uniformBuffers[image], ro.texture.getImageView());
+        }
     }
 
     CHECK(success);
@@ -480,10 +498,10 @@ void SubpassApp::createGBufferDescriptorSets(uint32_t setCount)
     VK_CHECK(vkAllocateDescriptorSets(m_logicalDevice, &gbufferAllocInfo, m_gbuffer.descriptorSets.data()));
 }
 
-void SubpassApp::updateGBufferDescriptorSet(VkDescriptorSet descriptorSet, VkImageView imageView)
+void SubpassApp::updateGBufferDescriptorSet(VkDescriptorSet descriptorSet, const fw::Buffer& uniformBuffer, VkImageView imageView)
 {
     VkDescriptorBufferInfo matrixBufferInfo{};
-    matrixBufferInfo.buffer = m_uniformBuffer.getBuffer();
+    matrixBufferInfo.buffer = uniformBuffer.getBuffer();
     matrixBufferInfo.offset = 0;
     matrixBufferInfo.range = c_transformMatricesSize;
 
@@ -601,7 +619,7 @@ void SubpassApp::createCommandBuffers()
             vkCmdBindVertexBuffers(cb, 0, 1, &vb, offsets);
             vkCmdBindIndexBuffer(cb, ro.indexBuffer.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
             vkCmdBindDescriptorSets(
-                cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_gbuffer.pipelineLayout, 0, 1, &ro.descriptorSet, 0, nullptr);
+                cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_gbuffer.pipelineLayout, 0, 1, &ro.descriptorSets[i], 0, nullptr);
             vkCmdDrawIndexed(cb, ro.numIndices, 1, 0, 0, 0);
         }
 
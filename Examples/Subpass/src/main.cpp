@@ -1,7 +1,7 @@
 #include "SubpassApp.h"
 #include "fw/Execute.h"
 
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 {
-    return fw::runApplication<SubpassApp>();
+    return fw::runApplication<SubpassApp>(argc, argv);
 }
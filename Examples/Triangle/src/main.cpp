@@ -1,7 +1,7 @@
 #include "TriangleApp.h"
 #include "fw/Execute.h"
 
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 {
-    return fw::runApplication<TriangleApp>();
+    return fw::runApplication<TriangleApp>(argc, argv);
 }
@@ -12,7 +12,8 @@ struct GLFWwindow;
 
 #include <vulkan/vulkan.h>
 
-#define IMGUI_VK_QUEUED_FRAMES 2
+// At least fw::Constants::maxFramesInFlight, the vertex and index buffers of a frame are reused this many frames later
+#define IMGUI_VK_QUEUED_FRAMES 3
 
 struct ImGui_ImplGlfwVulkan_Init_Data
 {
@@ -32,6 +32,15 @@ public:
 
     static float getTimeSinceStart();
     static float getTimeDelta();
+    static double getTimeSinceStartSeconds();
+    static double getTimeDeltaSeconds();
+    // Zero disables the fixed steps
+    static void setFixedTimestep(double seconds);
+    static uint32_t getFixedStepCount();
+    static double getFixedTimestep();
+    static double getFixedStepAlpha();
+    // Zero disables the limit, ignored in a benchmark run
+    static void setFrameRateLimit(double framesPerSecond);
 
     static bool isKeyPressed(int key);
     static bool isKeyDown(int key);
@@ -41,11 +50,28 @@ public:
 
     static void setCommandBuffers(const std::vector<VkCommandBuffer>& commandBuffers);
     static void setNextCommandBuffer(VkCommandBuffer commandBuffer);
+    // Submitted before the rendering of every frame, the rendering waits for it
     static void setNextComputeCommandBuffer(VkCommandBuffer commandBuffer);
-    static void setRenderBufferFence(VkFence fence);
+    // Lets the compute of a frame run alongside the rendering of the previous frame. Only for compute that writes
+    // resources the previous frame does not read, for example the other copy of double buffered storage.
+    static void setAsyncCompute(bool enabled);
+    static bool isAsyncComputeEnabled();
+    // True when compute is submitted to a queue family without graphics
+    static bool hasDedicatedComputeQueue();
     static void setCommandBufferFence(VkFence fence);
 
+    static void setFramesInFlight(uint32_t count);
+    static uint32_t getFramesInFlight();
+    static uint32_t getCurrentFrameIndex();
+    static uint64_t getFrameNumber();
+    static VkCommandBuffer getCurrentFrameCommandBuffer();
+
     static GLFWwindow* getGLFWwindow();
+    static bool isHeadless();
+    // Set when a benchmark runs with a camera path, otherwise null
+    static const CameraPath* getCameraPath();
+    // Reports the work of a GPU or CPU profiler scope per second in the benchmark results, ignored outside of a benchmark
+    static void setBenchmarkThroughput(const std::string& scopeName, double workPerSample, const std::string& unit);
 
     static void setRenderingEnabled(bool status);
 
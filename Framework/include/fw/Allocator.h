@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace fw
+{
+// Sub-allocates buffer and image memory from large per memory type blocks
+class Allocator
+{
+public:
+    friend class Device;
+
+    struct Block;
+
+    struct Allocation
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void* mappedData = nullptr;
+        Block* block = nullptr;
+    };
+
+    struct Stats
+    {
+        uint32_t blockCount = 0;
+        uint32_t dedicatedBlockCount = 0;
+        uint32_t allocationCount = 0;
+        VkDeviceSize reservedBytes = 0;
+        VkDeviceSize usedBytes = 0;
+        uint32_t freeRangeCount = 0;
+        VkDeviceSize largestFreeRange = 0;
+        // 0 when all the free memory is contiguous, approaches 1 when it is scattered into small ranges
+        float fragmentation = 0.0f;
+    };
+
+    Allocator() = delete;
+
+    // Images with optimal tiling are kept in their own blocks so bufferImageGranularity does not need to be tracked
+    static bool allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool optimalTiling, Allocation& allocation);
+    static void free(Allocation& allocation);
+    static bool flush(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size);
+
+    static Stats getStats();
+    static void printStats();
+
+private:
+    static std::mutex s_mutex;
+    static std::vector<std::unique_ptr<Block>> s_blocks;
+
+    static Block* createBlock(VkDeviceSize size, uint32_t memoryType, bool optimalTiling, bool dedicated);
+    static void destroyBlock(Block* block);
+    static bool allocateFromBlock(Block* block, VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation);
+    static void release();
+};
+
+} // namespace fw
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CameraPath.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fw
+{
+// Collects frame times and the profiler scopes of a headless run and writes them as JSON
+class Benchmark
+{
+public:
+    struct Settings
+    {
+        std::string name;
+        uint32_t frameCount = 300;
+        // Not included in the results, lets caches and pipelines settle
+        uint32_t warmupFrameCount = 10;
+        // Seconds advanced per frame instead of the wall clock
+        float timestep = 1.0f / 60.0f;
+        std::string outputFilename;
+        std::string cameraPathFilename;
+    };
+
+    Benchmark(){};
+    Benchmark(const Benchmark&) = delete;
+    Benchmark(Benchmark&&) = delete;
+    Benchmark& operator=(const Benchmark&) = delete;
+    Benchmark& operator=(Benchmark&&) = delete;
+
+    bool initialize(const Settings& settings);
+    void beginFrame();
+    void endFrame();
+    bool write();
+    // The work done by one sample of a GPU or CPU scope, written as work per second of its mean time
+    void setThroughput(const std::string& scopeName, double workPerSample, const std::string& unit);
+
+    const Settings& getSettings() const;
+    const CameraPath& getCameraPath() const;
+
+private:
+    Settings m_settings;
+    CameraPath m_cameraPath;
+    uint32_t m_frameIndex = 0;
+    std::chrono::steady_clock::time_point m_frameStart;
+    std::vector<double> m_frameTimes;
+    // Name and GPU flag to the samples of the profiler scope
+    std::map<std::pair<std::string, bool>, std::vector<double>> m_scopeTimes;
+    std::map<std::pair<std::string, bool>, uint64_t> m_sampleCounts;
+    // Scope name to the work per sample and its unit
+    std::map<std::string, std::pair<double, std::string>> m_throughputs;
+
+    void collectScopes(bool record);
+};
+
+} // namespace fw
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+namespace fw
+{
+// BC1, BC3 and BC5 encoding with stb_dxt and a reference decoder for checking the results. BC7 can be uploaded from
+// DDS files but is not encoded here.
+class BlockCompression
+{
+public:
+    BlockCompression() = delete;
+
+    static bool canEncode(VkFormat format);
+    static uint32_t getBlockSize(VkFormat format);
+    static size_t getLevelSize(VkFormat format, uint32_t width, uint32_t height);
+
+    // The source is 8 bit RGBA and BC5 stores its red and green channels. Partial blocks at the edges repeat the last
+    // row and column. Block rows are split over the thread pool if one is given.
+    static void compress(const unsigned char* rgba, uint32_t width, uint32_t height, VkFormat format, unsigned char* dst, ThreadPool* threadPool = nullptr);
+    // Writes 8 bit RGBA, channels the format does not store are 0 except alpha which is 255
+    static void decompress(const unsigned char* blocks, uint32_t width, uint32_t height, VkFormat format, unsigned char* rgba);
+    // Peak signal to noise ratio in dB over the channels the format stores
+    static double getPsnr(const unsigned char* reference, const unsigned char* rgba, uint32_t width, uint32_t height, VkFormat format);
+};
+
+} // namespace fw
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "Allocator.h"
 #include "Common.h"
 #include "Context.h"
+#include "Mesh.h"
 
 #include <vulkan/vulkan.h>
 
@@ -10,6 +12,8 @@
 
 namespace fw
 {
+class UploadBatch;
+
 class Buffer
 {
 public:
@@ -18,64 +22,60 @@ public:
     Buffer(){};
     ~Buffer();
 
-    bool create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+    // A buffer shared with compute can be used by the graphics and the compute queue without ownership transfers
+    bool create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool sharedWithCompute = false);
     void copyToImage(VkImage image, uint32_t width, uint32_t height) const;
 
     VkBuffer getBuffer() const;
     VkDeviceMemory getMemory() const;
+    VkDeviceSize getMemoryOffset() const;
+    // Host visible buffers are persistently mapped, returns nullptr for device local buffers
+    void* getMappedMemory() const;
+    bool flush(VkDeviceSize offset, VkDeviceSize size) const;
 
     template<typename T>
     bool setData(VkDeviceSize size, const T* src);
 
     template<typename T>
     bool createForDevice(const std::vector<T>& content, VkBufferUsageFlagBits flag);
+    // The content is available once the batch has been waited
+    template<typename T>
+    bool createForDevice(const std::vector<T>& content, VkBufferUsageFlagBits flag, UploadBatch& batch);
+    // Interleaves the mesh streams directly into staging memory without building a vertex vector first
+    bool createVertexBuffer(const Mesh& mesh, Mesh::VertexFormat format = Mesh::VertexFormat::Full);
+    bool createVertexBuffer(const Mesh& mesh, Mesh::VertexFormat format, UploadBatch& batch);
 
 private:
     VkDevice m_logicalDevice = VK_NULL_HANDLE;
     VkBuffer m_buffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_memory = VK_NULL_HANDLE;
+    Allocator::Allocation m_allocation;
+
+    bool createForDevice(const void* content, VkDeviceSize size, VkBufferUsageFlags usage, UploadBatch* batch);
+    bool createVertexBuffer(const Mesh& mesh, Mesh::VertexFormat format, UploadBatch* batch);
 };
 
 template<typename T>
 bool Buffer::setData(VkDeviceSize size, const T* src)
 {
-    void* dst;
-    if (VkResult r = vkMapMemory(m_logicalDevice, m_memory, 0, size, 0, &dst);
-        r != VK_SUCCESS)
+    if (m_allocation.mappedData == nullptr)
     {
-        printError("Failed to map memory");
+        printError("Failed to set data, buffer memory is not host visible");
         return false;
     }
-    std::memcpy(dst, src, static_cast<size_t>(size));
-    vkUnmapMemory(m_logicalDevice, m_memory);
-    return true;
+    std::memcpy(m_allocation.mappedData, src, static_cast<size_t>(size));
+    return flush(0, size);
 }
 
 template<typename T>
 bool Buffer::createForDevice(const std::vector<T>& content, VkBufferUsageFlagBits flag)
 {
-    VkDeviceSize bufferSize = sizeof(content[0]) * content.size();
-
-    Buffer staging;
-    VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    if (!staging.create(bufferSize, usage, properties))
-    {
-        return false;
-    }
-
-    if (!staging.setData<T>(bufferSize, content.data()))
-    {
-        return false;
-    }
-
-    if (!create(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | flag, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
-    {
-        return false;
-    }
+    return createForDevice(content.data(), sizeof(content[0]) * content.size(), flag, nullptr);
+}
 
-    copy(staging, *this, bufferSize);
-    return true;
+template<typename T>
+bool Buffer::createForDevice(const std::vector<T>& content, VkBufferUsageFlagBits flag, UploadBatch& batch)
+{
+    return createForDevice(content.data(), sizeof(content[0]) * content.size(), flag, &batch);
 }
 
 } // namespace fw
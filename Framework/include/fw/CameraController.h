@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Camera.h"
+#include "CameraPath.h"
 #include <glm/glm.hpp>
 
 namespace fw
@@ -28,6 +29,12 @@ private:
     glm::vec3 m_resetRotation;
     int m_resetKey = -1;
     bool m_rotationEnabled = true;
+
+    bool m_pathStarted = false;
+    glm::vec3 m_pathOriginPosition = glm::vec3(0.0f);
+    glm::vec3 m_pathOriginRotation = glm::vec3(0.0f);
+
+    void followPath(const CameraPath& path);
 };
 
 } // fw
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+namespace fw
+{
+// Keyframed camera offsets relative to where the camera is when the path starts, so the same path fits every scene.
+// The path loops after the last keyframe.
+class CameraPath
+{
+public:
+    struct Keyframe
+    {
+        float time = 0.0f;
+        glm::vec3 position = glm::vec3(0.0f);
+        // Radians
+        glm::vec3 rotation = glm::vec3(0.0f);
+    };
+
+    CameraPath(){};
+    CameraPath(const CameraPath&) = delete;
+    CameraPath(CameraPath&&) = delete;
+    CameraPath& operator=(const CameraPath&) = delete;
+    CameraPath& operator=(CameraPath&&) = delete;
+
+    // One keyframe per line: time in seconds, position offset x y z and rotation offset x y z in degrees.
+    // Empty lines and lines starting with # are skipped.
+    bool load(const std::string& filename);
+    // Keyframes have to be added in time order
+    void addKeyframe(const Keyframe& keyframe);
+
+    bool isEmpty() const;
+    float getDuration() const;
+    void sample(float time, glm::vec3& position, glm::vec3& rotation) const;
+
+private:
+    std::vector<Keyframe> m_keyframes;
+};
+
+} // namespace fw
@@ -10,6 +10,7 @@ public:
     Command() = delete;
     static bool createGraphicsCommandPool(VkCommandPool* commandPool);
     static bool createComputeCommandPool(VkCommandPool* commandPool);
+    static bool createTransferCommandPool(VkCommandPool* commandPool);
     static VkCommandBuffer beginSingleTimeCommands();
     static void endSingleTimeCommands(VkCommandBuffer commandBuffer);
 };
@@ -3,6 +3,8 @@
 #include <vulkan/vulkan.h>
 
 #include <functional>
+#include <iosfwd>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -15,21 +17,38 @@ void printLog(std::string_view msg);
 struct QueueFamilyIndices
 {
     int graphicsFamily = -1;
+    // A family without graphics if the device has one, otherwise a family that also has graphics
     int computeFamily = -1;
     int presentFamily = -1;
+    // Same as the graphics family if the device has no dedicated transfer family
+    int transferFamily = -1;
     bool hasGraphicsAndPresentFamily() const;
 };
 
 QueueFamilyIndices getQueueFamilies(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface);
 
-VkShaderModule createShaderModule(const std::string& filename);
-
 bool findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t& typeIndex);
 
 void* alignedAlloc(size_t size, size_t alignment);
 
 void alignedFree(void* data);
 
+// 64-bit FNV-1a, pass the previous result as the seed to hash data in pieces
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+// Escapes quotes and backslashes for a JSON string, control characters become spaces
+std::string escapeJSON(const std::string& s);
+
+// Hash of the contents of a file with hashBytes, false if the file cannot be read
+bool hashFile(const std::string& filename, uint64_t& hash);
+
+// The callback writes the contents to a temporary file which then replaces the file, so that an interrupted save
+// never leaves a truncated file behind. The description names the file in the warnings.
+bool writeFileAtomically(const std::string& filename, std::string_view description, const std::function<void(std::ostream&)>& write);
+
+// Levels of a full mip chain down to 1x1
+uint32_t getMipLevelCount(uint32_t width, uint32_t height);
+
 class Cleaner
 {
 public:
@@ -19,6 +19,29 @@ const std::vector<const char*> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NA
 
 const VkFormat depthFormat = VK_FORMAT_D24_UNORM_S8_UINT;
 
+const VkDeviceSize memoryBlockSize = 64 * 1024 * 1024;
+const VkDeviceSize stagingBlockSize = 16 * 1024 * 1024;
+const bool useDedicatedTransferQueue = true;
+// Compute is submitted to a family without graphics when the device has one, so it can run alongside rendering
+const bool useDedicatedComputeQueue = true;
+// Post-processed models are stored next to the source as <file>.myvkmesh
+const bool useMeshCache = true;
+// Reorder imported meshes for the vertex cache, overdraw and vertex fetch
+const bool optimizeMeshes = true;
+// Pipeline cache data is stored in the working directory as pipelines_<uuid>_<driver version>.myvkpipelines
+const bool usePipelineCache = true;
+// Loaded textures get a full mip chain
+const bool generateMipmaps = true;
+// Streamed textures are usable once the mip levels up to this size are resident
+const uint32_t streamedTextureInitialSize = 64;
+// Examples with a GUI get a window with the profiler scopes
+const bool showProfiler = true;
+// Written in the working directory on exit when the framework is built with MYVK_ENABLE_TRACING
+const char* const traceFilename = "trace.json";
+
+const uint32_t framesInFlight = 2;
+const uint32_t maxFramesInFlight = 3;
+
 const glm::vec3 zeroVec3 = glm::vec3(0.0f, 0.0f, 0.0f);
 const glm::vec3 forward = glm::vec3(0.0f, 0.0f, -1.0f);
 const glm::vec3 backward = glm::vec3(0.0f, 0.0f, 1.0f);
@@ -12,6 +12,7 @@ public:
     friend class Instance;
     friend class Window;
     friend class Device;
+    friend class PipelineCache;
 
     Context() = delete;
     static VkInstance getInstance();
@@ -21,7 +22,13 @@ public:
     static VkQueue getGraphicsQueue();
     static VkQueue getComputeQueue();
     static VkQueue getPresentQueue();
+    static VkQueue getTransferQueue();
+    // Families of the queues, chosen when the device is created
+    static uint32_t getGraphicsQueueFamily();
+    static uint32_t getComputeQueueFamily();
     static VkPhysicalDeviceProperties* getPhysicalDeviceProperties();
+    // Pass to every vkCreate*Pipelines call, it is persisted across runs
+    static VkPipelineCache getPipelineCache();
 
 private:
     static VkInstance s_instance;
@@ -31,7 +38,11 @@ private:
     static VkQueue s_graphicsQueue;
     static VkQueue s_computeQueue;
     static VkQueue s_presentQueue;
+    static VkQueue s_transferQueue;
+    static uint32_t s_graphicsQueueFamily;
+    static uint32_t s_computeQueueFamily;
     static VkPhysicalDeviceProperties* s_physicalDeviceProperties;
+    static VkPipelineCache s_pipelineCache;
 };
 
 } // namespace fw
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Constants.h"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace fw
+{
+// Allocates descriptor sets from pools that are created on demand, so nothing has to be sized up front. Persistent
+// sets live until reset or destruction. Transient sets are valid for the current frame only, every frame in flight
+// has its own pools which are reset when the frame comes around again. The layouts need to come from
+// DescriptorLayoutCache which knows how many descriptors of each type they have.
+class DescriptorAllocator
+{
+public:
+    DescriptorAllocator(){};
+    ~DescriptorAllocator();
+    DescriptorAllocator(const DescriptorAllocator&) = delete;
+    DescriptorAllocator(DescriptorAllocator&&) = delete;
+    DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+    DescriptorAllocator& operator=(DescriptorAllocator&&) = delete;
+
+    bool allocate(VkDescriptorSetLayout layout, VkDescriptorSet& set);
+    bool allocate(const std::vector<VkDescriptorSetLayout>& layouts, std::vector<VkDescriptorSet>& sets);
+    // Only for sets that are used by the graphics queue within the frame they are allocated on
+    bool allocateTransient(VkDescriptorSetLayout layout, VkDescriptorSet& set);
+    // Invalidates every persistent set, the pools are kept for reuse
+    void reset();
+
+    uint32_t getPoolCount() const;
+
+private:
+    struct Pool
+    {
+        VkDescriptorPool pool = VK_NULL_HANDLE;
+        uint32_t setCount = 0;
+        std::vector<VkDescriptorPoolSize> sizes;
+    };
+
+    struct PoolList
+    {
+        std::vector<Pool> pools;
+        size_t current = 0;
+        // Left in the current pool, tracked so that Vulkan 1.0 drivers never see an allocation that does not fit
+        uint32_t remainingSets = 0;
+        std::vector<VkDescriptorPoolSize> remainingDescriptors;
+    };
+
+    PoolList m_persistentPools;
+    std::array<PoolList, Constants::maxFramesInFlight> m_framePools;
+    uint64_t m_frameNumber = std::numeric_limits<uint64_t>::max();
+
+    bool allocate(PoolList& list, VkDescriptorSetLayout layout, VkDescriptorSet& set);
+    VkDescriptorPool createPool(uint32_t setCount, const std::vector<VkDescriptorPoolSize>& poolSizes);
+    void selectPool(PoolList& list, size_t index);
+    bool fits(const PoolList& list, const std::vector<VkDescriptorPoolSize>& descriptorCounts) const;
+    void reset(PoolList& list);
+    void destroy(PoolList& list);
+};
+
+} // namespace fw
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace fw
+{
+// Descriptor set layouts shared by every user with the same bindings, the order of the bindings does not matter.
+// The layouts are owned by the cache and destroyed with the device.
+class DescriptorLayoutCache
+{
+public:
+    friend class Device;
+
+    DescriptorLayoutCache() = delete;
+
+    // Returns VK_NULL_HANDLE on failure
+    static VkDescriptorSetLayout get(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+    // Descriptors of each type in a layout returned by get, false for layouts the cache did not create
+    static bool getDescriptorCounts(VkDescriptorSetLayout layout, std::vector<VkDescriptorPoolSize>& counts);
+
+    static uint32_t getLayoutCount();
+
+private:
+    struct Entry
+    {
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+        VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    };
+
+    static std::mutex s_mutex;
+    // Signature hash to the layouts with that hash
+    static std::unordered_multimap<uint64_t, Entry> s_entries;
+
+    static void release();
+};
+
+} // namespace fw
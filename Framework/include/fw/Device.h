@@ -22,6 +22,7 @@ private:
     VkQueue graphicsQueue = VK_NULL_HANDLE;
     VkQueue computeQueue = VK_NULL_HANDLE;
     VkQueue presentQueue = VK_NULL_HANDLE;
+    VkQueue transferQueue = VK_NULL_HANDLE;
     VkPhysicalDeviceProperties physicalDeviceProperties;
 
     bool getPhysicalDevice();
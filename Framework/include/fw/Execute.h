@@ -2,12 +2,15 @@
 
 #include "Framework.h"
 
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
 namespace fw
 {
 template<typename T>
-int runApplication()
+int runApplication(Framework& fw)
 {
-    fw::Framework fw;
     int status = 1;
     if (fw.initialize())
     {
@@ -23,4 +26,68 @@ int runApplication()
     return status;
 }
 
+template<typename T>
+int runApplication()
+{
+    fw::Framework fw;
+    return runApplication<T>(fw);
+}
+
+// Supports "--headless <frame count>" for running without a window and "--bench <frame count>" for a headless benchmark.
+// A benchmark takes "--warmup <frame count>", "--timestep <seconds>", "--camera-path <file>" and "--bench-output <file>".
+template<typename T>
+int runApplication(int argc, char** argv)
+{
+    fw::Framework fw;
+
+    std::string name = argc > 0 ? argv[0] : "myvk";
+    name = name.substr(name.find_last_of("/\\") + 1);
+    name = name.substr(0, name.find_last_of('.'));
+
+    bool benchmark = false;
+    Benchmark::Settings benchmarkSettings;
+    benchmarkSettings.name = name;
+    benchmarkSettings.outputFilename = name + "_bench.json";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--headless") == 0)
+        {
+            uint32_t frameCount = hasValue ? static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)) : 1;
+            fw.setHeadless(frameCount);
+        }
+        else if (std::strcmp(argv[i], "--bench") == 0)
+        {
+            benchmark = true;
+            if (hasValue)
+            {
+                benchmarkSettings.frameCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+        }
+        else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue)
+        {
+            benchmarkSettings.warmupFrameCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--timestep") == 0 && hasValue)
+        {
+            benchmarkSettings.timestep = std::strtof(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--camera-path") == 0 && hasValue)
+        {
+            benchmarkSettings.cameraPathFilename = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--bench-output") == 0 && hasValue)
+        {
+            benchmarkSettings.outputFilename = argv[++i];
+        }
+    }
+
+    if (benchmark && !fw.setBenchmark(benchmarkSettings))
+    {
+        return 1;
+    }
+    return runApplication<T>(fw);
+}
+
 } // namespace fw
@@ -1,16 +1,22 @@
 #pragma once
 
 #include "Application.h"
+#include "Benchmark.h"
+#include "Constants.h"
 #include "Device.h"
 #include "GUI.h"
 #include "Input.h"
 #include "Instance.h"
+#include "PipelineCache.h"
 #include "SwapChain.h"
 #include "Time.h"
 #include "Window.h"
 
 #include <vulkan/vulkan.h>
 
+#include <deque>
+#include <vector>
+
 namespace fw
 {
 class Framework
@@ -25,6 +31,9 @@ public:
     Framework& operator=(const Framework&) = delete;
     Framework& operator=(Framework&&) = delete;
 
+    void setHeadless(uint32_t frameCount);
+    // Runs headless with a fixed timestep and writes the results when the application exits
+    bool setBenchmark(const Benchmark::Settings& settings);
     bool initialize();
     void setApplication(Application* application);
     void execute();
@@ -33,15 +42,23 @@ private:
     Instance m_instance;
     Window m_window;
     Device m_device;
+    PipelineCache m_pipelineCache;
     SwapChain m_swapChain;
     Time m_time;
     Input m_input;
     GUI m_gui;
 
+    struct Frame
+    {
+        VkSemaphore imageAvailable = VK_NULL_HANDLE;
+        VkSemaphore renderFinished = VK_NULL_HANDLE;
+        VkSemaphore computeFinished = VK_NULL_HANDLE;
+        VkFence inFlight = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    };
+
     VkCommandPool m_commandPool = VK_NULL_HANDLE;
     VkCommandPool m_computeCommandPool = VK_NULL_HANDLE;
-    VkSemaphore m_imageAvailable = VK_NULL_HANDLE;
-    VkSemaphore m_renderFinished = VK_NULL_HANDLE;
 
     VkDevice m_logicalDevice = VK_NULL_HANDLE;
     VkQueue m_graphicsQueue = VK_NULL_HANDLE;
@@ -52,18 +69,36 @@ private:
     Application* m_app = nullptr;
     std::vector<VkCommandBuffer> m_commandBuffers;
     VkCommandBuffer m_nextCommandBuffer = nullptr;
-    VkFence m_renderBufferFence = VK_NULL_HANDLE;
     VkFence m_commandBufferFence = VK_NULL_HANDLE;
 
     VkCommandBuffer m_nextComputeCommandBuffer = nullptr;
+    bool m_asyncCompute = false;
+    bool m_computeSubmitted = false;
+    // Signaled by the rendering of frames with compute and waited by the compute of a later frame, oldest first
+    std::deque<VkSemaphore> m_pendingRenderReleases;
+    std::vector<VkSemaphore> m_freeRenderReleases;
 
     uint32_t m_currentImageIndex = std::numeric_limits<uint32_t>::max();
 
+    uint32_t m_framesInFlight = Constants::framesInFlight;
+    uint32_t m_currentFrameIndex = 0;
+    std::vector<Frame> m_frames;
+    std::vector<VkFence> m_imagesInFlight;
+
     bool m_renderingEnabled = true;
 
+    bool m_headless = false;
+    uint32_t m_headlessFrameCount = 0;
+    uint64_t m_frameNumber = 0;
+
+    Benchmark m_benchmark;
+    bool m_benchmarkEnabled = false;
+
     bool m_quit = false;
 
-    bool createSemaphores();
+    bool createFrames();
+    void setFramesInFlight(uint32_t count);
+    bool shouldQuit();
     void compute();
     bool render();
     bool acquireNextSwapChainImage();
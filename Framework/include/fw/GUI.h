@@ -12,6 +12,8 @@
 
 #include <vulkan/vulkan.h>
 
+#include <vector>
+
 namespace fw
 {
 class GUI
@@ -26,6 +28,7 @@ public:
 
     bool initialize(VkDescriptorPool descriptorPool);
     void beginPass() const;
+    void drawProfiler() const;
     bool render(VkFramebuffer framebuffer) const;
     VkCommandBuffer getCommandBuffer() const;
 
@@ -34,12 +37,12 @@ public:
 private:
     VkDevice m_logicalDevice = VK_NULL_HANDLE;
     VkCommandBufferBeginInfo m_info{};
-    VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> m_commandBuffers;
     VkRenderPass m_renderPass = VK_NULL_HANDLE;
 
     bool m_initialized = false;
 
-    bool createCommandBuffer();
+    bool createCommandBuffers();
     bool createRenderPass();
 };
 
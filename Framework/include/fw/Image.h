@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Allocator.h"
+
 #include <vulkan/vulkan.h>
 
 namespace fw
@@ -7,6 +9,8 @@ namespace fw
 class Image
 {
 public:
+    friend class UploadBatch;
+
     Image(){};
     ~Image();
 
@@ -27,16 +31,24 @@ public:
                 uint32_t mipLevels,
                 VkSampleCountFlagBits sampleCount);
 
+    // The view covers all mip levels
     bool createView(VkFormat format, VkImageAspectFlags aspectFlags, VkImageView* imageView);
+    bool createView(VkFormat format, VkImageAspectFlags aspectFlags, uint32_t baseMipLevel, uint32_t levelCount, VkImageView* imageView);
     bool transitLayout(VkImageLayout newLayout);
+    // Records the barrier into an already recording command buffer
+    bool transitLayout(VkCommandBuffer commandBuffer, VkImageLayout newLayout);
 
     VkImage getHandle() const;
+    uint32_t getMipLevels() const;
 
 private:
     VkDevice m_logicalDevice = VK_NULL_HANDLE;
     VkImage m_image = VK_NULL_HANDLE;
-    VkDeviceMemory m_memory = VK_NULL_HANDLE;
+    Allocator::Allocation m_allocation;
     VkImageLayout m_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    uint32_t m_mipLevels = 1;
+    // Levels UploadBatch has left in the shader read layout, m_layout covers every level so it changes once all are
+    uint32_t m_uploadedMipLevels = 0;
 
     bool allocate(const VkImageCreateInfo& imageInfo);
 };
@@ -15,13 +15,13 @@ public:
     Instance& operator=(const Instance&) = delete;
     Instance& operator=(Instance&&) = delete;
 
-    bool initialize();
+    bool initialize(bool headless);
 
 private:
     VkInstance m_instance = VK_NULL_HANDLE;
     VkDebugReportCallbackEXT m_callback;
 
-    bool createInstance();
+    bool createInstance(bool headless);
     bool createDebugReportCallback();
 };
 
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace fw
+{
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile(){};
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+
+    bool open(const std::string& filename);
+    void close();
+
+    const unsigned char* getData() const;
+    size_t getSize() const;
+
+private:
+    void* m_data = nullptr;
+    size_t m_size = 0;
+#if defined(_WIN32)
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+};
+
+} // namespace fw
@@ -3,6 +3,7 @@
 #include <assimp/material.h>
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -20,6 +21,21 @@ public:
         glm::vec2 uv;
     };
 
+    enum class VertexFormat
+    {
+        Full,
+        // Octahedral snorm16 normal and tangent, half float uv
+        Packed
+    };
+
+    struct PackedVertex
+    {
+        glm::vec3 position;
+        uint32_t normal;
+        uint32_t tangent;
+        uint32_t uv;
+    };
+
     using Vertices = std::vector<Vertex>;
     using Materials = std::unordered_map<aiTextureType, std::vector<std::string>>;
 
@@ -30,8 +46,13 @@ public:
     std::vector<uint32_t> indices;
     Materials materials;
 
+    static size_t getVertexSize(VertexFormat format);
+
     Mesh(){};
     Vertices getVertices() const;
+    size_t getVertexDataSize(VertexFormat format) const;
+    // Writes interleaved vertices to dst, e.g. a mapped staging buffer, which must hold getVertexDataSize(format) bytes
+    void writeVertices(void* dst, VertexFormat format = VertexFormat::Full) const;
     std::string getFirstTextureOfType(aiTextureType type) const;
 };
 
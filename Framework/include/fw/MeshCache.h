@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Model.h"
+
+#include <string>
+
+namespace fw
+{
+// Binary cache of post-processed model data stored next to the source file as <file>.myvkmesh. The cache is valid
+// only for the same format version, import flags, mesh optimization and source file content.
+class MeshCache
+{
+public:
+    MeshCache() = delete;
+
+    static std::string getCacheFilename(const std::string& file);
+    static bool load(const std::string& file, unsigned int importFlags, bool optimized, Model::Meshes& meshes, Model::TextureDatas& textureDatas);
+    static bool save(const std::string& file, unsigned int importFlags, bool optimized, const Model::Meshes& meshes, const Model::TextureDatas& textureDatas);
+};
+
+} // namespace fw
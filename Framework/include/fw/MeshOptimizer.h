@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace fw
+{
+// Reorders mesh indices and vertices for the post-transform vertex cache, overdraw and vertex fetch.
+// Index reordering is Tipsify (Sander, Nehab and Barczak 2007), the same paper gives the cluster ordering.
+class MeshOptimizer
+{
+public:
+    struct VertexCacheStats
+    {
+        size_t transformCount = 0;
+        size_t triangleCount = 0;
+        size_t vertexCount = 0;
+
+        // Average cache miss ratio, vertex shader invocations per triangle. 3.0 is the worst case.
+        double getAcmr() const;
+        // Average transform to vertex ratio, 1.0 is optimal
+        double getAtvr() const;
+        VertexCacheStats& operator+=(const VertexCacheStats& other);
+    };
+
+    MeshOptimizer() = delete;
+
+    // Runs all the steps below, the mesh keeps its vertex count
+    static void optimize(Mesh& mesh, uint32_t cacheSize = 16);
+
+    // Returns false if the indices are not a triangle list. Clusters are the first triangles of the
+    // runs that start from a dead end, they are the units reordered by optimizeOverdraw.
+    static bool optimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>& optimized, std::vector<size_t>& clusters);
+    // Draws the outward facing clusters far from the mesh center first so that they occlude the rest
+    static void optimizeOverdraw(const std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices, const std::vector<size_t>& clusters);
+    // Orders the vertices by their first use in the index buffer, unreferenced vertices are moved to the end
+    static void optimizeVertexFetch(Mesh& mesh);
+
+    // Simulates a FIFO cache of the given size
+    static VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+};
+
+} // namespace fw
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "Constants.h"
 #include "Mesh.h"
+#include "MeshOptimizer.h"
 
 #include <string>
 #include <unordered_map>
@@ -13,6 +15,24 @@ class Model
 public:
     using Meshes = std::vector<Mesh>;
     using TextureData = std::vector<unsigned char>;
+    using TextureDatas = std::unordered_map<unsigned int, TextureData>;
+
+    struct LoadStats
+    {
+        bool fromCache = false;
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
+        // Assimp reading and post-processing
+        double importMilliseconds = 0.0;
+        // Conversion of the Assimp scene into meshes
+        double extractMilliseconds = 0.0;
+        double optimizeMilliseconds = 0.0;
+        double totalMilliseconds = 0.0;
+        // Index order given by Assimp, only filled when the model is imported
+        MeshOptimizer::VertexCacheStats importedVertexCache;
+        // Index order of the loaded meshes
+        MeshOptimizer::VertexCacheStats vertexCache;
+    };
 
     Model(){};
     Model(const Model&) = delete;
@@ -21,12 +41,20 @@ public:
     Model& operator=(Model&&) = delete;
 
     bool loadModel(const std::string& file);
+    void setCacheEnabled(bool enabled);
+    void setOptimizationEnabled(bool enabled);
+    const LoadStats& getLoadStats() const;
     const Meshes& getMeshes() const;
     const TextureData& getTextureData(unsigned int index);
 
 private:
     Meshes m_meshes;
-    std::unordered_map<unsigned int, TextureData> m_textureDatas;
+    TextureDatas m_textureDatas;
+    bool m_cacheEnabled = Constants::useMeshCache;
+    bool m_optimizationEnabled = Constants::optimizeMeshes;
+    LoadStats m_loadStats;
+
+    bool importModel(const std::string& file, unsigned int flags);
 };
 
 } // namespace fw
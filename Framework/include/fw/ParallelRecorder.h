@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace fw
+{
+// Records secondary command buffers for ranges of objects on worker threads. Every worker has its own command pool
+// per frame in flight, the pools are reset when their frame comes around again.
+class ParallelRecorder
+{
+public:
+    using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, size_t begin, size_t end)>;
+
+    ParallelRecorder(){};
+    ~ParallelRecorder();
+    ParallelRecorder(const ParallelRecorder&) = delete;
+    ParallelRecorder(ParallelRecorder&&) = delete;
+    ParallelRecorder& operator=(const ParallelRecorder&) = delete;
+    ParallelRecorder& operator=(ParallelRecorder&&) = delete;
+
+    // Zero uses all the hardware threads
+    bool initialize(uint32_t threadCount = 0);
+    uint32_t getThreadCount() const;
+    // Number of ranges and therefore secondary command buffers per record call, defaults to the thread count
+    void setJobCount(uint32_t count);
+    uint32_t getJobCount() const;
+
+    // The function is called once per range with a secondary command buffer that has been begun with the given
+    // inheritance, the resulting command buffers are returned in range order ready for vkCmdExecuteCommands
+    bool record(const VkCommandBufferInheritanceInfo& inheritanceInfo, size_t count, const RecordFunction& function, std::vector<VkCommandBuffer>& commandBuffers);
+
+private:
+    struct WorkerFrame
+    {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> commandBuffers;
+        size_t usedCount = 0;
+    };
+
+    VkDevice m_logicalDevice = VK_NULL_HANDLE;
+    std::unique_ptr<ThreadPool> m_threadPool;
+    // Indexed with frame index * thread count + thread index
+    std::vector<WorkerFrame> m_workerFrames;
+    uint32_t m_jobCount = 0;
+    uint64_t m_frameNumber = std::numeric_limits<uint64_t>::max();
+
+    VkCommandBuffer getCommandBuffer(WorkerFrame& workerFrame);
+};
+
+} // namespace fw
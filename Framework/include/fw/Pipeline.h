@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Mesh.h"
+
 #include <vulkan/vulkan.h>
 
 #include <string>
@@ -11,10 +13,11 @@ class Pipeline
 {
 public:
     Pipeline() = delete;
+    // The shader modules come from ShaderModuleCache, release them with ShaderModuleCache::release
     static std::vector<VkPipelineShaderStageCreateInfo> getShaderStageInfos(const std::string& vertexShaderFilename, const std::string& fragmentShaderFilename);
     static VkPipelineShaderStageCreateInfo getComputeShaderStageInfo(const std::string& computeShaderFilename);
-    static VkVertexInputBindingDescription getVertexDescription();
-    static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+    static VkVertexInputBindingDescription getVertexDescription(Mesh::VertexFormat format = Mesh::VertexFormat::Full);
+    static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(Mesh::VertexFormat format = Mesh::VertexFormat::Full);
     static VkPipelineVertexInputStateCreateInfo
     getVertexInputState(const VkVertexInputBindingDescription* vertexDescription, const std::vector<VkVertexInputAttributeDescription>* attributeDescriptions);
     static VkPipelineInputAssemblyStateCreateInfo getInputAssemblyState();
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+
+namespace fw
+{
+// Framework owned VkPipelineCache which is loaded on startup and written back on shutdown. The file name contains
+// the pipeline cache UUID and the driver version so that a different device or driver starts from an empty cache.
+class PipelineCache
+{
+public:
+    PipelineCache(){};
+    ~PipelineCache();
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache(PipelineCache&&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+    PipelineCache& operator=(PipelineCache&&) = delete;
+
+    bool initialize();
+    bool save() const;
+
+    static std::string getCacheFilename();
+
+private:
+    VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+};
+
+} // namespace fw
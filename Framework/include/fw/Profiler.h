@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fw
+{
+// Named GPU scopes measured with timestamp queries and CPU scopes measured with the steady clock. GPU results are read
+// after the frame fence has been waited so the readback never stalls, they lag a few frames behind. Scopes with the
+// same name are combined into one result.
+class Profiler
+{
+public:
+    friend class Framework;
+
+    struct Result
+    {
+        std::string name;
+        bool gpu = false;
+        uint64_t sampleCount = 0;
+        double lastMs = 0.0;
+        double averageMs = 0.0;
+        double minMs = 0.0;
+        double maxMs = 0.0;
+        // Oldest first, the average, min and max are over these
+        std::vector<float> history;
+    };
+
+    class CpuScope
+    {
+    public:
+        explicit CpuScope(const char* name);
+        ~CpuScope();
+        CpuScope(const CpuScope&) = delete;
+        CpuScope(CpuScope&&) = delete;
+        CpuScope& operator=(const CpuScope&) = delete;
+        CpuScope& operator=(CpuScope&&) = delete;
+
+    private:
+        const char* m_name;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    Profiler() = delete;
+
+    // A scope is identified by its command buffer and name, so command buffers that are recorded once and submitted
+    // every frame keep producing results. Begin resets the queries and has to be recorded outside of a render pass.
+    static void beginScope(VkCommandBuffer commandBuffer, const std::string& name, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+    static void endScope(VkCommandBuffer commandBuffer, const std::string& name, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+    static std::vector<Result> getResults();
+    // One row per scope with the same numbers as the results
+    static bool exportCSV(const std::string& filename);
+    // Every recorded sample, load in chrome://tracing or Perfetto. The GPU and CPU clocks are not calibrated against
+    // each other so the two tracks both start from zero.
+    static bool exportChromeTrace(const std::string& filename);
+
+    static bool isGpuSupported();
+
+private:
+    struct Scope
+    {
+        uint32_t statIndex = 0;
+        uint32_t firstQuery = 0;
+        // A command buffer that has not been submitted again still has the old result available
+        uint64_t lastBegin = 0;
+    };
+
+    struct Stat
+    {
+        std::string name;
+        bool gpu = false;
+        uint64_t sampleCount = 0;
+        double lastMs = 0.0;
+        std::vector<float> history;
+        size_t historyIndex = 0;
+    };
+
+    struct Event
+    {
+        uint32_t statIndex = 0;
+        double startUs = 0.0;
+        double durationUs = 0.0;
+    };
+
+    static std::mutex s_mutex;
+    static VkQueryPool s_queryPool;
+    static uint32_t s_usedQueryCount;
+    static double s_nanosecondsPerTick;
+    static uint64_t s_timestampMask;
+    static uint64_t s_firstTimestamp;
+    static std::chrono::steady_clock::time_point s_start;
+    static std::unordered_map<VkCommandBuffer, std::unordered_map<std::string, uint32_t>> s_scopeIndices;
+    static std::vector<Scope> s_scopes;
+    static std::map<std::pair<std::string, bool>, uint32_t> s_statIndices;
+    static std::vector<Stat> s_stats;
+    static std::deque<Event> s_events;
+
+    static bool initialize();
+    // Called once the frame fence has been waited
+    static void collect();
+    static void release();
+
+    static uint32_t getStatIndex(const std::string& name, bool gpu);
+    static void addSample(uint32_t statIndex, double startUs, double durationUs);
+};
+
+} // namespace fw
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Buffer.h"
+#include "DescriptorAllocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+
+namespace fw
+{
+// Sorts pairs of uint32 keys and values on the GPU with a least significant digit radix sort of 4 bits per pass. A
+// pass counts the digits of every block of keys, scans the counts to the first index of each digit in each block and
+// moves the pairs stably to a scratch copy, the next pass moves them back. The result is in the original buffers.
+class RadixSort
+{
+public:
+    RadixSort(){};
+    ~RadixSort();
+    RadixSort(const RadixSort&) = delete;
+    RadixSort(RadixSort&&) = delete;
+    RadixSort& operator=(const RadixSort&) = delete;
+    RadixSort& operator=(RadixSort&&) = delete;
+
+    // The buffers need the storage buffer usage and room for maxCount pairs
+    bool create(Buffer* keyBuffer, Buffer* valueBuffer, uint32_t maxCount);
+    // Sorts the first count pairs in ascending order by the lowest keyBits bits of the keys, at most 32, the higher bits
+    // are ignored. The caller makes the pairs visible to the compute shader stage before and waits for the compute
+    // shader stage after. Binds its own pipelines and descriptor sets.
+    void record(VkCommandBuffer commandBuffer, uint32_t count, uint32_t keyBits = 32) const;
+
+    uint32_t getMaxCount() const;
+    // Always even so that the last pass writes to the original buffers
+    static uint32_t getPassCount(uint32_t keyBits);
+
+private:
+    enum Stage
+    {
+        Count,
+        Scan,
+        Scatter,
+        StageCount
+    };
+
+    struct Pass
+    {
+        uint32_t count;
+        uint32_t shift;
+        uint32_t blockCount;
+        uint32_t digitMask;
+    };
+
+    VkDevice m_logicalDevice = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    std::array<VkPipeline, StageCount> m_pipelines{};
+
+    uint32_t m_maxCount = 0;
+    Buffer* m_keyBuffer = nullptr;
+    Buffer* m_valueBuffer = nullptr;
+    Buffer m_scratchKeyBuffer;
+    Buffer m_scratchValueBuffer;
+    // Digit counts and then offsets of every block
+    Buffer m_histogramBuffer;
+
+    DescriptorAllocator m_descriptorAllocator;
+    // From the original buffers to the scratch buffers and back
+    std::array<VkDescriptorSet, 2> m_descriptorSets{};
+
+    bool createBuffers();
+    bool createDescriptorSetLayout();
+    bool createPipelines();
+    bool createDescriptorSets();
+    void dispatch(VkCommandBuffer commandBuffer, Stage stage, uint32_t workgroupCount) const;
+};
+
+} // namespace fw
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Buffer.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstring>
+#include <limits>
+
+namespace fw
+{
+// Persistently mapped buffer for transient per-frame data. Every frame in flight owns its own region which is
+// reset when the frame comes around again, allocations return offsets for dynamic descriptors.
+class RingBuffer
+{
+public:
+    RingBuffer(){};
+    ~RingBuffer(){};
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer(RingBuffer&&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+    RingBuffer& operator=(RingBuffer&&) = delete;
+
+    bool create(VkDeviceSize frameSize, VkBufferUsageFlags usage, bool sharedWithCompute = false);
+
+    bool allocate(VkDeviceSize size, uint32_t& offset, void** data);
+
+    template<typename T>
+    bool push(const T& data, uint32_t& offset);
+
+    VkBuffer getBuffer() const;
+    VkDeviceSize getFrameSize() const;
+    VkDeviceSize getAlignment() const;
+
+private:
+    Buffer m_buffer;
+    char* m_mappedData = nullptr;
+    VkDeviceSize m_frameSize = 0;
+    VkDeviceSize m_alignment = 1;
+    VkDeviceSize m_head = 0;
+    VkDeviceSize m_frameEnd = 0;
+    uint64_t m_frameNumber = std::numeric_limits<uint64_t>::max();
+
+    void beginFrame();
+};
+
+template<typename T>
+bool RingBuffer::push(const T& data, uint32_t& offset)
+{
+    void* dst = nullptr;
+    if (!allocate(sizeof(T), offset, &dst))
+    {
+        return false;
+    }
+    std::memcpy(dst, &data, sizeof(T));
+    return m_buffer.flush(offset, sizeof(T));
+}
+
+} // namespace fw
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace fw
+{
+// Shader modules keyed by the hash of their SPIR-V so that identical code is turned into a module only once.
+// File names already seen map straight to their module without touching the file again.
+class ShaderModuleCache
+{
+public:
+    friend class Device;
+
+    ShaderModuleCache() = delete;
+
+    // Every acquired module must be released, returns VK_NULL_HANDLE on failure
+    static VkShaderModule acquire(const std::string& filename);
+    static void release(VkShaderModule shaderModule);
+    // Modules without references are kept for later pipeline builds until they are trimmed
+    static void trim();
+
+    static uint32_t getModuleCount();
+
+private:
+    struct Entry
+    {
+        VkShaderModule shaderModule = VK_NULL_HANDLE;
+        uint32_t referenceCount = 0;
+    };
+
+    static std::mutex s_mutex;
+    // SPIR-V hash to module
+    static std::unordered_map<uint64_t, Entry> s_entries;
+    static std::unordered_map<std::string, uint64_t> s_filenameHashes;
+
+    static void destroy(uint64_t hash);
+    static void releaseAll();
+};
+
+} // namespace fw
@@ -28,6 +28,7 @@ public:
     SwapChain& operator=(SwapChain&&) = delete;
 
     bool create(uint32_t width, uint32_t height);
+    bool createOffscreen(uint32_t width, uint32_t height);
     bool initialize();
     bool initializeWithoutDepthImage();
     bool initializeWithDefaultFramebuffer(VkRenderPass renderPass);
@@ -49,6 +50,7 @@ private:
     VkSwapchainKHR m_swapChain = VK_NULL_HANDLE;
 
     std::vector<VkImage> m_images;
+    std::vector<Image> m_offscreenImages;
     std::vector<VkImageView> m_imageViews;
     std::vector<VkFramebuffer> m_framebuffers;
 
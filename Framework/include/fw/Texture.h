@@ -1,31 +1,84 @@
 #pragma once
 
 #include "Image.h"
+#include "TextureCache.h"
+#include "UploadBatch.h"
 
 #include <vulkan/vulkan.h>
 
+#include <cstdint>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace fw
 {
 class Texture
 {
 public:
+    friend class TextureLoader;
+
+    enum class Compression
+    {
+        BC1,
+        BC3,
+        // Red and green channels only, e.g. for normal maps
+        BC5,
+        // There is no encoder for it, the <file>.<format>.dds cache has to be made by an offline tool
+        BC7
+    };
+
     Texture(){};
     ~Texture();
 
     bool load(const std::string& filename, VkFormat format);
     bool loadHDR(const std::string& filename);
     bool load(const unsigned char* data, size_t size, VkFormat format);
+    // The image is usable once the batch has been waited
+    bool load(const std::string& filename, VkFormat format, UploadBatch& batch);
+    bool load(const unsigned char* data, size_t size, VkFormat format, UploadBatch& batch);
+
+    // Uploads block compressed mips from the <file>.<format>.dds cache which is encoded on the first load. Falls back to
+    // an uncompressed load if the device cannot sample the format.
+    bool loadCompressed(const std::string& filename, Compression compression, bool srgb);
+    bool loadCompressed(const std::string& filename, Compression compression, bool srgb, UploadBatch& batch);
+    // Uploads a BC1, BC3, BC5 or BC7 DDS file as is, e.g. one made by an offline tool
+    bool loadDds(const std::string& filename);
+    bool loadDds(const std::string& filename, UploadBatch& batch);
+
+    // The mip chain is built on the CPU but only the levels up to Constants::streamedTextureInitialSize are uploaded,
+    // the texture is usable once the batch has been waited. The larger levels follow with streamNextMipLevel.
+    bool loadStreamed(const std::string& filename, VkFormat format, UploadBatch& batch);
+    // Uploads the next larger mip level, call updateImageView after the batch has been waited
+    bool streamNextMipLevel(UploadBatch& batch);
+    // Recreates the view when new levels have been uploaded. Descriptors using the previous view need to be updated,
+    // the previous view is destroyed once the frames in flight no longer use it.
+    bool updateImageView();
+    bool isFullyResident() const;
 
     VkImageView getImageView() const;
 
 private:
     Image m_image;
     VkImageView m_imageView = VK_NULL_HANDLE;
+    VkFormat m_format = VK_FORMAT_UNDEFINED;
+
+    // Streaming state, the view starts from m_residentMipLevel and m_uploadedMipLevel is the smallest level uploaded
+    std::vector<std::vector<unsigned char>> m_mipLevelData;
+    std::vector<UploadBatch::ImageLevel> m_mipLevels;
+    uint32_t m_residentMipLevel = 0;
+    uint32_t m_uploadedMipLevel = 0;
+    // Views replaced by updateImageView with the frame number they were replaced on
+    std::vector<std::pair<VkImageView, uint64_t>> m_retiredImageViews;
 
-    bool load(const std::string& filename, VkFormat format, int desiredChannels);
-    bool createImage(unsigned char* pixels, int width, int height, VkFormat format);
+    bool load(const std::string& filename, VkFormat format, int desiredChannels, UploadBatch* batch);
+    bool load(const unsigned char* data, size_t size, VkFormat format, UploadBatch* batch);
+    bool createImage(unsigned char* pixels, int width, int height, VkFormat format, UploadBatch* batch);
+    bool loadCompressed(const std::string& filename, Compression compression, bool srgb, UploadBatch* batch);
+    bool loadDds(const std::string& filename, UploadBatch* batch);
+    bool encodeCompressed(const std::string& filename, VkFormat format, TextureCache::CompressedImage& image);
+    bool createCompressedImage(const TextureCache::CompressedImage& image, UploadBatch* batch);
+    void destroyRetiredImageViews(bool all);
 };
 
 } // namespace fw
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fw
+{
+// Block compressed mip chains stored next to the source file as DDS files with the DX10 header. The hash of the
+// source file is kept in the reserved words of the DDS header so that a changed source is compressed again.
+class TextureCache
+{
+public:
+    struct Level
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        size_t offset = 0;
+        size_t size = 0;
+    };
+
+    struct CompressedImage
+    {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        std::vector<Level> levels;
+        std::vector<unsigned char> data;
+    };
+
+    TextureCache() = delete;
+
+    static std::string getCacheFilename(const std::string& file, VkFormat format);
+    static bool load(const std::string& file, VkFormat format, CompressedImage& image);
+    static bool save(const std::string& file, const CompressedImage& image);
+    // Any BC1, BC3, BC5 or BC7 DDS file, e.g. one made by an offline tool
+    static bool loadDds(const std::string& filename, CompressedImage& image);
+};
+
+} // namespace fw
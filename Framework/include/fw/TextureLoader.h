@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Texture.h"
+#include "ThreadPool.h"
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace fw
+{
+// Decodes 8 bit RGBA textures on worker threads while the calling thread creates the images as the decodes finish
+// and stages them all into one upload batch. Textures and memory given to add must stay alive until wait returns.
+class TextureLoader
+{
+public:
+    using Handle = uint32_t;
+
+    // Zero uses all the hardware threads
+    explicit TextureLoader(uint32_t threadCount = 0);
+    ~TextureLoader();
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader(TextureLoader&&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+    TextureLoader& operator=(TextureLoader&&) = delete;
+
+    // Decoding starts immediately
+    Handle add(Texture& texture, const std::string& filename, VkFormat format);
+    Handle add(Texture& texture, const unsigned char* data, size_t size, VkFormat format);
+
+    // Creates the images of everything added since the previous wait, submits the uploads once and waits for them
+    bool wait();
+    // Whether the texture was created and uploaded, valid after the wait that covered it
+    bool isLoaded(Handle handle) const;
+    uint32_t getThreadCount() const;
+
+private:
+    struct Request
+    {
+        Texture* texture = nullptr;
+        std::string filename;
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        unsigned char* pixels = nullptr;
+        int width = 0;
+        int height = 0;
+        bool loaded = false;
+    };
+
+    std::vector<std::unique_ptr<Request>> m_requests;
+    size_t m_firstPending = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_requestDecoded;
+    std::queue<Request*> m_decodedRequests;
+
+    // Declared last so that the workers are joined before the state they use is destroyed
+    ThreadPool m_threadPool;
+
+    Handle add(std::unique_ptr<Request> request);
+    void decode(Request& request);
+};
+
+} // namespace fw
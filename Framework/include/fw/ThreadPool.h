@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace fw
+{
+// Fixed set of worker threads, jobs get the index of the worker that runs them so that per-thread resources
+// such as command pools can be used without locking
+class ThreadPool
+{
+public:
+    using Job = std::function<void(uint32_t threadIndex)>;
+    using RangeJob = std::function<void(size_t begin, size_t end, uint32_t threadIndex)>;
+
+    // Zero uses all the hardware threads
+    explicit ThreadPool(uint32_t threadCount = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    uint32_t getThreadCount() const;
+
+    void enqueue(Job job);
+    // Blocks until every enqueued job has finished
+    void wait();
+    // Splits [0, count) into at most rangeCount contiguous ranges and waits for them, zero range count uses one range per thread
+    void parallelFor(size_t count, const RangeJob& job, uint32_t rangeCount = 0);
+
+private:
+    std::vector<std::thread> m_threads;
+    std::queue<Job> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    std::condition_variable m_jobsDone;
+    uint32_t m_activeJobs = 0;
+    bool m_stop = false;
+
+    void work(uint32_t threadIndex);
+};
+
+} // namespace fw
@@ -1,23 +1,63 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+
 namespace fw
 {
+// Time is kept as integer nanoseconds so the precision does not degrade over a long session
 class Time
 {
 public:
-    Time(){};
+    Time();
     Time(const Time&) = delete;
     Time(Time&&) = delete;
     Time& operator=(const Time&) = delete;
     Time& operator=(Time&&) = delete;
 
+    // Every update advances the time by the given delta instead of the wall clock, zero goes back to the wall clock
+    void setDeterministicDelta(double seconds);
+    // Splits the frame time into fixed steps, zero disables the steps
+    void setFixedTimestep(double seconds);
+    // Zero disables the limit
+    void setFrameRateLimit(double framesPerSecond);
+
     void update();
+    // Sleeps until the next frame is due when the frame rate is limited
+    void waitForNextFrame();
+
     float getSinceStart() const;
     float getDelta() const;
+    double getSinceStartSeconds() const;
+    double getDeltaSeconds() const;
+    int64_t getSinceStartNanoseconds() const;
+    int64_t getDeltaNanoseconds() const;
+
+    // Steps to simulate this frame, the time left over is carried to the next frame
+    uint32_t getFixedStepCount() const;
+    double getFixedTimestep() const;
+    // Fraction of a step left over, for interpolating between the last two simulated states
+    double getFixedStepAlpha() const;
 
 private:
-    float m_sinceStart = 0.0f;
-    float m_delta = 0.0f;
+    std::chrono::steady_clock::time_point m_start;
+    int64_t m_sinceStart = 0;
+    int64_t m_delta = 0;
+    int64_t m_deterministicDelta = 0;
+
+    int64_t m_fixedTimestep = 0;
+    int64_t m_accumulator = 0;
+    uint32_t m_fixedStepCount = 0;
+
+    int64_t m_framePeriod = 0;
+    int64_t m_nextFrame = 0;
+    // Running mean and variance of how long a short sleep takes
+    double m_sleepMean = 2.0e6;
+    double m_sleepM2 = 0.0;
+    uint64_t m_sleepCount = 1;
+
+    int64_t getElapsed() const;
+    void sleepUntil(int64_t target);
 };
 
 } // namespace fw
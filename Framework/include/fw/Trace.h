@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fw
+{
+// CPU scopes written to a ring buffer owned by the recording thread, recording takes no locks. The buffers are
+// written out as Chrome trace JSON, for chrome://tracing or Perfetto, when the framework shuts down. The scopes are
+// recorded only when built with MYVK_ENABLE_TRACING, otherwise the TRACE_ macros compile to nothing.
+class Trace
+{
+public:
+    class Scope
+    {
+    public:
+        // The name has to outlive the trace, in practice a string literal
+        explicit Scope(const char* name);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope(Scope&&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        Scope& operator=(Scope&&) = delete;
+
+    private:
+        const char* m_name;
+        uint64_t m_start;
+    };
+
+    Trace() = delete;
+
+    static void setThreadName(const std::string& name);
+    // Does nothing if no scopes were recorded. Scopes recorded while writing may be missing or torn.
+    static bool write(const std::string& filename);
+
+private:
+    struct Event
+    {
+        const char* name = nullptr;
+        uint64_t startNs = 0;
+        uint64_t durationNs = 0;
+    };
+
+    struct ThreadBuffer
+    {
+        uint32_t threadId = 0;
+        std::string name;
+        std::vector<Event> events;
+        // Total number of recorded events, the oldest ones have been overwritten
+        std::atomic<uint64_t> count{0};
+        bool inUse = false;
+    };
+
+    // The events of a thread that has exited, oldest first
+    struct RetiredThread
+    {
+        uint32_t threadId = 0;
+        std::string name;
+        std::vector<Event> events;
+    };
+
+    // Thread local, releases the buffer of the thread when it exits
+    struct ThreadBufferOwner
+    {
+        ThreadBuffer* buffer = nullptr;
+        ~ThreadBufferOwner();
+    };
+
+    static std::mutex s_mutex;
+    // Buffers are reused by new threads once their thread has exited, e.g. the workers of short lived pools
+    static std::vector<std::unique_ptr<ThreadBuffer>> s_threadBuffers;
+    static std::vector<ThreadBuffer*> s_freeThreadBuffers;
+    // Copied from released buffers so that the events of finished threads end up in the trace
+    static std::deque<RetiredThread> s_retiredThreads;
+    static size_t s_retiredEventCount;
+    static uint32_t s_nextThreadId;
+
+    static uint64_t now();
+    static ThreadBuffer& getThreadBuffer();
+    static void releaseThreadBuffer(ThreadBuffer& buffer);
+    static void writeThread(std::ostream& file, uint32_t threadId, const std::string& name, const std::vector<Event>& events, uint64_t first, uint64_t count, const char*& separator);
+};
+
+} // namespace fw
+
+#ifdef MYVK_ENABLE_TRACING
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name) fw::Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) fw::Trace::setThreadName(name)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_THREAD_NAME(name)
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Buffer.h"
+#include "Image.h"
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <vector>
+
+namespace fw
+{
+// Collects buffer and image uploads into one command buffer which is submitted once and waited with a fence.
+// Uploads go to the dedicated transfer queue if the device has one, ownership is then handed to the graphics queue.
+class UploadBatch
+{
+public:
+    struct ImageLevel
+    {
+        const void* data = nullptr;
+        VkDeviceSize size = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t mipLevel = 0;
+    };
+
+    UploadBatch(){};
+    ~UploadBatch();
+    UploadBatch(const UploadBatch&) = delete;
+    UploadBatch(UploadBatch&&) = delete;
+    UploadBatch& operator=(const UploadBatch&) = delete;
+    UploadBatch& operator=(UploadBatch&&) = delete;
+
+    // The data is copied to staging memory immediately, the destination is ready to use after wait()
+    bool upload(Buffer& dst, const void* data, VkDeviceSize size);
+    // Returns staging memory that is copied to dst when the batch is submitted, fill it before that
+    void* allocate(Buffer& dst, VkDeviceSize size);
+    // Leaves the image in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    bool upload(Image& dst, const void* data, VkDeviceSize size, uint32_t width, uint32_t height);
+    // Every level is uploaded only once and left in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, other levels are not touched
+    bool upload(Image& dst, const std::vector<ImageLevel>& levels);
+    // Uploads the first level and blits the rest of the mip chain from it on the graphics queue. The format must
+    // support linear blits and the image needs the transfer source usage.
+    bool uploadAndGenerateMipmaps(Image& dst, const void* data, VkDeviceSize size, uint32_t width, uint32_t height, uint32_t mipLevels);
+
+    bool submit();
+    bool wait();
+    // Does not block, true if nothing is pending or the submitted uploads have finished so that wait() returns at once
+    bool isFinished() const;
+    // Submits and waits
+    bool flush();
+
+private:
+    struct StagingBlock
+    {
+        std::unique_ptr<Buffer> buffer;
+        VkDeviceSize size = 0;
+        VkDeviceSize head = 0;
+    };
+
+    struct MipmapGeneration
+    {
+        VkImage image = VK_NULL_HANDLE;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t mipLevels = 0;
+    };
+
+    VkDevice m_logicalDevice = VK_NULL_HANDLE;
+    uint32_t m_transferFamily = 0;
+    uint32_t m_graphicsFamily = 0;
+    bool m_ownershipTransfer = false;
+
+    VkCommandPool m_transferCommandPool = VK_NULL_HANDLE;
+    VkCommandPool m_graphicsCommandPool = VK_NULL_HANDLE;
+    VkCommandBuffer m_transferCommandBuffer = VK_NULL_HANDLE;
+    VkCommandBuffer m_graphicsCommandBuffer = VK_NULL_HANDLE;
+    VkSemaphore m_transferFinished = VK_NULL_HANDLE;
+    VkFence m_fence = VK_NULL_HANDLE;
+
+    std::vector<StagingBlock> m_stagingBlocks;
+    std::vector<VkBufferMemoryBarrier> m_bufferBarriers;
+    std::vector<VkImageMemoryBarrier> m_imageBarriers;
+    std::vector<Image*> m_images;
+    std::vector<MipmapGeneration> m_mipmapGenerations;
+
+    bool m_recording = false;
+    bool m_submitted = false;
+
+    bool begin();
+    void* stage(VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset);
+    bool copyToLevel(Image& dst, const ImageLevel& level);
+    void addReleaseBarrier(Image& dst, uint32_t mipLevel, VkImageLayout newLayout, VkAccessFlags dstAccessMask);
+    void recordMipmapGenerations(VkCommandBuffer commandBuffer);
+    void reset();
+};
+
+} // namespace fw
@@ -1,5 +1,6 @@
 #include "API.h"
 #include "Common.h"
+#include "Context.h"
 
 namespace fw
 {
@@ -22,6 +23,10 @@ bool API::initializeSwapChainWithDefaultFramebuffer(VkRenderPass renderPass)
 
 bool API::initializeGUI(VkDescriptorPool descriptorPool)
 {
+    if (s_framework->m_headless)
+    {
+        return true;
+    }
     return s_framework->m_gui.initialize(descriptorPool);
 }
 
@@ -80,6 +85,44 @@ float API::getTimeDelta()
     return s_framework->m_time.getDelta();
 }
 
+double API::getTimeSinceStartSeconds()
+{
+    return s_framework->m_time.getSinceStartSeconds();
+}
+
+double API::getTimeDeltaSeconds()
+{
+    return s_framework->m_time.getDeltaSeconds();
+}
+
+void API::setFixedTimestep(double seconds)
+{
+    s_framework->m_time.setFixedTimestep(seconds);
+}
+
+uint32_t API::getFixedStepCount()
+{
+    return s_framework->m_time.getFixedStepCount();
+}
+
+double API::getFixedTimestep()
+{
+    return s_framework->m_time.getFixedTimestep();
+}
+
+double API::getFixedStepAlpha()
+{
+    return s_framework->m_time.getFixedStepAlpha();
+}
+
+void API::setFrameRateLimit(double framesPerSecond)
+{
+    if (!s_framework->m_benchmarkEnabled)
+    {
+        s_framework->m_time.setFrameRateLimit(framesPerSecond);
+    }
+}
+
 bool API::isKeyPressed(int key)
 {
     return s_framework->m_input.isKeyPressed(key);
@@ -124,9 +167,19 @@ void API::setNextComputeCommandBuffer(VkCommandBuffer commandBuffer)
     s_framework->m_nextComputeCommandBuffer = commandBuffer;
 }
 
-void API::setRenderBufferFence(VkFence fence)
+void API::setAsyncCompute(bool enabled)
 {
-    s_framework->m_renderBufferFence = fence;
+    s_framework->m_asyncCompute = enabled;
+}
+
+bool API::isAsyncComputeEnabled()
+{
+    return s_framework->m_asyncCompute;
+}
+
+bool API::hasDedicatedComputeQueue()
+{
+    return Context::getComputeQueueFamily() != Context::getGraphicsQueueFamily();
 }
 
 void API::setCommandBufferFence(VkFence fence)
@@ -134,11 +187,55 @@ void API::setCommandBufferFence(VkFence fence)
     s_framework->m_commandBufferFence = fence;
 }
 
+void API::setFramesInFlight(uint32_t count)
+{
+    s_framework->setFramesInFlight(count);
+}
+
+uint32_t API::getFramesInFlight()
+{
+    return s_framework->m_framesInFlight;
+}
+
+uint32_t API::getCurrentFrameIndex()
+{
+    return s_framework->m_currentFrameIndex;
+}
+
+uint64_t API::getFrameNumber()
+{
+    return s_framework->m_frameNumber;
+}
+
+VkCommandBuffer API::getCurrentFrameCommandBuffer()
+{
+    return s_framework->m_frames[s_framework->m_currentFrameIndex].commandBuffer;
+}
+
 GLFWwindow* API::getGLFWwindow()
 {
     return s_framework->m_window.getWindow();
 }
 
+bool API::isHeadless()
+{
+    return s_framework->m_headless;
+}
+
+const CameraPath* API::getCameraPath()
+{
+    const CameraPath& cameraPath = s_framework->m_benchmark.getCameraPath();
+    return s_framework->m_benchmarkEnabled && !cameraPath.isEmpty() ? &cameraPath : nullptr;
+}
+
+void API::setBenchmarkThroughput(const std::string& scopeName, double workPerSample, const std::string& unit)
+{
+    if (s_framework->m_benchmarkEnabled)
+    {
+        s_framework->m_benchmark.setThroughput(scopeName, workPerSample, unit);
+    }
+}
+
 void API::setRenderingEnabled(bool status)
 {
     s_framework->m_renderingEnabled = status;
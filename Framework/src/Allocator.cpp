@@ -0,0 +1,307 @@
+#include "Allocator.h"
+#include "Common.h"
+#include "Constants.h"
+#include "Context.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+namespace fw
+{
+struct Allocator::Block
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    uint32_t memoryType = 0;
+    bool optimalTiling = false;
+    bool dedicated = false;
+    bool coherent = true;
+    void* mappedData = nullptr;
+    uint32_t allocationCount = 0;
+    // Offset to size, adjacent ranges are always merged
+    std::map<VkDeviceSize, VkDeviceSize> freeRanges;
+};
+
+std::mutex Allocator::s_mutex;
+std::vector<std::unique_ptr<Allocator::Block>> Allocator::s_blocks;
+
+namespace
+{
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+VkDeviceSize alignDown(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return value / alignment * alignment;
+}
+
+} // unnamed
+
+bool Allocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool optimalTiling, Allocation& allocation)
+{
+    uint32_t memoryType;
+    if (!findMemoryType(requirements.memoryTypeBits, properties, memoryType))
+    {
+        return false;
+    }
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(Context::getPhysicalDevice(), &memoryProperties);
+    VkMemoryPropertyFlags typeFlags = memoryProperties.memoryTypes[memoryType].propertyFlags;
+    bool coherent = (typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+    // Non-coherent allocations must not share an atom so that flushing one does not touch another
+    VkDeviceSize alignment = requirements.alignment;
+    VkDeviceSize size = requirements.size;
+    if (!coherent && (typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+    {
+        VkDeviceSize atomSize = Context::getPhysicalDeviceProperties()->limits.nonCoherentAtomSize;
+        alignment = std::max(alignment, atomSize);
+        size = alignUp(size, atomSize);
+    }
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    if (size > Constants::memoryBlockSize / 2)
+    {
+        Block* block = createBlock(size, memoryType, optimalTiling, true);
+        return block != nullptr && allocateFromBlock(block, size, alignment, allocation);
+    }
+
+    for (const std::unique_ptr<Block>& block : s_blocks)
+    {
+        if (!block->dedicated && block->memoryType == memoryType && block->optimalTiling == optimalTiling
+            && allocateFromBlock(block.get(), size, alignment, allocation))
+        {
+            return true;
+        }
+    }
+
+    Block* block = createBlock(Constants::memoryBlockSize, memoryType, optimalTiling, false);
+    if (block == nullptr)
+    {
+        // Small heaps may not fit a whole block
+        block = createBlock(size, memoryType, optimalTiling, true);
+    }
+    return block != nullptr && allocateFromBlock(block, size, alignment, allocation);
+}
+
+void Allocator::free(Allocation& allocation)
+{
+    if (allocation.block == nullptr)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    Block* block = allocation.block;
+    std::map<VkDeviceSize, VkDeviceSize>& ranges = block->freeRanges;
+    auto it = ranges.emplace(allocation.offset, allocation.size).first;
+
+    auto next = std::next(it);
+    if (next != ranges.end() && it->first + it->second == next->first)
+    {
+        it->second += next->second;
+        ranges.erase(next);
+    }
+    if (it != ranges.begin())
+    {
+        auto prev = std::prev(it);
+        if (prev->first + prev->second == it->first)
+        {
+            prev->second += it->second;
+            ranges.erase(it);
+        }
+    }
+
+    --block->allocationCount;
+    allocation = Allocation{};
+
+    if (block->allocationCount > 0)
+    {
+        return;
+    }
+
+    // Keep one empty block per memory type around so that create-destroy cycles do not hit vkAllocateMemory
+    bool hasOtherBlock = std::any_of(s_blocks.begin(), s_blocks.end(), [block](const std::unique_ptr<Block>& b) {
+        return b.get() != block && !b->dedicated && b->memoryType == block->memoryType && b->optimalTiling == block->optimalTiling;
+    });
+    if (block->dedicated || hasOtherBlock)
+    {
+        destroyBlock(block);
+    }
+}
+
+bool Allocator::flush(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+    if (allocation.block == nullptr || allocation.block->coherent)
+    {
+        return true;
+    }
+
+    VkDeviceSize atomSize = Context::getPhysicalDeviceProperties()->limits.nonCoherentAtomSize;
+    VkDeviceSize begin = alignDown(allocation.offset + offset, atomSize);
+    VkDeviceSize end = std::min(alignUp(allocation.offset + offset + size, atomSize), allocation.block->size);
+
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = begin;
+    range.size = end - begin;
+
+    if (VkResult r = vkFlushMappedMemoryRanges(Context::getLogicalDevice(), 1, &range); r != VK_SUCCESS)
+    {
+        printError("Failed to flush mapped memory", &r);
+        return false;
+    }
+    return true;
+}
+
+Allocator::Stats Allocator::getStats()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    Stats stats;
+    VkDeviceSize freeBytes = 0;
+    for (const std::unique_ptr<Block>& block : s_blocks)
+    {
+        ++stats.blockCount;
+        stats.dedicatedBlockCount += block->dedicated ? 1 : 0;
+        stats.allocationCount += block->allocationCount;
+        stats.reservedBytes += block->size;
+        for (const auto& range : block->freeRanges)
+        {
+            ++stats.freeRangeCount;
+            freeBytes += range.second;
+            stats.largestFreeRange = std::max(stats.largestFreeRange, range.second);
+        }
+    }
+    stats.usedBytes = stats.reservedBytes - freeBytes;
+    if (freeBytes > 0)
+    {
+        stats.fragmentation = 1.0f - static_cast<float>(stats.largestFreeRange) / static_cast<float>(freeBytes);
+    }
+    return stats;
+}
+
+void Allocator::printStats()
+{
+    Stats stats = getStats();
+    const VkDeviceSize kilobyte = 1024;
+    std::cout << "Memory blocks: " << stats.blockCount << " (dedicated " << stats.dedicatedBlockCount << ")\n"
+              << "Allocations: " << stats.allocationCount << "\n"
+              << "Reserved: " << stats.reservedBytes / kilobyte << " KB, used: " << stats.usedBytes / kilobyte << " KB\n"
+              << "Free ranges: " << stats.freeRangeCount << ", largest: " << stats.largestFreeRange / kilobyte << " KB\n"
+              << "Fragmentation: " << stats.fragmentation << "\n";
+}
+
+Allocator::Block* Allocator::createBlock(VkDeviceSize size, uint32_t memoryType, bool optimalTiling, bool dedicated)
+{
+    VkDevice logicalDevice = Context::getLogicalDevice();
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    auto block = std::make_unique<Block>();
+    if (VkResult r = vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &block->memory); r != VK_SUCCESS)
+    {
+        printError("Failed to allocate a memory block", &r);
+        return nullptr;
+    }
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(Context::getPhysicalDevice(), &memoryProperties);
+    VkMemoryPropertyFlags typeFlags = memoryProperties.memoryTypes[memoryType].propertyFlags;
+
+    // Host visible blocks stay mapped for their whole lifetime, a block can be mapped only once
+    if (typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        if (VkResult r = vkMapMemory(logicalDevice, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mappedData); r != VK_SUCCESS)
+        {
+            printError("Failed to map a memory block", &r);
+            vkFreeMemory(logicalDevice, block->memory, nullptr);
+            return nullptr;
+        }
+    }
+
+    block->size = size;
+    block->memoryType = memoryType;
+    block->optimalTiling = optimalTiling;
+    block->dedicated = dedicated;
+    block->coherent = (typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+    block->freeRanges.emplace(0, size);
+
+    s_blocks.push_back(std::move(block));
+    return s_blocks.back().get();
+}
+
+void Allocator::destroyBlock(Block* block)
+{
+    auto it = std::find_if(s_blocks.begin(), s_blocks.end(), [block](const std::unique_ptr<Block>& b) {
+        return b.get() == block;
+    });
+    if (it == s_blocks.end())
+    {
+        return;
+    }
+    // Freeing implicitly unmaps the memory
+    vkFreeMemory(Context::getLogicalDevice(), block->memory, nullptr);
+    s_blocks.erase(it);
+}
+
+bool Allocator::allocateFromBlock(Block* block, VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation)
+{
+    // First fit, padding in front of the aligned offset is returned to the free list
+    for (auto it = block->freeRanges.begin(); it != block->freeRanges.end(); ++it)
+    {
+        VkDeviceSize rangeOffset = it->first;
+        VkDeviceSize rangeEnd = it->first + it->second;
+        VkDeviceSize offset = alignUp(rangeOffset, alignment);
+        if (offset + size > rangeEnd)
+        {
+            continue;
+        }
+
+        block->freeRanges.erase(it);
+        if (offset > rangeOffset)
+        {
+            block->freeRanges.emplace(rangeOffset, offset - rangeOffset);
+        }
+        if (offset + size < rangeEnd)
+        {
+            block->freeRanges.emplace(offset + size, rangeEnd - offset - size);
+        }
+
+        ++block->allocationCount;
+        allocation.memory = block->memory;
+        allocation.offset = offset;
+        allocation.size = size;
+        allocation.mappedData = block->mappedData != nullptr ? static_cast<char*>(block->mappedData) + offset : nullptr;
+        allocation.block = block;
+        return true;
+    }
+    return false;
+}
+
+void Allocator::release()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    for (const std::unique_ptr<Block>& block : s_blocks)
+    {
+        if (block->allocationCount > 0)
+        {
+            printWarning("Releasing a memory block that still has allocations");
+        }
+        vkFreeMemory(Context::getLogicalDevice(), block->memory, nullptr);
+    }
+    s_blocks.clear();
+}
+
+} // namespace fw
@@ -0,0 +1,169 @@
+#include "Benchmark.h"
+#include "Common.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+
+namespace fw
+{
+namespace
+{
+// Nearest rank on sorted values
+double getPercentile(const std::vector<double>& sorted, double percentile)
+{
+    size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * static_cast<double>(sorted.size())));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+void writeStats(std::ofstream& file, std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    file << "{\"samples\":" << values.size();
+    if (!values.empty())
+    {
+        double mean = std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+        file << ",\"mean\":" << mean << ",\"min\":" << values.front() << ",\"p50\":" << getPercentile(values, 50.0)
+             << ",\"p90\":" << getPercentile(values, 90.0) << ",\"p95\":" << getPercentile(values, 95.0)
+             << ",\"p99\":" << getPercentile(values, 99.0) << ",\"max\":" << values.back();
+    }
+    file << "}";
+}
+
+} // unnamed
+
+bool Benchmark::initialize(const Settings& settings)
+{
+    m_settings = settings;
+    m_frameTimes.reserve(settings.frameCount);
+    if (!settings.cameraPathFilename.empty() && !m_cameraPath.load(settings.cameraPathFilename))
+    {
+        return false;
+    }
+    return true;
+}
+
+void Benchmark::beginFrame()
+{
+    m_frameStart = std::chrono::steady_clock::now();
+}
+
+void Benchmark::endFrame()
+{
+    bool record = m_frameIndex >= m_settings.warmupFrameCount;
+    if (record)
+    {
+        m_frameTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_frameStart).count());
+    }
+    collectScopes(record);
+    ++m_frameIndex;
+}
+
+bool Benchmark::write()
+{
+    // GPU results of the last frames become available only after the device is idle
+    collectScopes(true);
+
+    std::ofstream file(m_settings.outputFilename, std::ios::trunc);
+    if (!file)
+    {
+        printError("Failed to open file " + m_settings.outputFilename);
+        return false;
+    }
+
+    file << "{\n";
+    file << "\"name\":\"" << escapeJSON(m_settings.name) << "\",\n";
+    file << "\"frames\":" << m_frameTimes.size() << ",\n";
+    file << "\"warmupFrames\":" << m_settings.warmupFrameCount << ",\n";
+    file << "\"timestep\":" << m_settings.timestep << ",\n";
+    file << "\"cameraPath\":\"" << escapeJSON(m_settings.cameraPathFilename) << "\",\n";
+    file << "\"frameMs\":";
+    writeStats(file, m_frameTimes);
+
+    for (bool gpu : {false, true})
+    {
+        file << ",\n\"" << (gpu ? "gpuMs" : "cpuMs") << "\":{";
+        const char* separator = "";
+        for (const auto& [key, times] : m_scopeTimes)
+        {
+            if (key.second == gpu)
+            {
+                file << separator << "\n\"" << escapeJSON(key.first) << "\":";
+                writeStats(file, times);
+                separator = ",";
+            }
+        }
+        file << "}";
+    }
+
+    file << ",\n\"throughput\":{";
+    const char* separator = "";
+    for (const auto& [name, throughput] : m_throughputs)
+    {
+        // A GPU scope is preferred when a CPU scope has the same name
+        auto times = m_scopeTimes.find(std::make_pair(name, true));
+        if (times == m_scopeTimes.end() || times->second.empty())
+        {
+            times = m_scopeTimes.find(std::make_pair(name, false));
+        }
+        if (times == m_scopeTimes.end() || times->second.empty())
+        {
+            continue;
+        }
+        double meanMs = std::accumulate(times->second.begin(), times->second.end(), 0.0) / static_cast<double>(times->second.size());
+        file << separator << "\n\"" << escapeJSON(name) << "\":{\"unit\":\"" << escapeJSON(throughput.second) << "\",\"perSample\":" << throughput.first
+             << ",\"perSecond\":" << (meanMs > 0.0 ? throughput.first / (meanMs / 1000.0) : 0.0) << "}";
+        separator = ",";
+    }
+    file << "}";
+    file << "\n}\n";
+
+    if (!file)
+    {
+        printError("Failed to write file " + m_settings.outputFilename);
+        return false;
+    }
+    printLog("Wrote benchmark results to " + m_settings.outputFilename);
+    return true;
+}
+
+void Benchmark::setThroughput(const std::string& scopeName, double workPerSample, const std::string& unit)
+{
+    m_throughputs[scopeName] = std::make_pair(workPerSample, unit);
+}
+
+const Benchmark::Settings& Benchmark::getSettings() const
+{
+    return m_settings;
+}
+
+const CameraPath& Benchmark::getCameraPath() const
+{
+    return m_cameraPath;
+}
+
+void Benchmark::collectScopes(bool record)
+{
+    for (const Profiler::Result& result : Profiler::getResults())
+    {
+        std::pair<std::string, bool> key(result.name, result.gpu);
+        uint64_t& sampleCount = m_sampleCounts[key];
+        size_t newSamples = std::min<size_t>(result.sampleCount - sampleCount, result.history.size());
+        sampleCount = result.sampleCount;
+        if (!record || newSamples == 0)
+        {
+            continue;
+        }
+
+        // The history is oldest first so the new samples are at the end
+        std::vector<double>& times = m_scopeTimes[key];
+        for (size_t i = result.history.size() - newSamples; i < result.history.size(); ++i)
+        {
+            times.push_back(static_cast<double>(result.history[i]));
+        }
+    }
+}
+
+} // namespace fw
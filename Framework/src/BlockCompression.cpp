@@ -0,0 +1,258 @@
+#include "BlockCompression.h"
+
+#define STB_DXT_IMPLEMENTATION
+#ifndef WIN32
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wimplicit-fallthrough"
+#pragma GCC diagnostic ignored "-Wsign-compare"
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+#include <stb_dxt.h>
+#ifndef WIN32
+#pragma GCC diagnostic pop
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace fw
+{
+namespace
+{
+bool isBC1(VkFormat format)
+{
+    return format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+}
+
+bool isBC3(VkFormat format)
+{
+    return format == VK_FORMAT_BC3_UNORM_BLOCK || format == VK_FORMAT_BC3_SRGB_BLOCK;
+}
+
+uint32_t getChannelCount(VkFormat format)
+{
+    return isBC1(format) ? 3 : (isBC3(format) ? 4 : 2);
+}
+
+void gatherBlock(const unsigned char* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, unsigned char* block)
+{
+    for (uint32_t y = 0; y < 4; ++y)
+    {
+        uint32_t srcY = std::min(blockY * 4 + y, height - 1);
+        for (uint32_t x = 0; x < 4; ++x)
+        {
+            uint32_t srcX = std::min(blockX * 4 + x, width - 1);
+            std::memcpy(block + (y * 4 + x) * 4, rgba + (static_cast<size_t>(srcY) * width + srcX) * 4, 4);
+        }
+    }
+}
+
+void compressBlock(const unsigned char* block, VkFormat format, unsigned char* dst)
+{
+    if (format == VK_FORMAT_BC5_UNORM_BLOCK)
+    {
+        unsigned char rg[32];
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            rg[i * 2] = block[i * 4];
+            rg[i * 2 + 1] = block[i * 4 + 1];
+        }
+        stb_compress_bc5_block(dst, rg);
+    }
+    else
+    {
+        stb_compress_dxt_block(dst, block, isBC3(format) ? 1 : 0, STB_DXT_HIGHQUAL);
+    }
+}
+
+void expand565(uint16_t color, unsigned char* rgb)
+{
+    uint32_t r = (color >> 11) & 31;
+    uint32_t g = (color >> 5) & 63;
+    uint32_t b = color & 31;
+    rgb[0] = static_cast<unsigned char>((r << 3) | (r >> 2));
+    rgb[1] = static_cast<unsigned char>((g << 2) | (g >> 4));
+    rgb[2] = static_cast<unsigned char>((b << 3) | (b >> 2));
+}
+
+// Writes the 16 decoded values to every stride'th byte of dst
+void decodeBC4(const unsigned char* block, unsigned char* dst, uint32_t stride)
+{
+    uint32_t values[8];
+    values[0] = block[0];
+    values[1] = block[1];
+    if (values[0] > values[1])
+    {
+        for (uint32_t i = 1; i < 7; ++i)
+        {
+            values[i + 1] = ((7 - i) * values[0] + i * values[1] + 3) / 7;
+        }
+    }
+    else
+    {
+        for (uint32_t i = 1; i < 5; ++i)
+        {
+            values[i + 1] = ((5 - i) * values[0] + i * values[1] + 2) / 5;
+        }
+        values[6] = 0;
+        values[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        indices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+    }
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        dst[i * stride] = static_cast<unsigned char>(values[(indices >> (3 * i)) & 7]);
+    }
+}
+
+void decodeBC1(const unsigned char* block, unsigned char* rgba, bool forceFourColors)
+{
+    uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+    uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+    unsigned char colors[4][4];
+    expand565(c0, colors[0]);
+    expand565(c1, colors[1]);
+    colors[0][3] = 255;
+    colors[1][3] = 255;
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        if (c0 > c1 || forceFourColors)
+        {
+            colors[2][c] = static_cast<unsigned char>((2 * colors[0][c] + colors[1][c] + 1) / 3);
+            colors[3][c] = static_cast<unsigned char>((colors[0][c] + 2 * colors[1][c] + 1) / 3);
+        }
+        else
+        {
+            colors[2][c] = static_cast<unsigned char>((colors[0][c] + colors[1][c] + 1) / 2);
+            colors[3][c] = 0;
+        }
+    }
+    colors[2][3] = 255;
+    colors[3][3] = c0 > c1 || forceFourColors ? 255 : 0;
+
+    uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        std::memcpy(rgba + i * 4, colors[(indices >> (2 * i)) & 3], 4);
+    }
+}
+
+} // unnamed
+
+bool BlockCompression::canEncode(VkFormat format)
+{
+    return isBC1(format) || isBC3(format) || format == VK_FORMAT_BC5_UNORM_BLOCK;
+}
+
+uint32_t BlockCompression::getBlockSize(VkFormat format)
+{
+    return isBC1(format) ? 8 : 16;
+}
+
+size_t BlockCompression::getLevelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+    size_t blocksX = (width + 3) / 4;
+    size_t blocksY = (height + 3) / 4;
+    return blocksX * blocksY * getBlockSize(format);
+}
+
+void BlockCompression::compress(const unsigned char* rgba, uint32_t width, uint32_t height, VkFormat format, unsigned char* dst, ThreadPool* threadPool)
+{
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+    const uint32_t blockSize = getBlockSize(format);
+
+    auto compressRows = [&](size_t begin, size_t end, uint32_t /*threadIndex*/) {
+        unsigned char block[64];
+        for (size_t blockY = begin; blockY < end; ++blockY)
+        {
+            for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+            {
+                gatherBlock(rgba, width, height, blockX, static_cast<uint32_t>(blockY), block);
+                compressBlock(block, format, dst + (blockY * blocksX + blockX) * blockSize);
+            }
+        }
+    };
+
+    if (threadPool != nullptr && blocksY > 1)
+    {
+        // Older stb_dxt versions build their lookup tables on the first call, so that is made before going wide
+        compressRows(0, 1, 0);
+        threadPool->parallelFor(blocksY - 1, [&](size_t begin, size_t end, uint32_t threadIndex) {
+            compressRows(begin + 1, end + 1, threadIndex);
+        });
+    }
+    else
+    {
+        compressRows(0, blocksY, 0);
+    }
+}
+
+void BlockCompression::decompress(const unsigned char* blocks, uint32_t width, uint32_t height, VkFormat format, unsigned char* rgba)
+{
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+    const uint32_t blockSize = getBlockSize(format);
+
+    unsigned char decoded[64];
+    for (uint32_t blockY = 0; blockY < blocksY; ++blockY)
+    {
+        for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+        {
+            const unsigned char* block = blocks + (static_cast<size_t>(blockY) * blocksX + blockX) * blockSize;
+            if (isBC1(format))
+            {
+                decodeBC1(block, decoded, false);
+            }
+            else if (isBC3(format))
+            {
+                decodeBC1(block + 8, decoded, true);
+                decodeBC4(block, decoded + 3, 4);
+            }
+            else
+            {
+                std::memset(decoded, 0, sizeof(decoded));
+                decodeBC4(block, decoded, 4);
+                decodeBC4(block + 8, decoded + 1, 4);
+                for (uint32_t i = 0; i < 16; ++i)
+                {
+                    decoded[i * 4 + 3] = 255;
+                }
+            }
+
+            for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; ++y)
+            {
+                for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; ++x)
+                {
+                    size_t dst = (static_cast<size_t>(blockY * 4 + y) * width + blockX * 4 + x) * 4;
+                    std::memcpy(rgba + dst, decoded + (y * 4 + x) * 4, 4);
+                }
+            }
+        }
+    }
+}
+
+double BlockCompression::getPsnr(const unsigned char* reference, const unsigned char* rgba, uint32_t width, uint32_t height, VkFormat format)
+{
+    const uint32_t channels = getChannelCount(format);
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+    double squaredError = 0.0;
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            double difference = static_cast<double>(reference[i * 4 + c]) - static_cast<double>(rgba[i * 4 + c]);
+            squaredError += difference * difference;
+        }
+    }
+    double meanSquaredError = squaredError / static_cast<double>(pixelCount * channels);
+    return meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : 99.0;
+}
+
+} // namespace fw
@@ -1,5 +1,9 @@
 #include "Buffer.h"
 #include "Command.h"
+#include "Trace.h"
+#include "UploadBatch.h"
+
+#include <array>
 
 namespace fw
 {
@@ -26,9 +30,9 @@ Buffer::~Buffer()
     {
         printWarning("Trying to destroy a null buffer");
     }
-    if (m_memory != VK_NULL_HANDLE)
+    if (m_allocation.memory != VK_NULL_HANDLE)
     {
-        vkFreeMemory(m_logicalDevice, m_memory, nullptr);
+        Allocator::free(m_allocation);
     }
     else
     {
@@ -36,8 +40,9 @@ Buffer::~Buffer()
     }
 }
 
-bool Buffer::create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+bool Buffer::create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool sharedWithCompute)
 {
+    TRACE_SCOPE("Buffer::create");
     m_logicalDevice = Context::getLogicalDevice();
 
     VkBufferCreateInfo bufferInfo{};
@@ -46,6 +51,18 @@ bool Buffer::create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropert
     bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+    std::array<uint32_t, 2> queueFamilies{};
+    if (sharedWithCompute)
+    {
+        queueFamilies = {Context::getGraphicsQueueFamily(), Context::getComputeQueueFamily()};
+        if (queueFamilies[0] != queueFamilies[1])
+        {
+            bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            bufferInfo.queueFamilyIndexCount = fw::ui32size(queueFamilies);
+            bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+        }
+    }
+
     if (VkResult r = vkCreateBuffer(m_logicalDevice, &bufferInfo, nullptr, &m_buffer); r != VK_SUCCESS)
     {
         printError("Failed to create buffer", &r);
@@ -55,21 +72,13 @@ bool Buffer::create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropert
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(m_logicalDevice, m_buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    if (!findMemoryType(memRequirements.memoryTypeBits, properties, allocInfo.memoryTypeIndex))
+    if (!Allocator::allocate(memRequirements, properties, false, m_allocation))
     {
+        printError("Failed to allocate buffer memory");
         return false;
     }
 
-    if (VkResult r = vkAllocateMemory(m_logicalDevice, &allocInfo, nullptr, &m_memory); r != VK_SUCCESS)
-    {
-        printError("Failed to allocate buffer memory", &r);
-        return false;
-    }
-
-    vkBindBufferMemory(m_logicalDevice, m_buffer, m_memory, 0);
+    vkBindBufferMemory(m_logicalDevice, m_buffer, m_allocation.memory, m_allocation.offset);
     return true;
 }
 
@@ -95,6 +104,54 @@ void Buffer::copyToImage(VkImage image, uint32_t width, uint32_t height) const
     Command::endSingleTimeCommands(commandBuffer);
 }
 
+bool Buffer::createForDevice(const void* content, VkDeviceSize size, VkBufferUsageFlags usage, UploadBatch* batch)
+{
+    TRACE_SCOPE("Buffer::createForDevice");
+    if (!create(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+    {
+        return false;
+    }
+
+    if (batch != nullptr)
+    {
+        return batch->upload(*this, content, size);
+    }
+
+    UploadBatch singleBatch;
+    return singleBatch.upload(*this, content, size) && singleBatch.flush();
+}
+
+bool Buffer::createVertexBuffer(const Mesh& mesh, Mesh::VertexFormat format)
+{
+    return createVertexBuffer(mesh, format, nullptr);
+}
+
+bool Buffer::createVertexBuffer(const Mesh& mesh, Mesh::VertexFormat format, UploadBatch& batch)
+{
+    return createVertexBuffer(mesh, format, &batch);
+}
+
+bool Buffer::createVertexBuffer(const Mesh& mesh, Mesh::VertexFormat format, UploadBatch* batch)
+{
+    TRACE_SCOPE("Buffer::createVertexBuffer");
+    VkDeviceSize size = mesh.getVertexDataSize(format);
+    if (!create(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+    {
+        return false;
+    }
+
+    UploadBatch singleBatch;
+    UploadBatch& uploadBatch = batch != nullptr ? *batch : singleBatch;
+    void* stagingData = uploadBatch.allocate(*this, size);
+    if (stagingData == nullptr)
+    {
+        return false;
+    }
+    mesh.writeVertices(stagingData, format);
+
+    return batch != nullptr || singleBatch.flush();
+}
+
 VkBuffer Buffer::getBuffer() const
 {
     return m_buffer;
@@ -102,7 +159,22 @@ VkBuffer Buffer::getBuffer() const
 
 VkDeviceMemory Buffer::getMemory() const
 {
-    return m_memory;
+    return m_allocation.memory;
+}
+
+VkDeviceSize Buffer::getMemoryOffset() const
+{
+    return m_allocation.offset;
+}
+
+void* Buffer::getMappedMemory() const
+{
+    return m_allocation.mappedData;
+}
+
+bool Buffer::flush(VkDeviceSize offset, VkDeviceSize size) const
+{
+    return Allocator::flush(m_allocation, offset, size);
 }
 
 } // namespace fw
@@ -35,6 +35,12 @@ void CameraController::update()
         return;
     }
 
+    if (const CameraPath* path = API::getCameraPath(); path != nullptr)
+    {
+        followPath(*path);
+        return;
+    }
+
     float speed = m_movementSpeed * API::getTimeDelta();
     const Transformation& t = m_camera->getTransformation();
 
@@ -82,4 +88,21 @@ void CameraController::update()
     }
 }
 
+void CameraController::followPath(const CameraPath& path)
+{
+    const Transformation& t = m_camera->getTransformation();
+    if (!m_pathStarted)
+    {
+        m_pathOriginPosition = t.getPosition();
+        m_pathOriginRotation = t.getRotation();
+        m_pathStarted = true;
+    }
+
+    glm::vec3 position;
+    glm::vec3 rotation;
+    path.sample(API::getTimeSinceStart(), position, rotation);
+    m_camera->setPosition(m_pathOriginPosition + position);
+    m_camera->setRotation(m_pathOriginRotation + rotation);
+}
+
 } // fw
@@ -0,0 +1,101 @@
+#include "CameraPath.h"
+#include "Common.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace fw
+{
+bool CameraPath::load(const std::string& filename)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        printError("Failed to open file " + filename);
+        return false;
+    }
+
+    m_keyframes.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+        {
+            continue;
+        }
+
+        Keyframe keyframe;
+        glm::vec3 degrees;
+        std::istringstream values(line);
+        if (!(values >> keyframe.time >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z >> degrees.x >> degrees.y >> degrees.z))
+        {
+            printError("Invalid camera keyframe on line " + std::to_string(lineNumber) + " in " + filename);
+            return false;
+        }
+        if (!m_keyframes.empty() && keyframe.time <= m_keyframes.back().time)
+        {
+            printError("Camera keyframes are not in time order on line " + std::to_string(lineNumber) + " in " + filename);
+            return false;
+        }
+        keyframe.rotation = glm::radians(degrees);
+        m_keyframes.push_back(keyframe);
+    }
+
+    if (m_keyframes.empty())
+    {
+        printWarning("No camera keyframes in " + filename);
+    }
+    return true;
+}
+
+void CameraPath::addKeyframe(const Keyframe& keyframe)
+{
+    m_keyframes.push_back(keyframe);
+}
+
+bool CameraPath::isEmpty() const
+{
+    return m_keyframes.empty();
+}
+
+float CameraPath::getDuration() const
+{
+    return m_keyframes.empty() ? 0.0f : m_keyframes.back().time;
+}
+
+void CameraPath::sample(float time, glm::vec3& position, glm::vec3& rotation) const
+{
+    if (m_keyframes.empty())
+    {
+        position = glm::vec3(0.0f);
+        rotation = glm::vec3(0.0f);
+        return;
+    }
+
+    float duration = getDuration();
+    float t = duration > 0.0f ? std::fmod(time, duration) : 0.0f;
+
+    auto next = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), t, [](float value, const Keyframe& keyframe) {
+        return value < keyframe.time;
+    });
+    if (next == m_keyframes.begin() || next == m_keyframes.end())
+    {
+        const Keyframe& keyframe = next == m_keyframes.begin() ? m_keyframes.front() : m_keyframes.back();
+        position = keyframe.position;
+        rotation = keyframe.rotation;
+        return;
+    }
+
+    const Keyframe& a = *(next - 1);
+    const Keyframe& b = *next;
+    float alpha = (t - a.time) / (b.time - a.time);
+    position = glm::mix(a.position, b.position, alpha);
+    rotation = glm::mix(a.rotation, b.rotation, alpha);
+}
+
+} // namespace fw
@@ -3,6 +3,8 @@
 #include "Common.h"
 #include "Context.h"
 
+#include <limits>
+
 namespace fw
 {
 bool Command::createGraphicsCommandPool(VkCommandPool* commandPool)
@@ -39,6 +41,23 @@ bool Command::createComputeCommandPool(VkCommandPool* commandPool)
     return true;
 }
 
+bool Command::createTransferCommandPool(VkCommandPool* commandPool)
+{
+    QueueFamilyIndices indices = getQueueFamilies(Context::getPhysicalDevice(), Context::getSurface());
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = indices.transferFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    if (VkResult r = vkCreateCommandPool(Context::getLogicalDevice(), &poolInfo, nullptr, commandPool); r != VK_SUCCESS)
+    {
+        printError("Failed to create transfer command pool", &r);
+        return false;
+    }
+    return true;
+}
+
 VkCommandBuffer Command::beginSingleTimeCommands()
 {
     VkCommandBufferAllocateInfo allocInfo{};
@@ -61,18 +80,43 @@ VkCommandBuffer Command::beginSingleTimeCommands()
 
 void Command::endSingleTimeCommands(VkCommandBuffer commandBuffer)
 {
-    vkEndCommandBuffer(commandBuffer);
+    VkDevice logicalDevice = Context::getLogicalDevice();
+    VkFence fence = VK_NULL_HANDLE;
+    Cleaner cleaner([logicalDevice, &fence, &commandBuffer]() {
+        vkDestroyFence(logicalDevice, fence, nullptr);
+        vkFreeCommandBuffers(logicalDevice, API::getCommandPool(), 1, &commandBuffer);
+    });
+
+    if (VkResult r = vkEndCommandBuffer(commandBuffer); r != VK_SUCCESS)
+    {
+        printError("Failed to end single time command buffer", &r);
+        return;
+    }
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    VkQueue graphicsQueue = Context::getGraphicsQueue();
-    vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue);
+    // Wait only for this submission instead of idling the whole queue which may have frames in flight
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (VkResult r = vkCreateFence(logicalDevice, &fenceInfo, nullptr, &fence); r != VK_SUCCESS)
+    {
+        printError("Failed to create single time command fence", &r);
+        return;
+    }
 
-    vkFreeCommandBuffers(Context::getLogicalDevice(), API::getCommandPool(), 1, &commandBuffer);
+    if (VkResult r = vkQueueSubmit(Context::getGraphicsQueue(), 1, &submitInfo, fence); r != VK_SUCCESS)
+    {
+        printError("Failed to submit single time command buffer", &r);
+        return;
+    }
+
+    if (VkResult r = vkWaitForFences(logicalDevice, 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max()); r != VK_SUCCESS)
+    {
+        printError("Failed to wait for single time command buffer", &r);
+    }
 }
 
 } // namespace fw
@@ -1,6 +1,10 @@
 #include "Common.h"
+#include "Constants.h"
 #include "Context.h"
+#include "MappedFile.h"
 
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
 #include <ios>
 #include <iostream>
@@ -52,7 +56,15 @@ QueueFamilyIndices getQueueFamilies(VkPhysicalDevice physicalDevice, VkSurfaceKH
         }
 
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+        if (surface != VK_NULL_HANDLE)
+        {
+            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+        }
+        else
+        {
+            // Headless, nothing is presented so the graphics queue stands in for the present queue
+            presentSupport = indices.graphicsFamily == static_cast<int>(i);
+        }
         if (queueFamilies[i].queueCount > 0 && presentSupport)
         {
             indices.presentFamily = i;
@@ -64,38 +76,30 @@ QueueFamilyIndices getQueueFamilies(VkPhysicalDevice physicalDevice, VkSurfaceKH
         }
     }
 
-    return indices;
-}
-
-VkShaderModule createShaderModule(const std::string& filename)
-{
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-    if (!file.is_open())
+    indices.transferFamily = indices.graphicsFamily;
+    for (unsigned int i = 0; Constants::useDedicatedTransferQueue && i < queueFamilies.size(); ++i)
     {
-        printError("Failed to open file " + filename);
-        return VK_NULL_HANDLE;
+        // A family without graphics and compute is typically a DMA engine that copies alongside rendering
+        VkQueueFlags flags = queueFamilies[i].queueFlags;
+        if (queueFamilies[i].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+        {
+            indices.transferFamily = i;
+            break;
+        }
     }
 
-    size_t fileSize = static_cast<size_t>(file.tellg());
-    std::vector<char> buffer(fileSize);
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
-
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = buffer.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(buffer.data());
-
-    VkShaderModule shaderModule;
-    if (VkResult r = vkCreateShaderModule(Context::getLogicalDevice(), &createInfo, nullptr, &shaderModule);
-        r != VK_SUCCESS)
+    for (unsigned int i = 0; Constants::useDedicatedComputeQueue && i < queueFamilies.size(); ++i)
     {
-        printError("Failed to create shader module", &r);
-        return VK_NULL_HANDLE;
+        // Dispatches on a family without graphics can run in parallel with the graphics queue
+        VkQueueFlags flags = queueFamilies[i].queueFlags;
+        if (queueFamilies[i].queueCount > 0 && (flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            indices.computeFamily = i;
+            break;
+        }
     }
 
-    return shaderModule;
+    return indices;
 }
 
 bool findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t& typeIndex)
@@ -139,4 +143,91 @@ void alignedFree(void* data)
 #endif
 }
 
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string escapeJSON(const std::string& s)
+{
+    std::string escaped;
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            escaped += ' ';
+        }
+        else
+        {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+bool hashFile(const std::string& filename, uint64_t& hash)
+{
+    MappedFile file;
+    if (!file.open(filename))
+    {
+        return false;
+    }
+    hash = hashBytes(file.getData(), file.getSize());
+    return true;
+}
+
+bool writeFileAtomically(const std::string& filename, std::string_view description, const std::function<void(std::ostream&)>& write)
+{
+    const std::string tempFilename = filename + ".tmp";
+    {
+        std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            printWarning("Unable to write " + std::string(description) + ": " + filename);
+            return false;
+        }
+
+        write(file);
+
+        if (!file.good())
+        {
+            printWarning("Failed to write " + std::string(description) + ": " + filename);
+            file.close();
+            std::remove(tempFilename.c_str());
+            return false;
+        }
+    }
+
+    std::remove(filename.c_str());
+    if (std::rename(tempFilename.c_str(), filename.c_str()) != 0)
+    {
+        printWarning("Failed to move " + std::string(description) + " in place: " + filename);
+        std::remove(tempFilename.c_str());
+        return false;
+    }
+    return true;
+}
+
+uint32_t getMipLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t levels = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+    {
+        ++levels;
+    }
+    return levels;
+}
+
 } // namespace fw
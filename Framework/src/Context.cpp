@@ -9,7 +9,11 @@ VkDevice Context::s_logicalDevice = VK_NULL_HANDLE;
 VkQueue Context::s_graphicsQueue = VK_NULL_HANDLE;
 VkQueue Context::s_computeQueue = VK_NULL_HANDLE;
 VkQueue Context::s_presentQueue = VK_NULL_HANDLE;
+VkQueue Context::s_transferQueue = VK_NULL_HANDLE;
+uint32_t Context::s_graphicsQueueFamily = 0;
+uint32_t Context::s_computeQueueFamily = 0;
 VkPhysicalDeviceProperties* Context::s_physicalDeviceProperties = nullptr;
+VkPipelineCache Context::s_pipelineCache = VK_NULL_HANDLE;
 
 VkInstance Context::getInstance()
 {
@@ -46,9 +50,29 @@ VkQueue Context::getPresentQueue()
     return s_presentQueue;
 }
 
+VkQueue Context::getTransferQueue()
+{
+    return s_transferQueue;
+}
+
+uint32_t Context::getGraphicsQueueFamily()
+{
+    return s_graphicsQueueFamily;
+}
+
+uint32_t Context::getComputeQueueFamily()
+{
+    return s_computeQueueFamily;
+}
+
 VkPhysicalDeviceProperties* Context::getPhysicalDeviceProperties()
 {
     return s_physicalDeviceProperties;
 }
 
+VkPipelineCache Context::getPipelineCache()
+{
+    return s_pipelineCache;
+}
+
 } // namespace fw
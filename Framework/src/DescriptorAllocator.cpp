@@ -0,0 +1,238 @@
+#include "DescriptorAllocator.h"
+#include "API.h"
+#include "Common.h"
+#include "Context.h"
+#include "DescriptorLayoutCache.h"
+
+#include <algorithm>
+
+namespace fw
+{
+namespace
+{
+const uint32_t c_initialSetsPerPool = 32;
+const uint32_t c_maxSetsPerPool = 4096;
+
+// Descriptors of each type per set, a pool that runs out of any of them is replaced by a larger one
+const std::array<std::pair<VkDescriptorType, float>, 11> c_poolSizeRatios = {{
+    {VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f},
+    {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f},
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f},
+    {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1.0f},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 0.5f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 0.5f},
+}};
+
+uint32_t getPoolSetCount(size_t poolIndex)
+{
+    return std::min(c_initialSetsPerPool << std::min<size_t>(poolIndex, 7), c_maxSetsPerPool);
+}
+
+// Every pool has room for at least one set of the layout it is created for, however many descriptors it needs
+std::vector<VkDescriptorPoolSize> getPoolSizes(uint32_t setCount, const std::vector<VkDescriptorPoolSize>& descriptorCounts)
+{
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (const auto& ratio : c_poolSizeRatios)
+    {
+        uint32_t descriptorCount = std::max(static_cast<uint32_t>(ratio.second * static_cast<float>(setCount)), 1u);
+        poolSizes.push_back({ratio.first, descriptorCount});
+    }
+    for (const VkDescriptorPoolSize& count : descriptorCounts)
+    {
+        auto poolSize = std::find_if(poolSizes.begin(), poolSizes.end(), [&count](const VkDescriptorPoolSize& size) {
+            return size.type == count.type;
+        });
+        if (poolSize == poolSizes.end())
+        {
+            poolSizes.push_back(count);
+        }
+        else
+        {
+            poolSize->descriptorCount = std::max(poolSize->descriptorCount, count.descriptorCount);
+        }
+    }
+    return poolSizes;
+}
+
+} // unnamed
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+    destroy(m_persistentPools);
+    for (PoolList& list : m_framePools)
+    {
+        destroy(list);
+    }
+}
+
+bool DescriptorAllocator::allocate(VkDescriptorSetLayout layout, VkDescriptorSet& set)
+{
+    return allocate(m_persistentPools, layout, set);
+}
+
+bool DescriptorAllocator::allocate(const std::vector<VkDescriptorSetLayout>& layouts, std::vector<VkDescriptorSet>& sets)
+{
+    sets.resize(layouts.size());
+    for (size_t i = 0; i < layouts.size(); ++i)
+    {
+        if (!allocate(m_persistentPools, layouts[i], sets[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DescriptorAllocator::allocateTransient(VkDescriptorSetLayout layout, VkDescriptorSet& set)
+{
+    // The frame fence has been waited so the GPU is done with the sets allocated for this frame index
+    PoolList& list = m_framePools[API::getCurrentFrameIndex()];
+    if (m_frameNumber != API::getFrameNumber())
+    {
+        m_frameNumber = API::getFrameNumber();
+        reset(list);
+    }
+    return allocate(list, layout, set);
+}
+
+void DescriptorAllocator::reset()
+{
+    reset(m_persistentPools);
+}
+
+uint32_t DescriptorAllocator::getPoolCount() const
+{
+    size_t count = m_persistentPools.pools.size();
+    for (const PoolList& list : m_framePools)
+    {
+        count += list.pools.size();
+    }
+    return static_cast<uint32_t>(count);
+}
+
+bool DescriptorAllocator::allocate(PoolList& list, VkDescriptorSetLayout layout, VkDescriptorSet& set)
+{
+    std::vector<VkDescriptorPoolSize> descriptorCounts;
+    if (!DescriptorLayoutCache::getDescriptorCounts(layout, descriptorCounts))
+    {
+        printError("Descriptor set layout is not from the DescriptorLayoutCache");
+        return false;
+    }
+
+    // Full pools are skipped until the next reset, every new pool is twice the size of the previous one
+    while (!fits(list, descriptorCounts))
+    {
+        if (list.current < list.pools.size())
+        {
+            selectPool(list, list.current + 1);
+            continue;
+        }
+
+        Pool pool;
+        pool.setCount = getPoolSetCount(list.current);
+        pool.sizes = getPoolSizes(pool.setCount, descriptorCounts);
+        pool.pool = createPool(pool.setCount, pool.sizes);
+        if (pool.pool == VK_NULL_HANDLE)
+        {
+            return false;
+        }
+        list.pools.push_back(std::move(pool));
+        selectPool(list, list.current);
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = list.pools[list.current].pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    if (VkResult r = vkAllocateDescriptorSets(Context::getLogicalDevice(), &allocInfo, &set); r != VK_SUCCESS)
+    {
+        printError("Failed to allocate a descriptor set", &r);
+        return false;
+    }
+
+    --list.remainingSets;
+    for (const VkDescriptorPoolSize& count : descriptorCounts)
+    {
+        for (VkDescriptorPoolSize& remaining : list.remainingDescriptors)
+        {
+            if (remaining.type == count.type)
+            {
+                remaining.descriptorCount -= count.descriptorCount;
+            }
+        }
+    }
+    return true;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t setCount, const std::vector<VkDescriptorPoolSize>& poolSizes)
+{
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = ui32size(poolSizes);
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = setCount;
+
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    if (VkResult r = vkCreateDescriptorPool(Context::getLogicalDevice(), &poolInfo, nullptr, &pool); r != VK_SUCCESS)
+    {
+        printError("Failed to create a descriptor pool", &r);
+        return VK_NULL_HANDLE;
+    }
+    return pool;
+}
+
+void DescriptorAllocator::selectPool(PoolList& list, size_t index)
+{
+    // Pools past the end are created when needed, nothing fits until then
+    list.current = index;
+    bool exists = index < list.pools.size();
+    list.remainingSets = exists ? list.pools[index].setCount : 0;
+    list.remainingDescriptors = exists ? list.pools[index].sizes : std::vector<VkDescriptorPoolSize>();
+}
+
+bool DescriptorAllocator::fits(const PoolList& list, const std::vector<VkDescriptorPoolSize>& descriptorCounts) const
+{
+    if (list.remainingSets == 0)
+    {
+        return false;
+    }
+    for (const VkDescriptorPoolSize& count : descriptorCounts)
+    {
+        auto remaining = std::find_if(list.remainingDescriptors.begin(), list.remainingDescriptors.end(), [&count](const VkDescriptorPoolSize& r) {
+            return r.type == count.type;
+        });
+        if (remaining == list.remainingDescriptors.end() || remaining->descriptorCount < count.descriptorCount)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void DescriptorAllocator::reset(PoolList& list)
+{
+    for (const Pool& pool : list.pools)
+    {
+        vkResetDescriptorPool(Context::getLogicalDevice(), pool.pool, 0);
+    }
+    selectPool(list, 0);
+}
+
+void DescriptorAllocator::destroy(PoolList& list)
+{
+    for (const Pool& pool : list.pools)
+    {
+        vkDestroyDescriptorPool(Context::getLogicalDevice(), pool.pool, nullptr);
+    }
+    list.pools.clear();
+    selectPool(list, 0);
+}
+
+} // namespace fw
@@ -0,0 +1,117 @@
+#include "DescriptorLayoutCache.h"
+#include "Common.h"
+#include "Context.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace fw
+{
+std::mutex DescriptorLayoutCache::s_mutex;
+std::unordered_multimap<uint64_t, DescriptorLayoutCache::Entry> DescriptorLayoutCache::s_entries;
+
+namespace
+{
+bool isEqual(const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+{
+    return a.binding == b.binding && a.descriptorType == b.descriptorType && a.descriptorCount == b.descriptorCount
+        && a.stageFlags == b.stageFlags && a.pImmutableSamplers == b.pImmutableSamplers;
+}
+
+// Hashes the members one by one, the struct has padding that is not guaranteed to be zero
+uint64_t hashBindings(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+    size_t count = bindings.size();
+    uint64_t hash = hashBytes(&count, sizeof(count));
+    for (const VkDescriptorSetLayoutBinding& binding : bindings)
+    {
+        uint32_t values[4] = {binding.binding, static_cast<uint32_t>(binding.descriptorType), binding.descriptorCount, binding.stageFlags};
+        hash = hashBytes(values, sizeof(values), hash);
+        hash = hashBytes(&binding.pImmutableSamplers, sizeof(binding.pImmutableSamplers), hash);
+    }
+    return hash;
+}
+
+} // unnamed
+
+VkDescriptorSetLayout DescriptorLayoutCache::get(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+    std::vector<VkDescriptorSetLayoutBinding> sorted = bindings;
+    std::sort(sorted.begin(), sorted.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+        return a.binding < b.binding;
+    });
+    uint64_t hash = hashBindings(sorted);
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    auto range = s_entries.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        const std::vector<VkDescriptorSetLayoutBinding>& cached = it->second.bindings;
+        if (std::equal(cached.begin(), cached.end(), sorted.begin(), sorted.end(), isEqual))
+        {
+            return it->second.layout;
+        }
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = ui32size(sorted);
+    layoutInfo.pBindings = sorted.data();
+
+    Entry entry;
+    if (VkResult r = vkCreateDescriptorSetLayout(Context::getLogicalDevice(), &layoutInfo, nullptr, &entry.layout); r != VK_SUCCESS)
+    {
+        printError("Failed to create a descriptor set layout", &r);
+        return VK_NULL_HANDLE;
+    }
+    entry.bindings = std::move(sorted);
+    return s_entries.emplace(hash, std::move(entry))->second.layout;
+}
+
+bool DescriptorLayoutCache::getDescriptorCounts(VkDescriptorSetLayout layout, std::vector<VkDescriptorPoolSize>& counts)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    auto it = std::find_if(s_entries.begin(), s_entries.end(), [layout](const auto& kv) { return kv.second.layout == layout; });
+    if (it == s_entries.end())
+    {
+        return false;
+    }
+
+    counts.clear();
+    for (const VkDescriptorSetLayoutBinding& binding : it->second.bindings)
+    {
+        auto count = std::find_if(counts.begin(), counts.end(), [&binding](const VkDescriptorPoolSize& c) {
+            return c.type == binding.descriptorType;
+        });
+        if (count == counts.end())
+        {
+            counts.push_back({binding.descriptorType, binding.descriptorCount});
+        }
+        else
+        {
+            count->descriptorCount += binding.descriptorCount;
+        }
+    }
+    return true;
+}
+
+uint32_t DescriptorLayoutCache::getLayoutCount()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return ui32size(s_entries);
+}
+
+void DescriptorLayoutCache::release()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    for (const auto& kv : s_entries)
+    {
+        vkDestroyDescriptorSetLayout(Context::getLogicalDevice(), kv.second.layout, nullptr);
+    }
+    s_entries.clear();
+}
+
+} // namespace fw
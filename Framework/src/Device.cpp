@@ -1,7 +1,10 @@
 #include "Device.h"
+#include "Allocator.h"
 #include "Common.h"
 #include "Constants.h"
 #include "Context.h"
+#include "DescriptorLayoutCache.h"
+#include "ShaderModuleCache.h"
 #include "SwapChain.h"
 
 #include <iostream>
@@ -11,14 +14,14 @@ namespace fw
 {
 namespace
 {
-bool hasDeviceExtensionSupport(VkPhysicalDevice physicalDevice)
+bool hasDeviceExtensionSupport(VkPhysicalDevice physicalDevice, const std::vector<const char*>& extensions)
 {
     uint32_t extensionCount;
     vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensions(Constants::deviceExtensions.begin(), Constants::deviceExtensions.end());
+    std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
     for (const auto& extension : availableExtensions)
     {
@@ -28,16 +31,38 @@ bool hasDeviceExtensionSupport(VkPhysicalDevice physicalDevice)
     return requiredExtensions.empty();
 }
 
+std::vector<const char*> getDeviceExtensions(VkPhysicalDevice physicalDevice)
+{
+    if (Context::getSurface() != VK_NULL_HANDLE)
+    {
+        return Constants::deviceExtensions;
+    }
+
+    // Headless does not need a swap chain but render passes may still use the present layout
+    std::vector<const char*> extensions;
+    for (const char* extension : Constants::deviceExtensions)
+    {
+        if (hasDeviceExtensionSupport(physicalDevice, {extension}))
+        {
+            extensions.push_back(extension);
+        }
+    }
+    return extensions;
+}
+
 bool isDeviceSuitable(VkPhysicalDevice physicalDevice)
 {
     VkSurfaceKHR surface = Context::getSurface();
     QueueFamilyIndices indices = getQueueFamilies(physicalDevice, surface);
 
-    if (hasDeviceExtensionSupport(physicalDevice))
+    if (hasDeviceExtensionSupport(physicalDevice, getDeviceExtensions(physicalDevice)))
     {
-        SwapChain::Capabilities swapChainCapabilities = SwapChain::getCapabilities(physicalDevice, surface);
-        bool isSwapChainAdequate
-            = !swapChainCapabilities.formats.empty() && !swapChainCapabilities.presentModes.empty();
+        bool isSwapChainAdequate = true;
+        if (surface != VK_NULL_HANDLE)
+        {
+            SwapChain::Capabilities swapChainCapabilities = SwapChain::getCapabilities(physicalDevice, surface);
+            isSwapChainAdequate = !swapChainCapabilities.formats.empty() && !swapChainCapabilities.presentModes.empty();
+        }
         VkPhysicalDeviceFeatures supportedFeatures;
         vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
         return indices.hasGraphicsAndPresentFamily() && isSwapChainAdequate && supportedFeatures.samplerAnisotropy;
@@ -50,6 +75,9 @@ bool isDeviceSuitable(VkPhysicalDevice physicalDevice)
 
 Device::~Device()
 {
+    ShaderModuleCache::releaseAll();
+    DescriptorLayoutCache::release();
+    Allocator::release();
     vkDestroyDevice(logicalDevice, nullptr);
 }
 
@@ -97,7 +125,8 @@ bool Device::createLogicalDevice()
     std::set<int> uniqueQueueFamilies = {
         indices.graphicsFamily,
         indices.computeFamily,
-        indices.presentFamily};
+        indices.presentFamily,
+        indices.transferFamily};
 
     float queuePriority = 1.0f;
     for (int queueFamily : uniqueQueueFamilies)
@@ -110,17 +139,23 @@ bool Device::createLogicalDevice()
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
     deviceFeatures.fragmentStoresAndAtomics = VK_TRUE;
+    // Optional, compressed textures fall back to uncompressed ones without it
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.queueCreateInfoCount = fw::ui32size(queueCreateInfos);
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = fw::ui32size(Constants::deviceExtensions);
-    createInfo.ppEnabledExtensionNames = Constants::deviceExtensions.data();
+    std::vector<const char*> extensions = getDeviceExtensions(physicalDevice);
+    createInfo.enabledExtensionCount = fw::ui32size(extensions);
+    createInfo.ppEnabledExtensionNames = extensions.data();
     if (Constants::enableValidationLayers)
     {
         createInfo.enabledLayerCount = fw::ui32size(Constants::validationLayers);
@@ -140,12 +175,16 @@ bool Device::createLogicalDevice()
     vkGetDeviceQueue(logicalDevice, indices.graphicsFamily, 0, &graphicsQueue);
     vkGetDeviceQueue(logicalDevice, indices.computeFamily, 0, &computeQueue);
     vkGetDeviceQueue(logicalDevice, indices.presentFamily, 0, &presentQueue);
+    vkGetDeviceQueue(logicalDevice, indices.transferFamily, 0, &transferQueue);
 
     Context::s_physicalDevice = physicalDevice;
     Context::s_logicalDevice = logicalDevice;
     Context::s_graphicsQueue = graphicsQueue;
     Context::s_computeQueue = computeQueue;
     Context::s_presentQueue = presentQueue;
+    Context::s_transferQueue = transferQueue;
+    Context::s_graphicsQueueFamily = static_cast<uint32_t>(indices.graphicsFamily);
+    Context::s_computeQueueFamily = static_cast<uint32_t>(indices.computeFamily);
     Context::s_physicalDeviceProperties = &physicalDeviceProperties;
 
     return true;
@@ -3,11 +3,22 @@
 #include "Command.h"
 #include "Common.h"
 #include "Context.h"
+#include "Profiler.h"
+#include "Trace.h"
 
+#include <algorithm>
 #include <iostream>
 
 namespace fw
 {
+namespace
+{
+// Two releases can be pending with async compute while the rendering of the frame signals a third one
+const uint32_t c_renderReleaseCount = 3;
+// The stages of the rendering that can read what compute wrote
+const VkPipelineStageFlags c_computeResultStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+} // unnamed
+
 Framework::Framework()
 {
     API::s_framework = this;
@@ -15,16 +26,59 @@ Framework::Framework()
 
 Framework::~Framework()
 {
-    vkDestroySemaphore(m_logicalDevice, m_renderFinished, nullptr);
-    vkDestroySemaphore(m_logicalDevice, m_imageAvailable, nullptr);
+    Profiler::release();
+    Trace::write(Constants::traceFilename);
+    for (VkSemaphore semaphore : m_pendingRenderReleases)
+    {
+        vkDestroySemaphore(m_logicalDevice, semaphore, nullptr);
+    }
+    for (VkSemaphore semaphore : m_freeRenderReleases)
+    {
+        vkDestroySemaphore(m_logicalDevice, semaphore, nullptr);
+    }
+    for (Frame& frame : m_frames)
+    {
+        vkDestroyFence(m_logicalDevice, frame.inFlight, nullptr);
+        vkDestroySemaphore(m_logicalDevice, frame.computeFinished, nullptr);
+        vkDestroySemaphore(m_logicalDevice, frame.renderFinished, nullptr);
+        vkDestroySemaphore(m_logicalDevice, frame.imageAvailable, nullptr);
+    }
     vkDestroyCommandPool(m_logicalDevice, m_commandPool, nullptr);
     vkDestroyCommandPool(m_logicalDevice, m_computeCommandPool, nullptr);
 }
 
+void Framework::setHeadless(uint32_t frameCount)
+{
+    m_headless = true;
+    m_headlessFrameCount = frameCount;
+}
+
+bool Framework::setBenchmark(const Benchmark::Settings& settings)
+{
+    if (!m_benchmark.initialize(settings))
+    {
+        return false;
+    }
+    m_benchmarkEnabled = true;
+    setHeadless(settings.warmupFrameCount + settings.frameCount);
+    m_time.setDeterministicDelta(settings.timestep);
+    m_time.setFrameRateLimit(0.0);
+    return true;
+}
+
 bool Framework::initialize()
 {
-    glfwInit();
-    bool success = m_instance.initialize() && m_window.initialize() && m_device.initialize() && m_swapChain.create(m_window.getWidth(), m_window.getHeight()) && Command::createGraphicsCommandPool(&m_commandPool) && Command::createComputeCommandPool(&m_computeCommandPool) && createSemaphores() && m_input.initialize(m_window.getWindow());
+    bool success = false;
+    if (m_headless)
+    {
+        // No window or surface, the swap chain images are plain offscreen images
+        success = m_instance.initialize(true) && m_device.initialize() && m_pipelineCache.initialize() && m_swapChain.createOffscreen(m_window.getWidth(), m_window.getHeight()) && Command::createGraphicsCommandPool(&m_commandPool) && Command::createComputeCommandPool(&m_computeCommandPool) && Profiler::initialize();
+    }
+    else
+    {
+        glfwInit();
+        success = m_instance.initialize(false) && m_window.initialize() && m_device.initialize() && m_pipelineCache.initialize() && m_swapChain.create(m_window.getWidth(), m_window.getHeight()) && Command::createGraphicsCommandPool(&m_commandPool) && Command::createComputeCommandPool(&m_computeCommandPool) && Profiler::initialize() && m_input.initialize(m_window.getWindow());
+    }
 
     m_logicalDevice = Context::getLogicalDevice();
     m_graphicsQueue = Context::getGraphicsQueue();
@@ -42,40 +96,111 @@ void Framework::setApplication(Application* application)
 
 void Framework::execute()
 {
-    while (!m_window.shouldClose() && !API::isKeyReleased(GLFW_KEY_ESCAPE) && !m_quit)
+    if (m_renderingEnabled && !createFrames())
     {
-        m_input.clearKeyStatus();
-        m_window.pollEvents();
-        m_input.update();
+        return;
+    }
+
+    TRACE_THREAD_NAME("Main");
+
+    while (!shouldQuit())
+    {
+        TRACE_SCOPE("Frame");
+        if (m_benchmarkEnabled)
+        {
+            m_benchmark.beginFrame();
+        }
+        if (!m_headless)
+        {
+            m_input.clearKeyStatus();
+            {
+                TRACE_SCOPE("Window::pollEvents");
+                m_window.pollEvents();
+            }
+            {
+                TRACE_SCOPE("Input::update");
+                m_input.update();
+            }
+        }
         m_time.update();
-        if (m_renderingEnabled && !acquireNextSwapChainImage())
         {
-            break;
+            TRACE_SCOPE("Framework::acquireNextSwapChainImage");
+            Profiler::CpuScope scope("Acquire");
+            if (m_renderingEnabled && !acquireNextSwapChainImage())
+            {
+                break;
+            }
+        }
+        Profiler::collect();
+        {
+            TRACE_SCOPE("Application::update");
+            Profiler::CpuScope scope("Update");
+            m_app->update();
         }
-        m_app->update();
         if (m_gui.isInitialized())
         {
+            TRACE_SCOPE("Application::onGUI");
             m_gui.beginPass();
             m_app->onGUI();
+            if (Constants::showProfiler)
+            {
+                m_gui.drawProfiler();
+            }
+        }
+        {
+            TRACE_SCOPE("Framework::compute");
+            Profiler::CpuScope scope("Compute");
+            compute();
+        }
+        {
+            TRACE_SCOPE("Framework::render");
+            Profiler::CpuScope scope("Render");
+            if (m_renderingEnabled && !render())
+            {
+                break;
+            }
+        }
+        {
+            TRACE_SCOPE("Application::postUpdate");
+            m_app->postUpdate();
         }
-        compute();
-        if (m_renderingEnabled && !render())
+        m_currentFrameIndex = (m_currentFrameIndex + 1) % m_framesInFlight;
+        ++m_frameNumber;
+        if (m_benchmarkEnabled)
         {
-            break;
+            m_benchmark.endFrame();
+        }
+        {
+            TRACE_SCOPE("Time::waitForNextFrame");
+            m_time.waitForNextFrame();
         }
-        m_app->postUpdate();
     }
     vkDeviceWaitIdle(m_logicalDevice);
+
+    if (m_benchmarkEnabled)
+    {
+        Profiler::collect();
+        m_benchmark.write();
+    }
 }
 
-bool Framework::createSemaphores()
+bool Framework::createFrames()
 {
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    auto createSemaphore = [semaphoreInfo](VkSemaphore& semaphore) {
-        if (VkResult r = vkCreateSemaphore(Context::getLogicalDevice(), &semaphoreInfo, nullptr, &semaphore);
-            r != VK_SUCCESS)
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    auto createSemaphore = [this, semaphoreInfo](VkSemaphore& semaphore) {
+        if (VkResult r = vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &semaphore); r != VK_SUCCESS)
         {
             printError("Failed to create a semaphore", &r);
             return false;
@@ -83,29 +208,115 @@ bool Framework::createSemaphores()
         return true;
     };
 
-    return createSemaphore(m_imageAvailable) && createSemaphore(m_renderFinished);
+    m_frames.resize(m_framesInFlight);
+    for (Frame& frame : m_frames)
+    {
+        if (!createSemaphore(frame.imageAvailable) || !createSemaphore(frame.renderFinished) || !createSemaphore(frame.computeFinished))
+        {
+            return false;
+        }
+        if (VkResult r = vkCreateFence(m_logicalDevice, &fenceInfo, nullptr, &frame.inFlight); r != VK_SUCCESS)
+        {
+            printError("Failed to create a frame fence", &r);
+            return false;
+        }
+        if (VkResult r = vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, &frame.commandBuffer); r != VK_SUCCESS)
+        {
+            printError("Failed to allocate a frame command buffer", &r);
+            return false;
+        }
+    }
+
+    m_freeRenderReleases.resize(c_renderReleaseCount);
+    for (VkSemaphore& semaphore : m_freeRenderReleases)
+    {
+        if (!createSemaphore(semaphore))
+        {
+            return false;
+        }
+    }
+
+    m_imagesInFlight.assign(m_swapChain.getImageCount(), VK_NULL_HANDLE);
+    m_currentFrameIndex = 0;
+    return true;
+}
+
+void Framework::setFramesInFlight(uint32_t count)
+{
+    if (!m_frames.empty())
+    {
+        printWarning("Frames in flight can be changed only before the main loop starts");
+        return;
+    }
+    m_framesInFlight = std::clamp(count, 1u, Constants::maxFramesInFlight);
+}
+
+bool Framework::shouldQuit()
+{
+    if (m_headless)
+    {
+        return m_quit || m_frameNumber >= m_headlessFrameCount;
+    }
+    return m_quit || m_window.shouldClose() || API::isKeyReleased(GLFW_KEY_ESCAPE);
 }
 
 void Framework::compute()
 {
-    if (m_nextComputeCommandBuffer != nullptr)
+    bool previousFrameComputed = m_computeSubmitted;
+    m_computeSubmitted = false;
+    if (m_nextComputeCommandBuffer == nullptr)
+    {
+        return;
+    }
+
+    // Compute can overwrite what the rendering of earlier frames reads once that rendering has finished. With async
+    // compute the rendering of the previous frame reads the other copy of double buffered resources so it may still run.
+    std::vector<VkSemaphore> waitSemaphores;
+    size_t overlappedFrameCount = m_asyncCompute ? 1 : 0;
+    while (m_pendingRenderReleases.size() > overlappedFrameCount)
     {
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &m_nextComputeCommandBuffer;
+        waitSemaphores.push_back(m_pendingRenderReleases.front());
+        m_freeRenderReleases.push_back(m_pendingRenderReleases.front());
+        m_pendingRenderReleases.pop_front();
+    }
+    std::vector<VkPipelineStageFlags> waitStages(waitSemaphores.size(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT);
 
-        if (VkResult r = vkQueueSubmit(m_computeQueue, 1, &submitInfo, m_commandBufferFence); r != VK_SUCCESS)
+    if (m_renderingEnabled && !previousFrameComputed && m_frameNumber > 0)
+    {
+        // Nothing was signaled by the frames rendered without compute
+        std::vector<VkFence> fences;
+        for (const Frame& frame : m_frames)
         {
-            printError("Failed to submit queue in compute", &r);
-            return;
+            fences.push_back(frame.inFlight);
         }
+        vkWaitForFences(m_logicalDevice, ui32size(fences), fences.data(), VK_TRUE, std::numeric_limits<uint64_t>::max());
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = ui32size(waitSemaphores);
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_nextComputeCommandBuffer;
+    if (m_renderingEnabled)
+    {
+        // The rendering of this frame waits for the results
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &m_frames[m_currentFrameIndex].computeFinished;
     }
+
+    if (VkResult r = vkQueueSubmit(m_computeQueue, 1, &submitInfo, m_commandBufferFence); r != VK_SUCCESS)
+    {
+        printError("Failed to submit queue in compute", &r);
+        return;
+    }
+    m_computeSubmitted = true;
 }
 
 bool Framework::render()
 {
-    vkQueueWaitIdle(m_presentQueue); // Optional sync for validation layers
+    Frame& frame = m_frames[m_currentFrameIndex];
 
     VkCommandBuffer commandBuffer;
     if (m_nextCommandBuffer != nullptr)
@@ -125,41 +336,70 @@ bool Framework::render()
     std::vector<VkCommandBuffer> renderCommandBuffers{commandBuffer};
     if (m_gui.isInitialized())
     {
+        TRACE_SCOPE("GUI::render");
         m_gui.render(API::getSwapChainFramebuffers().at(m_currentImageIndex));
         renderCommandBuffers.push_back(m_gui.getCommandBuffer());
     }
 
-    VkSemaphore waitSemaphores[] = {m_imageAvailable};
-    VkSemaphore signalSemaphores[] = {m_renderFinished};
-
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
+    std::vector<VkSemaphore> signalSemaphores;
+    if (!m_headless)
+    {
+        waitSemaphores.push_back(frame.imageAvailable);
+        waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        signalSemaphores.push_back(frame.renderFinished);
+    }
+    if (m_computeSubmitted)
+    {
+        waitSemaphores.push_back(frame.computeFinished);
+        waitStages.push_back(c_computeResultStages);
+        // The compute of a later frame waits until this frame no longer reads its results
+        if (!m_freeRenderReleases.empty())
+        {
+            signalSemaphores.push_back(m_freeRenderReleases.back());
+            m_pendingRenderReleases.push_back(m_freeRenderReleases.back());
+            m_freeRenderReleases.pop_back();
+        }
+    }
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+    submitInfo.waitSemaphoreCount = ui32size(waitSemaphores);
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
     submitInfo.commandBufferCount = ui32size(renderCommandBuffers);
     submitInfo.pCommandBuffers = renderCommandBuffers.data();
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+    submitInfo.signalSemaphoreCount = ui32size(signalSemaphores);
+    submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+    vkResetFences(m_logicalDevice, 1, &frame.inFlight);
 
-    if (VkResult r = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_renderBufferFence); r != VK_SUCCESS)
     {
-        printError("Failed to submit a draw command buffer", &r);
-        return false;
+        TRACE_SCOPE("vkQueueSubmit");
+        if (VkResult r = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, frame.inFlight); r != VK_SUCCESS)
+        {
+            printError("Failed to submit a draw command buffer", &r);
+            return false;
+        }
+    }
+
+    if (m_headless)
+    {
+        return true;
     }
 
     VkPresentInfoKHR presentInfo{};
     VkSwapchainKHR swapChains[] = {m_swapChainHandle};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
+    presentInfo.pWaitSemaphores = &frame.renderFinished;
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = swapChains;
     presentInfo.pImageIndices = &m_currentImageIndex;
     presentInfo.pResults = nullptr; // Optional
 
+    TRACE_SCOPE("vkQueuePresentKHR");
     if (VkResult r = vkQueuePresentKHR(m_presentQueue, &presentInfo); r != VK_SUCCESS)
     {
         printError("Failed to present swap chain image", &r);
@@ -173,12 +413,32 @@ bool Framework::acquireNextSwapChainImage()
 {
     static uint64_t timeout = std::numeric_limits<uint64_t>::max();
 
-    if (VkResult r = vkAcquireNextImageKHR(m_logicalDevice, m_swapChainHandle, timeout, m_imageAvailable, VK_NULL_HANDLE, &m_currentImageIndex);
-        r != VK_SUCCESS)
+    // Wait until the GPU is done with the frame that used these resources N frames ago
+    Frame& frame = m_frames[m_currentFrameIndex];
+    {
+        TRACE_SCOPE("vkWaitForFences");
+        vkWaitForFences(m_logicalDevice, 1, &frame.inFlight, VK_TRUE, timeout);
+    }
+
+    if (m_headless)
+    {
+        m_currentImageIndex = (m_currentImageIndex + 1) % m_swapChain.getImageCount();
+    }
+    else if (VkResult r = vkAcquireNextImageKHR(m_logicalDevice, m_swapChainHandle, timeout, frame.imageAvailable, VK_NULL_HANDLE, &m_currentImageIndex);
+             r != VK_SUCCESS)
     {
         printError("Failed to acquire swap chain image");
         return false;
     }
+
+    // The swap chain may hand out images out of order so the image can still be used by another frame
+    VkFence& imageFence = m_imagesInFlight[m_currentImageIndex];
+    if (imageFence != VK_NULL_HANDLE && imageFence != frame.inFlight)
+    {
+        vkWaitForFences(m_logicalDevice, 1, &imageFence, VK_TRUE, timeout);
+    }
+    imageFence = frame.inFlight;
+
     return true;
 }
 
@@ -2,15 +2,21 @@
 #include "API.h"
 #include "Command.h"
 #include "Common.h"
+#include "Constants.h"
 #include "Context.h"
+#include "Profiler.h"
 #include "RenderPass.h"
 
 #include <array>
+#include <cfloat>
+#include <string>
 
 namespace fw
 {
 namespace
 {
+static_assert(IMGUI_VK_QUEUED_FRAMES >= Constants::maxFramesInFlight, "ImGui would overwrite buffers that are still in flight");
+
 static void imguiVkResult(VkResult r)
 {
     if (r != VK_SUCCESS)
@@ -38,7 +44,7 @@ bool GUI::initialize(VkDescriptorPool descriptorPool)
     m_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     m_info.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    bool success = createCommandBuffer() && createRenderPass();
+    bool success = createCommandBuffers() && createRenderPass();
 
     ImGui::CreateContext();
 
@@ -47,7 +53,7 @@ bool GUI::initialize(VkDescriptorPool descriptorPool)
     initData.gpu = Context::getPhysicalDevice();
     initData.device = m_logicalDevice;
     initData.render_pass = m_renderPass;
-    initData.pipeline_cache = VK_NULL_HANDLE;
+    initData.pipeline_cache = Context::getPipelineCache();
     initData.descriptor_pool = descriptorPool;
     initData.check_vk_result = imguiVkResult;
     bool installCallbacks = false;
@@ -68,9 +74,63 @@ void GUI::beginPass() const
     ImGui_ImplGlfwVulkan_NewFrame();
 }
 
+void GUI::drawProfiler() const
+{
+    std::vector<Profiler::Result> results = Profiler::getResults();
+
+    ImGui::SetNextWindowPos(ImVec2(10.0f, 120.0f), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin("Profiler"))
+    {
+        ImGui::Columns(5, "ProfilerColumns");
+        ImGui::Text("Scope");
+        ImGui::NextColumn();
+        ImGui::Text("Last ms");
+        ImGui::NextColumn();
+        ImGui::Text("Avg ms");
+        ImGui::NextColumn();
+        ImGui::Text("Min ms");
+        ImGui::NextColumn();
+        ImGui::Text("Max ms");
+        ImGui::NextColumn();
+        ImGui::Separator();
+        for (const Profiler::Result& result : results)
+        {
+            ImGui::Text("%s %s", result.gpu ? "GPU" : "CPU", result.name.c_str());
+            ImGui::NextColumn();
+            ImGui::Text("%.3f", result.lastMs);
+            ImGui::NextColumn();
+            ImGui::Text("%.3f", result.averageMs);
+            ImGui::NextColumn();
+            ImGui::Text("%.3f", result.minMs);
+            ImGui::NextColumn();
+            ImGui::Text("%.3f", result.maxMs);
+            ImGui::NextColumn();
+        }
+        ImGui::Columns(1);
+
+        for (const Profiler::Result& result : results)
+        {
+            std::string label = (result.gpu ? "GPU " : "CPU ") + result.name;
+            ImGui::PlotLines(label.c_str(), result.history.data(), static_cast<int>(result.history.size()), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+        }
+
+        if (ImGui::Button("Export CSV"))
+        {
+            Profiler::exportCSV("profile.csv");
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Export trace"))
+        {
+            Profiler::exportChromeTrace("profile.json");
+        }
+    }
+    ImGui::End();
+}
+
 bool GUI::render(VkFramebuffer framebuffer) const
 {
-    vkBeginCommandBuffer(m_commandBuffer, &m_info);
+    VkCommandBuffer commandBuffer = getCommandBuffer();
+    vkBeginCommandBuffer(commandBuffer, &m_info);
 
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -79,12 +139,12 @@ bool GUI::render(VkFramebuffer framebuffer) const
     renderPassInfo.renderArea.extent = API::getSwapChainExtent();
     renderPassInfo.clearValueCount = 0;
     renderPassInfo.pClearValues = nullptr;
-    vkCmdBeginRenderPass(m_commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-    ImGui_ImplGlfwVulkan_Render(m_commandBuffer);
+    ImGui_ImplGlfwVulkan_Render(commandBuffer);
 
-    vkCmdEndRenderPass(m_commandBuffer);
-    if (VkResult r = vkEndCommandBuffer(m_commandBuffer); r != VK_SUCCESS)
+    vkCmdEndRenderPass(commandBuffer);
+    if (VkResult r = vkEndCommandBuffer(commandBuffer); r != VK_SUCCESS)
     {
         fw::printError("Failed to record GUI command buffer", &r);
         return false;
@@ -94,7 +154,7 @@ bool GUI::render(VkFramebuffer framebuffer) const
 
 VkCommandBuffer GUI::getCommandBuffer() const
 {
-    return m_commandBuffer;
+    return m_commandBuffers[API::getCurrentFrameIndex()];
 }
 
 bool GUI::isInitialized() const
@@ -102,15 +162,18 @@ bool GUI::isInitialized() const
     return m_initialized;
 }
 
-bool GUI::createCommandBuffer()
+bool GUI::createCommandBuffers()
 {
+    // One per frame in flight since the buffer is re-recorded every frame
+    m_commandBuffers.resize(Constants::maxFramesInFlight);
+
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.commandPool = fw::API::getCommandPool();
     allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = 1;
+    allocInfo.commandBufferCount = fw::ui32size(m_commandBuffers);
 
-    if (VkResult r = vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, &m_commandBuffer); r != VK_SUCCESS)
+    if (VkResult r = vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, m_commandBuffers.data()); r != VK_SUCCESS)
     {
         fw::printError("Failed to allocate GUI command buffer", &r);
         return false;
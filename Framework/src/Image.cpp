@@ -2,6 +2,7 @@
 #include "Command.h"
 #include "Common.h"
 #include "Context.h"
+#include "Trace.h"
 
 namespace fw
 {
@@ -12,14 +13,12 @@ Image::~Image()
         vkDestroyImage(m_logicalDevice, m_image, nullptr);
     }
 
-    if (m_memory != VK_NULL_HANDLE)
-    {
-        vkFreeMemory(m_logicalDevice, m_memory, nullptr);
-    }
+    Allocator::free(m_allocation);
 }
 
 bool Image::create(const VkImageCreateInfo& imageInfo)
 {
+    TRACE_SCOPE("Image::create");
     m_logicalDevice = Context::getLogicalDevice();
     return allocate(imageInfo);
 }
@@ -70,6 +69,11 @@ bool Image::create(uint32_t width,
 }
 
 bool Image::createView(VkFormat format, VkImageAspectFlags aspectFlags, VkImageView* imageView)
+{
+    return createView(format, aspectFlags, 0, m_mipLevels, imageView);
+}
+
+bool Image::createView(VkFormat format, VkImageAspectFlags aspectFlags, uint32_t baseMipLevel, uint32_t levelCount, VkImageView* imageView)
 {
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -77,8 +81,8 @@ bool Image::createView(VkFormat format, VkImageAspectFlags aspectFlags, VkImageV
     viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
     viewInfo.format = format;
     viewInfo.subresourceRange.aspectMask = aspectFlags;
-    viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseMipLevel = baseMipLevel;
+    viewInfo.subresourceRange.levelCount = levelCount;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
 
@@ -91,6 +95,14 @@ bool Image::createView(VkFormat format, VkImageAspectFlags aspectFlags, VkImageV
 }
 
 bool Image::transitLayout(VkImageLayout newLayout)
+{
+    VkCommandBuffer commandBuffer = Command::beginSingleTimeCommands();
+    bool success = transitLayout(commandBuffer, newLayout);
+    Command::endSingleTimeCommands(commandBuffer);
+    return success;
+}
+
+bool Image::transitLayout(VkCommandBuffer commandBuffer, VkImageLayout newLayout)
 {
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -108,7 +120,7 @@ bool Image::transitLayout(VkImageLayout newLayout)
         barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     }
     barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.levelCount = m_mipLevels;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
 
@@ -150,12 +162,8 @@ bool Image::transitLayout(VkImageLayout newLayout)
         return false;
     }
 
-    VkCommandBuffer commandBuffer = Command::beginSingleTimeCommands();
-
     vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
-    Command::endSingleTimeCommands(commandBuffer);
-
     m_layout = newLayout;
 
     return true;
@@ -166,8 +174,15 @@ VkImage Image::getHandle() const
     return m_image;
 }
 
+uint32_t Image::getMipLevels() const
+{
+    return m_mipLevels;
+}
+
 bool Image::allocate(const VkImageCreateInfo& imageInfo)
 {
+    m_mipLevels = imageInfo.mipLevels;
+
     if (VkResult r = vkCreateImage(m_logicalDevice, &imageInfo, nullptr, &m_image); r != VK_SUCCESS)
     {
         printError("Failed to create image", &r);
@@ -177,20 +192,14 @@ bool Image::allocate(const VkImageCreateInfo& imageInfo)
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(m_logicalDevice, m_image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    if (!findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, allocInfo.memoryTypeIndex))
+    bool optimalTiling = imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL;
+    if (!Allocator::allocate(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, optimalTiling, m_allocation))
     {
+        printError("Failed to allocate image memory");
         return false;
     }
 
-    if (VkResult r = vkAllocateMemory(m_logicalDevice, &allocInfo, nullptr, &m_memory); r != VK_SUCCESS)
-    {
-        printError("Failed to allocate image memory", &r);
-    }
-
-    vkBindImageMemory(m_logicalDevice, m_image, m_memory, 0);
+    vkBindImageMemory(m_logicalDevice, m_image, m_allocation.memory, m_allocation.offset);
     return true;
 }
 
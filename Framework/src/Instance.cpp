@@ -39,16 +39,19 @@ bool isValidationLayerAvailable()
     return true;
 }
 
-std::vector<const char*> getRequiredExtensions()
+std::vector<const char*> getRequiredExtensions(bool headless)
 {
     std::vector<const char*> extensions;
-    unsigned int glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-    for (unsigned int i = 0; i < glfwExtensionCount; ++i)
+    if (!headless)
     {
-        extensions.push_back(glfwExtensions[i]);
+        unsigned int glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+        for (unsigned int i = 0; i < glfwExtensionCount; ++i)
+        {
+            extensions.push_back(glfwExtensions[i]);
+        }
     }
 
     if (Constants::enableValidationLayers)
@@ -85,12 +88,12 @@ Instance::~Instance()
     vkDestroyInstance(m_instance, nullptr);
 }
 
-bool Instance::initialize()
+bool Instance::initialize(bool headless)
 {
-    return createInstance() && createDebugReportCallback();
+    return createInstance(headless) && createDebugReportCallback();
 }
 
-bool Instance::createInstance()
+bool Instance::createInstance(bool headless)
 {
     if (Constants::enableValidationLayers && !isValidationLayerAvailable())
     {
@@ -109,7 +112,7 @@ bool Instance::createInstance()
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
-    std::vector<const char*> extensions = getRequiredExtensions();
+    std::vector<const char*> extensions = getRequiredExtensions(headless);
     createInfo.enabledExtensionCount = fw::ui32size(extensions);
     createInfo.ppEnabledExtensionNames = extensions.data();
     if (Constants::enableValidationLayers)
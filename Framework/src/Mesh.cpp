@@ -1,35 +1,120 @@
 #include "Mesh.h"
 #include "Common.h"
 
+#include <glm/gtc/packing.hpp>
+
+#include <cmath>
+#include <cstddef>
 #include <stdexcept>
-#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MYVK_MESH_SSE2
+#endif
 
 namespace fw
 {
-Mesh::Vertices Mesh::getVertices() const
+namespace
 {
-    Vertices vertices;
-    vertices.reserve(positions.size());
-    for (unsigned int i = 0; i < positions.size(); ++i)
+uint32_t packOctahedral(const glm::vec3& v)
+{
+    float length = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+    if (length == 0.0f)
+    {
+        return glm::packSnorm2x16(glm::vec2(0.0f));
+    }
+    glm::vec2 e = glm::vec2(v.x, v.y) / length;
+    if (v.z < 0.0f)
     {
-        Vertex v;
-        v.position = positions[i];
-        v.normal = normals[i];
+        glm::vec2 signs(e.x >= 0.0f ? 1.0f : -1.0f, e.y >= 0.0f ? 1.0f : -1.0f);
+        e = (1.0f - glm::abs(glm::vec2(e.y, e.x))) * signs;
+    }
+    return glm::packSnorm2x16(e);
+}
 
-        if (!tangents.empty())
-        {
-            v.tangent = tangents[i];
-        }
+void writeFullVertices(const Mesh& mesh, Mesh::Vertex* dst)
+{
+    const size_t count = mesh.positions.size();
+    const bool hasTangents = !mesh.tangents.empty();
+    const bool hasUvs = !mesh.uvs.empty();
+    size_t i = 0;
 
-        if (!uvs.empty())
-        {
-            v.uv = uvs[i];
-        }
-        vertices.push_back(std::move(v));
+#ifdef MYVK_MESH_SSE2
+    // 16 byte loads and stores cover a vec3 and the first float of the next one, the stores go in ascending
+    // order so that the spill of one attribute is overwritten by the next. The last vertex would read past
+    // the end of the streams and is written by the scalar loop.
+    char* out = reinterpret_cast<char*>(dst);
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 1 < count; ++i, out += sizeof(Mesh::Vertex))
+    {
+        _mm_storeu_ps(reinterpret_cast<float*>(out + offsetof(Mesh::Vertex, position)), _mm_loadu_ps(&mesh.positions[i].x));
+        _mm_storeu_ps(reinterpret_cast<float*>(out + offsetof(Mesh::Vertex, normal)), _mm_loadu_ps(&mesh.normals[i].x));
+        __m128 tangent = hasTangents ? _mm_loadu_ps(&mesh.tangents[i].x) : zero;
+        _mm_storeu_ps(reinterpret_cast<float*>(out + offsetof(Mesh::Vertex, tangent)), tangent);
+        __m128i uv = hasUvs ? _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&mesh.uvs[i].x)) : _mm_setzero_si128();
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + offsetof(Mesh::Vertex, uv)), uv);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        Mesh::Vertex& v = dst[i];
+        v.position = mesh.positions[i];
+        v.normal = mesh.normals[i];
+        v.tangent = hasTangents ? mesh.tangents[i] : glm::vec3(0.0f);
+        v.uv = hasUvs ? mesh.uvs[i] : glm::vec2(0.0f);
+    }
+}
+
+void writePackedVertices(const Mesh& mesh, Mesh::PackedVertex* dst)
+{
+    const size_t count = mesh.positions.size();
+    const bool hasTangents = !mesh.tangents.empty();
+    const bool hasUvs = !mesh.uvs.empty();
+    const uint32_t zeroSnorm = glm::packSnorm2x16(glm::vec2(0.0f));
+    const uint32_t zeroHalf = glm::packHalf2x16(glm::vec2(0.0f));
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        Mesh::PackedVertex& v = dst[i];
+        v.position = mesh.positions[i];
+        v.normal = packOctahedral(mesh.normals[i]);
+        v.tangent = hasTangents ? packOctahedral(mesh.tangents[i]) : zeroSnorm;
+        v.uv = hasUvs ? glm::packHalf2x16(mesh.uvs[i]) : zeroHalf;
     }
+}
+
+} // unnamed
+
+size_t Mesh::getVertexSize(VertexFormat format)
+{
+    return format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+Mesh::Vertices Mesh::getVertices() const
+{
+    Vertices vertices(positions.size());
+    writeVertices(vertices.data());
     return vertices;
 }
 
+size_t Mesh::getVertexDataSize(VertexFormat format) const
+{
+    return positions.size() * getVertexSize(format);
+}
+
+void Mesh::writeVertices(void* dst, VertexFormat format) const
+{
+    if (format == VertexFormat::Packed)
+    {
+        writePackedVertices(*this, static_cast<PackedVertex*>(dst));
+    }
+    else
+    {
+        writeFullVertices(*this, static_cast<Vertex*>(dst));
+    }
+}
+
 std::string Mesh::getFirstTextureOfType(aiTextureType type) const
 {
     std::string ret = "";
@@ -0,0 +1,238 @@
+#include "MeshCache.h"
+#include "Common.h"
+#include "MappedFile.h"
+
+#include <cstring>
+#include <ostream>
+#include <utility>
+
+namespace fw
+{
+namespace
+{
+const char c_magic[8] = {'M', 'Y', 'V', 'K', 'M', 'E', 'S', 'H'};
+// Increment when the layout changes so that old caches are rebuilt
+const uint32_t c_version = 2;
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t importFlags;
+    uint32_t optimized;
+    uint64_t sourceHash;
+    uint32_t meshCount;
+    uint32_t textureCount;
+};
+
+struct MeshHeader
+{
+    uint32_t vertexCount;
+    uint32_t tangentCount;
+    uint32_t uvCount;
+    uint32_t indexCount;
+    uint32_t materialTypeCount;
+};
+
+// Bounds checked reads straight out of the mapped file
+class Reader
+{
+public:
+    Reader(const unsigned char* data, size_t size) :
+        m_data(data),
+        m_remaining(size) {}
+
+    bool read(void* dst, size_t size)
+    {
+        if (size > m_remaining)
+        {
+            return false;
+        }
+        if (size > 0)
+        {
+            std::memcpy(dst, m_data, size);
+        }
+        m_data += size;
+        m_remaining -= size;
+        return true;
+    }
+
+    template<typename T>
+    bool read(T& value)
+    {
+        return read(&value, sizeof(T));
+    }
+
+    template<typename T>
+    bool read(std::vector<T>& values, size_t count)
+    {
+        if (count > m_remaining / sizeof(T))
+        {
+            return false;
+        }
+        values.resize(count);
+        return read(values.data(), count * sizeof(T));
+    }
+
+private:
+    const unsigned char* m_data;
+    size_t m_remaining;
+};
+
+template<typename T>
+void write(std::ostream& file, const T& value)
+{
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+void write(std::ostream& file, const std::vector<T>& values)
+{
+    file.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+bool readMesh(Reader& reader, Mesh& mesh)
+{
+    MeshHeader header;
+    if (!reader.read(header))
+    {
+        return false;
+    }
+
+    bool success = reader.read(mesh.positions, header.vertexCount)
+        && reader.read(mesh.normals, header.vertexCount)
+        && reader.read(mesh.tangents, header.tangentCount)
+        && reader.read(mesh.uvs, header.uvCount)
+        && reader.read(mesh.indices, header.indexCount);
+
+    for (uint32_t i = 0; success && i < header.materialTypeCount; ++i)
+    {
+        uint32_t type = 0;
+        uint32_t pathCount = 0;
+        success = reader.read(type) && reader.read(pathCount);
+
+        std::vector<std::string>& paths = mesh.materials[static_cast<aiTextureType>(type)];
+        for (uint32_t j = 0; success && j < pathCount; ++j)
+        {
+            std::vector<char> path;
+            uint32_t length = 0;
+            success = reader.read(length) && reader.read(path, length);
+            paths.emplace_back(path.begin(), path.end());
+        }
+    }
+    return success;
+}
+
+void writeMesh(std::ostream& file, const Mesh& mesh)
+{
+    MeshHeader header;
+    header.vertexCount = ui32size(mesh.positions);
+    header.tangentCount = ui32size(mesh.tangents);
+    header.uvCount = ui32size(mesh.uvs);
+    header.indexCount = ui32size(mesh.indices);
+    header.materialTypeCount = ui32size(mesh.materials);
+    write(file, header);
+
+    write(file, mesh.positions);
+    write(file, mesh.normals);
+    write(file, mesh.tangents);
+    write(file, mesh.uvs);
+    write(file, mesh.indices);
+
+    for (const auto& material : mesh.materials)
+    {
+        write(file, static_cast<uint32_t>(material.first));
+        write(file, ui32size(material.second));
+        for (const std::string& path : material.second)
+        {
+            write(file, ui32size(path));
+            file.write(path.data(), static_cast<std::streamsize>(path.size()));
+        }
+    }
+}
+
+} // unnamed
+
+std::string MeshCache::getCacheFilename(const std::string& file)
+{
+    return file + ".myvkmesh";
+}
+
+bool MeshCache::load(const std::string& file, unsigned int importFlags, bool optimized, Model::Meshes& meshes, Model::TextureDatas& textureDatas)
+{
+    MappedFile cache;
+    if (!cache.open(getCacheFilename(file)))
+    {
+        return false;
+    }
+
+    Reader reader(cache.getData(), cache.getSize());
+    FileHeader header{};
+    if (!reader.read(header) || std::memcmp(header.magic, c_magic, sizeof(c_magic)) != 0 || header.version != c_version
+        || header.importFlags != importFlags || header.optimized != (optimized ? 1u : 0u))
+    {
+        return false;
+    }
+
+    uint64_t sourceHash = 0;
+    if (!hashFile(file, sourceHash) || sourceHash != header.sourceHash)
+    {
+        return false;
+    }
+
+    Model::Meshes cachedMeshes(header.meshCount);
+    bool success = true;
+    for (Mesh& mesh : cachedMeshes)
+    {
+        success = success && readMesh(reader, mesh);
+    }
+
+    Model::TextureDatas cachedTextureDatas;
+    for (uint32_t i = 0; success && i < header.textureCount; ++i)
+    {
+        uint32_t index = 0;
+        uint64_t size = 0;
+        success = reader.read(index) && reader.read(size) && reader.read(cachedTextureDatas[index], static_cast<size_t>(size));
+    }
+
+    if (!success)
+    {
+        printWarning("Ignoring a corrupted mesh cache: " + getCacheFilename(file));
+        return false;
+    }
+
+    meshes = std::move(cachedMeshes);
+    textureDatas = std::move(cachedTextureDatas);
+    return true;
+}
+
+bool MeshCache::save(const std::string& file, unsigned int importFlags, bool optimized, const Model::Meshes& meshes, const Model::TextureDatas& textureDatas)
+{
+    FileHeader header{};
+    std::memcpy(header.magic, c_magic, sizeof(c_magic));
+    header.version = c_version;
+    header.importFlags = importFlags;
+    header.optimized = optimized ? 1 : 0;
+    header.meshCount = ui32size(meshes);
+    header.textureCount = ui32size(textureDatas);
+    if (!hashFile(file, header.sourceHash))
+    {
+        return false;
+    }
+
+    return writeFileAtomically(getCacheFilename(file), "mesh cache", [&](std::ostream& cache) {
+        write(cache, header);
+        for (const Mesh& mesh : meshes)
+        {
+            writeMesh(cache, mesh);
+        }
+        for (const auto& textureData : textureDatas)
+        {
+            write(cache, static_cast<uint32_t>(textureData.first));
+            write(cache, static_cast<uint64_t>(textureData.second.size()));
+            write(cache, textureData.second);
+        }
+    });
+}
+
+} // namespace fw
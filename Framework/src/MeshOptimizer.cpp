@@ -0,0 +1,294 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace fw
+{
+namespace
+{
+const uint32_t c_unused = std::numeric_limits<uint32_t>::max();
+
+template<typename T>
+void reorder(std::vector<T>& values, const std::vector<uint32_t>& remap)
+{
+    if (values.empty())
+    {
+        return;
+    }
+    std::vector<T> reordered(values.size());
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        reordered[remap[i]] = values[i];
+    }
+    values.swap(reordered);
+}
+
+} // unnamed
+
+double MeshOptimizer::VertexCacheStats::getAcmr() const
+{
+    return triangleCount > 0 ? static_cast<double>(transformCount) / static_cast<double>(triangleCount) : 0.0;
+}
+
+double MeshOptimizer::VertexCacheStats::getAtvr() const
+{
+    return vertexCount > 0 ? static_cast<double>(transformCount) / static_cast<double>(vertexCount) : 0.0;
+}
+
+MeshOptimizer::VertexCacheStats& MeshOptimizer::VertexCacheStats::operator+=(const VertexCacheStats& other)
+{
+    transformCount += other.transformCount;
+    triangleCount += other.triangleCount;
+    vertexCount += other.vertexCount;
+    return *this;
+}
+
+void MeshOptimizer::optimize(Mesh& mesh, uint32_t cacheSize)
+{
+    std::vector<uint32_t> optimized;
+    std::vector<size_t> clusters;
+    if (!optimizeVertexCache(mesh.indices, mesh.positions.size(), cacheSize, optimized, clusters))
+    {
+        return;
+    }
+    optimizeOverdraw(mesh.positions, optimized, clusters);
+    mesh.indices.swap(optimized);
+    optimizeVertexFetch(mesh);
+}
+
+bool MeshOptimizer::optimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>& optimized, std::vector<size_t>& clusters)
+{
+    if (indices.size() % 3 != 0)
+    {
+        return false;
+    }
+    const size_t triangleCount = indices.size() / 3;
+
+    // Triangles of each vertex packed into one array, liveCounts is the number of triangles not yet emitted
+    std::vector<uint32_t> liveCounts(vertexCount, 0);
+    for (uint32_t index : indices)
+    {
+        ++liveCounts[index];
+    }
+    std::vector<size_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        offsets[v + 1] = offsets[v] + liveCounts[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        for (size_t k = 0; k < 3; ++k)
+        {
+            adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<size_t> timeStamps(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    size_t time = cacheSize + 1;
+    size_t cursor = 0;
+
+    // Restarts from the most recently used vertex that still has triangles, or from the next one in input order
+    auto skipDeadEnd = [&]() -> int64_t {
+        while (!deadEnds.empty())
+        {
+            uint32_t vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveCounts[vertex] > 0)
+            {
+                return vertex;
+            }
+        }
+        for (; cursor < vertexCount; ++cursor)
+        {
+            if (liveCounts[cursor] > 0)
+            {
+                return static_cast<int64_t>(cursor);
+            }
+        }
+        return -1;
+    };
+
+    optimized.clear();
+    optimized.reserve(indices.size());
+    clusters.clear();
+
+    int64_t fanningVertex = skipDeadEnd();
+    if (fanningVertex >= 0)
+    {
+        clusters.push_back(0);
+    }
+    while (fanningVertex >= 0)
+    {
+        candidates.clear();
+        for (size_t a = offsets[static_cast<size_t>(fanningVertex)]; a < offsets[static_cast<size_t>(fanningVertex) + 1]; ++a)
+        {
+            uint32_t triangle = adjacency[a];
+            if (emitted[triangle])
+            {
+                continue;
+            }
+            for (size_t k = 0; k < 3; ++k)
+            {
+                uint32_t vertex = indices[triangle * 3 + k];
+                optimized.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                --liveCounts[vertex];
+                if (time - timeStamps[vertex] > cacheSize)
+                {
+                    timeStamps[vertex] = time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // Prefer a vertex that stays in the cache while its remaining triangles are emitted, oldest first
+        int64_t nextVertex = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t vertex : candidates)
+        {
+            if (liveCounts[vertex] == 0)
+            {
+                continue;
+            }
+            size_t age = time - timeStamps[vertex];
+            int64_t priority = age + 2 * liveCounts[vertex] <= cacheSize ? static_cast<int64_t>(age) : 0;
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                nextVertex = vertex;
+            }
+        }
+
+        if (nextVertex < 0)
+        {
+            nextVertex = skipDeadEnd();
+            if (nextVertex >= 0)
+            {
+                clusters.push_back(optimized.size() / 3);
+            }
+        }
+        fanningVertex = nextVertex;
+    }
+    return true;
+}
+
+void MeshOptimizer::optimizeOverdraw(const std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices, const std::vector<size_t>& clusters)
+{
+    if (clusters.size() < 2 || positions.empty())
+    {
+        return;
+    }
+
+    glm::vec3 meshCenter(0.0f);
+    for (const glm::vec3& position : positions)
+    {
+        meshCenter += position;
+    }
+    meshCenter /= static_cast<float>(positions.size());
+
+    struct Cluster
+    {
+        size_t begin;
+        size_t end;
+        float sortKey;
+    };
+
+    const size_t triangleCount = indices.size() / 3;
+    std::vector<Cluster> sortedClusters(clusters.size());
+    for (size_t c = 0; c < clusters.size(); ++c)
+    {
+        Cluster& cluster = sortedClusters[c];
+        cluster.begin = clusters[c];
+        cluster.end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+        // Area weighted center and normal of the cluster
+        glm::vec3 center(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = cluster.begin; t < cluster.end; ++t)
+        {
+            const glm::vec3& p0 = positions[indices[t * 3]];
+            const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+            const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+            glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(triangleNormal);
+            center += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal += triangleNormal;
+            area += triangleArea;
+        }
+        center = area > 0.0f ? center / area : positions[indices[cluster.begin * 3]];
+        float normalLength = glm::length(normal);
+        normal = normalLength > 0.0f ? normal / normalLength : normal;
+        cluster.sortKey = glm::dot(center - meshCenter, normal);
+    }
+
+    std::stable_sort(sortedClusters.begin(), sortedClusters.end(), [](const Cluster& a, const Cluster& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<uint32_t> sortedIndices;
+    sortedIndices.reserve(indices.size());
+    for (const Cluster& cluster : sortedClusters)
+    {
+        sortedIndices.insert(sortedIndices.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    }
+    indices.swap(sortedIndices);
+}
+
+void MeshOptimizer::optimizeVertexFetch(Mesh& mesh)
+{
+    const size_t vertexCount = mesh.positions.size();
+    std::vector<uint32_t> remap(vertexCount, c_unused);
+    uint32_t nextVertex = 0;
+    for (uint32_t& index : mesh.indices)
+    {
+        if (remap[index] == c_unused)
+        {
+            remap[index] = nextVertex++;
+        }
+        index = remap[index];
+    }
+    for (uint32_t& vertex : remap)
+    {
+        if (vertex == c_unused)
+        {
+            vertex = nextVertex++;
+        }
+    }
+
+    reorder(mesh.positions, remap);
+    reorder(mesh.normals, remap);
+    reorder(mesh.tangents, remap);
+    reorder(mesh.uvs, remap);
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStats stats;
+    stats.triangleCount = indices.size() / 3;
+
+    std::vector<size_t> timeStamps(vertexCount, 0);
+    size_t time = cacheSize + 1;
+    for (uint32_t index : indices)
+    {
+        if (timeStamps[index] == 0)
+        {
+            ++stats.vertexCount;
+        }
+        if (time - timeStamps[index] > cacheSize)
+        {
+            timeStamps[index] = time++;
+            ++stats.transformCount;
+        }
+    }
+    return stats;
+}
+
+} // namespace fw
@@ -1,127 +1,159 @@
 #include "Model.h"
 #include "Common.h"
+#include "Constants.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
+#include "Trace.h"
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <thread>
 #include <utility>
 
 namespace fw
 {
-bool Model::loadModel(const std::string& file)
+namespace
 {
-    Assimp::Importer importer;
-    unsigned int flags = aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_GenSmoothNormals
-        | aiProcess_GenUVCoords | aiProcess_CalcTangentSpace;
-    const aiScene* aScene = importer.ReadFile(file, flags);
+void extractMesh(const aiScene* aScene, const aiMesh* aMesh, Mesh& mesh, std::string& error)
+{
+    if (aMesh->mNumVertices == 0)
+    {
+        error = "Invalid mesh (no vertices)";
+        return;
+    }
+    if (!aMesh->HasNormals())
+    {
+        error = "Invalid mesh (number of vertices and normals do not match)";
+        return;
+    }
+
+    // Every stream is sized once up front and written by index
+    const unsigned int numVertices = aMesh->mNumVertices;
+    mesh.positions.resize(numVertices);
+    mesh.normals.resize(numVertices);
+    for (unsigned int i = 0; i < numVertices; ++i)
+    {
+        const aiVector3D& p = aMesh->mVertices[i];
+        const aiVector3D& n = aMesh->mNormals[i];
+        mesh.positions[i] = glm::vec3(p.x, p.y, p.z);
+        mesh.normals[i] = glm::vec3(n.x, n.y, n.z);
+    }
 
-    if (aScene)
+    if (aMesh->HasTangentsAndBitangents())
     {
-        if (aScene->mNumMeshes == 0)
+        mesh.tangents.resize(numVertices);
+        for (unsigned int i = 0; i < numVertices; ++i)
         {
-            printWarning("No mesh found in the model: " + file);
-            return false;
+            const aiVector3D& t = aMesh->mTangents[i];
+            mesh.tangents[i] = glm::vec3(t.x, t.y, t.z);
         }
+    }
 
-        for (unsigned int meshIndex = 0; meshIndex < aScene->mNumMeshes; ++meshIndex)
+    if (aMesh->HasTextureCoords(0))
+    {
+        mesh.uvs.resize(numVertices);
+        for (unsigned int i = 0; i < numVertices; ++i)
         {
-            const aiMesh* aMesh = aScene->mMeshes[meshIndex];
-            Mesh mesh;
-            for (unsigned int vertexIndex = 0; vertexIndex < aMesh->mNumVertices; ++vertexIndex)
-            {
-                mesh.positions.push_back(glm::vec3(
-                    aMesh->mVertices[vertexIndex].x, aMesh->mVertices[vertexIndex].y, aMesh->mVertices[vertexIndex].z));
-
-                mesh.normals.push_back(glm::vec3(
-                    aMesh->mNormals[vertexIndex].x, aMesh->mNormals[vertexIndex].y, aMesh->mNormals[vertexIndex].z));
-
-                if (aMesh->HasTangentsAndBitangents())
-                {
-                    mesh.tangents.push_back(glm::vec3(aMesh->mTangents[vertexIndex].x,
-                                                      aMesh->mTangents[vertexIndex].y,
-                                                      aMesh->mTangents[vertexIndex].z));
-                }
-
-                if (aMesh->HasTextureCoords(0))
-                {
-                    mesh.uvs.push_back(
-                        glm::vec2(aMesh->mTextureCoords[0][vertexIndex].x, -aMesh->mTextureCoords[0][vertexIndex].y));
-                }
-            }
+            const aiVector3D& uv = aMesh->mTextureCoords[0][i];
+            mesh.uvs[i] = glm::vec2(uv.x, -uv.y);
+        }
+    }
 
-            for (unsigned int faceIndex = 0; faceIndex < aMesh->mNumFaces; ++faceIndex)
-            {
-                if (aMesh->mFaces[faceIndex].mNumIndices != 3)
-                {
-                    printWarning("Unable to parse model indices for " + file);
-                    return false;
-                }
-                mesh.indices.push_back(aMesh->mFaces[faceIndex].mIndices[0]);
-                mesh.indices.push_back(aMesh->mFaces[faceIndex].mIndices[1]);
-                mesh.indices.push_back(aMesh->mFaces[faceIndex].mIndices[2]);
-            }
+    mesh.indices.resize(static_cast<size_t>(aMesh->mNumFaces) * 3);
+    for (unsigned int faceIndex = 0; faceIndex < aMesh->mNumFaces; ++faceIndex)
+    {
+        const aiFace& face = aMesh->mFaces[faceIndex];
+        if (face.mNumIndices != 3)
+        {
+            error = "Unable to parse model indices";
+            return;
+        }
+        uint32_t* dst = &mesh.indices[static_cast<size_t>(faceIndex) * 3];
+        dst[0] = face.mIndices[0];
+        dst[1] = face.mIndices[1];
+        dst[2] = face.mIndices[2];
+    }
 
-            aiMaterial* aMaterial = aScene->mMaterials[aMesh->mMaterialIndex];
-            if (aMaterial)
+    const aiMaterial* aMaterial = aScene->mMaterials[aMesh->mMaterialIndex];
+    if (aMaterial)
+    {
+        for (int typeIndex = 0; typeIndex < aiTextureType_UNKNOWN; ++typeIndex)
+        {
+            aiTextureType type = static_cast<aiTextureType>(typeIndex);
+            unsigned int numTextures = aMaterial->GetTextureCount(type);
+            if (numTextures == 0)
             {
-                for (int typeIndex = 0; typeIndex < aiTextureType_UNKNOWN; ++typeIndex)
-                {
-                    aiTextureType type = static_cast<aiTextureType>(typeIndex);
-                    unsigned int numTextures = aMaterial->GetTextureCount(type);
-                    for (unsigned int texIndex = 0; texIndex < numTextures; ++texIndex)
-                    {
-                        aiString path;
-                        aMaterial->GetTexture(type, texIndex, &path);
-                        mesh.materials[type].push_back(std::string(path.C_Str()));
-                    }
-                }
+                continue;
             }
-
-            if (aScene->HasTextures())
+            std::vector<std::string>& paths = mesh.materials[type];
+            paths.reserve(numTextures);
+            for (unsigned int texIndex = 0; texIndex < numTextures; ++texIndex)
             {
-                for (unsigned int i = 0; i < aScene->mNumTextures; ++i)
-                {
-                    aiTexture* aTexture = aScene->mTextures[i];
-                    m_textureDatas[i] = std::vector<unsigned char>(aTexture->mWidth);
-                    TextureData& data = m_textureDatas[i];
-                    std::memcpy(data.data(), aTexture->pcData, aTexture->mWidth);
-                }
+                aiString path;
+                aMaterial->GetTexture(type, texIndex, &path);
+                paths.emplace_back(path.C_Str());
             }
+        }
+    }
+}
 
-            if (mesh.positions.empty())
-            {
-                printWarning("Invalid mesh (no vertices): " + file);
-                return false;
-            }
+} // unnamed
 
-            size_t numVertices = mesh.positions.size();
-            if (mesh.normals.size() != numVertices)
-            {
-                printWarning("Invalid mesh (number of vertices and normals do not match): " + file);
-                return false;
-            }
-            m_meshes.push_back(std::move(mesh));
-        }
+bool Model::loadModel(const std::string& file)
+{
+    TRACE_SCOPE("Model::loadModel");
+    unsigned int flags = aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_GenSmoothNormals
+        | aiProcess_GenUVCoords | aiProcess_CalcTangentSpace;
+
+    m_loadStats = LoadStats{};
+    auto start = std::chrono::steady_clock::now();
+
+    m_loadStats.fromCache = m_cacheEnabled && MeshCache::load(file, flags, m_optimizationEnabled, m_meshes, m_textureDatas);
+    if (m_loadStats.fromCache)
+    {
+        printLog("Loaded model from cache: " + file);
     }
-    else
+    else if (!importModel(file, flags))
     {
-        printWarning("Failed to read model: " + file);
-        std::cerr << "Assimp error message: " << importer.GetErrorString() << "\n";
         return false;
     }
 
-    if (m_meshes.empty())
+    m_loadStats.totalMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    for (const Mesh& mesh : m_meshes)
     {
-        printWarning("Empty model: " + file);
-        return false;
+        m_loadStats.vertexCount += mesh.positions.size();
+        m_loadStats.indexCount += mesh.indices.size();
+        m_loadStats.vertexCache += MeshOptimizer::analyzeVertexCache(mesh.indices, mesh.positions.size());
     }
 
-    printLog("Loaded model: " + file);
+    if (m_cacheEnabled && !m_loadStats.fromCache)
+    {
+        MeshCache::save(file, flags, m_optimizationEnabled, m_meshes, m_textureDatas);
+    }
     return true;
 }
 
+void Model::setCacheEnabled(bool enabled)
+{
+    m_cacheEnabled = enabled;
+}
+
+void Model::setOptimizationEnabled(bool enabled)
+{
+    m_optimizationEnabled = enabled;
+}
+
+const Model::LoadStats& Model::getLoadStats() const
+{
+    return m_loadStats;
+}
+
 const Model::Meshes& Model::getMeshes() const
 {
     return m_meshes;
@@ -132,4 +164,87 @@ const Model::TextureData& Model::getTextureData(unsigned int index)
     return m_textureDatas[index];
 }
 
+bool Model::importModel(const std::string& file, unsigned int flags)
+{
+    TRACE_SCOPE("Model::importModel");
+    auto importStart = std::chrono::steady_clock::now();
+
+    Assimp::Importer importer;
+    const aiScene* aScene = importer.ReadFile(file, flags);
+    if (!aScene)
+    {
+        printWarning("Failed to read model: " + file);
+        std::cerr << "Assimp error message: " << importer.GetErrorString() << "\n";
+        return false;
+    }
+
+    if (aScene->mNumMeshes == 0)
+    {
+        printWarning("No mesh found in the model: " + file);
+        return false;
+    }
+
+    auto extractStart = std::chrono::steady_clock::now();
+
+    // Embedded textures belong to the scene, not to any single mesh
+    m_textureDatas.clear();
+    for (unsigned int i = 0; i < aScene->mNumTextures; ++i)
+    {
+        const aiTexture* aTexture = aScene->mTextures[i];
+        const unsigned char* data = reinterpret_cast<const unsigned char*>(aTexture->pcData);
+        m_textureDatas[i] = TextureData(data, data + aTexture->mWidth);
+    }
+
+    // Meshes are independent of each other so they are converted in parallel, the scene is only read
+    const size_t numMeshes = aScene->mNumMeshes;
+    m_meshes.clear();
+    m_meshes.resize(numMeshes);
+    std::vector<std::string> errors(numMeshes);
+    uint32_t threadCount = std::min(static_cast<uint32_t>(numMeshes), std::thread::hardware_concurrency());
+    ThreadPool threadPool(threadCount);
+    threadPool.parallelFor(numMeshes, [&](size_t begin, size_t end, uint32_t /*threadIndex*/) {
+        for (size_t meshIndex = begin; meshIndex < end; ++meshIndex)
+        {
+            extractMesh(aScene, aScene->mMeshes[meshIndex], m_meshes[meshIndex], errors[meshIndex]);
+        }
+    });
+
+    for (const std::string& error : errors)
+    {
+        if (!error.empty())
+        {
+            printWarning(error + ": " + file);
+            m_meshes.clear();
+            return false;
+        }
+    }
+
+    auto extractEnd = std::chrono::steady_clock::now();
+
+    std::vector<MeshOptimizer::VertexCacheStats> importedVertexCaches(numMeshes);
+    threadPool.parallelFor(numMeshes, [&](size_t begin, size_t end, uint32_t /*threadIndex*/) {
+        for (size_t meshIndex = begin; meshIndex < end; ++meshIndex)
+        {
+            Mesh& mesh = m_meshes[meshIndex];
+            importedVertexCaches[meshIndex] = MeshOptimizer::analyzeVertexCache(mesh.indices, mesh.positions.size());
+            if (m_optimizationEnabled)
+            {
+                MeshOptimizer::optimize(mesh);
+            }
+        }
+    });
+    for (const MeshOptimizer::VertexCacheStats& stats : importedVertexCaches)
+    {
+        m_loadStats.importedVertexCache += stats;
+    }
+
+    auto optimizeEnd = std::chrono::steady_clock::now();
+    m_loadStats.importMilliseconds = std::chrono::duration<double, std::milli>(extractStart - importStart).count();
+    m_loadStats.extractMilliseconds = std::chrono::duration<double, std::milli>(extractEnd - extractStart).count();
+    m_loadStats.optimizeMilliseconds = std::chrono::duration<double, std::milli>(optimizeEnd - extractEnd).count();
+
+    printLog("Loaded model: " + file);
+    return true;
+}
+
 } // namespace fw
@@ -0,0 +1,138 @@
+#include "ParallelRecorder.h"
+#include "API.h"
+#include "Command.h"
+#include "Common.h"
+#include "Constants.h"
+#include "Context.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <utility>
+
+namespace fw
+{
+ParallelRecorder::~ParallelRecorder()
+{
+    // Stop the workers before their pools go away
+    m_threadPool.reset();
+    for (WorkerFrame& workerFrame : m_workerFrames)
+    {
+        vkDestroyCommandPool(m_logicalDevice, workerFrame.commandPool, nullptr);
+    }
+}
+
+bool ParallelRecorder::initialize(uint32_t threadCount)
+{
+    m_logicalDevice = Context::getLogicalDevice();
+    m_threadPool = std::make_unique<ThreadPool>(threadCount);
+    m_jobCount = m_threadPool->getThreadCount();
+
+    // The frame count can still change before the main loop so reserve pools for the maximum
+    m_workerFrames.resize(Constants::maxFramesInFlight * m_threadPool->getThreadCount());
+    for (WorkerFrame& workerFrame : m_workerFrames)
+    {
+        if (!Command::createGraphicsCommandPool(&workerFrame.commandPool))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t ParallelRecorder::getThreadCount() const
+{
+    return m_threadPool->getThreadCount();
+}
+
+void ParallelRecorder::setJobCount(uint32_t count)
+{
+    m_jobCount = std::max(count, 1u);
+}
+
+uint32_t ParallelRecorder::getJobCount() const
+{
+    return m_jobCount;
+}
+
+bool ParallelRecorder::record(const VkCommandBufferInheritanceInfo& inheritanceInfo, size_t count, const RecordFunction& function, std::vector<VkCommandBuffer>& commandBuffers)
+{
+    const uint32_t threadCount = m_threadPool->getThreadCount();
+    const size_t firstWorkerFrame = API::getCurrentFrameIndex() * threadCount;
+
+    if (m_frameNumber != API::getFrameNumber())
+    {
+        // The frame fence has been waited so nothing recorded from these pools is pending anymore
+        m_frameNumber = API::getFrameNumber();
+        for (size_t i = firstWorkerFrame; i < firstWorkerFrame + threadCount; ++i)
+        {
+            vkResetCommandPool(m_logicalDevice, m_workerFrames[i].commandPool, 0);
+            m_workerFrames[i].usedCount = 0;
+        }
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    std::mutex mutex;
+    std::vector<std::pair<size_t, VkCommandBuffer>> recorded;
+    std::atomic<bool> success(true);
+
+    auto recordRange = [&](size_t begin, size_t end, uint32_t threadIndex) {
+        // Only this thread touches the pool of this worker during the call
+        VkCommandBuffer commandBuffer = getCommandBuffer(m_workerFrames[firstWorkerFrame + threadIndex]);
+        if (commandBuffer == VK_NULL_HANDLE || vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        {
+            success = false;
+            return;
+        }
+        function(commandBuffer, begin, end);
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        {
+            success = false;
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        recorded.emplace_back(begin, commandBuffer);
+    };
+    m_threadPool->parallelFor(count, recordRange, m_jobCount);
+
+    if (!success)
+    {
+        printError("Failed to record secondary command buffers");
+        return false;
+    }
+
+    std::sort(recorded.begin(), recorded.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    commandBuffers.clear();
+    for (const auto& range : recorded)
+    {
+        commandBuffers.push_back(range.second);
+    }
+    return true;
+}
+
+VkCommandBuffer ParallelRecorder::getCommandBuffer(WorkerFrame& workerFrame)
+{
+    if (workerFrame.usedCount == workerFrame.commandBuffers.size())
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = workerFrame.commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        if (vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, &commandBuffer) != VK_SUCCESS)
+        {
+            return VK_NULL_HANDLE;
+        }
+        workerFrame.commandBuffers.push_back(commandBuffer);
+    }
+    return workerFrame.commandBuffers[workerFrame.usedCount++];
+}
+
+} // namespace fw
@@ -1,19 +1,21 @@
 #include "Pipeline.h"
 #include "API.h"
 #include "Common.h"
-#include "Mesh.h"
+#include "ShaderModuleCache.h"
 
 namespace fw
 {
 std::vector<VkPipelineShaderStageCreateInfo> Pipeline::getShaderStageInfos(const std::string& vertexShaderFilename, const std::string& fragmentShaderFilename)
 {
-    VkShaderModule vertexShaderModule = createShaderModule(vertexShaderFilename);
-    VkShaderModule fragmentShaderModule = createShaderModule(fragmentShaderFilename);
+    VkShaderModule vertexShaderModule = ShaderModuleCache::acquire(vertexShaderFilename);
+    VkShaderModule fragmentShaderModule = ShaderModuleCache::acquire(fragmentShaderFilename);
 
     auto isNull = [](VkShaderModule shaderModule) { return shaderModule == VK_NULL_HANDLE; };
 
     if (isNull(vertexShaderModule) || isNull(fragmentShaderModule))
     {
+        ShaderModuleCache::release(vertexShaderModule);
+        ShaderModuleCache::release(fragmentShaderModule);
         return std::vector<VkPipelineShaderStageCreateInfo>{};
     }
 
@@ -34,7 +36,7 @@ std::vector<VkPipelineShaderStageCreateInfo> Pipeline::getShaderStageInfos(const
 
 VkPipelineShaderStageCreateInfo Pipeline::getComputeShaderStageInfo(const std::string& computeShaderFilename)
 {
-    VkShaderModule computeShaderModule = createShaderModule(computeShaderFilename);
+    VkShaderModule computeShaderModule = ShaderModuleCache::acquire(computeShaderFilename);
 
     auto isNull = [](VkShaderModule shaderModule) { return shaderModule == VK_NULL_HANDLE; };
 
@@ -52,16 +54,16 @@ VkPipelineShaderStageCreateInfo Pipeline::getComputeShaderStageInfo(const std::s
     return computeShaderStageInfo;
 }
 
-VkVertexInputBindingDescription Pipeline::getVertexDescription()
+VkVertexInputBindingDescription Pipeline::getVertexDescription(Mesh::VertexFormat format)
 {
     VkVertexInputBindingDescription vertexDescription{};
     vertexDescription.binding = 0;
-    vertexDescription.stride = sizeof(Mesh::Vertex);
+    vertexDescription.stride = static_cast<uint32_t>(Mesh::getVertexSize(format));
     vertexDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
     return vertexDescription;
 }
 
-std::vector<VkVertexInputAttributeDescription> Pipeline::getAttributeDescriptions()
+std::vector<VkVertexInputAttributeDescription> Pipeline::getAttributeDescriptions(Mesh::VertexFormat format)
 {
     std::vector<VkVertexInputAttributeDescription> attributeDescriptions(4);
 
@@ -85,6 +87,18 @@ std::vector<VkVertexInputAttributeDescription> Pipeline::getAttributeDescription
     attributeDescriptions[3].format = VK_FORMAT_R32G32_SFLOAT;
     attributeDescriptions[3].offset = offsetof(Mesh::Vertex, uv);
 
+    // The normal and tangent arrive as octahedral encoded vec2s, a shader that uses them has to decode them itself
+    if (format == Mesh::VertexFormat::Packed)
+    {
+        attributeDescriptions[0].offset = offsetof(Mesh::PackedVertex, position);
+        attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+        attributeDescriptions[1].offset = offsetof(Mesh::PackedVertex, normal);
+        attributeDescriptions[2].format = VK_FORMAT_R16G16_SNORM;
+        attributeDescriptions[2].offset = offsetof(Mesh::PackedVertex, tangent);
+        attributeDescriptions[3].format = VK_FORMAT_R16G16_SFLOAT;
+        attributeDescriptions[3].offset = offsetof(Mesh::PackedVertex, uv);
+    }
+
     return attributeDescriptions;
 }
 
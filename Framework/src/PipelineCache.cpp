@@ -0,0 +1,111 @@
+#include "PipelineCache.h"
+#include "Common.h"
+#include "Constants.h"
+#include "Context.h"
+#include "MappedFile.h"
+
+#include <cstring>
+#include <ostream>
+#include <vector>
+
+namespace fw
+{
+namespace
+{
+// Drivers are expected to reject foreign data but not all of them do, the header is checked before handing it over
+bool isCompatible(const unsigned char* data, size_t size)
+{
+    const VkPhysicalDeviceProperties* properties = Context::getPhysicalDeviceProperties();
+    const size_t headerSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+    if (size < headerSize)
+    {
+        return false;
+    }
+
+    uint32_t header[4];
+    std::memcpy(header, data, sizeof(header));
+    return header[0] >= headerSize && header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && header[2] == properties->vendorID
+        && header[3] == properties->deviceID && std::memcmp(data + sizeof(header), properties->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+} // unnamed
+
+PipelineCache::~PipelineCache()
+{
+    if (m_pipelineCache != VK_NULL_HANDLE)
+    {
+        save();
+        vkDestroyPipelineCache(Context::getLogicalDevice(), m_pipelineCache, nullptr);
+        Context::s_pipelineCache = VK_NULL_HANDLE;
+    }
+}
+
+bool PipelineCache::initialize()
+{
+    MappedFile file;
+    bool loaded = Constants::usePipelineCache && file.open(getCacheFilename());
+    if (loaded && !isCompatible(file.getData(), file.getSize()))
+    {
+        printWarning("Ignoring an incompatible pipeline cache: " + getCacheFilename());
+        loaded = false;
+    }
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = loaded ? file.getSize() : 0;
+    createInfo.pInitialData = loaded ? file.getData() : nullptr;
+
+    if (VkResult r = vkCreatePipelineCache(Context::getLogicalDevice(), &createInfo, nullptr, &m_pipelineCache); r != VK_SUCCESS)
+    {
+        printError("Failed to create a pipeline cache", &r);
+        return false;
+    }
+
+    if (loaded)
+    {
+        printLog("Loaded pipeline cache " + getCacheFilename() + " (" + std::to_string(file.getSize()) + " bytes)");
+    }
+    Context::s_pipelineCache = m_pipelineCache;
+    return true;
+}
+
+bool PipelineCache::save() const
+{
+    if (!Constants::usePipelineCache || m_pipelineCache == VK_NULL_HANDLE)
+    {
+        return true;
+    }
+
+    VkDevice logicalDevice = Context::getLogicalDevice();
+    size_t size = 0;
+    if (VkResult r = vkGetPipelineCacheData(logicalDevice, m_pipelineCache, &size, nullptr); r != VK_SUCCESS)
+    {
+        printError("Failed to get the pipeline cache size", &r);
+        return false;
+    }
+    std::vector<char> data(size);
+    if (VkResult r = vkGetPipelineCacheData(logicalDevice, m_pipelineCache, &size, data.data()); r != VK_SUCCESS)
+    {
+        printError("Failed to get the pipeline cache data", &r);
+        return false;
+    }
+
+    return writeFileAtomically(getCacheFilename(), "pipeline cache", [&data, size](std::ostream& cache) {
+        cache.write(data.data(), static_cast<std::streamsize>(size));
+    });
+}
+
+std::string PipelineCache::getCacheFilename()
+{
+    const VkPhysicalDeviceProperties* properties = Context::getPhysicalDeviceProperties();
+    const char* digits = "0123456789abcdef";
+    std::string uuid;
+    for (uint32_t i = 0; i < VK_UUID_SIZE; ++i)
+    {
+        uuid += digits[properties->pipelineCacheUUID[i] >> 4];
+        uuid += digits[properties->pipelineCacheUUID[i] & 0xf];
+    }
+    return "pipelines_" + uuid + "_" + std::to_string(properties->driverVersion) + ".myvkpipelines";
+}
+
+} // namespace fw
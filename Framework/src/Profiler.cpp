@@ -0,0 +1,355 @@
+#include "Profiler.h"
+#include "Command.h"
+#include "Common.h"
+#include "Context.h"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+namespace fw
+{
+std::mutex Profiler::s_mutex;
+VkQueryPool Profiler::s_queryPool = VK_NULL_HANDLE;
+uint32_t Profiler::s_usedQueryCount = 0;
+double Profiler::s_nanosecondsPerTick = 1.0;
+uint64_t Profiler::s_timestampMask = std::numeric_limits<uint64_t>::max();
+std::unordered_map<VkCommandBuffer, std::unordered_map<std::string, uint32_t>> Profiler::s_scopeIndices;
+std::vector<Profiler::Scope> Profiler::s_scopes;
+std::map<std::pair<std::string, bool>, uint32_t> Profiler::s_statIndices;
+std::vector<Profiler::Stat> Profiler::s_stats;
+std::deque<Profiler::Event> Profiler::s_events;
+
+namespace
+{
+const uint32_t c_maxQueryCount = 512;
+const size_t c_historySize = 256;
+const size_t c_maxEventCount = 1 << 18;
+
+std::string escapeCSV(const std::string& s)
+{
+    if (s.find_first_of(",\"\n") == std::string::npos)
+    {
+        return s;
+    }
+    std::string escaped = "\"";
+    for (char c : s)
+    {
+        escaped += c;
+        if (c == '"')
+        {
+            escaped += '"';
+        }
+    }
+    return escaped + "\"";
+}
+
+} // unnamed
+
+Profiler::CpuScope::CpuScope(const char* name) :
+    m_name(name),
+    m_start(std::chrono::steady_clock::now())
+{
+}
+
+Profiler::CpuScope::~CpuScope()
+{
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double startUs = std::chrono::duration<double, std::micro>(m_start.time_since_epoch()).count();
+    double durationUs = std::chrono::duration<double, std::micro>(end - m_start).count();
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    addSample(getStatIndex(m_name, false), startUs, durationUs);
+}
+
+void Profiler::beginScope(VkCommandBuffer commandBuffer, const std::string& name, VkPipelineStageFlagBits stage)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    if (s_queryPool == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    std::unordered_map<std::string, uint32_t>& scopeIndices = s_scopeIndices[commandBuffer];
+    auto it = scopeIndices.find(name);
+    if (it == scopeIndices.end())
+    {
+        if (s_usedQueryCount + 2 > c_maxQueryCount)
+        {
+            printWarning("Out of timestamp queries, ignoring GPU scope " + name);
+            return;
+        }
+        Scope scope;
+        scope.statIndex = getStatIndex(name, true);
+        scope.firstQuery = s_usedQueryCount;
+        s_usedQueryCount += 2;
+        it = scopeIndices.emplace(name, ui32size(s_scopes)).first;
+        s_scopes.push_back(scope);
+    }
+
+    uint32_t firstQuery = s_scopes[it->second].firstQuery;
+    vkCmdResetQueryPool(commandBuffer, s_queryPool, firstQuery, 2);
+    vkCmdWriteTimestamp(commandBuffer, stage, s_queryPool, firstQuery);
+}
+
+void Profiler::endScope(VkCommandBuffer commandBuffer, const std::string& name, VkPipelineStageFlagBits stage)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    if (s_queryPool == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    std::unordered_map<std::string, uint32_t>& scopeIndices = s_scopeIndices[commandBuffer];
+    auto it = scopeIndices.find(name);
+    if (it == scopeIndices.end())
+    {
+        printWarning("GPU scope " + name + " ended without a begin");
+        return;
+    }
+    vkCmdWriteTimestamp(commandBuffer, stage, s_queryPool, s_scopes[it->second].firstQuery + 1);
+}
+
+std::vector<Profiler::Result> Profiler::getResults()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    std::vector<Result> results;
+    results.reserve(s_stats.size());
+    for (const Stat& stat : s_stats)
+    {
+        Result result;
+        result.name = stat.name;
+        result.gpu = stat.gpu;
+        result.sampleCount = stat.sampleCount;
+        result.lastMs = stat.lastMs;
+
+        size_t count = std::min<size_t>(stat.sampleCount, c_historySize);
+        size_t oldest = count < c_historySize ? 0 : stat.historyIndex;
+        result.history.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            result.history.push_back(stat.history[(oldest + i) % c_historySize]);
+        }
+
+        if (count > 0)
+        {
+            auto [minIt, maxIt] = std::minmax_element(result.history.begin(), result.history.end());
+            double sum = 0.0;
+            for (float ms : result.history)
+            {
+                sum += static_cast<double>(ms);
+            }
+            result.averageMs = sum / static_cast<double>(count);
+            result.minMs = static_cast<double>(*minIt);
+            result.maxMs = static_cast<double>(*maxIt);
+        }
+        results.push_back(std::move(result));
+    }
+    return results;
+}
+
+bool Profiler::exportCSV(const std::string& filename)
+{
+    std::ofstream file(filename, std::ios::trunc);
+    if (!file)
+    {
+        printError("Failed to open file " + filename);
+        return false;
+    }
+
+    file << "name,type,samples,last_ms,average_ms,min_ms,max_ms\n";
+    for (const Result& result : getResults())
+    {
+        file << escapeCSV(result.name) << ',' << (result.gpu ? "gpu" : "cpu") << ',' << result.sampleCount << ','
+             << result.lastMs << ',' << result.averageMs << ',' << result.minMs << ',' << result.maxMs << '\n';
+    }
+
+    if (!file)
+    {
+        printError("Failed to write file " + filename);
+        return false;
+    }
+    printLog("Wrote profiler results to " + filename);
+    return true;
+}
+
+bool Profiler::exportChromeTrace(const std::string& filename)
+{
+    std::vector<Event> events;
+    std::vector<std::pair<std::string, bool>> stats;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        events.assign(s_events.begin(), s_events.end());
+        for (const Stat& stat : s_stats)
+        {
+            stats.emplace_back(escapeJSON(stat.name), stat.gpu);
+        }
+    }
+
+    // Both clocks have an arbitrary origin, each track starts from its first event
+    double cpuStart = std::numeric_limits<double>::max();
+    double gpuStart = std::numeric_limits<double>::max();
+    for (const Event& event : events)
+    {
+        double& start = stats[event.statIndex].second ? gpuStart : cpuStart;
+        start = std::min(start, event.startUs);
+    }
+
+    std::ofstream file(filename, std::ios::trunc);
+    if (!file)
+    {
+        printError("Failed to open file " + filename);
+        return false;
+    }
+
+    file << "{\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+    file.precision(3);
+    file << std::fixed;
+    for (const Event& event : events)
+    {
+        const auto& [name, gpu] = stats[event.statIndex];
+        double ts = event.startUs - (gpu ? gpuStart : cpuStart);
+        file << ",\n{\"name\":\"" << name << "\",\"cat\":\"" << (gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << (gpu ? 1 : 0)
+             << ",\"ts\":" << ts << ",\"dur\":" << event.durationUs << "}";
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    if (!file)
+    {
+        printError("Failed to write file " + filename);
+        return false;
+    }
+    printLog("Wrote profiler trace to " + filename);
+    return true;
+}
+
+bool Profiler::isGpuSupported()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return s_queryPool != VK_NULL_HANDLE;
+}
+
+bool Profiler::initialize()
+{
+    VkPhysicalDevice physicalDevice = Context::getPhysicalDevice();
+    const VkPhysicalDeviceProperties* properties = Context::getPhysicalDeviceProperties();
+
+    QueueFamilyIndices indices = getQueueFamilies(physicalDevice, Context::getSurface());
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    // Scopes are recorded on both queues, which can be from different families
+    uint32_t validBits = std::min(queueFamilies[indices.graphicsFamily].timestampValidBits, queueFamilies[indices.computeFamily].timestampValidBits);
+    if (!properties->limits.timestampComputeAndGraphics || validBits == 0)
+    {
+        printWarning("Timestamps are not supported on every graphics and compute queue, GPU scopes are ignored");
+        return true;
+    }
+    s_nanosecondsPerTick = static_cast<double>(properties->limits.timestampPeriod);
+    s_timestampMask = validBits >= 64 ? std::numeric_limits<uint64_t>::max() : (1ull << validBits) - 1;
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = c_maxQueryCount;
+
+    if (VkResult r = vkCreateQueryPool(Context::getLogicalDevice(), &queryPoolInfo, nullptr, &s_queryPool); r != VK_SUCCESS)
+    {
+        printError("Failed to create a timestamp query pool", &r);
+        return false;
+    }
+
+    // Availability can be read only from queries that have been reset at least once
+    VkCommandBuffer commandBuffer = Command::beginSingleTimeCommands();
+    vkCmdResetQueryPool(commandBuffer, s_queryPool, 0, c_maxQueryCount);
+    Command::endSingleTimeCommands(commandBuffer);
+
+    return true;
+}
+
+void Profiler::collect()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    if (s_usedQueryCount == 0)
+    {
+        return;
+    }
+
+    // Value and availability of each query, queries still in flight are unavailable and skipped
+    std::vector<uint64_t> data(s_usedQueryCount * 2);
+    VkQueryResultFlags flags = VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT;
+    VkResult r = vkGetQueryPoolResults(Context::getLogicalDevice(), s_queryPool, 0, s_usedQueryCount, data.size() * sizeof(uint64_t), data.data(), 2 * sizeof(uint64_t), flags);
+    if (r != VK_SUCCESS && r != VK_NOT_READY)
+    {
+        printError("Failed to get timestamp query results", &r);
+        return;
+    }
+
+    for (Scope& scope : s_scopes)
+    {
+        const uint64_t* begin = &data[scope.firstQuery * 2];
+        const uint64_t* end = begin + 2;
+        if (begin[1] == 0 || end[1] == 0 || begin[0] == scope.lastBegin)
+        {
+            continue;
+        }
+        scope.lastBegin = begin[0];
+
+        double startUs = static_cast<double>(begin[0]) * s_nanosecondsPerTick / 1000.0;
+        double durationUs = static_cast<double>((end[0] - begin[0]) & s_timestampMask) * s_nanosecondsPerTick / 1000.0;
+        addSample(scope.statIndex, startUs, durationUs);
+    }
+}
+
+void Profiler::release()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    vkDestroyQueryPool(Context::getLogicalDevice(), s_queryPool, nullptr);
+    s_queryPool = VK_NULL_HANDLE;
+    s_usedQueryCount = 0;
+    s_scopeIndices.clear();
+    s_scopes.clear();
+    s_statIndices.clear();
+    s_stats.clear();
+    s_events.clear();
+}
+
+uint32_t Profiler::getStatIndex(const std::string& name, bool gpu)
+{
+    auto [it, added] = s_statIndices.emplace(std::make_pair(name, gpu), ui32size(s_stats));
+    if (added)
+    {
+        Stat stat;
+        stat.name = name;
+        stat.gpu = gpu;
+        stat.history.resize(c_historySize);
+        s_stats.push_back(std::move(stat));
+    }
+    return it->second;
+}
+
+void Profiler::addSample(uint32_t statIndex, double startUs, double durationUs)
+{
+    Stat& stat = s_stats[statIndex];
+    stat.lastMs = durationUs / 1000.0;
+    stat.history[stat.historyIndex] = static_cast<float>(stat.lastMs);
+    stat.historyIndex = (stat.historyIndex + 1) % c_historySize;
+    ++stat.sampleCount;
+
+    s_events.push_back({statIndex, startUs, durationUs});
+    if (s_events.size() > c_maxEventCount)
+    {
+        s_events.pop_front();
+    }
+}
+
+} // namespace fw
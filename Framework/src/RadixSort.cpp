@@ -0,0 +1,233 @@
+#include "RadixSort.h"
+#include "Common.h"
+#include "Context.h"
+#include "DescriptorLayoutCache.h"
+#include "Pipeline.h"
+#include "ShaderModuleCache.h"
+
+#include <algorithm>
+#include <string>
+
+namespace fw
+{
+namespace
+{
+const std::string c_shaderFolder = SHADER_PATH;
+
+const std::array<const char*, 3> c_shaderFilenames = {
+    "radix_count.comp.spv",
+    "radix_scan.comp.spv",
+    "radix_scatter.comp.spv"};
+
+// Same as in the shaders
+const uint32_t c_radixBits = 4;
+const uint32_t c_radixSize = 1 << c_radixBits;
+const uint32_t c_blockSize = 2048;
+
+// Bindings 0 and 1 are the input keys and values, 2 and 3 the output keys and values and 4 the histogram
+const uint32_t c_bindingCount = 5;
+
+uint32_t getBlockCount(uint32_t count)
+{
+    return (count + c_blockSize - 1) / c_blockSize;
+}
+
+void addComputeBarrier(VkCommandBuffer commandBuffer)
+{
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+} // unnamed
+
+RadixSort::~RadixSort()
+{
+    for (VkPipeline pipeline : m_pipelines)
+    {
+        vkDestroyPipeline(m_logicalDevice, pipeline, nullptr);
+    }
+    vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
+}
+
+bool RadixSort::create(Buffer* keyBuffer, Buffer* valueBuffer, uint32_t maxCount)
+{
+    m_logicalDevice = Context::getLogicalDevice();
+    m_keyBuffer = keyBuffer;
+    m_valueBuffer = valueBuffer;
+    m_maxCount = maxCount;
+
+    const VkPhysicalDeviceLimits& limits = Context::getPhysicalDeviceProperties()->limits;
+    if (maxCount == 0 || getBlockCount(maxCount) > limits.maxComputeWorkGroupCount[0])
+    {
+        printError("Invalid radix sort size " + std::to_string(maxCount));
+        return false;
+    }
+
+    return createBuffers() && createDescriptorSetLayout() && createPipelines() && createDescriptorSets();
+}
+
+void RadixSort::record(VkCommandBuffer commandBuffer, uint32_t count, uint32_t keyBits) const
+{
+    if (count == 0 || count > m_maxCount)
+    {
+        return;
+    }
+    if (keyBits == 0 || keyBits > 32)
+    {
+        printError("Invalid radix sort key bit count " + std::to_string(keyBits));
+        return;
+    }
+
+    Pass pass{count, 0, getBlockCount(count), 0};
+    uint32_t passCount = getPassCount(keyBits);
+    for (uint32_t i = 0; i < passCount; ++i)
+    {
+        if (i > 0)
+        {
+            addComputeBarrier(commandBuffer);
+        }
+
+        pass.shift = i * c_radixBits;
+        // The last pass may cover fewer bits, the extra pass of an odd count covers none
+        uint32_t digitBits = keyBits > pass.shift ? std::min(keyBits - pass.shift, c_radixBits) : 0;
+        pass.digitMask = (1u << digitBits) - 1;
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSets[i % 2], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pass), &pass);
+
+        dispatch(commandBuffer, Count, pass.blockCount);
+        addComputeBarrier(commandBuffer);
+        dispatch(commandBuffer, Scan, 1);
+        addComputeBarrier(commandBuffer);
+        dispatch(commandBuffer, Scatter, pass.blockCount);
+    }
+}
+
+uint32_t RadixSort::getMaxCount() const
+{
+    return m_maxCount;
+}
+
+uint32_t RadixSort::getPassCount(uint32_t keyBits)
+{
+    // The extra pass of an odd count masks every digit to zero which keeps the order
+    uint32_t passCount = (keyBits + c_radixBits - 1) / c_radixBits;
+    return passCount + passCount % 2;
+}
+
+bool RadixSort::createBuffers()
+{
+    VkBufferUsageFlags storageUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    VkMemoryPropertyFlags deviceLocal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    return m_scratchKeyBuffer.create(sizeof(uint32_t) * m_maxCount, storageUsage, deviceLocal)
+        && m_scratchValueBuffer.create(sizeof(uint32_t) * m_maxCount, storageUsage, deviceLocal)
+        && m_histogramBuffer.create(sizeof(uint32_t) * c_radixSize * getBlockCount(m_maxCount), storageUsage, deviceLocal);
+}
+
+bool RadixSort::createDescriptorSetLayout()
+{
+    std::vector<VkDescriptorSetLayoutBinding> bindings(c_bindingCount);
+    for (uint32_t i = 0; i < bindings.size(); ++i)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    m_descriptorSetLayout = DescriptorLayoutCache::get(bindings);
+    return m_descriptorSetLayout != VK_NULL_HANDLE;
+}
+
+bool RadixSort::createPipelines()
+{
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(Pass);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = Pipeline::getPipelineLayoutInfo(&m_descriptorSetLayout);
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (VkResult r = vkCreatePipelineLayout(m_logicalDevice, &pipelineLayoutInfo, nullptr, &m_pipelineLayout); r != VK_SUCCESS)
+    {
+        printError("Failed to create radix sort pipeline layout", &r);
+        return false;
+    }
+
+    for (size_t i = 0; i < m_pipelines.size(); ++i)
+    {
+        VkPipelineShaderStageCreateInfo shaderStage = Pipeline::getComputeShaderStageInfo(c_shaderFolder + c_shaderFilenames[i]);
+        if (shaderStage.module == VK_NULL_HANDLE)
+        {
+            return false;
+        }
+
+        Cleaner cleaner([&shaderStage]() {
+            ShaderModuleCache::release(shaderStage.module);
+        });
+
+        VkComputePipelineCreateInfo pipelineCreateInfo{};
+        pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineCreateInfo.stage = shaderStage;
+        pipelineCreateInfo.layout = m_pipelineLayout;
+
+        if (VkResult r = vkCreateComputePipelines(m_logicalDevice, Context::getPipelineCache(), 1, &pipelineCreateInfo, nullptr, &m_pipelines[i]); r != VK_SUCCESS)
+        {
+            printError("Failed to create radix sort pipeline", &r);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RadixSort::createDescriptorSets()
+{
+    for (uint32_t i = 0; i < m_descriptorSets.size(); ++i)
+    {
+        if (!m_descriptorAllocator.allocate(m_descriptorSetLayout, m_descriptorSets[i]))
+        {
+            return false;
+        }
+
+        bool toScratch = i == 0;
+        std::array<const Buffer*, c_bindingCount> buffers = {
+            toScratch ? m_keyBuffer : &m_scratchKeyBuffer,
+            toScratch ? m_valueBuffer : &m_scratchValueBuffer,
+            toScratch ? &m_scratchKeyBuffer : m_keyBuffer,
+            toScratch ? &m_scratchValueBuffer : m_valueBuffer,
+            &m_histogramBuffer};
+
+        std::array<VkDescriptorBufferInfo, c_bindingCount> bufferInfos{};
+        std::array<VkWriteDescriptorSet, c_bindingCount> descriptorWrites{};
+        for (uint32_t binding = 0; binding < descriptorWrites.size(); ++binding)
+        {
+            bufferInfos[binding].buffer = buffers[binding]->getBuffer();
+            bufferInfos[binding].offset = 0;
+            bufferInfos[binding].range = VK_WHOLE_SIZE;
+
+            descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[binding].dstSet = m_descriptorSets[i];
+            descriptorWrites[binding].dstBinding = binding;
+            descriptorWrites[binding].dstArrayElement = 0;
+            descriptorWrites[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[binding].descriptorCount = 1;
+            descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+        }
+
+        vkUpdateDescriptorSets(m_logicalDevice, ui32size(descriptorWrites), descriptorWrites.data(), 0, nullptr);
+    }
+    return true;
+}
+
+void RadixSort::dispatch(VkCommandBuffer commandBuffer, Stage stage, uint32_t workgroupCount) const
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelines[stage]);
+    vkCmdDispatch(commandBuffer, workgroupCount, 1, 1);
+}
+
+} // namespace fw
@@ -0,0 +1,78 @@
+#include "RingBuffer.h"
+#include "API.h"
+#include "Common.h"
+#include "Constants.h"
+#include "Context.h"
+
+#include <algorithm>
+
+namespace fw
+{
+bool RingBuffer::create(VkDeviceSize frameSize, VkBufferUsageFlags usage, bool sharedWithCompute)
+{
+    const VkPhysicalDeviceLimits& limits = Context::getPhysicalDeviceProperties()->limits;
+    if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+    {
+        m_alignment = std::max(m_alignment, limits.minUniformBufferOffsetAlignment);
+    }
+    if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+    {
+        m_alignment = std::max(m_alignment, limits.minStorageBufferOffsetAlignment);
+    }
+    m_frameSize = (frameSize + m_alignment - 1) / m_alignment * m_alignment;
+
+    // The frame count can still change before the main loop so reserve room for the maximum
+    VkDeviceSize size = m_frameSize * Constants::maxFramesInFlight;
+    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    if (!m_buffer.create(size, usage, properties, sharedWithCompute))
+    {
+        return false;
+    }
+    m_mappedData = static_cast<char*>(m_buffer.getMappedMemory());
+    return true;
+}
+
+bool RingBuffer::allocate(VkDeviceSize size, uint32_t& offset, void** data)
+{
+    if (m_frameNumber != API::getFrameNumber())
+    {
+        beginFrame();
+    }
+
+    VkDeviceSize alignedHead = (m_head + m_alignment - 1) / m_alignment * m_alignment;
+    if (alignedHead + size > m_frameEnd)
+    {
+        printError("Ring buffer frame region is full");
+        return false;
+    }
+
+    offset = static_cast<uint32_t>(alignedHead);
+    *data = m_mappedData + alignedHead;
+    m_head = alignedHead + size;
+    return true;
+}
+
+VkBuffer RingBuffer::getBuffer() const
+{
+    return m_buffer.getBuffer();
+}
+
+VkDeviceSize RingBuffer::getFrameSize() const
+{
+    return m_frameSize;
+}
+
+VkDeviceSize RingBuffer::getAlignment() const
+{
+    return m_alignment;
+}
+
+void RingBuffer::beginFrame()
+{
+    // The frame fence has been waited so the GPU is done with the previous contents of this region
+    m_frameNumber = API::getFrameNumber();
+    m_head = API::getCurrentFrameIndex() * m_frameSize;
+    m_frameEnd = m_head + m_frameSize;
+}
+
+} // namespace fw
@@ -0,0 +1,132 @@
+#include "ShaderModuleCache.h"
+#include "Common.h"
+#include "Context.h"
+#include "MappedFile.h"
+
+#include <vector>
+
+namespace fw
+{
+std::mutex ShaderModuleCache::s_mutex;
+std::unordered_map<uint64_t, ShaderModuleCache::Entry> ShaderModuleCache::s_entries;
+std::unordered_map<std::string, uint64_t> ShaderModuleCache::s_filenameHashes;
+
+VkShaderModule ShaderModuleCache::acquire(const std::string& filename)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    if (auto it = s_filenameHashes.find(filename); it != s_filenameHashes.end())
+    {
+        Entry& entry = s_entries[it->second];
+        ++entry.referenceCount;
+        return entry.shaderModule;
+    }
+
+    MappedFile file;
+    if (!file.open(filename))
+    {
+        printError("Failed to open file " + filename);
+        return VK_NULL_HANDLE;
+    }
+
+    // The mapping is page aligned which satisfies the alignment pCode needs
+    uint64_t hash = hashBytes(file.getData(), file.getSize());
+    Entry& entry = s_entries[hash];
+    if (entry.shaderModule == VK_NULL_HANDLE)
+    {
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = file.getSize();
+        createInfo.pCode = reinterpret_cast<const uint32_t*>(file.getData());
+
+        if (VkResult r = vkCreateShaderModule(Context::getLogicalDevice(), &createInfo, nullptr, &entry.shaderModule); r != VK_SUCCESS)
+        {
+            printError("Failed to create shader module", &r);
+            s_entries.erase(hash);
+            return VK_NULL_HANDLE;
+        }
+    }
+
+    s_filenameHashes[filename] = hash;
+    ++entry.referenceCount;
+    return entry.shaderModule;
+}
+
+void ShaderModuleCache::release(VkShaderModule shaderModule)
+{
+    if (shaderModule == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    for (auto& kv : s_entries)
+    {
+        if (kv.second.shaderModule == shaderModule)
+        {
+            if (kv.second.referenceCount == 0)
+            {
+                printWarning("Releasing a shader module that has no references");
+                return;
+            }
+            --kv.second.referenceCount;
+            return;
+        }
+    }
+    printWarning("Releasing a shader module that is not in the cache");
+}
+
+void ShaderModuleCache::trim()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    std::vector<uint64_t> unused;
+    for (const auto& kv : s_entries)
+    {
+        if (kv.second.referenceCount == 0)
+        {
+            unused.push_back(kv.first);
+        }
+    }
+    for (uint64_t hash : unused)
+    {
+        destroy(hash);
+    }
+}
+
+uint32_t ShaderModuleCache::getModuleCount()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return ui32size(s_entries);
+}
+
+void ShaderModuleCache::destroy(uint64_t hash)
+{
+    vkDestroyShaderModule(Context::getLogicalDevice(), s_entries[hash].shaderModule, nullptr);
+    s_entries.erase(hash);
+
+    auto it = s_filenameHashes.begin();
+    while (it != s_filenameHashes.end())
+    {
+        it = it->second == hash ? s_filenameHashes.erase(it) : std::next(it);
+    }
+}
+
+void ShaderModuleCache::releaseAll()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    for (const auto& kv : s_entries)
+    {
+        if (kv.second.referenceCount > 0)
+        {
+            printWarning("Releasing a shader module that still has references");
+        }
+        vkDestroyShaderModule(Context::getLogicalDevice(), kv.second.shaderModule, nullptr);
+    }
+    s_entries.clear();
+    s_filenameHashes.clear();
+}
+
+} // namespace fw
@@ -109,8 +109,11 @@ SwapChain::~SwapChain()
     {
         vkDestroyFramebuffer(m_logicalDevice, fb, nullptr);
     }
-    vkDestroySwapchainKHR(m_logicalDevice, m_swapChain,
-                          nullptr); // Destroys images
+    if (m_swapChain != VK_NULL_HANDLE)
+    {
+        vkDestroySwapchainKHR(m_logicalDevice, m_swapChain,
+                              nullptr); // Destroys images
+    }
 }
 
 bool SwapChain::create(uint32_t width, uint32_t height)
@@ -170,6 +173,29 @@ bool SwapChain::create(uint32_t width, uint32_t height)
     return true;
 }
 
+bool SwapChain::createOffscreen(uint32_t width, uint32_t height)
+{
+    m_logicalDevice = Context::getLogicalDevice();
+    m_imageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+    m_extent = {width, height};
+    m_imageCount = Constants::maxFramesInFlight;
+
+    // Images are sampled or copied out so that the rendered frames can be inspected
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    m_offscreenImages.resize(m_imageCount);
+    for (Image& image : m_offscreenImages)
+    {
+        if (!image.create(width, height, m_imageFormat, 0, usage))
+        {
+            printError("Failed to create an offscreen image");
+            return false;
+        }
+        m_images.push_back(image.getHandle());
+    }
+
+    return true;
+}
+
 bool SwapChain::initialize()
 {
     return createImageViews() && createDepthImage();
@@ -222,9 +248,12 @@ const VkImageView& SwapChain::getDepthImageView() const
 
 bool SwapChain::createImageViews()
 {
-    vkGetSwapchainImagesKHR(m_logicalDevice, m_swapChain, &m_imageCount, nullptr);
-    m_images.resize(m_imageCount);
-    vkGetSwapchainImagesKHR(m_logicalDevice, m_swapChain, &m_imageCount, m_images.data());
+    if (m_swapChain != VK_NULL_HANDLE)
+    {
+        vkGetSwapchainImagesKHR(m_logicalDevice, m_swapChain, &m_imageCount, nullptr);
+        m_images.resize(m_imageCount);
+        vkGetSwapchainImagesKHR(m_logicalDevice, m_swapChain, &m_imageCount, m_images.data());
+    }
 
     m_imageViews.resize(m_images.size());
     for (size_t i = 0; i < m_images.size(); ++i)
@@ -1,7 +1,11 @@
 #include "Texture.h"
-#include "Buffer.h"
+#include "API.h"
+#include "BlockCompression.h"
 #include "Common.h"
+#include "Constants.h"
 #include "Context.h"
+#include "ThreadPool.h"
+#include "Trace.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #ifndef WIN32
@@ -17,42 +21,269 @@
 #pragma GCC diagnostic pop
 #endif
 
+#include <algorithm>
 #include <cstring>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MYVK_TEXTURE_SSE2
+#endif
 
 namespace fw
 {
+namespace
+{
+bool isRgba8(VkFormat format)
+{
+    return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_B8G8R8A8_UNORM
+        || format == VK_FORMAT_B8G8R8A8_SRGB;
+}
+
+bool supportsLinearBlit(VkFormat format)
+{
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(Context::getPhysicalDevice(), format, &properties);
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (properties.optimalTilingFeatures & required) == required;
+}
+
+VkFormat getCompressedFormat(Texture::Compression compression, bool srgb)
+{
+    switch (compression)
+    {
+    case Texture::Compression::BC1:
+        return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case Texture::Compression::BC3:
+        return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    case Texture::Compression::BC5:
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+    case Texture::Compression::BC7:
+        return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    }
+    return VK_FORMAT_UNDEFINED;
+}
+
+// Shared by every encode instead of starting the workers again for each texture
+ThreadPool& getEncodeThreadPool()
+{
+    static ThreadPool threadPool;
+    return threadPool;
+}
+
+bool supportsSampling(VkFormat format)
+{
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(Context::getPhysicalDevice(), format, &properties);
+    return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
+// 2x2 box filter for 8 bit RGBA, the last row and column are repeated for odd sizes. sRGB data is filtered as is.
+void downsample(const unsigned char* src, uint32_t srcWidth, uint32_t srcHeight, unsigned char* dst, uint32_t dstWidth, uint32_t dstHeight)
+{
+    const size_t srcPitch = static_cast<size_t>(srcWidth) * 4;
+    for (uint32_t y = 0; y < dstHeight; ++y)
+    {
+        const unsigned char* row0 = src + 2 * y * srcPitch;
+        const unsigned char* row1 = src + std::min(2 * y + 1, srcHeight - 1) * srcPitch;
+        unsigned char* out = dst + static_cast<size_t>(y) * dstWidth * 4;
+        uint32_t x = 0;
+
+#ifdef MYVK_TEXTURE_SSE2
+        // Four texels of both rows are widened to 16 bits and summed into two output texels
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rounding = _mm_set1_epi16(2);
+        for (; x + 2 <= dstWidth && 2 * x + 4 <= srcWidth; x += 2)
+        {
+            __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+            __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+            __m128i left = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+            __m128i right = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+            __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(left, right), _mm_unpackhi_epi64(left, right));
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(sum, zero));
+        }
+#endif
+
+        for (; x < dstWidth; ++x)
+        {
+            const uint32_t x0 = 2 * x * 4;
+            const uint32_t x1 = std::min(2 * x + 1, srcWidth - 1) * 4;
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                uint32_t sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                out[x * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+// Levels must contain the first level, the rest are appended and their pixels stored in data
+void buildMipChain(uint32_t mipLevels, std::vector<std::vector<unsigned char>>& data, std::vector<UploadBatch::ImageLevel>& levels)
+{
+    data.resize(mipLevels);
+    for (uint32_t level = 1; level < mipLevels; ++level)
+    {
+        const UploadBatch::ImageLevel& src = levels.back();
+        UploadBatch::ImageLevel dst;
+        dst.width = std::max(src.width / 2, 1u);
+        dst.height = std::max(src.height / 2, 1u);
+        dst.size = static_cast<VkDeviceSize>(dst.width) * dst.height * 4;
+        dst.mipLevel = level;
+
+        data[level].resize(static_cast<size_t>(dst.size));
+        downsample(static_cast<const unsigned char*>(src.data), src.width, src.height, data[level].data(), dst.width, dst.height);
+        dst.data = data[level].data();
+        levels.push_back(dst);
+    }
+}
+
+} // unnamed
+
 Texture::~Texture()
 {
     if (m_imageView != VK_NULL_HANDLE)
     {
         vkDestroyImageView(Context::getLogicalDevice(), m_imageView, nullptr);
     }
+    destroyRetiredImageViews(true);
 }
 
 bool Texture::load(const std::string& filename, VkFormat format)
 {
-    return load(filename, format, STBI_rgb_alpha);
+    return load(filename, format, STBI_rgb_alpha, nullptr);
 }
 
 bool Texture::loadHDR(const std::string& filename)
 {
-    return load(filename, VK_FORMAT_R16G16B16A16_SFLOAT, 0);
+    return load(filename, VK_FORMAT_R16G16B16A16_SFLOAT, 0, nullptr);
 }
 
 bool Texture::load(const unsigned char* data, size_t size, VkFormat format)
 {
+    return load(data, size, format, nullptr);
+}
+
+bool Texture::load(const std::string& filename, VkFormat format, UploadBatch& batch)
+{
+    return load(filename, format, STBI_rgb_alpha, &batch);
+}
+
+bool Texture::load(const unsigned char* data, size_t size, VkFormat format, UploadBatch& batch)
+{
+    return load(data, size, format, &batch);
+}
+
+bool Texture::loadCompressed(const std::string& filename, Compression compression, bool srgb)
+{
+    return loadCompressed(filename, compression, srgb, nullptr);
+}
+
+bool Texture::loadCompressed(const std::string& filename, Compression compression, bool srgb, UploadBatch& batch)
+{
+    return loadCompressed(filename, compression, srgb, &batch);
+}
+
+bool Texture::loadDds(const std::string& filename)
+{
+    return loadDds(filename, nullptr);
+}
+
+bool Texture::loadDds(const std::string& filename, UploadBatch& batch)
+{
+    return loadDds(filename, &batch);
+}
+
+bool Texture::loadStreamed(const std::string& filename, VkFormat format, UploadBatch& batch)
+{
+    TRACE_SCOPE("Texture::loadStreamed");
+    if (!isRgba8(format))
+    {
+        printError("Streamed textures need an 8 bit RGBA format: " + filename);
+        return false;
+    }
+
     int texWidth, texHeight, texChannels;
-    stbi_uc* pixels
-        = stbi_load_from_memory(data, static_cast<int>(size), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    stbi_uc* pixels = stbi_load(filename.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
     if (!pixels)
     {
-        printError("Failed to load texture from data");
+        printError("Failed to load texture image: " + filename);
         return false;
     }
 
     Cleaner cleaner([&pixels]() { stbi_image_free(pixels); });
 
-    return createImage(pixels, texWidth, texHeight, format);
+    uint32_t width = static_cast<uint32_t>(texWidth);
+    uint32_t height = static_cast<uint32_t>(texHeight);
+    uint32_t mipLevels = getMipLevelCount(width, height);
+    VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (!m_image.create(width, height, format, 0, imageUsage, 1, mipLevels, VK_SAMPLE_COUNT_1_BIT))
+    {
+        return false;
+    }
+    m_format = format;
+
+    VkDeviceSize imageSize = static_cast<VkDeviceSize>(width) * height * 4;
+    m_mipLevelData = {std::vector<unsigned char>(pixels, pixels + imageSize)};
+    m_mipLevels = {UploadBatch::ImageLevel{m_mipLevelData[0].data(), imageSize, width, height, 0}};
+    buildMipChain(mipLevels, m_mipLevelData, m_mipLevels);
+
+    m_uploadedMipLevel = mipLevels - 1;
+    while (m_uploadedMipLevel > 0)
+    {
+        const UploadBatch::ImageLevel& next = m_mipLevels[m_uploadedMipLevel - 1];
+        if (std::max(next.width, next.height) > Constants::streamedTextureInitialSize)
+        {
+            break;
+        }
+        --m_uploadedMipLevel;
+    }
+    m_residentMipLevel = m_uploadedMipLevel;
+
+    std::vector<UploadBatch::ImageLevel> initialLevels(m_mipLevels.begin() + m_uploadedMipLevel, m_mipLevels.end());
+    return batch.upload(m_image, initialLevels)
+        && m_image.createView(format, VK_IMAGE_ASPECT_COLOR_BIT, m_residentMipLevel, mipLevels - m_residentMipLevel, &m_imageView);
+}
+
+bool Texture::streamNextMipLevel(UploadBatch& batch)
+{
+    if (m_uploadedMipLevel == 0)
+    {
+        return true;
+    }
+    --m_uploadedMipLevel;
+    return batch.upload(m_image, {m_mipLevels[m_uploadedMipLevel]});
+}
+
+bool Texture::updateImageView()
+{
+    destroyRetiredImageViews(false);
+    if (m_uploadedMipLevel == m_residentMipLevel)
+    {
+        return true;
+    }
+
+    VkImageView imageView;
+    uint32_t levelCount = m_image.getMipLevels() - m_uploadedMipLevel;
+    if (!m_image.createView(m_format, VK_IMAGE_ASPECT_COLOR_BIT, m_uploadedMipLevel, levelCount, &imageView))
+    {
+        return false;
+    }
+    m_retiredImageViews.emplace_back(m_imageView, API::getFrameNumber());
+    m_imageView = imageView;
+    m_residentMipLevel = m_uploadedMipLevel;
+
+    if (m_residentMipLevel == 0)
+    {
+        m_mipLevels.clear();
+        m_mipLevelData.clear();
+    }
+    return true;
+}
+
+bool Texture::isFullyResident() const
+{
+    return m_residentMipLevel == 0;
 }
 
 VkImageView Texture::getImageView() const
@@ -60,8 +291,26 @@ VkImageView Texture::getImageView() const
     return m_imageView;
 }
 
-bool Texture::load(const std::string& filename, VkFormat format, int desiredChannels)
+bool Texture::load(const unsigned char* data, size_t size, VkFormat format, UploadBatch* batch)
+{
+    TRACE_SCOPE("Texture::load");
+    int texWidth, texHeight, texChannels;
+    stbi_uc* pixels
+        = stbi_load_from_memory(data, static_cast<int>(size), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    if (!pixels)
+    {
+        printError("Failed to load texture from data");
+        return false;
+    }
+
+    Cleaner cleaner([&pixels]() { stbi_image_free(pixels); });
+
+    return createImage(pixels, texWidth, texHeight, format, batch);
+}
+
+bool Texture::load(const std::string& filename, VkFormat format, int desiredChannels, UploadBatch* batch)
 {
+    TRACE_SCOPE("Texture::load");
     int texWidth, texHeight, texChannels;
     stbi_uc* pixels = stbi_load(filename.c_str(), &texWidth, &texHeight, &texChannels, desiredChannels);
     if (!pixels)
@@ -72,48 +321,192 @@ bool Texture::load(const std::string& filename, VkFormat format, int desiredChan
 
     Cleaner cleaner([&pixels]() { stbi_image_free(pixels); });
 
-    return createImage(pixels, texWidth, texHeight, format);
+    return createImage(pixels, texWidth, texHeight, format, batch);
 }
 
-bool Texture::createImage(unsigned char* pixels, int width, int height, VkFormat format)
+bool Texture::createImage(unsigned char* pixels, int width, int height, VkFormat format, UploadBatch* batch)
 {
+    TRACE_SCOPE("Texture::createImage");
     VkDeviceSize imageSize = width * height * 4;
-    Buffer staging;
-    VkBufferUsageFlags bufferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    if (!staging.create(imageSize, bufferUsage, properties))
+    uint32_t w = static_cast<uint32_t>(width);
+    uint32_t h = static_cast<uint32_t>(height);
+
+    // Blits filter on the GPU, formats without linear blit support are downsampled on the CPU if the layout is known
+    bool blitMipmaps = Constants::generateMipmaps && supportsLinearBlit(format);
+    bool cpuMipmaps = Constants::generateMipmaps && !blitMipmaps && isRgba8(format);
+    uint32_t mipLevels = blitMipmaps || cpuMipmaps ? getMipLevelCount(w, h) : 1;
+
+    VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (blitMipmaps)
+    {
+        imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+    if (!m_image.create(w, h, format, 0, imageUsage, 1, mipLevels, VK_SAMPLE_COUNT_1_BIT))
     {
         return false;
     }
+    m_format = format;
 
-    if (!staging.setData<stbi_uc>(imageSize, pixels))
+    if (!m_image.createView(format, VK_IMAGE_ASPECT_COLOR_BIT, &m_imageView))
     {
         return false;
     }
 
-    VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-    if (!m_image.create(width, height, format, 0, imageUsage, 1))
+    std::vector<std::vector<unsigned char>> mipLevelData;
+    std::vector<UploadBatch::ImageLevel> levels = {UploadBatch::ImageLevel{pixels, imageSize, w, h, 0}};
+    if (cpuMipmaps)
+    {
+        buildMipChain(mipLevels, mipLevelData, levels);
+    }
+
+    UploadBatch singleBatch;
+    UploadBatch& uploadBatch = batch != nullptr ? *batch : singleBatch;
+    bool uploaded = blitMipmaps ? uploadBatch.uploadAndGenerateMipmaps(m_image, pixels, imageSize, w, h, mipLevels) : uploadBatch.upload(m_image, levels);
+    return uploaded && (batch != nullptr || singleBatch.flush());
+}
+
+bool Texture::loadCompressed(const std::string& filename, Compression compression, bool srgb, UploadBatch* batch)
+{
+    TRACE_SCOPE("Texture::loadCompressed");
+    VkFormat format = getCompressedFormat(compression, srgb);
+    VkFormat uncompressedFormat = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    if (!supportsSampling(format))
     {
+        printWarning("Block compressed format is not supported, loading uncompressed: " + filename);
+        return load(filename, uncompressedFormat, STBI_rgb_alpha, batch);
+    }
+
+    TextureCache::CompressedImage image;
+    if (!TextureCache::load(filename, format, image))
+    {
+        if (!BlockCompression::canEncode(format))
+        {
+            // The cache was made by an offline tool and has no source hash, it is used as is
+            std::string cacheFilename = TextureCache::getCacheFilename(filename, format);
+            if (!TextureCache::loadDds(cacheFilename, image) || image.format != format)
+            {
+                printWarning("No cached texture for a format that is not encoded, loading uncompressed: " + cacheFilename);
+                return load(filename, uncompressedFormat, STBI_rgb_alpha, batch);
+            }
+            return createCompressedImage(image, batch);
+        }
+        if (!encodeCompressed(filename, format, image))
+        {
+            return false;
+        }
+        TextureCache::save(filename, image);
+    }
+    return createCompressedImage(image, batch);
+}
+
+bool Texture::loadDds(const std::string& filename, UploadBatch* batch)
+{
+    TRACE_SCOPE("Texture::loadDds");
+    TextureCache::CompressedImage image;
+    if (!TextureCache::loadDds(filename, image))
+    {
+        return false;
+    }
+    if (!supportsSampling(image.format))
+    {
+        printError("Block compressed format of the DDS file is not supported: " + filename);
         return false;
     }
+    return createCompressedImage(image, batch);
+}
 
-    if (!m_image.transitLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL))
+bool Texture::encodeCompressed(const std::string& filename, VkFormat format, TextureCache::CompressedImage& image)
+{
+    int texWidth, texHeight, texChannels;
+    stbi_uc* pixels = stbi_load(filename.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    if (!pixels)
     {
+        printError("Failed to load texture image: " + filename);
         return false;
     }
 
-    staging.copyToImage(m_image.getHandle(), static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+    Cleaner cleaner([&pixels]() { stbi_image_free(pixels); });
+
+    uint32_t width = static_cast<uint32_t>(texWidth);
+    uint32_t height = static_cast<uint32_t>(texHeight);
+    VkDeviceSize imageSize = static_cast<VkDeviceSize>(width) * height * 4;
+    std::vector<std::vector<unsigned char>> mipLevelData;
+    std::vector<UploadBatch::ImageLevel> levels = {UploadBatch::ImageLevel{pixels, imageSize, width, height, 0}};
+    buildMipChain(getMipLevelCount(width, height), mipLevelData, levels);
+
+    image.format = format;
+    image.levels.clear();
+    size_t dataSize = 0;
+    for (const UploadBatch::ImageLevel& level : levels)
+    {
+        TextureCache::Level compressedLevel;
+        compressedLevel.width = level.width;
+        compressedLevel.height = level.height;
+        compressedLevel.offset = dataSize;
+        compressedLevel.size = BlockCompression::getLevelSize(format, level.width, level.height);
+        dataSize += compressedLevel.size;
+        image.levels.push_back(compressedLevel);
+    }
+    image.data.resize(dataSize);
+
+    ThreadPool& threadPool = getEncodeThreadPool();
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        const unsigned char* levelPixels = static_cast<const unsigned char*>(levels[i].data);
+        BlockCompression::compress(levelPixels, levels[i].width, levels[i].height, format, image.data.data() + image.levels[i].offset, &threadPool);
+    }
+
+    // The first level is decoded again to report how much the encoder lost
+    std::vector<unsigned char> decoded(static_cast<size_t>(imageSize));
+    BlockCompression::decompress(image.data.data(), width, height, format, decoded.data());
+    double psnr = BlockCompression::getPsnr(pixels, decoded.data(), width, height, format);
+    printLog("Compressed texture " + filename + ", PSNR " + std::to_string(psnr) + " dB");
+    return true;
+}
 
-    if (!m_image.transitLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL))
+bool Texture::createCompressedImage(const TextureCache::CompressedImage& image, UploadBatch* batch)
+{
+    const TextureCache::Level& base = image.levels[0];
+    VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (!m_image.create(base.width, base.height, image.format, 0, imageUsage, 1, ui32size(image.levels), VK_SAMPLE_COUNT_1_BIT))
     {
         return false;
     }
+    m_format = image.format;
 
-    if (!m_image.createView(format, VK_IMAGE_ASPECT_COLOR_BIT, &m_imageView))
+    if (!m_image.createView(image.format, VK_IMAGE_ASPECT_COLOR_BIT, &m_imageView))
     {
         return false;
     }
-    return true;
+
+    std::vector<UploadBatch::ImageLevel> levels;
+    for (uint32_t i = 0; i < ui32size(image.levels); ++i)
+    {
+        const TextureCache::Level& level = image.levels[i];
+        levels.push_back(UploadBatch::ImageLevel{image.data.data() + level.offset, level.size, level.width, level.height, i});
+    }
+
+    UploadBatch singleBatch;
+    UploadBatch& uploadBatch = batch != nullptr ? *batch : singleBatch;
+    return uploadBatch.upload(m_image, levels) && (batch != nullptr || singleBatch.flush());
+}
+
+void Texture::destroyRetiredImageViews(bool all)
+{
+    uint64_t frameNumber = API::getFrameNumber();
+    auto it = m_retiredImageViews.begin();
+    while (it != m_retiredImageViews.end())
+    {
+        if (all || frameNumber >= it->second + Constants::maxFramesInFlight)
+        {
+            vkDestroyImageView(Context::getLogicalDevice(), it->first, nullptr);
+            it = m_retiredImageViews.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
 }
 
 } // namespace fw
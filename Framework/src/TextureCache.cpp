@@ -0,0 +1,313 @@
+#include "TextureCache.h"
+#include "BlockCompression.h"
+#include "Common.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <utility>
+
+namespace fw
+{
+namespace
+{
+const uint32_t c_ddsMagic = 0x20534444; // "DDS "
+const uint32_t c_dx10FourCC = 0x30315844; // "DX10"
+const uint32_t c_dxt1FourCC = 0x31545844; // "DXT1"
+const uint32_t c_dxt5FourCC = 0x35545844; // "DXT5"
+const uint32_t c_ati2FourCC = 0x32495441; // "ATI2"
+const uint32_t c_cacheTag = 0x4B56594D; // "MYVK", marks the reserved words as ours
+// Increment when the encoder changes so that old caches are rebuilt
+const uint32_t c_cacheVersion = 1;
+
+const uint32_t c_ddsdCaps = 0x1;
+const uint32_t c_ddsdHeight = 0x2;
+const uint32_t c_ddsdWidth = 0x4;
+const uint32_t c_ddsdPixelFormat = 0x1000;
+const uint32_t c_ddsdMipMapCount = 0x20000;
+const uint32_t c_ddsdLinearSize = 0x80000;
+const uint32_t c_ddpfFourCC = 0x4;
+const uint32_t c_ddsCapsComplex = 0x8;
+const uint32_t c_ddsCapsTexture = 0x1000;
+const uint32_t c_ddsCapsMipMap = 0x400000;
+const uint32_t c_dimensionTexture2D = 3;
+
+struct DdsPixelFormat
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask;
+    uint32_t gBitMask;
+    uint32_t bBitMask;
+    uint32_t aBitMask;
+};
+
+struct DdsHeader
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    // [0] tag, [1] version, [2] and [3] the source hash
+    uint32_t reserved1[11];
+    DdsPixelFormat pixelFormat;
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+struct DdsHeaderDx10
+{
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+struct FormatMapping
+{
+    uint32_t dxgiFormat;
+    VkFormat format;
+};
+
+const FormatMapping c_formatMappings[] = {
+    {71, VK_FORMAT_BC1_RGBA_UNORM_BLOCK},
+    {72, VK_FORMAT_BC1_RGBA_SRGB_BLOCK},
+    {77, VK_FORMAT_BC3_UNORM_BLOCK},
+    {78, VK_FORMAT_BC3_SRGB_BLOCK},
+    {83, VK_FORMAT_BC5_UNORM_BLOCK},
+    {98, VK_FORMAT_BC7_UNORM_BLOCK},
+    {99, VK_FORMAT_BC7_SRGB_BLOCK}};
+
+VkFormat getFormat(uint32_t dxgiFormat)
+{
+    for (const FormatMapping& mapping : c_formatMappings)
+    {
+        if (mapping.dxgiFormat == dxgiFormat)
+        {
+            return mapping.format;
+        }
+    }
+    return VK_FORMAT_UNDEFINED;
+}
+
+uint32_t getDxgiFormat(VkFormat format)
+{
+    for (const FormatMapping& mapping : c_formatMappings)
+    {
+        if (mapping.format == format)
+        {
+            return mapping.dxgiFormat;
+        }
+    }
+    return 0;
+}
+
+VkFormat getLegacyFormat(uint32_t fourCC)
+{
+    switch (fourCC)
+    {
+    case c_dxt1FourCC:
+        return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case c_dxt5FourCC:
+        return VK_FORMAT_BC3_UNORM_BLOCK;
+    case c_ati2FourCC:
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+    default:
+        return VK_FORMAT_UNDEFINED;
+    }
+}
+
+const char* getSuffix(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        return ".bc1.dds";
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        return ".bc1_srgb.dds";
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+        return ".bc3.dds";
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        return ".bc3_srgb.dds";
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+        return ".bc5.dds";
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+        return ".bc7.dds";
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return ".bc7_srgb.dds";
+    default:
+        return ".dds";
+    }
+}
+
+bool parseDds(const unsigned char* data, size_t size, DdsHeader& header, TextureCache::CompressedImage& image)
+{
+    if (size < sizeof(uint32_t) + sizeof(DdsHeader))
+    {
+        return false;
+    }
+    uint32_t magic;
+    std::memcpy(&magic, data, sizeof(magic));
+    std::memcpy(&header, data + sizeof(magic), sizeof(header));
+    size_t offset = sizeof(magic) + sizeof(header);
+    if (magic != c_ddsMagic || header.size != sizeof(DdsHeader) || !(header.pixelFormat.flags & c_ddpfFourCC))
+    {
+        return false;
+    }
+
+    VkFormat format = getLegacyFormat(header.pixelFormat.fourCC);
+    if (header.pixelFormat.fourCC == c_dx10FourCC)
+    {
+        DdsHeaderDx10 headerDx10;
+        if (size < offset + sizeof(headerDx10))
+        {
+            return false;
+        }
+        std::memcpy(&headerDx10, data + offset, sizeof(headerDx10));
+        offset += sizeof(headerDx10);
+        if (headerDx10.resourceDimension != c_dimensionTexture2D || headerDx10.arraySize > 1)
+        {
+            return false;
+        }
+        format = getFormat(headerDx10.dxgiFormat);
+    }
+    // A larger count would loop over the 1x1 level until the data runs out
+    if (format == VK_FORMAT_UNDEFINED || header.width == 0 || header.height == 0
+        || header.mipMapCount > getMipLevelCount(header.width, header.height))
+    {
+        return false;
+    }
+
+    image.format = format;
+    image.levels.clear();
+    uint32_t mipLevels = std::max(header.mipMapCount, 1u);
+    uint32_t width = header.width;
+    uint32_t height = header.height;
+    size_t dataSize = 0;
+    for (uint32_t i = 0; i < mipLevels; ++i)
+    {
+        TextureCache::Level level;
+        level.width = width;
+        level.height = height;
+        level.offset = dataSize;
+        level.size = BlockCompression::getLevelSize(format, width, height);
+        dataSize += level.size;
+        image.levels.push_back(level);
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    if (size - offset < dataSize)
+    {
+        return false;
+    }
+    image.data.assign(data + offset, data + offset + dataSize);
+    return true;
+}
+
+} // unnamed
+
+std::string TextureCache::getCacheFilename(const std::string& file, VkFormat format)
+{
+    return file + getSuffix(format);
+}
+
+bool TextureCache::load(const std::string& file, VkFormat format, CompressedImage& image)
+{
+    MappedFile cache;
+    if (!cache.open(getCacheFilename(file, format)))
+    {
+        return false;
+    }
+
+    DdsHeader header;
+    CompressedImage cachedImage;
+    if (!parseDds(cache.getData(), cache.getSize(), header, cachedImage) || cachedImage.format != format
+        || header.reserved1[0] != c_cacheTag || header.reserved1[1] != c_cacheVersion)
+    {
+        return false;
+    }
+
+    uint64_t sourceHash = 0;
+    if (!hashFile(file, sourceHash) || header.reserved1[2] != static_cast<uint32_t>(sourceHash)
+        || header.reserved1[3] != static_cast<uint32_t>(sourceHash >> 32))
+    {
+        return false;
+    }
+
+    image = std::move(cachedImage);
+    return true;
+}
+
+bool TextureCache::save(const std::string& file, const CompressedImage& image)
+{
+    uint32_t dxgiFormat = getDxgiFormat(image.format);
+    if (dxgiFormat == 0 || image.levels.empty())
+    {
+        printWarning("Unable to cache a texture of an unsupported format: " + file);
+        return false;
+    }
+
+    uint64_t sourceHash = 0;
+    if (!hashFile(file, sourceHash))
+    {
+        return false;
+    }
+
+    DdsHeader header{};
+    header.size = sizeof(DdsHeader);
+    header.flags = c_ddsdCaps | c_ddsdHeight | c_ddsdWidth | c_ddsdPixelFormat | c_ddsdMipMapCount | c_ddsdLinearSize;
+    header.height = image.levels[0].height;
+    header.width = image.levels[0].width;
+    header.pitchOrLinearSize = static_cast<uint32_t>(image.levels[0].size);
+    header.mipMapCount = ui32size(image.levels);
+    header.reserved1[0] = c_cacheTag;
+    header.reserved1[1] = c_cacheVersion;
+    header.reserved1[2] = static_cast<uint32_t>(sourceHash);
+    header.reserved1[3] = static_cast<uint32_t>(sourceHash >> 32);
+    header.pixelFormat.size = sizeof(DdsPixelFormat);
+    header.pixelFormat.flags = c_ddpfFourCC;
+    header.pixelFormat.fourCC = c_dx10FourCC;
+    header.caps = c_ddsCapsTexture | (image.levels.size() > 1 ? c_ddsCapsComplex | c_ddsCapsMipMap : 0);
+
+    DdsHeaderDx10 headerDx10{};
+    headerDx10.dxgiFormat = dxgiFormat;
+    headerDx10.resourceDimension = c_dimensionTexture2D;
+    headerDx10.arraySize = 1;
+
+    return writeFileAtomically(getCacheFilename(file, image.format), "texture cache", [&](std::ostream& cache) {
+        cache.write(reinterpret_cast<const char*>(&c_ddsMagic), sizeof(c_ddsMagic));
+        cache.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        cache.write(reinterpret_cast<const char*>(&headerDx10), sizeof(headerDx10));
+        cache.write(reinterpret_cast<const char*>(image.data.data()), static_cast<std::streamsize>(image.data.size()));
+    });
+}
+
+bool TextureCache::loadDds(const std::string& filename, CompressedImage& image)
+{
+    MappedFile file;
+    if (!file.open(filename))
+    {
+        printError("Failed to open DDS file: " + filename);
+        return false;
+    }
+
+    DdsHeader header;
+    if (!parseDds(file.getData(), file.getSize(), header, image))
+    {
+        printError("Unsupported or corrupted DDS file: " + filename);
+        return false;
+    }
+    return true;
+}
+
+} // namespace fw
@@ -0,0 +1,139 @@
+#include "TextureLoader.h"
+#include "Common.h"
+#include "UploadBatch.h"
+
+#ifndef WIN32
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wimplicit-fallthrough"
+#pragma GCC diagnostic ignored "-Wdouble-promotion"
+#pragma GCC diagnostic ignored "-Wduplicated-branches"
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+#include <stb_image.h>
+#ifndef WIN32
+#pragma GCC diagnostic pop
+#endif
+
+#include <utility>
+
+namespace fw
+{
+TextureLoader::TextureLoader(uint32_t threadCount) :
+    m_threadPool(threadCount)
+{
+}
+
+TextureLoader::~TextureLoader()
+{
+    m_threadPool.wait();
+    for (const std::unique_ptr<Request>& request : m_requests)
+    {
+        if (request->pixels != nullptr)
+        {
+            stbi_image_free(request->pixels);
+        }
+    }
+}
+
+TextureLoader::Handle TextureLoader::add(Texture& texture, const std::string& filename, VkFormat format)
+{
+    auto request = std::make_unique<Request>();
+    request->texture = &texture;
+    request->filename = filename;
+    request->format = format;
+    return add(std::move(request));
+}
+
+TextureLoader::Handle TextureLoader::add(Texture& texture, const unsigned char* data, size_t size, VkFormat format)
+{
+    auto request = std::make_unique<Request>();
+    request->texture = &texture;
+    request->data = data;
+    request->size = size;
+    request->format = format;
+    return add(std::move(request));
+}
+
+bool TextureLoader::wait()
+{
+    UploadBatch batch;
+    bool success = true;
+
+    // Images are created in the order the decodes finish so that the main thread works while the rest are decoded
+    size_t pendingCount = m_requests.size() - m_firstPending;
+    for (size_t i = 0; i < pendingCount; ++i)
+    {
+        Request* request = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_requestDecoded.wait(lock, [this]() { return !m_decodedRequests.empty(); });
+            request = m_decodedRequests.front();
+            m_decodedRequests.pop();
+        }
+
+        if (request->pixels == nullptr)
+        {
+            printError(request->data != nullptr ? "Failed to load texture from data" : "Failed to load texture image: " + request->filename);
+            success = false;
+            continue;
+        }
+
+        request->loaded = request->texture->createImage(request->pixels, request->width, request->height, request->format, &batch);
+        success = success && request->loaded;
+
+        stbi_image_free(request->pixels);
+        request->pixels = nullptr;
+    }
+
+    if (!batch.flush())
+    {
+        for (size_t i = m_firstPending; i < m_requests.size(); ++i)
+        {
+            m_requests[i]->loaded = false;
+        }
+        success = false;
+    }
+    m_firstPending = m_requests.size();
+    return success;
+}
+
+bool TextureLoader::isLoaded(Handle handle) const
+{
+    return handle < m_requests.size() && m_requests[handle]->loaded;
+}
+
+uint32_t TextureLoader::getThreadCount() const
+{
+    return m_threadPool.getThreadCount();
+}
+
+TextureLoader::Handle TextureLoader::add(std::unique_ptr<Request> request)
+{
+    Request* decodedRequest = request.get();
+    Handle handle = ui32size(m_requests);
+    m_requests.push_back(std::move(request));
+    m_threadPool.enqueue([this, decodedRequest](uint32_t) { decode(*decodedRequest); });
+    return handle;
+}
+
+void TextureLoader::decode(Request& request)
+{
+    int channels;
+    if (request.data != nullptr)
+    {
+        request.pixels = stbi_load_from_memory(request.data, static_cast<int>(request.size), &request.width, &request.height, &channels, STBI_rgb_alpha);
+    }
+    else
+    {
+        request.pixels = stbi_load(request.filename.c_str(), &request.width, &request.height, &channels, STBI_rgb_alpha);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_decodedRequests.push(&request);
+    }
+    m_requestDecoded.notify_one();
+}
+
+} // namespace fw
@@ -0,0 +1,117 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <string>
+
+namespace fw
+{
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    m_threads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        m_threads.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_jobAvailable.notify_all();
+    for (std::thread& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+uint32_t ThreadPool::getThreadCount() const
+{
+    return static_cast<uint32_t>(m_threads.size());
+}
+
+void ThreadPool::enqueue(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push(std::move(job));
+        ++m_activeJobs;
+    }
+    m_jobAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobsDone.wait(lock, [this]() { return m_activeJobs == 0; });
+}
+
+void ThreadPool::parallelFor(size_t count, const RangeJob& job, uint32_t rangeCount)
+{
+    if (rangeCount == 0)
+    {
+        rangeCount = getThreadCount();
+    }
+    size_t ranges = std::min(count, static_cast<size_t>(rangeCount));
+    if (ranges == 0)
+    {
+        return;
+    }
+
+    // The first count % ranges ranges get one extra element
+    size_t rangeSize = count / ranges;
+    size_t remainder = count % ranges;
+    size_t begin = 0;
+    for (size_t i = 0; i < ranges; ++i)
+    {
+        size_t end = begin + rangeSize + (i < remainder ? 1 : 0);
+        enqueue([&job, begin, end](uint32_t threadIndex) { job(begin, end, threadIndex); });
+        begin = end;
+    }
+    wait();
+}
+
+void ThreadPool::work(uint32_t threadIndex)
+{
+    TRACE_THREAD_NAME("Worker " + std::to_string(threadIndex));
+
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAvailable.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+            if (m_stop && m_jobs.empty())
+            {
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop();
+        }
+
+        {
+            TRACE_SCOPE("ThreadPool job");
+            job(threadIndex);
+        }
+
+        bool done = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            done = --m_activeJobs == 0;
+        }
+        if (done)
+        {
+            m_jobsDone.notify_all();
+        }
+    }
+}
+
+} // namespace fw
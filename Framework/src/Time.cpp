@@ -1,24 +1,161 @@
 #include "Time.h"
 
-#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cmath>
+#include <thread>
 
 namespace fw
 {
+namespace
+{
+const int64_t c_nanosecondsPerSecond = 1000000000;
+// A long hitch drops the time beyond this instead of simulating a burst of steps
+const int64_t c_maxFixedStepsPerFrame = 8;
+const std::chrono::milliseconds c_sleepStep(1);
+
+int64_t toNanoseconds(double seconds)
+{
+    return seconds > 0.0 ? static_cast<int64_t>(std::llround(seconds * static_cast<double>(c_nanosecondsPerSecond))) : 0;
+}
+
+double toSeconds(int64_t nanoseconds)
+{
+    return static_cast<double>(nanoseconds) / static_cast<double>(c_nanosecondsPerSecond);
+}
+
+} // unnamed
+
+Time::Time() :
+    m_start(std::chrono::steady_clock::now())
+{
+}
+
+void Time::setDeterministicDelta(double seconds)
+{
+    m_deterministicDelta = toNanoseconds(seconds);
+}
+
+void Time::setFixedTimestep(double seconds)
+{
+    m_fixedTimestep = toNanoseconds(seconds);
+    m_accumulator = 0;
+    m_fixedStepCount = 0;
+}
+
+void Time::setFrameRateLimit(double framesPerSecond)
+{
+    m_framePeriod = framesPerSecond > 0.0 ? toNanoseconds(1.0 / framesPerSecond) : 0;
+    m_nextFrame = 0;
+}
+
 void Time::update()
 {
-    float t = static_cast<float>(glfwGetTime());
-    m_delta = t - m_sinceStart;
-    m_sinceStart = t;
+    // Not using glfwGetTime so that the clock works also without a window
+    int64_t now = m_deterministicDelta > 0 ? m_sinceStart + m_deterministicDelta : getElapsed();
+    m_delta = now - m_sinceStart;
+    m_sinceStart = now;
+
+    if (m_fixedTimestep > 0)
+    {
+        m_accumulator += m_delta;
+        m_fixedStepCount = static_cast<uint32_t>(std::min(m_accumulator / m_fixedTimestep, c_maxFixedStepsPerFrame));
+        m_accumulator = std::min(m_accumulator - m_fixedStepCount * m_fixedTimestep, m_fixedTimestep - 1);
+    }
+}
+
+void Time::waitForNextFrame()
+{
+    if (m_framePeriod == 0)
+    {
+        return;
+    }
+
+    // The targets advance by whole periods so that the pacing does not drift, a frame that is far behind starts over
+    int64_t now = getElapsed();
+    if (m_nextFrame == 0 || now - m_nextFrame > m_framePeriod)
+    {
+        m_nextFrame = now;
+    }
+    m_nextFrame += m_framePeriod;
+    sleepUntil(m_nextFrame);
 }
 
 float Time::getSinceStart() const
 {
-    return m_sinceStart;
+    return static_cast<float>(getSinceStartSeconds());
 }
 
 float Time::getDelta() const
+{
+    return static_cast<float>(getDeltaSeconds());
+}
+
+double Time::getSinceStartSeconds() const
+{
+    return toSeconds(m_sinceStart);
+}
+
+double Time::getDeltaSeconds() const
+{
+    return toSeconds(m_delta);
+}
+
+int64_t Time::getSinceStartNanoseconds() const
+{
+    return m_sinceStart;
+}
+
+int64_t Time::getDeltaNanoseconds() const
 {
     return m_delta;
 }
 
+uint32_t Time::getFixedStepCount() const
+{
+    return m_fixedStepCount;
+}
+
+double Time::getFixedTimestep() const
+{
+    return toSeconds(m_fixedTimestep);
+}
+
+double Time::getFixedStepAlpha() const
+{
+    return m_fixedTimestep > 0 ? static_cast<double>(m_accumulator) / static_cast<double>(m_fixedTimestep) : 0.0;
+}
+
+int64_t Time::getElapsed() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+void Time::sleepUntil(int64_t target)
+{
+    // Short sleeps overshoot by a varying amount, keep sleeping while the time left is longer than a pessimistic
+    // estimate of a sleep and yield for the rest
+    while (true)
+    {
+        double estimate = m_sleepMean + std::sqrt(m_sleepM2 / static_cast<double>(m_sleepCount));
+        int64_t start = getElapsed();
+        if (static_cast<double>(target - start) <= estimate)
+        {
+            break;
+        }
+
+        std::this_thread::sleep_for(c_sleepStep);
+
+        double observed = static_cast<double>(getElapsed() - start);
+        ++m_sleepCount;
+        double difference = observed - m_sleepMean;
+        m_sleepMean += difference / static_cast<double>(m_sleepCount);
+        m_sleepM2 += difference * (observed - m_sleepMean);
+    }
+
+    while (getElapsed() < target)
+    {
+        std::this_thread::yield();
+    }
+}
+
 } // namespace fw
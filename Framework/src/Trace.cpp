@@ -0,0 +1,181 @@
+#include "Trace.h"
+#include "Common.h"
+
+#include <chrono>
+#include <fstream>
+
+namespace fw
+{
+std::mutex Trace::s_mutex;
+std::vector<std::unique_ptr<Trace::ThreadBuffer>> Trace::s_threadBuffers;
+std::vector<Trace::ThreadBuffer*> Trace::s_freeThreadBuffers;
+std::deque<Trace::RetiredThread> Trace::s_retiredThreads;
+size_t Trace::s_retiredEventCount = 0;
+uint32_t Trace::s_nextThreadId = 0;
+
+namespace
+{
+const size_t c_eventsPerThread = 1 << 16;
+// The oldest finished threads are dropped past this
+const size_t c_maxRetiredEvents = 1 << 20;
+} // unnamed
+
+Trace::Scope::Scope(const char* name) :
+    m_name(name),
+    m_start(now())
+{
+}
+
+Trace::Scope::~Scope()
+{
+    uint64_t end = now();
+    ThreadBuffer& buffer = getThreadBuffer();
+
+    // Only this thread writes to the buffer, the count tells the writer of the trace which events are complete
+    uint64_t count = buffer.count.load(std::memory_order_relaxed);
+    Event& event = buffer.events[count % c_eventsPerThread];
+    event.name = m_name;
+    event.startNs = m_start;
+    event.durationNs = end - m_start;
+    buffer.count.store(count + 1, std::memory_order_release);
+}
+
+void Trace::setThreadName(const std::string& name)
+{
+    ThreadBuffer& buffer = getThreadBuffer();
+    std::lock_guard<std::mutex> lock(s_mutex);
+    buffer.name = name;
+}
+
+bool Trace::write(const std::string& filename)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    bool hasEvents = s_retiredEventCount > 0;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : s_threadBuffers)
+    {
+        hasEvents = hasEvents || (buffer->inUse && buffer->count.load(std::memory_order_acquire) > 0);
+    }
+    if (!hasEvents)
+    {
+        return true;
+    }
+
+    std::ofstream file(filename, std::ios::trunc);
+    if (!file)
+    {
+        printError("Failed to open file " + filename);
+        return false;
+    }
+
+    file << "{\"traceEvents\":[";
+    const char* separator = "\n";
+    for (const RetiredThread& thread : s_retiredThreads)
+    {
+        writeThread(file, thread.threadId, thread.name, thread.events, 0, thread.events.size(), separator);
+    }
+    for (const std::unique_ptr<ThreadBuffer>& buffer : s_threadBuffers)
+    {
+        if (buffer->inUse)
+        {
+            uint64_t count = buffer->count.load(std::memory_order_acquire);
+            uint64_t first = count > c_eventsPerThread ? count - c_eventsPerThread : 0;
+            writeThread(file, buffer->threadId, buffer->name, buffer->events, first, count, separator);
+        }
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    if (!file)
+    {
+        printError("Failed to write file " + filename);
+        return false;
+    }
+    printLog("Wrote CPU trace to " + filename);
+    return true;
+}
+
+uint64_t Trace::now()
+{
+    // Relative to the first call so that the trace starts close to zero
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+Trace::ThreadBuffer& Trace::getThreadBuffer()
+{
+    thread_local ThreadBufferOwner owner;
+    if (owner.buffer == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if (s_freeThreadBuffers.empty())
+        {
+            auto buffer = std::make_unique<ThreadBuffer>();
+            buffer->events.resize(c_eventsPerThread);
+            s_freeThreadBuffers.push_back(buffer.get());
+            s_threadBuffers.push_back(std::move(buffer));
+        }
+        owner.buffer = s_freeThreadBuffers.back();
+        s_freeThreadBuffers.pop_back();
+        owner.buffer->threadId = s_nextThreadId++;
+        owner.buffer->inUse = true;
+    }
+    return *owner.buffer;
+}
+
+Trace::ThreadBufferOwner::~ThreadBufferOwner()
+{
+    if (buffer != nullptr)
+    {
+        releaseThreadBuffer(*buffer);
+    }
+}
+
+void Trace::releaseThreadBuffer(ThreadBuffer& buffer)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    uint64_t count = buffer.count.load(std::memory_order_relaxed);
+    if (count > 0)
+    {
+        RetiredThread thread;
+        thread.threadId = buffer.threadId;
+        thread.name = buffer.name;
+        uint64_t first = count > c_eventsPerThread ? count - c_eventsPerThread : 0;
+        thread.events.reserve(static_cast<size_t>(count - first));
+        for (uint64_t i = first; i < count; ++i)
+        {
+            thread.events.push_back(buffer.events[i % c_eventsPerThread]);
+        }
+        s_retiredEventCount += thread.events.size();
+        s_retiredThreads.push_back(std::move(thread));
+
+        while (s_retiredEventCount > c_maxRetiredEvents)
+        {
+            s_retiredEventCount -= s_retiredThreads.front().events.size();
+            s_retiredThreads.pop_front();
+        }
+    }
+
+    buffer.name.clear();
+    buffer.count.store(0, std::memory_order_relaxed);
+    buffer.inUse = false;
+    s_freeThreadBuffers.push_back(&buffer);
+}
+
+void Trace::writeThread(std::ostream& file, uint32_t threadId, const std::string& name, const std::vector<Event>& events, uint64_t first, uint64_t count, const char*& separator)
+{
+    std::string threadName = name.empty() ? "Thread " + std::to_string(threadId) : name;
+    file << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << threadId
+         << ",\"args\":{\"name\":\"" << escapeJSON(threadName) << "\"}}";
+    separator = ",\n";
+
+    for (uint64_t i = first; i < count; ++i)
+    {
+        const Event& event = events[i % events.size()];
+        // Microseconds with nanosecond decimals
+        file << ",\n{\"name\":\"" << escapeJSON(event.name) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << threadId
+             << ",\"ts\":" << event.startNs / 1000 << '.' << std::to_string(1000 + event.startNs % 1000).substr(1)
+             << ",\"dur\":" << event.durationNs / 1000 << '.' << std::to_string(1000 + event.durationNs % 1000).substr(1) << "}";
+    }
+}
+
+} // namespace fw
@@ -0,0 +1,527 @@
+#include "UploadBatch.h"
+#include "Command.h"
+#include "Common.h"
+#include "Constants.h"
+#include "Context.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace fw
+{
+namespace
+{
+// Satisfies the buffer offset rules of buffer to image copies for all uncompressed formats
+const VkDeviceSize c_stagingAlignment = 16;
+
+VkImageMemoryBarrier getImageBarrier(VkImage image, uint32_t baseMipLevel, uint32_t levelCount)
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = baseMipLevel;
+    barrier.subresourceRange.levelCount = levelCount;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    return barrier;
+}
+
+} // unnamed
+
+UploadBatch::~UploadBatch()
+{
+    if (m_recording)
+    {
+        printWarning("Upload batch destroyed before submitting, flushing it");
+    }
+    flush();
+
+    if (m_logicalDevice == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    vkDestroyFence(m_logicalDevice, m_fence, nullptr);
+    vkDestroySemaphore(m_logicalDevice, m_transferFinished, nullptr);
+    vkDestroyCommandPool(m_logicalDevice, m_graphicsCommandPool, nullptr);
+    vkDestroyCommandPool(m_logicalDevice, m_transferCommandPool, nullptr);
+}
+
+bool UploadBatch::upload(Buffer& dst, const void* data, VkDeviceSize size)
+{
+    void* stagingData = allocate(dst, size);
+    if (stagingData == nullptr)
+    {
+        return false;
+    }
+    std::memcpy(stagingData, data, static_cast<size_t>(size));
+    return true;
+}
+
+void* UploadBatch::allocate(Buffer& dst, VkDeviceSize size)
+{
+    if (!m_recording && !begin())
+    {
+        return nullptr;
+    }
+
+    VkBuffer stagingBuffer;
+    VkDeviceSize stagingOffset;
+    void* stagingData = stage(size, stagingBuffer, stagingOffset);
+    if (stagingData == nullptr)
+    {
+        return nullptr;
+    }
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = stagingOffset;
+    copyRegion.dstOffset = 0;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(m_transferCommandBuffer, stagingBuffer, dst.getBuffer(), 1, &copyRegion);
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    barrier.srcQueueFamilyIndex = m_ownershipTransfer ? m_transferFamily : VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = m_ownershipTransfer ? m_graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = dst.getBuffer();
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    m_bufferBarriers.push_back(barrier);
+
+    return stagingData;
+}
+
+bool UploadBatch::upload(Image& dst, const void* data, VkDeviceSize size, uint32_t width, uint32_t height)
+{
+    return upload(dst, {ImageLevel{data, size, width, height, 0}});
+}
+
+bool UploadBatch::upload(Image& dst, const std::vector<ImageLevel>& levels)
+{
+    for (const ImageLevel& level : levels)
+    {
+        if (!copyToLevel(dst, level))
+        {
+            return false;
+        }
+        addReleaseBarrier(dst, level.mipLevel, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
+    }
+    dst.m_uploadedMipLevels += ui32size(levels);
+    m_images.push_back(&dst);
+    return true;
+}
+
+bool UploadBatch::uploadAndGenerateMipmaps(Image& dst, const void* data, VkDeviceSize size, uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+    if (!copyToLevel(dst, ImageLevel{data, size, width, height, 0}))
+    {
+        return false;
+    }
+    // The first level is handed over as the source of the first blit
+    addReleaseBarrier(dst, 0, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT);
+    m_mipmapGenerations.push_back(MipmapGeneration{dst.getHandle(), width, height, mipLevels});
+    dst.m_uploadedMipLevels += mipLevels;
+    m_images.push_back(&dst);
+    return true;
+}
+
+bool UploadBatch::submit()
+{
+    if (!m_recording)
+    {
+        return true;
+    }
+    m_recording = false;
+
+    // Without an ownership transfer the release barriers alone make the copies visible to all later work
+    VkPipelineStageFlags releaseDstStage = m_ownershipTransfer ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    std::vector<VkBufferMemoryBarrier> bufferReleases = m_bufferBarriers;
+    std::vector<VkImageMemoryBarrier> imageReleases = m_imageBarriers;
+    if (m_ownershipTransfer)
+    {
+        for (VkBufferMemoryBarrier& barrier : bufferReleases)
+        {
+            barrier.dstAccessMask = 0;
+        }
+        for (VkImageMemoryBarrier& barrier : imageReleases)
+        {
+            barrier.dstAccessMask = 0;
+        }
+    }
+    vkCmdPipelineBarrier(m_transferCommandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         releaseDstStage,
+                         0,
+                         0,
+                         nullptr,
+                         ui32size(bufferReleases),
+                         bufferReleases.data(),
+                         ui32size(imageReleases),
+                         imageReleases.data());
+
+    // Blits need a graphics queue, without an ownership transfer the transfer queue is one
+    if (!m_ownershipTransfer)
+    {
+        recordMipmapGenerations(m_transferCommandBuffer);
+    }
+
+    if (VkResult r = vkEndCommandBuffer(m_transferCommandBuffer); r != VK_SUCCESS)
+    {
+        printError("Failed to end upload command buffer", &r);
+        return false;
+    }
+
+    VkSubmitInfo transferSubmit{};
+    transferSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    transferSubmit.commandBufferCount = 1;
+    transferSubmit.pCommandBuffers = &m_transferCommandBuffer;
+
+    if (!m_ownershipTransfer)
+    {
+        if (VkResult r = vkQueueSubmit(Context::getTransferQueue(), 1, &transferSubmit, m_fence); r != VK_SUCCESS)
+        {
+            printError("Failed to submit uploads", &r);
+            return false;
+        }
+    }
+    else
+    {
+        // The graphics queue acquires what the transfer queue released
+        for (VkBufferMemoryBarrier& barrier : m_bufferBarriers)
+        {
+            barrier.srcAccessMask = 0;
+        }
+        for (VkImageMemoryBarrier& barrier : m_imageBarriers)
+        {
+            barrier.srcAccessMask = 0;
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(m_graphicsCommandBuffer, &beginInfo);
+        vkCmdPipelineBarrier(m_graphicsCommandBuffer,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             ui32size(m_bufferBarriers),
+                             m_bufferBarriers.data(),
+                             ui32size(m_imageBarriers),
+                             m_imageBarriers.data());
+        recordMipmapGenerations(m_graphicsCommandBuffer);
+        if (VkResult r = vkEndCommandBuffer(m_graphicsCommandBuffer); r != VK_SUCCESS)
+        {
+            printError("Failed to end upload acquire command buffer", &r);
+            return false;
+        }
+
+        transferSubmit.signalSemaphoreCount = 1;
+        transferSubmit.pSignalSemaphores = &m_transferFinished;
+        if (VkResult r = vkQueueSubmit(Context::getTransferQueue(), 1, &transferSubmit, VK_NULL_HANDLE); r != VK_SUCCESS)
+        {
+            printError("Failed to submit uploads to the transfer queue", &r);
+            return false;
+        }
+
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        VkSubmitInfo acquireSubmit{};
+        acquireSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        acquireSubmit.waitSemaphoreCount = 1;
+        acquireSubmit.pWaitSemaphores = &m_transferFinished;
+        acquireSubmit.pWaitDstStageMask = &waitStage;
+        acquireSubmit.commandBufferCount = 1;
+        acquireSubmit.pCommandBuffers = &m_graphicsCommandBuffer;
+        if (VkResult r = vkQueueSubmit(Context::getGraphicsQueue(), 1, &acquireSubmit, m_fence); r != VK_SUCCESS)
+        {
+            printError("Failed to submit upload ownership acquire", &r);
+            return false;
+        }
+    }
+
+    // Streamed images still have levels in the undefined layout until their last level is uploaded
+    for (Image* image : m_images)
+    {
+        if (image->m_uploadedMipLevels >= image->m_mipLevels)
+        {
+            image->m_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        }
+    }
+    m_bufferBarriers.clear();
+    m_imageBarriers.clear();
+    m_images.clear();
+
+    m_submitted = true;
+    return true;
+}
+
+bool UploadBatch::wait()
+{
+    if (!m_submitted)
+    {
+        return true;
+    }
+    m_submitted = false;
+
+    bool success = true;
+    if (VkResult r = vkWaitForFences(m_logicalDevice, 1, &m_fence, VK_TRUE, std::numeric_limits<uint64_t>::max()); r != VK_SUCCESS)
+    {
+        printError("Failed to wait for uploads", &r);
+        success = false;
+    }
+    reset();
+    return success;
+}
+
+bool UploadBatch::isFinished() const
+{
+    return !m_submitted || vkGetFenceStatus(m_logicalDevice, m_fence) == VK_SUCCESS;
+}
+
+bool UploadBatch::flush()
+{
+    return submit() && wait();
+}
+
+bool UploadBatch::begin()
+{
+    if (m_submitted && !wait())
+    {
+        return false;
+    }
+
+    if (m_transferCommandPool == VK_NULL_HANDLE)
+    {
+        m_logicalDevice = Context::getLogicalDevice();
+        QueueFamilyIndices indices = getQueueFamilies(Context::getPhysicalDevice(), Context::getSurface());
+        m_transferFamily = static_cast<uint32_t>(indices.transferFamily);
+        m_graphicsFamily = static_cast<uint32_t>(indices.graphicsFamily);
+        m_ownershipTransfer = m_transferFamily != m_graphicsFamily;
+
+        if (!Command::createTransferCommandPool(&m_transferCommandPool))
+        {
+            return false;
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = m_transferCommandPool;
+        allocInfo.commandBufferCount = 1;
+        if (VkResult r = vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, &m_transferCommandBuffer); r != VK_SUCCESS)
+        {
+            printError("Failed to allocate upload command buffer", &r);
+            return false;
+        }
+
+        if (m_ownershipTransfer)
+        {
+            if (!Command::createGraphicsCommandPool(&m_graphicsCommandPool))
+            {
+                return false;
+            }
+            allocInfo.commandPool = m_graphicsCommandPool;
+            if (VkResult r = vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, &m_graphicsCommandBuffer); r != VK_SUCCESS)
+            {
+                printError("Failed to allocate upload acquire command buffer", &r);
+                return false;
+            }
+
+            VkSemaphoreCreateInfo semaphoreInfo{};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            if (VkResult r = vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_transferFinished); r != VK_SUCCESS)
+            {
+                printError("Failed to create upload semaphore", &r);
+                return false;
+            }
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (VkResult r = vkCreateFence(m_logicalDevice, &fenceInfo, nullptr, &m_fence); r != VK_SUCCESS)
+        {
+            printError("Failed to create upload fence", &r);
+            return false;
+        }
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (VkResult r = vkBeginCommandBuffer(m_transferCommandBuffer, &beginInfo); r != VK_SUCCESS)
+    {
+        printError("Failed to begin upload command buffer", &r);
+        return false;
+    }
+
+    m_recording = true;
+    return true;
+}
+
+void* UploadBatch::stage(VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset)
+{
+    auto fits = [size](const StagingBlock& block) {
+        return (block.head + c_stagingAlignment - 1) / c_stagingAlignment * c_stagingAlignment + size <= block.size;
+    };
+    auto it = std::find_if(m_stagingBlocks.begin(), m_stagingBlocks.end(), fits);
+
+    if (it == m_stagingBlocks.end())
+    {
+        StagingBlock block;
+        block.size = std::max(size, Constants::stagingBlockSize);
+        block.buffer = std::make_unique<Buffer>();
+        VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        if (!block.buffer->create(block.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, properties))
+        {
+            return nullptr;
+        }
+        m_stagingBlocks.push_back(std::move(block));
+        it = std::prev(m_stagingBlocks.end());
+    }
+
+    offset = (it->head + c_stagingAlignment - 1) / c_stagingAlignment * c_stagingAlignment;
+    it->head = offset + size;
+    buffer = it->buffer->getBuffer();
+
+    // Staging memory is host coherent so writes need no flush before the submit
+    return static_cast<char*>(it->buffer->getMappedMemory()) + offset;
+}
+
+bool UploadBatch::copyToLevel(Image& dst, const ImageLevel& level)
+{
+    if (!m_recording && !begin())
+    {
+        return false;
+    }
+
+    VkBuffer stagingBuffer;
+    VkDeviceSize stagingOffset;
+    void* stagingData = stage(level.size, stagingBuffer, stagingOffset);
+    if (stagingData == nullptr)
+    {
+        return false;
+    }
+    std::memcpy(stagingData, level.data, static_cast<size_t>(level.size));
+
+    // Levels are written only once so their previous content can be discarded
+    VkImageMemoryBarrier barrier = getImageBarrier(dst.getHandle(), level.mipLevel, 1);
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    vkCmdPipelineBarrier(m_transferCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = stagingOffset;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = level.mipLevel;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {level.width, level.height, 1};
+    vkCmdCopyBufferToImage(m_transferCommandBuffer, stagingBuffer, dst.getHandle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    return true;
+}
+
+void UploadBatch::addReleaseBarrier(Image& dst, uint32_t mipLevel, VkImageLayout newLayout, VkAccessFlags dstAccessMask)
+{
+    VkImageMemoryBarrier barrier = getImageBarrier(dst.getHandle(), mipLevel, 1);
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = dstAccessMask;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = m_ownershipTransfer ? m_transferFamily : VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = m_ownershipTransfer ? m_graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+    m_imageBarriers.push_back(barrier);
+}
+
+void UploadBatch::recordMipmapGenerations(VkCommandBuffer commandBuffer)
+{
+    for (const MipmapGeneration& generation : m_mipmapGenerations)
+    {
+        if (generation.mipLevels > 1)
+        {
+            VkImageMemoryBarrier barrier = getImageBarrier(generation.image, 1, generation.mipLevels - 1);
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        }
+
+        int32_t width = static_cast<int32_t>(generation.width);
+        int32_t height = static_cast<int32_t>(generation.height);
+        for (uint32_t level = 1; level < generation.mipLevels; ++level)
+        {
+            int32_t levelWidth = std::max(width / 2, 1);
+            int32_t levelHeight = std::max(height / 2, 1);
+
+            VkImageBlit blit{};
+            blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1};
+            blit.srcOffsets[1] = {width, height, 1};
+            blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+            blit.dstOffsets[1] = {levelWidth, levelHeight, 1};
+            vkCmdBlitImage(commandBuffer,
+                           generation.image,
+                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           generation.image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1,
+                           &blit,
+                           VK_FILTER_LINEAR);
+
+            // The source level is finished and the destination becomes the source of the next blit
+            VkImageMemoryBarrier barriers[2] = {getImageBarrier(generation.image, level - 1, 1), getImageBarrier(generation.image, level, 1)};
+            barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+
+            width = levelWidth;
+            height = levelHeight;
+        }
+
+        VkImageMemoryBarrier barrier = getImageBarrier(generation.image, generation.mipLevels - 1, 1);
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+    m_mipmapGenerations.clear();
+}
+
+void UploadBatch::reset()
+{
+    vkResetCommandPool(m_logicalDevice, m_transferCommandPool, 0);
+    if (m_graphicsCommandPool != VK_NULL_HANDLE)
+    {
+        vkResetCommandPool(m_logicalDevice, m_graphicsCommandPool, 0);
+    }
+    vkResetFences(m_logicalDevice, 1, &m_fence);
+
+    // Keep one block around for the next batch and release the rest
+    if (m_stagingBlocks.size() > 1)
+    {
+        m_stagingBlocks.resize(1);
+    }
+    for (StagingBlock& block : m_stagingBlocks)
+    {
+        block.head = 0;
+    }
+}
+
+} // namespace fw
@@ -6,8 +6,11 @@ namespace fw
 {
 Window::~Window()
 {
-    vkDestroySurfaceKHR(Context::getInstance(), m_surface, nullptr);
-    glfwDestroyWindow(m_window);
+    if (m_window != nullptr)
+    {
+        vkDestroySurfaceKHR(Context::getInstance(), m_surface, nullptr);
+        glfwDestroyWindow(m_window);
+    }
     glfwTerminate();
 }
 